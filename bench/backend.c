@@ -0,0 +1,327 @@
+/*
+ *  OpenLDAP pwdPolicy/shadowAccount Overlay
+ *  Copyright (c) 2023 David M. Syzdek <david@syzdek.net>
+ *  All rights reserved.
+ *
+ *  Dominus vobiscum. Et cum spiritu tuo.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted only as authorized by the OpenLDAP
+ *  Public License.
+ *
+ *  A copy of this license is available in the file LICENSE in the
+ *  top-level directory of the distribution or, alternatively, at
+ *  <http://www.OpenLDAP.org/license.html>.
+ */
+/*
+ *  Database of the benchmarks. Entries added with stub_entry_add() are
+ *  returned by be_entry_get_rw() and searched by stub_search(), DNs are
+ *  expected to be normalized when entries are created and attribute types
+ *  are limited to the schema used by the benchmarks.
+ */
+#include "portable.h"
+
+///////////////
+//           //
+//  Headers  //
+//           //
+///////////////
+
+#include <ldap.h>
+#include "slap.h"
+#include "stub.h"
+
+
+///////////////////
+//               //
+//  Definitions  //
+//               //
+///////////////////
+
+// entries which may be added with stub_entry_add()
+#define STUB_ENTRIES_MAX		4096
+
+
+//////////////////
+//              //
+//  Data Types  //
+//              //
+//////////////////
+
+typedef struct stub_at_t
+{
+	const char *			sa_name;
+	const char *			sa_syntax;
+} stub_at_t;
+
+
+/////////////////
+//             //
+//  Variables  //
+//             //
+/////////////////
+
+// backend and entries returned by be_entry_get_rw() and select_backend()
+static BackendDB *			stub_be				= NULL;
+static Entry *				stub_entries[STUB_ENTRIES_MAX];
+static int					stub_entries_count	= 0;
+
+// attributes provided by other schema
+static const stub_at_t		stub_schema[] =
+{
+	// core schema
+	{ "objectClass",		"1.3.6.1.4.1.1466.115.121.1.38" },
+	{ "cn",					"1.3.6.1.4.1.1466.115.121.1.15" },
+	{ "sn",					"1.3.6.1.4.1.1466.115.121.1.15" },
+	{ "uid",				"1.3.6.1.4.1.1466.115.121.1.15" },
+	{ "mail",				"1.3.6.1.4.1.1466.115.121.1.26" },
+	{ "description",		"1.3.6.1.4.1.1466.115.121.1.15" },
+	{ "userPassword",		"1.3.6.1.4.1.1466.115.121.1.40" },
+	{ "modifyTimestamp",	"1.3.6.1.4.1.1466.115.121.1.24" },
+
+	// slapo-ppolicy
+	{ "pwdChangedTime",		"1.3.6.1.4.1.1466.115.121.1.24" },
+	{ "pwdEndTime",			"1.3.6.1.4.1.1466.115.121.1.24" },
+	{ "pwdExpireWarning",	SLAPD_INTEGER_SYNTAX },
+	{ "pwdGraceExpiry",		SLAPD_INTEGER_SYNTAX },
+	{ "pwdMaxAge",			SLAPD_INTEGER_SYNTAX },
+	{ "pwdMinAge",			SLAPD_INTEGER_SYNTAX },
+	{ "pwdPolicySubentry",	SLAPD_DN_SYNTAX },
+
+	// RFC 2307
+	{ "uidNumber",			SLAPD_INTEGER_SYNTAX },
+	{ "gidNumber",			SLAPD_INTEGER_SYNTAX },
+	{ "homeDirectory",		"1.3.6.1.4.1.1466.115.121.1.26" },
+	{ "loginShell",			"1.3.6.1.4.1.1466.115.121.1.26" },
+	{ "shadowExpire",		SLAPD_INTEGER_SYNTAX },
+	{ "shadowFlag",			SLAPD_INTEGER_SYNTAX },
+	{ "shadowInactive",		SLAPD_INTEGER_SYNTAX },
+	{ "shadowLastChange",	SLAPD_INTEGER_SYNTAX },
+	{ "shadowMax",			SLAPD_INTEGER_SYNTAX },
+	{ "shadowMin",			SLAPD_INTEGER_SYNTAX },
+	{ "shadowWarning",		SLAPD_INTEGER_SYNTAX },
+
+	{ NULL, NULL }
+};
+
+
+/////////////////
+//             //
+//  Functions  //
+//             //
+/////////////////
+
+int
+be_entry_get_rw(
+		Operation *					op,
+		struct berval *				ndn,
+		ObjectClass *				oc,
+		AttributeDescription *		at,
+		int							rw,
+		Entry **					e )
+{
+	int				idx;
+
+	for(idx = 0; idx < stub_entries_count; idx++)
+	{
+		if (!(bvmatch(&stub_entries[idx]->e_nname, ndn)))
+			continue;
+		*e = stub_entries[idx];
+		return(LDAP_SUCCESS);
+	};
+
+	if ( (!(op)) || ((oc)) || ((at)) || ((rw)) )
+		return(LDAP_NO_SUCH_OBJECT);
+	return(LDAP_NO_SUCH_OBJECT);
+}
+
+
+int
+be_entry_release_r(
+		Operation *					op,
+		Entry *						e )
+{
+	if ( (!(op)) || (!(e)) )
+		return(0);
+	return(0);
+}
+
+
+int
+dnIsSuffix(
+		struct berval *				dn,
+		struct berval *				suffix )
+{
+	ber_len_t		off;
+
+	if (dn->bv_len < suffix->bv_len)
+		return(0);
+	if (!(suffix->bv_len))
+		return(1);
+	off = dn->bv_len - suffix->bv_len;
+	if ( ((off)) && (dn->bv_val[off-1] != ',') )
+		return(0);
+	return(!(memcmp(&dn->bv_val[off], suffix->bv_val, suffix->bv_len)));
+}
+
+
+int
+dnNormalize(
+		slap_mask_t					use,
+		Syntax *					syntax,
+		MatchingRule *				mr,
+		struct berval *				val,
+		struct berval *				out,
+		void *						ctx )
+{
+	ber_dupbv(out, val);
+	if ( ((use)) || ((syntax)) || ((mr)) || ((ctx)) )
+		return(LDAP_SUCCESS);
+	return(LDAP_SUCCESS);
+}
+
+
+void
+dnParent(
+		struct berval *				dn,
+		struct berval *				pdn )
+{
+	char *			p;
+
+	if ((p = memchr(dn->bv_val, ',', dn->bv_len)) == NULL)
+	{
+		pdn->bv_val = &dn->bv_val[dn->bv_len];
+		pdn->bv_len = 0;
+		return;
+	};
+	pdn->bv_val = p + 1;
+	pdn->bv_len = dn->bv_len - (pdn->bv_val - dn->bv_val);
+	return;
+}
+
+
+BackendDB *
+select_backend(
+		struct berval *				dn,
+		int							noSubordinates )
+{
+	if ( (!(dn)) || ((noSubordinates)) )
+		return(stub_be);
+	return(stub_be);
+}
+
+
+int
+slap_str2ad(
+		const char *				name,
+		AttributeDescription **		ad,
+		const char **				text )
+{
+	int				idx;
+
+	*text = NULL;
+
+	if ((*ad = stub_ad_find(name)) != NULL)
+		return(LDAP_SUCCESS);
+
+	for(idx = 0; ((stub_schema[idx].sa_name)); idx++)
+	{
+		if (!(strcasecmp(stub_schema[idx].sa_name, name)))
+		{
+			*ad = stub_ad_new(stub_schema[idx].sa_name, strlen(stub_schema[idx].sa_name), stub_schema[idx].sa_syntax, 0);
+			return(LDAP_SUCCESS);
+		};
+	};
+
+	*text = "attribute type undefined";
+	return(LDAP_UNDEFINED_TYPE);
+}
+
+
+int
+stub_backend(
+		BackendDB *					be )
+{
+	stub_be = be;
+	return(0);
+}
+
+
+int
+stub_entry_add(
+		Entry *						e )
+{
+	if (stub_entries_count >= STUB_ENTRIES_MAX)
+		return(-1);
+	stub_entries[stub_entries_count++] = e;
+	return(0);
+}
+
+
+// entry is no longer returned, the caller frees it
+int
+stub_entry_remove(
+		Entry *						e )
+{
+	int				idx;
+
+	for(idx = 0; idx < stub_entries_count; idx++)
+	{
+		if (stub_entries[idx] != e)
+			continue;
+		stub_entries[idx] = stub_entries[--stub_entries_count];
+		return(0);
+	};
+
+	return(-1);
+}
+
+
+// search of the entries added with stub_entry_add() within the scope of the
+// request, filters are evaluated by test_filter()
+int
+stub_search(
+		Operation *					op,
+		SlapReply *					rs )
+{
+	int						idx;
+	int						rc;
+	struct berval			parent;
+	Entry *					e;
+
+	for(idx = 0; idx < stub_entries_count; idx++)
+	{
+		e = stub_entries[idx];
+		switch(op->ors_scope)
+		{
+			case LDAP_SCOPE_BASE:
+			rc = bvmatch(&e->e_nname, &op->o_req_ndn);
+			break;
+
+			case LDAP_SCOPE_ONELEVEL:
+			dnParent(&e->e_nname, &parent);
+			rc = bvmatch(&parent, &op->o_req_ndn);
+			break;
+
+			default:
+			rc = dnIsSuffix(&e->e_nname, &op->o_req_ndn);
+			break;
+		};
+		if ( (!(rc)) || (test_filter(op, e, op->ors_filter) != LDAP_COMPARE_TRUE) )
+			continue;
+		rs->sr_type		= REP_SEARCH;
+		rs->sr_entry	= e;
+		rs->sr_attrs	= op->ors_attrs;
+		rs->sr_err		= LDAP_SUCCESS;
+		send_search_entry(op, rs);
+	};
+
+	rs->sr_entry	= NULL;
+	rs->sr_attrs	= NULL;
+	rs->sr_err		= LDAP_SUCCESS;
+	send_ldap_result(op, rs);
+
+	return(rs->sr_err);
+}
+
+/* end of source file */
@@ -0,0 +1,1984 @@
+/*
+ *  OpenLDAP pwdPolicy/shadowAccount Overlay
+ *  Copyright (c) 2023 David M. Syzdek <david@syzdek.net>
+ *  All rights reserved.
+ *
+ *  Dominus vobiscum. Et cum spiritu tuo.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted only as authorized by the OpenLDAP
+ *  Public License.
+ *
+ *  A copy of this license is available in the file LICENSE in the
+ *  top-level directory of the distribution or, alternatively, at
+ *  <http://www.OpenLDAP.org/license.html>.
+ */
+/*
+ *  Microbenchmarks of the overlay's evaluation path. The overlay is included
+ *  directly so that its static functions may be measured and is linked with
+ *  the slapd stub in bench/stub.c. Results are written as tab separated
+ *  values:
+ *
+ *     benchmark <TAB> iterations <TAB> ns/op <TAB> allocs/op <TAB> tmpallocs/op
+ *
+ *  allocs/op counts heap allocations and tmpallocs/op counts allocations
+ *  from the operation's memory context (the thread's slab in slapd).
+ *
+ *  Before benchmarking, the integer and GeneralizedTime parsers are verified
+ *  against every date of years 0001 through 9999, and the filters and
+ *  entries of searches passed through the overlay, including searches
+ *  answered by the tuple cache, and the pages of the expiry index after
+ *  writes are compared with expected values.
+ */
+#include "../pwdshadow.c"
+
+///////////////
+//           //
+//  Headers  //
+//           //
+///////////////
+
+#include <getopt.h>
+#include "stub.h"
+
+
+///////////////////
+//               //
+//  Definitions  //
+//               //
+///////////////////
+
+#define BENCH_ITERATIONS		100000
+#define BENCH_USER_DN			"uid=jdoe,ou=people,dc=example,dc=com"
+#define BENCH_POLICY_DN			"cn=standard,ou=policies,dc=example,dc=com"
+#define BENCH_SUFFIX			"dc=example,dc=com"
+#define BENCH_ROOTDN			"cn=manager,dc=example,dc=com"
+#define BENCH_STAFF_DN			"uid=jdoe,ou=staff,ou=people,dc=example,dc=com"
+
+
+//////////////////
+//              //
+//  Data Types  //
+//              //
+//////////////////
+
+typedef struct bench_t
+{
+	long					bn_iterations;
+	Entry *					bn_user;
+	Entry *					bn_policy;
+	slap_overinst			bn_on;
+	BackendInfo				bn_bi;
+	BackendDB				bn_be;
+	pwdshadow_t *			bn_ps;
+	struct berval			bn_suffix[2];
+	struct berval			bn_nsuffix[2];
+} bench_t;
+
+
+typedef struct bench_timer_t
+{
+	struct timespec			bt_start;
+	unsigned long			bt_allocs;
+	unsigned long			bt_tmpallocs;
+} bench_timer_t;
+
+
+//////////////////
+//              //
+//  Prototypes  //
+//              //
+//////////////////
+
+static int
+bench_attr_find(
+		bench_t *					bn );
+
+
+static int
+bench_backend_search(
+		Operation *					op,
+		SlapReply *					rs );
+
+
+static int
+bench_eval(
+		bench_t *					bn,
+		const char *				name,
+		int							slot );
+
+
+static int
+bench_expiry_check(
+		bench_t *					bn,
+		const char *				step,
+		const char *				query,
+		int							rc,
+		int							pages,
+		const char *				value );
+
+
+static int
+bench_get_attrs(
+		bench_t *					bn );
+
+
+static Entry *
+bench_entry_user(
+		const char *				dn );
+
+
+static int
+bench_op(
+		bench_t *					bn,
+		OperationBuffer *			opbuf );
+
+
+static int
+bench_op_add(
+		bench_t *					bn );
+
+
+static int
+bench_op_modify(
+		bench_t *					bn,
+		const char *				name,
+		const char *				attr );
+
+
+static int
+bench_op_password(
+		bench_t *					bn,
+		const char *				name,
+		long						iterations,
+		int							count,
+		char *						date,
+		size_t						size );
+
+
+static int
+bench_op_replicated(
+		bench_t *					bn,
+		const char *				name,
+		int							trust,
+		int							count );
+
+
+static int
+bench_operational(
+		bench_t *					bn );
+
+
+static int
+bench_operational_free(
+		bench_t *					bn,
+		Attribute **				attrs );
+
+
+static int
+bench_parse_int(
+		bench_t *					bn );
+
+
+static int
+bench_parse_time(
+		bench_t *					bn );
+
+
+static int
+bench_scan_attrs(
+		bench_t *					bn );
+
+
+static int
+bench_set(
+		bench_t *					bn,
+		const char *				name,
+		int							slot,
+		const char *				value );
+
+
+static int
+bench_setup(
+		bench_t *					bn );
+
+
+static void
+bench_start(
+		bench_timer_t *				bt );
+
+
+static void
+bench_stop(
+		bench_timer_t *				bt,
+		const char *				name,
+		long						iterations );
+
+
+static int
+bench_subtree(
+		bench_t *					bn );
+
+
+static int
+bench_subtree_cfg(
+		bench_t *					bn,
+		int							op,
+		int							valx,
+		const char *				suffix,
+		const char *				policy );
+
+
+static int
+bench_tuple_check(
+		bench_t *					bn,
+		const char *				step,
+		const char *				key,
+		int							loads,
+		int							passed,
+		const char *				value );
+
+
+static int
+bench_tuple_collect(
+		Operation *					op,
+		SlapReply *					rs );
+
+
+static Entry *
+bench_tuple_entry(
+		const char *				uid,
+		const char *				max );
+
+
+static void
+bench_usage(
+		void );
+
+
+static int
+bench_verify_expiry(
+		bench_t *					bn );
+
+
+static int
+bench_verify_filter(
+		bench_t *					bn );
+
+
+static int
+bench_verify_int(
+		void );
+
+
+static int
+bench_verify_lastchange(
+		bench_t *					bn );
+
+
+static int
+bench_verify_subtree(
+		bench_t *					bn );
+
+
+static int
+bench_verify_time(
+		void );
+
+
+static int
+bench_verify_tuple(
+		bench_t *					bn );
+
+
+static int
+bench_write(
+		bench_t *					bn,
+		ber_tag_t					tag,
+		Entry *						e,
+		const char *				attr,
+		const char *				value );
+
+
+/////////////////
+//             //
+//  Variables  //
+//             //
+/////////////////
+
+static volatile int				bench_sink;
+
+// searches of the backend by pwdshadow_tuple_load() and searches passed to
+// the backend by the overlay
+static int						bench_loads;
+static int						bench_passed;
+
+
+/////////////////
+//             //
+//  Functions  //
+//             //
+/////////////////
+
+int
+main(
+		int							argc,
+		char *						argv[] )
+{
+	int						c;
+	bench_t					bn;
+	ConfigReply				cr;
+
+	memset(&bn, 0, sizeof(bn));
+	bn.bn_iterations = BENCH_ITERATIONS;
+
+	while((c = getopt(argc, argv, "c:hn:")) != -1)
+	{
+		switch(c)
+		{
+			case 'c':
+			stub_clock = (time_t)strtoll(optarg, NULL, 10);
+			break;
+
+			case 'h':
+			bench_usage();
+			return(0);
+
+			case 'n':
+			if ((bn.bn_iterations = strtol(optarg, NULL, 10)) < 1)
+			{
+				fprintf(stderr, "pwdshadow-bench: invalid number of iterations\n");
+				return(1);
+			};
+			break;
+
+			default:
+			fprintf(stderr, "Try `pwdshadow-bench -h' for more information.\n");
+			return(1);
+		};
+	};
+
+	if ((bench_setup(&bn)))
+		return(1);
+
+	printf("# pwdshadow benchmark\n");
+	printf("# clock: %lld\n", (long long)stub_clock);
+	if ( ((bench_verify_int())) || ((bench_verify_time())) || ((bench_verify_subtree(&bn))) ||
+	     ((bench_verify_lastchange(&bn))) || ((bench_verify_filter(&bn))) || ((bench_verify_tuple(&bn))) ||
+	     ((bench_verify_expiry(&bn))) )
+		return(1);
+	printf("benchmark\titerations\tns/op\tallocs/op\ttmpallocs/op\n");
+
+	bench_op_add(&bn);
+	bench_op_modify(&bn, "op_modify_relevant",   "userPassword");
+	bench_op_modify(&bn, "op_modify_irrelevant", "description");
+	bench_op_password(&bn, "op_modify_changedtime", bn.bn_iterations, 2, NULL, 0);
+	bench_op_replicated(&bn, "op_replicated_clock",    0, 2);
+	bench_op_replicated(&bn, "op_replicated_evaluate", 0, 3);
+	bench_op_replicated(&bn, "op_replicated_trust",    1, 4);
+	bench_get_attrs(&bn);
+	bench_scan_attrs(&bn);
+	bench_attr_find(&bn);
+	bench_set(&bn, "set_bool",    PWDSHADOW_SL_pwdShadowGenerate,	"TRUE");
+	bench_set(&bn, "set_days",    PWDSHADOW_SL_shadowMax,			"90");
+	bench_set(&bn, "set_exists",  PWDSHADOW_SL_userPassword,		"{SSHA}x");
+	bench_set(&bn, "set_integer", PWDSHADOW_SL_shadowFlag,			"0");
+	bench_set(&bn, "set_secs",    PWDSHADOW_SL_pwdMaxAge,			"7776000");
+	bench_set(&bn, "set_time",    PWDSHADOW_SL_pwdChangedTime,		"20230415120000Z");
+	bench_parse_int(&bn);
+	bench_parse_time(&bn);
+	bench_eval(&bn, "eval_password",	PWDSHADOW_SL_userPassword);
+	bench_eval(&bn, "eval_shadowflag",	PWDSHADOW_SL_shadowFlag);
+	bench_eval(&bn, "eval_generate",	PWDSHADOW_SL_pwdShadowGenerate);
+	bench_operational(&bn);
+	bench_subtree(&bn);
+
+	memset(&cr, 0, sizeof(cr));
+	pwdshadow_db_close(&bn.bn_be, &cr);
+	pwdshadow_db_destroy(&bn.bn_be, &cr);
+	stub_entry_free(bn.bn_user);
+	stub_entry_free(bn.bn_policy);
+
+	return(0);
+}
+
+
+int
+bench_attr_find(
+		bench_t *					bn )
+{
+	long					n;
+	int						idx;
+	Attribute *				a;
+	pwdshadow_state_t		st;
+	bench_timer_t			bt;
+
+	// retrieves entry attributes with one attr_find() per tracked attribute
+	bench_start(&bt);
+	for(n = 0; n < bn->bn_iterations; n++)
+	{
+		pwdshadow_state_initialize(&st, pwdshadow_cfg_get(bn->bn_ps));
+		for(idx = 0; ((pwdshadow_slots[idx].sl_ad)); idx++)
+		{
+			if (!(pwdshadow_slots[idx].sl_scan & PWDSHADOW_SCAN_ENTRY))
+				continue;
+			if ( (!(st.st_cfg->cf_ads[idx])) || ((a = attr_find(bn->bn_user->e_attrs, st.st_cfg->cf_ads[idx])) == NULL) )
+				continue;
+			pwdshadow_set(&st, idx, &a->a_nvals[0], PWDSHADOW_FLG_EXISTS);
+		};
+		bench_sink += st.st_prev[PWDSHADOW_SL_pwdChangedTime];
+	};
+	bench_stop(&bt, "attr_find", bn->bn_iterations);
+
+	return(0);
+}
+
+
+// backend of the database, searches are counted before the stub answers
+int
+bench_backend_search(
+		Operation *					op,
+		SlapReply *					rs )
+{
+	if ( ((op->o_callback)) && (op->o_callback->sc_response == pwdshadow_tuple_collect) )
+		bench_loads++;
+	else
+		bench_passed++;
+	return(stub_search(op, rs));
+}
+
+
+Entry *
+bench_entry_user(
+		const char *				dn )
+{
+	Entry *			e;
+
+	e = stub_entry_new(dn);
+	stub_entry_set(e, "objectClass",		"inetOrgPerson");
+	stub_entry_set(e, "objectClass",		"posixAccount");
+	stub_entry_set(e, "objectClass",		"shadowAccount");
+	stub_entry_set(e, "uid",				"jdoe");
+	stub_entry_set(e, "cn",					"John Doe");
+	stub_entry_set(e, "sn",					"Doe");
+	stub_entry_set(e, "mail",				"jdoe@example.com");
+	stub_entry_set(e, "uidNumber",			"1000");
+	stub_entry_set(e, "gidNumber",			"1000");
+	stub_entry_set(e, "homeDirectory",		"/home/jdoe");
+	stub_entry_set(e, "loginShell",			"/bin/sh");
+	stub_entry_set(e, "userPassword",		"{SSHA}AAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAA");
+	stub_entry_set(e, "pwdChangedTime",		"20230301120000Z");
+	stub_entry_set(e, "pwdShadowGenerate",	"TRUE");
+
+	return(e);
+}
+
+
+int
+bench_eval(
+		bench_t *					bn,
+		const char *				name,
+		int							slot )
+{
+	long					n;
+	OperationBuffer			opbuf;
+	pwdshadow_state_t		st;
+	pwdshadow_state_t		st0;
+	bench_timer_t			bt;
+
+	bench_op(bn, &opbuf);
+
+	// evaluate entry as if the attribute was replaced
+	pwdshadow_state_initialize(&st0, pwdshadow_cfg_get(bn->bn_ps));
+	pwdshadow_get_attrs(&st0, bn->bn_user, PWDSHADOW_FLG_EXISTS);
+	st0.st_useradd |= pwdshadow_bit(slot);
+
+	bench_start(&bt);
+	for(n = 0; n < bn->bn_iterations; n++)
+	{
+		st = st0;
+		pwdshadow_eval(&opbuf.ob_op, &st);
+		bench_sink += st.st_post[PWDSHADOW_SL_pwdShadowMax];
+	};
+	bench_stop(&bt, name, bn->bn_iterations);
+
+	return(0);
+}
+
+
+// queries the expiry index as the rootdn through the extended operation,
+// requests the page following the last line of a page until a page is empty
+// and compares the result, the number of pages and the pages separated by "|"
+int
+bench_expiry_check(
+		bench_t *					bn,
+		const char *				step,
+		const char *				query,
+		int							rc,
+		int							pages,
+		const char *				value )
+{
+	int						err;
+	int						count;
+	size_t					len;
+	char *					eol;
+	char					req[256];
+	char					buff[1024];
+	struct berval			bv;
+	BackendDB				db;
+	slap_overinfo			oi;
+	OperationBuffer			opbuf;
+	SlapReply				rs;
+
+	// select_backend() returns the database stacked on the overlay
+	memset(&oi, 0, sizeof(oi));
+	oi.oi_bi.bi_type	= "over";
+	oi.oi_list			= &bn->bn_on;
+	db					= bn->bn_be;
+	db.bd_info			= (BackendInfo *)&oi;
+	stub_backend(&db);
+
+	buff[0] = '\0';
+	snprintf(req, sizeof(req), "%s", query);
+	for(count = 0, len = 0; len < sizeof(buff); count++)
+	{
+		bench_op(bn, &opbuf);
+		opbuf.ob_op.o_tag		= LDAP_REQ_EXTENDED;
+		opbuf.ob_op.ore_reqdata	= ber_str2bv(req, 0, 0, &bv);
+		memset(&rs, 0, sizeof(rs));
+		if ( ((err = pwdshadow_expiry_extop(&opbuf.ob_op, &rs)) != LDAP_SUCCESS) || (!(rs.sr_rspdata)) )
+			break;
+		len += snprintf(&buff[len], sizeof(buff) - len, "%s%.*s", ((count)) ? "|" : "", (int)rs.sr_rspdata->bv_len, rs.sr_rspdata->bv_val);
+		rs.sr_rspdata->bv_val[rs.sr_rspdata->bv_len - 1] = '\0';
+		eol = strrchr(rs.sr_rspdata->bv_val, '\n');
+		snprintf(req, sizeof(req), "%s\n%s", query, ((eol)) ? &eol[1] : rs.sr_rspdata->bv_val);
+		ch_free(rs.sr_rspdata->bv_val);
+		ch_free(rs.sr_rspdata);
+	};
+	stub_backend(&bn->bn_be);
+
+	if ( (err != rc) || (count != pages) || ((strcmp(buff, value))) )
+	{
+		fprintf(stderr, "pwdshadow-bench: expiry index %s returned %i with %i pages \"%s\", failed verification\n", step, err, count, buff);
+		return(1);
+	};
+
+	return(0);
+}
+
+
+int
+bench_get_attrs(
+		bench_t *					bn )
+{
+	long					n;
+	pwdshadow_state_t		st;
+	bench_timer_t			bt;
+
+	bench_start(&bt);
+	for(n = 0; n < bn->bn_iterations; n++)
+	{
+		pwdshadow_state_initialize(&st, pwdshadow_cfg_get(bn->bn_ps));
+		pwdshadow_get_attrs(&st, bn->bn_user, PWDSHADOW_FLG_EXISTS);
+		bench_sink += st.st_prev[PWDSHADOW_SL_pwdChangedTime];
+	};
+	bench_stop(&bt, "get_attrs", bn->bn_iterations);
+
+	return(0);
+}
+
+
+int
+bench_op(
+		bench_t *					bn,
+		OperationBuffer *			opbuf )
+{
+	stub_op_init(opbuf);
+	opbuf->ob_op.o_bd			= &bn->bn_be;
+	opbuf->ob_op.o_dn			= bn->bn_be.be_rootdn;
+	opbuf->ob_op.o_ndn			= bn->bn_be.be_rootndn;
+	opbuf->ob_op.o_req_dn		= bn->bn_user->e_name;
+	opbuf->ob_op.o_req_ndn		= bn->bn_user->e_nname;
+	return(0);
+}
+
+
+int
+bench_op_add(
+		bench_t *					bn )
+{
+	long					n;
+	Entry **				entries;
+	OperationBuffer			opbuf;
+	SlapReply				rs;
+	bench_timer_t			bt;
+
+	bench_op(bn, &opbuf);
+	opbuf.ob_op.o_tag = LDAP_REQ_ADD;
+	memset(&rs, 0, sizeof(rs));
+
+	// entries are prepared before timing since op_add() modifies the entry
+	entries = calloc((size_t)bn->bn_iterations, sizeof(Entry *));
+	for(n = 0; n < bn->bn_iterations; n++)
+		entries[n] = bench_entry_user(BENCH_USER_DN);
+
+	bench_start(&bt);
+	for(n = 0; n < bn->bn_iterations; n++)
+	{
+		opbuf.ob_op.ora_e = entries[n];
+		pwdshadow_op_add(&opbuf.ob_op, &rs);
+	};
+	bench_stop(&bt, "op_add", bn->bn_iterations);
+
+	for(n = 0; n < bn->bn_iterations; n++)
+		stub_entry_free(entries[n]);
+	free(entries);
+
+	return(0);
+}
+
+
+int
+bench_op_modify(
+		bench_t *					bn,
+		const char *				name,
+		const char *				attr )
+{
+	long					n;
+	const char *			text;
+	Modifications			mod;
+	OperationBuffer			opbuf;
+	SlapReply				rs;
+	struct berval			vals[2];
+	bench_timer_t			bt;
+
+	bench_op(bn, &opbuf);
+	opbuf.ob_op.o_tag = LDAP_REQ_MODIFY;
+	memset(&rs, 0, sizeof(rs));
+
+	// replace a single value of the attribute
+	memset(&mod, 0, sizeof(mod));
+	ber_str2bv("{SSHA}BBBBBBBBBBBBBBBBBBBBBBBBBBBBBBBB", 0, 0, &vals[0]);
+	BER_BVZERO(&vals[1]);
+	slap_str2ad(attr, &mod.sml_desc, &text);
+	mod.sml_op			= LDAP_MOD_REPLACE;
+	mod.sml_type		= mod.sml_desc->ad_cname;
+	mod.sml_numvals		= 1;
+	mod.sml_values		= vals;
+	mod.sml_nvalues		= vals;
+
+	// callbacks are played as when slapd completes the operation
+	bench_start(&bt);
+	for(n = 0; n < bn->bn_iterations; n++)
+	{
+		mod.sml_next				= NULL;
+		opbuf.ob_op.orm_modlist		= &mod;
+		opbuf.ob_op.o_callback		= NULL;
+		pwdshadow_op_modify(&opbuf.ob_op, &rs);
+		slap_cleanup_play(&opbuf.ob_op, &rs);
+	};
+	bench_stop(&bt, name, bn->bn_iterations);
+
+	return(0);
+}
+
+
+int
+bench_op_password(
+		bench_t *					bn,
+		const char *				name,
+		long						iterations,
+		int							count,
+		char *						date,
+		size_t						size )
+{
+	long					n;
+	int						idx;
+	const char *			text;
+	Modifications			mods[2];
+	Modifications *			mod;
+	OperationBuffer			opbuf;
+	SlapReply				rs;
+	struct berval			vals[2][2];
+	bench_timer_t			bt;
+	static const char *		attrs[2][2] =
+	{
+		{ "userPassword",			"{SSHA}BBBBBBBBBBBBBBBBBBBBBBBBBBBBBBBB" },
+		{ "pwdChangedTime",			"20230101000000Z" },
+	};
+
+	bench_op(bn, &opbuf);
+	opbuf.ob_op.o_tag = LDAP_REQ_MODIFY;
+	memset(&rs, 0, sizeof(rs));
+
+	// password change by a client, with a count of 2 the pwdChangedTime
+	// appended by slapo-ppolicy running before the overlay is included
+	memset(mods, 0, sizeof(mods));
+	for(idx = 0; idx < 2; idx++)
+	{
+		ber_str2bv(attrs[idx][1], 0, 0, &vals[idx][0]);
+		BER_BVZERO(&vals[idx][1]);
+		slap_str2ad(attrs[idx][0], &mods[idx].sml_desc, &text);
+		mods[idx].sml_op		= LDAP_MOD_REPLACE;
+		mods[idx].sml_type		= mods[idx].sml_desc->ad_cname;
+		mods[idx].sml_numvals	= 1;
+		mods[idx].sml_values	= vals[idx];
+		mods[idx].sml_nvalues	= vals[idx];
+	};
+
+	// generated pwdShadowLastChange is copied before the callbacks release it
+	if ((date))
+		snprintf(date, size, "-");
+	bench_start(&bt);
+	for(n = 0; n < iterations; n++)
+	{
+		for(idx = 0; idx < count; idx++)
+			mods[idx].sml_next = (idx < (count - 1)) ? &mods[idx+1] : NULL;
+		opbuf.ob_op.orm_modlist		= &mods[0];
+		opbuf.ob_op.o_callback		= NULL;
+		pwdshadow_op_modify(&opbuf.ob_op, &rs);
+		for(mod = mods[count-1].sml_next; ( ((date)) && ((mod)) ); mod = mod->sml_next)
+			if (mod->sml_desc == ad_pwdShadowLastChange)
+				snprintf(date, size, "%s", mod->sml_values[0].bv_val);
+		slap_cleanup_play(&opbuf.ob_op, &rs);
+	};
+	if ((name))
+		bench_stop(&bt, name, iterations);
+
+	return(0);
+}
+
+
+int
+bench_op_replicated(
+		bench_t *					bn,
+		const char *				name,
+		int							trust,
+		int							count )
+{
+	long					n;
+	long					extra;
+	int						idx;
+	char					date[16];
+	const char *			text;
+	Modifications			mods[4];
+	Modifications *			mod;
+	OperationBuffer			opbuf;
+	SlapReply				rs;
+	struct berval			vals[4][2];
+	bench_timer_t			bt;
+	static const char *		attrs[4][2] =
+	{
+		{ "userPassword",			"{SSHA}BBBBBBBBBBBBBBBBBBBBBBBBBBBBBBBB" },
+		{ "pwdChangedTime",			"20230101000000Z" },
+		{ "modifyTimestamp",		"20230101000000Z" },
+		{ "pwdShadowLastChange",	"19358" },
+	};
+
+	bench_op(bn, &opbuf);
+	opbuf.ob_op.o_tag = LDAP_REQ_MODIFY;
+	memset(&rs, 0, sizeof(rs));
+
+	// password change made by the provider months before the local clock and
+	// replayed by syncrepl, the first count modifications are replicated:
+	// without modifyTimestamp dates are derived from the local clock and with
+	// pwdShadowLastChange the value generated by the provider is included
+	memset(mods, 0, sizeof(mods));
+	for(idx = 0; idx < 4; idx++)
+	{
+		ber_str2bv(attrs[idx][1], 0, 0, &vals[idx][0]);
+		BER_BVZERO(&vals[idx][1]);
+		slap_str2ad(attrs[idx][0], &mods[idx].sml_desc, &text);
+		mods[idx].sml_op		= LDAP_MOD_REPLACE;
+		mods[idx].sml_type		= mods[idx].sml_desc->ad_cname;
+		mods[idx].sml_numvals	= 1;
+		mods[idx].sml_values	= vals[idx];
+		mods[idx].sml_nvalues	= vals[idx];
+	};
+
+	stub_shadow_update					= 1;
+	bn->bn_ps->ps_trust_replication		= trust;
+	pwdshadow_cfg_publish(bn->bn_ps);
+
+	// modifications appended to the replicated change are counted before the
+	// callbacks release them
+	extra	= 0;
+	strcpy(date, "-");
+	bench_start(&bt);
+	for(n = 0; n < bn->bn_iterations; n++)
+	{
+		for(idx = 0; idx < count; idx++)
+			mods[idx].sml_next = (idx < (count - 1)) ? &mods[idx+1] : NULL;
+		opbuf.ob_op.orm_modlist		= &mods[0];
+		opbuf.ob_op.o_callback		= NULL;
+		pwdshadow_op_modify(&opbuf.ob_op, &rs);
+		for(mod = mods[count-1].sml_next; ((mod)); mod = mod->sml_next, extra++)
+			if (mod->sml_desc == ad_pwdShadowLastChange)
+				snprintf(date, sizeof(date), "%s", mod->sml_values[0].bv_val);
+		slap_cleanup_play(&opbuf.ob_op, &rs);
+	};
+	bench_stop(&bt, name, bn->bn_iterations);
+	printf("# %s: %.2f modifications/op added to replicated change, pwdShadowLastChange: %s\n", name, (double)extra / (double)bn->bn_iterations, date);
+
+	stub_shadow_update					= 0;
+	bn->bn_ps->ps_trust_replication		= 1;
+	pwdshadow_cfg_publish(bn->bn_ps);
+
+	return(0);
+}
+
+
+int
+bench_operational(
+		bench_t *					bn )
+{
+	long					n;
+	Attribute **			attrs;
+	OperationBuffer			opbuf;
+	SlapReply				rs;
+	bench_timer_t			bt;
+
+	bench_op(bn, &opbuf);
+	opbuf.ob_op.o_tag = LDAP_REQ_SEARCH;
+
+	// generated attributes are freed after timing
+	attrs = calloc((size_t)bn->bn_iterations, sizeof(Attribute *));
+
+	// read entry with all operational attributes in virtual mode
+	bn->bn_ps->ps_mode = PWDSHADOW_MODE_VIRTUAL;
+	pwdshadow_cfg_publish(bn->bn_ps);
+	bench_start(&bt);
+	for(n = 0; n < bn->bn_iterations; n++)
+	{
+		memset(&rs, 0, sizeof(rs));
+		rs.sr_type			= REP_SEARCH;
+		rs.sr_entry			= bn->bn_user;
+		rs.sr_attr_flags	= SLAP_OPATTRS(~0UL);
+		pwdshadow_operational(&opbuf.ob_op, &rs);
+		attrs[n]			= rs.sr_operational_attrs;
+	};
+	bench_stop(&bt, "operational_virtual", bn->bn_iterations);
+	bench_operational_free(bn, attrs);
+
+	// read entry with all user attributes aliased to generated attributes
+	bn->bn_ps->ps_alias = 1;
+	pwdshadow_cfg_publish(bn->bn_ps);
+	bench_start(&bt);
+	for(n = 0; n < bn->bn_iterations; n++)
+	{
+		memset(&rs, 0, sizeof(rs));
+		rs.sr_type			= REP_SEARCH;
+		rs.sr_entry			= bn->bn_user;
+		rs.sr_attr_flags	= SLAP_USERATTRS(~0UL);
+		pwdshadow_operational(&opbuf.ob_op, &rs);
+		attrs[n]			= rs.sr_operational_attrs;
+	};
+	bench_stop(&bt, "operational_alias", bn->bn_iterations);
+	bench_operational_free(bn, attrs);
+	bn->bn_ps->ps_alias = 0;
+	bn->bn_ps->ps_mode = PWDSHADOW_MODE_STORED;
+	pwdshadow_cfg_publish(bn->bn_ps);
+
+	free(attrs);
+
+	return(0);
+}
+
+
+int
+bench_operational_free(
+		bench_t *					bn,
+		Attribute **				attrs )
+{
+	long					n;
+	Attribute *				a;
+	Attribute *				next;
+
+	for(n = 0; n < bn->bn_iterations; n++)
+	{
+		for(a = attrs[n]; ((a)); a = next)
+		{
+			next = a->a_next;
+			ber_bvarray_free(a->a_vals);
+			ch_free(a);
+		};
+		attrs[n] = NULL;
+	};
+
+	return(0);
+}
+
+
+int
+bench_parse_int(
+		bench_t *					bn )
+{
+	long					n;
+	int						ival;
+	int64_t					val;
+	struct berval			bv;
+	bench_timer_t			bt;
+
+	ber_str2bv("7776000", 0, 0, &bv);
+
+	bench_start(&bt);
+	for(n = 0; n < bn->bn_iterations; n++)
+	{
+		pwdshadow_parse_int(&bv, &val);
+		bench_sink = (int)val;
+	};
+	bench_stop(&bt, "parse_int", bn->bn_iterations);
+
+	bench_start(&bt);
+	for(n = 0; n < bn->bn_iterations; n++)
+	{
+		lutil_atoi(&ival, bv.bv_val);
+		bench_sink = ival;
+	};
+	bench_stop(&bt, "parse_int_lutil", bn->bn_iterations);
+
+	return(0);
+}
+
+
+int
+bench_parse_time(
+		bench_t *					bn )
+{
+	long					n;
+	int64_t					val;
+	struct berval			bv;
+	struct lutil_tm			tm;
+	struct lutil_timet		tt;
+	bench_timer_t			bt;
+
+	ber_str2bv("20230415120000Z", 0, 0, &bv);
+
+	bench_start(&bt);
+	for(n = 0; n < bn->bn_iterations; n++)
+	{
+		pwdshadow_parse_time(&bv, &val);
+		bench_sink = (int)val;
+	};
+	bench_stop(&bt, "parse_time", bn->bn_iterations);
+
+	bench_start(&bt);
+	for(n = 0; n < bn->bn_iterations; n++)
+	{
+		lutil_parsetime(bv.bv_val, &tm);
+		lutil_tm2time(&tm, &tt);
+		bench_sink = (int)(tt.tt_sec / (60 * 60 * 24));
+	};
+	bench_stop(&bt, "parse_time_lutil", bn->bn_iterations);
+
+	return(0);
+}
+
+int
+bench_scan_attrs(
+		bench_t *					bn )
+{
+	long					n;
+	pwdshadow_state_t		st;
+	bench_timer_t			bt;
+
+	// retrieves entry attributes with a single pass over the entry
+	bench_start(&bt);
+	for(n = 0; n < bn->bn_iterations; n++)
+	{
+		pwdshadow_state_initialize(&st, pwdshadow_cfg_get(bn->bn_ps));
+		pwdshadow_scan_attrs(&st, bn->bn_user->e_attrs, PWDSHADOW_SCAN_ENTRY, PWDSHADOW_FLG_EXISTS);
+		bench_sink += st.st_prev[PWDSHADOW_SL_pwdChangedTime];
+	};
+	bench_stop(&bt, "scan_attrs", bn->bn_iterations);
+
+	return(0);
+}
+
+
+int
+bench_set(
+		bench_t *					bn,
+		const char *				name,
+		int							slot,
+		const char *				value )
+{
+	long					n;
+	struct berval			bv;
+	pwdshadow_state_t		st;
+	bench_timer_t			bt;
+
+	ber_str2bv(value, 0, 0, &bv);
+	pwdshadow_state_initialize(&st, pwdshadow_cfg_get(bn->bn_ps));
+
+	// setting a slot only adds its flag, the state is not reset
+	bench_start(&bt);
+	for(n = 0; n < bn->bn_iterations; n++)
+	{
+		pwdshadow_set(&st, slot, &bv, PWDSHADOW_FLG_EXISTS);
+		bench_sink += st.st_prev[slot];
+	};
+	bench_stop(&bt, name, bn->bn_iterations);
+
+	return(0);
+}
+
+
+int
+bench_setup(
+		bench_t *					bn )
+{
+	ConfigReply				cr;
+
+	if ((pwdshadow_initialize()))
+	{
+		fprintf(stderr, "pwdshadow-bench: pwdshadow_initialize() failed\n");
+		return(1);
+	};
+
+	// database with a single instance of the overlay
+	bn->bn_bi.bi_type		= "stub";
+	bn->bn_on				= pwdshadow;
+	bn->bn_on.on_info		= &bn->bn_bi;
+	bn->bn_be.bd_info		= (BackendInfo *)&bn->bn_on;
+	bn->bn_be.bd_self		= &bn->bn_be;
+	ber_str2bv(BENCH_SUFFIX, 0, 0, &bn->bn_suffix[0]);
+	ber_str2bv(BENCH_SUFFIX, 0, 0, &bn->bn_nsuffix[0]);
+	ber_str2bv(BENCH_ROOTDN, 0, 0, &bn->bn_be.be_rootdn);
+	ber_str2bv(BENCH_ROOTDN, 0, 0, &bn->bn_be.be_rootndn);
+	bn->bn_be.be_suffix		= bn->bn_suffix;
+	bn->bn_be.be_nsuffix	= bn->bn_nsuffix;
+	stub_backend(&bn->bn_be);
+	slapMode				= SLAP_TOOL_MODE;
+
+	memset(&cr, 0, sizeof(cr));
+	if ((pwdshadow_db_init(&bn->bn_be, &cr)))
+		return(1);
+	bn->bn_ps = bn->bn_on.on_bi.bi_private;
+	ber_str2bv(BENCH_POLICY_DN, 0, 1, &bn->bn_ps->ps_def_policy);
+	if ((pwdshadow_db_open(&bn->bn_be, &cr)))
+		return(1);
+
+	// default password policy
+	bn->bn_policy = stub_entry_new(BENCH_POLICY_DN);
+	stub_entry_set(bn->bn_policy, "objectClass",		"pwdPolicy");
+	stub_entry_set(bn->bn_policy, "objectClass",		"pwdShadowPolicy");
+	stub_entry_set(bn->bn_policy, "pwdMaxAge",			"7776000");
+	stub_entry_set(bn->bn_policy, "pwdMinAge",			"86400");
+	stub_entry_set(bn->bn_policy, "pwdExpireWarning",	"1209600");
+	stub_entry_set(bn->bn_policy, "pwdGraceExpiry",		"604800");
+	stub_entry_set(bn->bn_policy, "pwdShadowAutoExpire",	"TRUE");
+	stub_entry_add(bn->bn_policy);
+
+	// user entry without generated attributes
+	bn->bn_user = bench_entry_user(BENCH_USER_DN);
+	stub_entry_add(bn->bn_user);
+
+	return(0);
+}
+
+
+void
+bench_start(
+		bench_timer_t *				bt )
+{
+	bt->bt_allocs		= stub_allocs;
+	bt->bt_tmpallocs	= stub_tmpallocs;
+	clock_gettime(CLOCK_MONOTONIC, &bt->bt_start);
+	return;
+}
+
+
+void
+bench_stop(
+		bench_timer_t *				bt,
+		const char *				name,
+		long						iterations )
+{
+	struct timespec			ts;
+	double					ns;
+	double					allocs;
+	double					tmpallocs;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	ns		= (double)(ts.tv_sec - bt->bt_start.tv_sec) * 1e9;
+	ns	   += (double)(ts.tv_nsec - bt->bt_start.tv_nsec);
+	allocs	= (double)(stub_allocs - bt->bt_allocs);
+	tmpallocs = (double)(stub_tmpallocs - bt->bt_tmpallocs);
+
+	printf("%s\t%ld\t%.1f\t%.2f\t%.2f\n", name, iterations, ns / (double)iterations, allocs / (double)iterations, tmpallocs / (double)iterations);
+
+	return;
+}
+
+
+int
+bench_subtree(
+		bench_t *					bn )
+{
+	long					n;
+	struct berval			ndn;
+	bench_timer_t			bt;
+
+	bench_subtree_cfg(bn, LDAP_MOD_ADD, -1, "dc=example,dc=com",				"cn=base,ou=policies,dc=example,dc=com");
+	bench_subtree_cfg(bn, LDAP_MOD_ADD, -1, "ou=people,dc=example,dc=com",		"cn=people,ou=policies,dc=example,dc=com");
+	bench_subtree_cfg(bn, LDAP_MOD_ADD, -1, "ou=staff,ou=people,dc=example,dc=com",	"cn=staff,ou=policies,dc=example,dc=com");
+	bench_subtree_cfg(bn, LDAP_MOD_ADD, -1, "ou=students,ou=people,dc=example,dc=com",	"cn=students,ou=policies,dc=example,dc=com");
+	bench_subtree_cfg(bn, LDAP_MOD_ADD, -1, "ou=service,dc=example,dc=com",		"cn=service,ou=policies,dc=example,dc=com");
+	ber_str2bv(BENCH_STAFF_DN, 0, 0, &ndn);
+
+	// longest suffix match of a user within a delegated OU
+	bench_start(&bt);
+	for(n = 0; n < bn->bn_iterations; n++)
+		bench_sink = (int)pwdshadow_subtree_find(pwdshadow_cfg_get(bn->bn_ps), &ndn, NULL)->bv_len;
+	bench_stop(&bt, "subtree_find", bn->bn_iterations);
+
+	return(0);
+}
+
+
+int
+bench_subtree_cfg(
+		bench_t *					bn,
+		int							op,
+		int							valx,
+		const char *				suffix,
+		const char *				policy )
+{
+	int						n;
+	ConfigArgs				c;
+	char *					argv[4];
+
+	argv[0] = "pwdshadow_subtree_policy";
+	argv[1] = (char *)suffix;
+	argv[2] = (char *)policy;
+	argv[3] = NULL;
+
+	memset(&c, 0, sizeof(c));
+	c.op	= op;
+	c.type	= PWDSHADOW_CFG_SUBTREE;
+	c.argc	= 3;
+	c.argv	= argv;
+	c.log	= "pwdshadow-bench";
+	c.valx	= valx;
+	c.bi	= (BackendInfo *)&bn->bn_on;
+
+	if (op != SLAP_CONFIG_EMIT)
+		return(pwdshadow_cfg_gen(&c));
+
+	// number of emitted values
+	if ((pwdshadow_cfg_gen(&c)))
+		return(-1);
+	for(n = 0; ( ((c.rvalue_vals)) && ((c.rvalue_vals[n].bv_val)) ); n++);
+	ber_bvarray_free(c.rvalue_vals);
+	return(n);
+}
+
+
+// searches the key as NSS does and compares the searches of the backend and
+// the uid, shadowMax and pwdShadowMax returned, or "-" if no entry is returned
+int
+bench_tuple_check(
+		bench_t *					bn,
+		const char *				step,
+		const char *				key,
+		int							loads,
+		int							passed,
+		const char *				value )
+{
+	int						idx;
+	const char *			text;
+	const char *			names[2] = { "shadowMax", "pwdShadowMax" };
+	char					buff[64];
+	AttributeName			an[3];
+	AttributeAssertion		ava;
+	Filter					f;
+	OperationBuffer			opbuf;
+	SlapReply				rs;
+	slap_callback			sc;
+
+	memset(an, 0, sizeof(an));
+	for(idx = 0; idx < 2; idx++)
+	{
+		slap_str2ad(names[idx], &an[idx].an_desc, &text);
+		an[idx].an_name = an[idx].an_desc->ad_cname;
+	};
+	memset(&ava, 0, sizeof(ava));
+	memset(&f, 0, sizeof(f));
+	slap_str2ad("uid", &ava.aa_desc, &text);
+	ber_str2bv(key, 0, 0, &ava.aa_value);
+	f.f_choice	= LDAP_FILTER_EQUALITY;
+	f.f_ava		= &ava;
+
+	memset(&sc, 0, sizeof(sc));
+	sc.sc_response	= bench_tuple_collect;
+	sc.sc_private	= buff;
+	strcpy(buff, "-");
+
+	bench_op(bn, &opbuf);
+	opbuf.ob_op.o_tag			= LDAP_REQ_SEARCH;
+	opbuf.ob_op.o_req_dn		= bn->bn_suffix[0];
+	opbuf.ob_op.o_req_ndn		= bn->bn_nsuffix[0];
+	opbuf.ob_op.o_callback		= &sc;
+	opbuf.ob_op.ors_scope		= LDAP_SCOPE_SUBTREE;
+	opbuf.ob_op.ors_attrs		= an;
+	opbuf.ob_op.ors_filter		= &f;
+	filter2bv_x(&opbuf.ob_op, &f, &opbuf.ob_op.ors_filterstr);
+	memset(&rs, 0, sizeof(rs));
+
+	// searches which are not answered by the overlay reach the backend
+	bench_loads		= 0;
+	bench_passed	= 0;
+	if (pwdshadow_op_search(&opbuf.ob_op, &rs) == SLAP_CB_CONTINUE)
+		bench_backend_search(&opbuf.ob_op, &rs);
+	slap_cleanup_play(&opbuf.ob_op, &rs);
+	free(opbuf.ob_op.ors_filterstr.bv_val);
+
+	if ( (bench_loads != loads) || (bench_passed != passed) || ((strcmp(buff, value))) )
+	{
+		fprintf(stderr, "pwdshadow-bench: tuple cache %s of %s returned \"%s\" with %i loads and %i searches, failed verification\n", step, key, buff, bench_loads, bench_passed);
+		return(1);
+	};
+
+	return(0);
+}
+
+
+int
+bench_tuple_collect(
+		Operation *					op,
+		SlapReply *					rs )
+{
+	int						idx;
+	size_t					len;
+	char *					buff;
+	const char *			text;
+	AttributeDescription *	ad;
+	Attribute *				a;
+	const char *			names[3] = { "uid", "shadowMax", "pwdShadowMax" };
+
+	buff = op->o_callback->sc_private;
+
+	if (rs->sr_type != REP_SEARCH)
+		return(SLAP_CB_CONTINUE);
+
+	for(idx = 0, len = 0; idx < 3; idx++)
+	{
+		slap_str2ad(names[idx], &ad, &text);
+		a	 = attr_find(rs->sr_entry->e_attrs, ad);
+		len	+= snprintf(&buff[len], 64 - len, "%s%s", ((idx)) ? " " : "", ((a)) ? a->a_vals[0].bv_val : "-");
+	};
+
+	return(SLAP_CB_CONTINUE);
+}
+
+
+Entry *
+bench_tuple_entry(
+		const char *				uid,
+		const char *				max )
+{
+	char			dn[64];
+	Entry *			e;
+
+	snprintf(dn, sizeof(dn), "uid=%s,ou=people,dc=example,dc=com", uid);
+	e = stub_entry_new(dn);
+	stub_entry_set(e, "objectClass",	"shadowAccount");
+	stub_entry_set(e, "uid",			uid);
+	stub_entry_set(e, "shadowMax",		max);
+	stub_entry_set(e, "pwdShadowMax",	"45");
+
+	return(e);
+}
+
+
+void
+bench_usage(
+		void )
+{
+	printf("Usage: pwdshadow-bench [options]\n");
+	printf("Options:\n");
+	printf("  -c epoch                  value returned by time() (default: %lld)\n", (long long)stub_clock);
+	printf("  -h                        print this help and exit\n");
+	printf("  -n iterations             iterations of each benchmark (default: %i)\n", BENCH_ITERATIONS);
+	printf("\n");
+	return;
+}
+
+
+// builds the expiry index from the entries of the database and queries it
+// after entries are added, modified, renamed and deleted
+int
+bench_verify_expiry(
+		bench_t *					bn )
+{
+	int						idx;
+	int						mode;
+	unsigned long			count;
+	Entry *					entries[6];
+	static const char *		dns[6] =
+	{
+		"uid=a,ou=people,dc=example,dc=com",
+		"uid=b,ou=people,dc=example,dc=com",
+		"uid=c,ou=staff,ou=people,dc=example,dc=com",
+		"uid=d,ou=service,dc=example,dc=com",
+		"uid=e,ou=people,dc=example,dc=com",
+		"uid=f,ou=people,dc=example,dc=com"
+	};
+	static const char *		times[6] = { "20230101000000Z", "20230201000000Z", "20230101000000Z", "20230301000000Z", "20230101000000Z", "20230115000000Z" };
+
+	// entries with generated attributes, added before the index is enabled
+	// except the last entry
+	for(idx = 0; idx < 6; idx++)
+	{
+		entries[idx] = bench_entry_user(dns[idx]);
+		attr_delete(&entries[idx]->e_attrs, ad_pwdChangedTime);
+		stub_entry_set(entries[idx], "pwdChangedTime", times[idx]);
+	};
+	for(idx = 0; idx < 5; idx++)
+		bench_write(bn, LDAP_REQ_ADD, entries[idx], NULL, NULL);
+
+	// index is built by a task once the server is running
+	mode					= slapMode;
+	slapMode				= 0;
+	bn->bn_bi.bi_op_search	= bench_backend_search;
+	bn->bn_ps->ps_expiry	= 1;
+	pwdshadow_cfg_publish(bn->bn_ps);
+	pwdshadow_expiry_config(bn->bn_ps);
+	if ((bench_expiry_check(bn, "building", BENCH_SUFFIX "\npwdShadowMax 0 99999", LDAP_BUSY, 0, "")))
+		return(1);
+
+	// entry deleted while the index is built is kept without days until the
+	// build completes
+	bench_write(bn, LDAP_REQ_DELETE, entries[4], NULL, NULL);
+	pwdshadow_expiry_build(NULL, bn->bn_ps->ps_expiry_task);
+	count = bn->bn_ps->ps_expiry_count;
+
+	// entries are listed by day and DN, within a subtree and a range of days
+	// and in pages continuing after the last entry of the previous page
+	if ( ((bench_expiry_check(bn, "build",		BENCH_SUFFIX "\npwdShadowMax 0 99999",							LDAP_SUCCESS, 1,
+	        "19448 uid=a,ou=people,dc=example,dc=com\n19448 uid=c,ou=staff,ou=people,dc=example,dc=com\n"
+	        "19479 uid=b,ou=people,dc=example,dc=com\n19507 uid=d,ou=service,dc=example,dc=com\n"))) ||
+	     ((bench_expiry_check(bn, "page",		BENCH_SUFFIX "\npwdShadowMax 0 99999 3",						LDAP_SUCCESS, 2,
+	        "19448 uid=a,ou=people,dc=example,dc=com\n19448 uid=c,ou=staff,ou=people,dc=example,dc=com\n"
+	        "19479 uid=b,ou=people,dc=example,dc=com\n|19507 uid=d,ou=service,dc=example,dc=com\n"))) ||
+	     ((bench_expiry_check(bn, "page",		BENCH_SUFFIX "\npwdShadowMax 0 99999 1",						LDAP_SUCCESS, 4,
+	        "19448 uid=a,ou=people,dc=example,dc=com\n|19448 uid=c,ou=staff,ou=people,dc=example,dc=com\n|"
+	        "19479 uid=b,ou=people,dc=example,dc=com\n|19507 uid=d,ou=service,dc=example,dc=com\n"))) ||
+	     ((bench_expiry_check(bn, "subtree",	"ou=people," BENCH_SUFFIX "\npwdShadowMax 19448 19479 1",		LDAP_SUCCESS, 3,
+	        "19448 uid=a,ou=people,dc=example,dc=com\n|19448 uid=c,ou=staff,ou=people,dc=example,dc=com\n|"
+	        "19479 uid=b,ou=people,dc=example,dc=com\n"))) ||
+	     ((bench_expiry_check(bn, "range",		BENCH_SUFFIX "\npwdShadowMax 19449 19507",						LDAP_SUCCESS, 1,
+	        "19479 uid=b,ou=people,dc=example,dc=com\n19507 uid=d,ou=service,dc=example,dc=com\n"))) ||
+	     ((bench_expiry_check(bn, "expire",		BENCH_SUFFIX "\npwdShadowExpire 19455 19486",					LDAP_SUCCESS, 1,
+	        "19455 uid=a,ou=people,dc=example,dc=com\n19455 uid=c,ou=staff,ou=people,dc=example,dc=com\n"
+	        "19486 uid=b,ou=people,dc=example,dc=com\n"))) )
+		return(1);
+
+	// added, modified and renamed entries are indexed by their new days and
+	// DN, deleted entries are removed
+	bench_write(bn, LDAP_REQ_ADD,		entries[5],	NULL,				NULL);
+	bench_write(bn, LDAP_REQ_MODIFY,	entries[0],	"pwdChangedTime",	"20230401000000Z");
+	bench_write(bn, LDAP_REQ_MODRDN,	entries[1],	NULL,				"uid=b,ou=service,dc=example,dc=com");
+	bench_write(bn, LDAP_REQ_DELETE,	entries[2],	NULL,				NULL);
+	if ( ((bench_expiry_check(bn, "write",		BENCH_SUFFIX "\npwdShadowMax 0 99999",							LDAP_SUCCESS, 1,
+	        "19462 uid=f,ou=people,dc=example,dc=com\n19479 uid=b,ou=service,dc=example,dc=com\n"
+	        "19507 uid=d,ou=service,dc=example,dc=com\n19538 uid=a,ou=people,dc=example,dc=com\n"))) ||
+	     ((bench_expiry_check(bn, "rename",		"ou=service," BENCH_SUFFIX "\npwdShadowMax 0 99999",			LDAP_SUCCESS, 1,
+	        "19479 uid=b,ou=service,dc=example,dc=com\n19507 uid=d,ou=service,dc=example,dc=com\n"))) )
+		return(1);
+
+	bn->bn_ps->ps_expiry	= 0;
+	pwdshadow_cfg_publish(bn->bn_ps);
+	pwdshadow_expiry_config(bn->bn_ps);
+	bn->bn_bi.bi_op_search	= NULL;
+	slapMode				= mode;
+	for(idx = 0; idx < 6; idx++)
+	{
+		stub_entry_remove(entries[idx]);
+		stub_entry_free(entries[idx]);
+	};
+	if (count != 4)
+	{
+		fprintf(stderr, "pwdshadow-bench: expiry index of %lu entries failed verification\n", count);
+		return(1);
+	};
+
+	printf("# verify: expiry_index builds, writes and pages\n");
+
+	return(0);
+}
+
+
+int
+bench_verify_filter(
+		bench_t *					bn )
+{
+	size_t					idx;
+	size_t					pos;
+	int						overrides;
+	int						saved;
+	int						fail;
+	const char *			text;
+	Filter					items[9];
+	AttributeAssertion		avas[9];
+	Filter *				filters[5];
+	OperationBuffer			opbuf;
+	SlapReply				rs;
+	struct berval			orig;
+	static const struct
+	{
+		ber_tag_t			choice;
+		const char *		attr;
+		const char *		val;
+	} asserts[9] =
+	{
+		{ LDAP_FILTER_PRESENT,							"shadowMax",		NULL },
+		{ LDAP_FILTER_EQUALITY,							"shadowMax",		"90" },
+		{ LDAP_FILTER_LE | SLAPD_FILTER_UNDEFINED,		"shadowMax",		"90" },
+		{ LDAP_FILTER_AND,								NULL,				NULL },
+		{ LDAP_FILTER_EQUALITY,							"uid",				"jdoe" },
+		{ LDAP_FILTER_GE,								"shadowLastChange",	"19358" },
+		{ LDAP_FILTER_OR,								NULL,				NULL },
+		{ LDAP_FILTER_EQUALITY,							"shadowMax",		"abc" },
+		{ LDAP_FILTER_EQUALITY,							"uid",				"90" },
+	};
+	static const char *		tests[5][3] =
+	{
+		{	"(shadowMax=*)",
+			"(|(shadowMax=*)(pwdShadowMax=*))",
+			"(|(shadowMax=*)(pwdShadowMax=*))" },
+		{	"(shadowMax=90)",
+			"(|(pwdShadowMax=90)(&(shadowMax=90)(!(pwdShadowMax=*))))",
+			"(|(shadowMax=90)(&(pwdShadowMax=90)(!(shadowMax=*))))" },
+		{	"(?shadowMax<=90)",
+			"(|(pwdShadowMax<=90)(&(?shadowMax<=90)(!(pwdShadowMax=*))))",
+			"(|(?shadowMax<=90)(&(pwdShadowMax<=90)(!(shadowMax=*))))" },
+		{	"(&(uid=jdoe)(shadowLastChange>=19358))",
+			"(&(uid=jdoe)(|(pwdShadowLastChange>=19358)(&(shadowLastChange>=19358)(!(pwdShadowLastChange=*)))))",
+			"(&(uid=jdoe)(|(shadowLastChange>=19358)(&(pwdShadowLastChange>=19358)(!(shadowLastChange=*)))))" },
+		{	"(|(shadowMax=abc)(uid=90))",
+			"(|(shadowMax=abc)(uid=90))",
+			"(|(shadowMax=abc)(uid=90))" },
+	};
+
+	// filters are built as decoded by slapd, the ordering assertion of an
+	// attribute without an ordering rule is undefined and the last filter
+	// cannot match a generated value, so it is not rewritten
+	memset(items, 0, sizeof(items));
+	memset(avas, 0, sizeof(avas));
+	for(idx = 0; idx < 9; idx++)
+	{
+		items[idx].f_choice = asserts[idx].choice;
+		switch(asserts[idx].choice & SLAPD_FILTER_MASK)
+		{
+			case LDAP_FILTER_AND:
+			case LDAP_FILTER_OR:
+			items[idx].f_list = &items[idx + 1];
+			items[idx + 1].f_next = &items[idx + 2];
+			break;
+
+			case LDAP_FILTER_PRESENT:
+			slap_str2ad(asserts[idx].attr, &items[idx].f_desc, &text);
+			break;
+
+			default:
+			items[idx].f_ava = &avas[idx];
+			slap_str2ad(asserts[idx].attr, &items[idx].f_av_desc, &text);
+			ber_str2bv(asserts[idx].val, 0, 0, &items[idx].f_av_value);
+			break;
+		};
+	};
+	filters[0]	= &items[0];
+	filters[1]	= &items[1];
+	filters[2]	= &items[2];
+	filters[3]	= &items[3];
+	filters[4]	= &items[6];
+	memset(&rs, 0, sizeof(rs));
+
+	// filter of each search is rewritten with both settings of overrides and
+	// restored by the callback when the operation completes
+	saved					= bn->bn_ps->ps_overrides;
+	bn->bn_ps->ps_alias		= 1;
+	for(overrides = 0, fail = 0, pos = 0; ( (overrides < 2) && (!(fail)) ); overrides++)
+	{
+		bn->bn_ps->ps_overrides = overrides;
+		pwdshadow_cfg_publish(bn->bn_ps);
+		for(idx = 0; ( (idx < 5) && (!(fail)) ); idx++, pos++)
+		{
+			bench_op(bn, &opbuf);
+			opbuf.ob_op.o_tag			= LDAP_REQ_SEARCH;
+			opbuf.ob_op.o_callback		= NULL;
+			opbuf.ob_op.ors_filter		= filters[idx];
+			filter2bv_x(&opbuf.ob_op, filters[idx], &opbuf.ob_op.ors_filterstr);
+			orig						= opbuf.ob_op.ors_filterstr;
+			pwdshadow_op_search(&opbuf.ob_op, &rs);
+			if ( ((strcmp(orig.bv_val, tests[idx][0]))) ||
+			     ((strcmp(opbuf.ob_op.ors_filterstr.bv_val, tests[idx][overrides + 1]))) ||
+			     ( (opbuf.ob_op.ors_filter == filters[idx]) != (idx == 4) ) )
+				fail = 1;
+			slap_cleanup_play(&opbuf.ob_op, &rs);
+			if ( (opbuf.ob_op.ors_filter != filters[idx]) || (opbuf.ob_op.ors_filterstr.bv_val != orig.bv_val) )
+				fail = 1;
+			if ((fail))
+				fprintf(stderr, "pwdshadow-bench: filter %s with overrides %s failed verification\n", tests[idx][0], ((overrides)) ? "on" : "off");
+			free(orig.bv_val);
+		};
+	};
+	bn->bn_ps->ps_alias		= 0;
+	bn->bn_ps->ps_overrides	= saved;
+	pwdshadow_cfg_publish(bn->bn_ps);
+	if ((fail))
+		return(1);
+
+	printf("# verify: filter_rewrite %zu filters\n", pos);
+
+	return(0);
+}
+
+
+int
+bench_verify_int(
+		void )
+{
+	size_t					idx;
+	int64_t					val;
+	struct berval			bv;
+	static const struct
+	{
+		const char *		str;
+		int					rc;
+		int64_t				val;
+	} tests[] =
+	{
+		{ "0",						 0, 0 },
+		{ "-0",						 0, 0 },
+		{ "7776000",				 0, 7776000 },
+		{ "-1",						 0, -1 },
+		{ "2147483648",				 0, 2147483648LL },
+		{ "9223372036854775807",	 0, INT64_MAX },
+		{ "-9223372036854775808",	 0, INT64_MIN },
+		{ "9223372036854775808",	-1, 0 },
+		{ "-9223372036854775809",	-1, 0 },
+		{ "99999999999999999999",	-1, 0 },
+		{ "",						-1, 0 },
+		{ "-",						-1, 0 },
+		{ "+1",						-1, 0 },
+		{ "1a",						-1, 0 },
+		{ " 1",						-1, 0 },
+	};
+
+	for(idx = 0; idx < (sizeof(tests) / sizeof(tests[0])); idx++)
+	{
+		val = 0;
+		ber_str2bv(tests[idx].str, 0, 0, &bv);
+		if ( (pwdshadow_parse_int(&bv, &val) != tests[idx].rc) || ( (!(tests[idx].rc)) && (val != tests[idx].val) ) )
+		{
+			fprintf(stderr, "pwdshadow-bench: parse_int(\"%s\") failed verification\n", tests[idx].str);
+			return(1);
+		};
+	};
+
+	printf("# verify: parse_int %zu values\n", idx);
+
+	return(0);
+}
+
+
+int
+bench_verify_lastchange(
+		bench_t *					bn )
+{
+	char					date[16];
+	char					today[24];
+
+	// password changed without and with the pwdChangedTime of slapo-ppolicy,
+	// the clock is months after pwdChangedTime
+	snprintf(today, sizeof(today), "%lld", (long long)(stub_clock / 86400));
+	bench_op_password(bn, NULL, 1, 1, date, sizeof(date));
+	if ((strcmp(date, today)))
+	{
+		fprintf(stderr, "pwdshadow-bench: pwdShadowLastChange %s of userPassword failed verification\n", date);
+		return(1);
+	};
+	bench_op_password(bn, NULL, 1, 2, date, sizeof(date));
+	if ((strcmp(date, "19358")))
+	{
+		fprintf(stderr, "pwdshadow-bench: pwdShadowLastChange %s of pwdChangedTime failed verification\n", date);
+		return(1);
+	};
+
+	printf("# verify: pwdShadowLastChange %s from pwdChangedTime\n", date);
+
+	return(0);
+}
+
+
+int
+bench_verify_subtree(
+		bench_t *					bn )
+{
+	size_t					idx;
+	int						nested;
+	struct berval			ndn;
+	struct berval *			policy;
+	static const struct
+	{
+		const char *		dn;
+		const char *		policy;
+		int					nested;
+	} tests[] =
+	{
+		{ "uid=a,ou=staff,ou=people,dc=example,dc=com",	"cn=staff,ou=policies,dc=example,dc=com",	0 },
+		{ "ou=staff,ou=people,dc=example,dc=com",		"cn=staff,ou=policies,dc=example,dc=com",	0 },
+		{ "uid=a,ou=people,dc=example,dc=com",			"cn=people,ou=policies,dc=example,dc=com",	0 },
+		{ "ou=people,dc=example,dc=com",				"cn=people,ou=policies,dc=example,dc=com",	1 },
+		{ "uid=a,ou=staff,dc=example,dc=com",			"cn=base,ou=policies,dc=example,dc=com",	0 },
+		{ "uid=a,xou=people,dc=example,dc=com",			"cn=base,ou=policies,dc=example,dc=com",	0 },
+		{ "dc=example,dc=com",							"cn=base,ou=policies,dc=example,dc=com",	1 },
+		{ "dc=com",										NULL,										1 },
+		{ "uid=a,dc=example,dc=org",					NULL,										0 },
+	};
+
+	if ( ((bench_subtree_cfg(bn, LDAP_MOD_ADD, -1, "ou=people,dc=example,dc=com",			"cn=people,ou=policies,dc=example,dc=com"))) ||
+	     ((bench_subtree_cfg(bn, LDAP_MOD_ADD, -1, "ou=staff,ou=people,dc=example,dc=com",	"cn=staff,ou=policies,dc=example,dc=com"))) ||
+	     ((bench_subtree_cfg(bn, LDAP_MOD_ADD, -1, "dc=example,dc=com",					"cn=base,ou=policies,dc=example,dc=com"))) ||
+	     (!(bench_subtree_cfg(bn, LDAP_MOD_ADD, -1, "dc=example,dc=com",				"cn=other,ou=policies,dc=example,dc=com"))) ||
+	     (bench_subtree_cfg(bn, SLAP_CONFIG_EMIT, -1, NULL, NULL) != 3) )
+	{
+		fprintf(stderr, "pwdshadow-bench: pwdshadow_subtree_policy failed verification\n");
+		return(1);
+	};
+
+	for(idx = 0; idx < (sizeof(tests) / sizeof(tests[0])); idx++)
+	{
+		ber_str2bv(tests[idx].dn, 0, 0, &ndn);
+		policy = pwdshadow_subtree_find(pwdshadow_cfg_get(bn->bn_ps), &ndn, &nested);
+		if ( ( (!(policy)) != (!(tests[idx].policy)) ) ||
+		     ( ((policy)) && ((strcmp(policy->bv_val, tests[idx].policy))) ) ||
+		     (nested != tests[idx].nested) )
+		{
+			fprintf(stderr, "pwdshadow-bench: subtree_find(\"%s\") failed verification\n", tests[idx].dn);
+			return(1);
+		};
+	};
+
+	// remove delegated OU, entries fall back to the parent suffix
+	ber_str2bv(tests[0].dn, 0, 0, &ndn);
+	bench_subtree_cfg(bn, LDAP_MOD_DELETE, 1, NULL, NULL);
+	policy = pwdshadow_subtree_find(pwdshadow_cfg_get(bn->bn_ps), &ndn, NULL);
+	if ( (!(policy)) || ((strcmp(policy->bv_val, tests[2].policy))) || (bench_subtree_cfg(bn, SLAP_CONFIG_EMIT, -1, NULL, NULL) != 2) )
+	{
+		fprintf(stderr, "pwdshadow-bench: pwdshadow_subtree_policy delete failed verification\n");
+		return(1);
+	};
+
+	bench_subtree_cfg(bn, LDAP_MOD_DELETE, -1, NULL, NULL);
+	if ( ((pwdshadow_cfg_get(bn->bn_ps)->cf_subtree)) || ((pwdshadow_subtree_find(pwdshadow_cfg_get(bn->bn_ps), &ndn, NULL))) )
+	{
+		fprintf(stderr, "pwdshadow-bench: pwdshadow_subtree_policy delete failed verification\n");
+		return(1);
+	};
+
+	printf("# verify: subtree_find %zu values\n", idx);
+
+	return(0);
+}
+
+
+int
+bench_verify_time(
+		void )
+{
+	int						year;
+	int						mon;
+	int						mday;
+	int						last;
+	int						leap;
+	int64_t					day;
+	int64_t					val;
+	unsigned long			count;
+	char					buff[32];
+	struct berval			bv;
+	struct lutil_tm			tm;
+	struct lutil_timet		tt;
+	static const int		mdays[13] = { 0, 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+
+	// walk the calendar one day at a time from 0001-01-01 (day -719162)
+	bv.bv_val	= buff;
+	day			= -719162;
+	count		= 0;
+	for(year = 1; year <= 9999; year++)
+	{
+		leap = ( (!(year % 4)) && ( ((year % 100)) || (!(year % 400)) ) ) ? 1 : 0;
+		for(mon = 1; mon <= 12; mon++)
+		{
+			last = mdays[mon] + ( ((mon == 2) && (leap)) ? 1 : 0 );
+			for(mday = 1; mday <= last; mday++, day++, count++)
+			{
+				// first and last second of the day
+				bv.bv_len = snprintf(buff, sizeof(buff), "%04i%02i%02i000000Z", year, mon, mday);
+				if ( (pwdshadow_parse_time_fast(&bv, &val) != 0) || (val != day) )
+					goto failed;
+				bv.bv_len = snprintf(buff, sizeof(buff), "%04i%02i%02i235959Z", year, mon, mday);
+				if ( (pwdshadow_parse_time_fast(&bv, &val) != 0) || (val != day) )
+					goto failed;
+
+				// general parser agrees where its unsigned seconds are valid
+				if ( (year >= 1970) && (year < 2106) )
+				{
+					lutil_parsetime(buff, &tm);
+					lutil_tm2time(&tm, &tt);
+					if ((int64_t)(tt.tt_sec / (60 * 60 * 24)) != day)
+						goto failed;
+				};
+			};
+
+			// day after the last day of the month is not accepted
+			bv.bv_len = snprintf(buff, sizeof(buff), "%04i%02i%02i000000Z", year, mon, last + 1);
+			if (pwdshadow_parse_time_fast(&bv, &val) == 0)
+				goto failed;
+		};
+
+		// out of range months and times are not accepted
+		bv.bv_len = snprintf(buff, sizeof(buff), "%04i0001000000Z", year);
+		if (pwdshadow_parse_time_fast(&bv, &val) == 0)
+			goto failed;
+		bv.bv_len = snprintf(buff, sizeof(buff), "%04i1301000000Z", year);
+		if (pwdshadow_parse_time_fast(&bv, &val) == 0)
+			goto failed;
+		bv.bv_len = snprintf(buff, sizeof(buff), "%04i0101240000Z", year);
+		if (pwdshadow_parse_time_fast(&bv, &val) == 0)
+			goto failed;
+		bv.bv_len = snprintf(buff, sizeof(buff), "%04i0101006000Z", year);
+		if (pwdshadow_parse_time_fast(&bv, &val) == 0)
+			goto failed;
+		bv.bv_len = snprintf(buff, sizeof(buff), "%04i0101000060Z", year);
+		if (pwdshadow_parse_time_fast(&bv, &val) == 0)
+			goto failed;
+	};
+
+	// other forms of GeneralizedTime are left to the general parser
+	ber_str2bv("20230415120000.5Z", 0, 0, &bv);
+	if (pwdshadow_parse_time_fast(&bv, &val) == 0)
+		goto failed;
+	ber_str2bv("20230415120000+0100", 0, 0, &bv);
+	if (pwdshadow_parse_time_fast(&bv, &val) == 0)
+		goto failed;
+	ber_str2bv("2023041512000AZ", 0, 0, &bv);
+	if (pwdshadow_parse_time_fast(&bv, &val) == 0)
+		goto failed;
+
+	printf("# verify: parse_time %lu dates\n", count);
+
+	return(0);
+
+	failed:
+	fprintf(stderr, "pwdshadow-bench: parse_time(\"%s\") failed verification\n", bv.bv_val);
+	return(1);
+}
+
+
+int
+bench_verify_tuple(
+		bench_t *					bn )
+{
+	int						idx;
+	unsigned long			gen;
+	unsigned long			count;
+	const char *			text;
+	AttributeDescription *	ad;
+	Entry *					entries[6];
+	Entry *					nobody;
+	OperationBuffer			opbuf;
+	pwdshadow_tuple_t *		tu;
+	struct berval			key;
+	static const char *		uids[6] = { "tuple0", "tuple1", "tuple2", "tuple3", "tuple4", "tuple5" };
+
+	for(idx = 0; idx < 6; idx++)
+	{
+		entries[idx] = bench_tuple_entry(uids[idx], "90");
+		stub_entry_add(entries[idx]);
+	};
+	nobody = bench_tuple_entry("nobody", "60");
+
+	// cache of four entries keyed by uid, loaded through the backend
+	slap_str2ad("uid", &ad, &text);
+	bn->bn_bi.bi_op_search = bench_backend_search;
+	pwdshadow_tuple_reset(bn->bn_ps, ad, 4);
+	pwdshadow_cfg_publish(bn->bn_ps);
+
+	// entry is loaded once and then answered from the cache, a key without
+	// an entry is cached as a marker which passes searches to the backend
+	if ( ((bench_tuple_check(bn, "load",	"tuple0",	1, 0, "tuple0 90 45"))) ||
+	     ((bench_tuple_check(bn, "hit",		"tuple0",	0, 0, "tuple0 90 45"))) ||
+	     ((bench_tuple_check(bn, "load",	"nobody",	1, 1, "-"))) ||
+	     ((bench_tuple_check(bn, "bypass",	"nobody",	0, 1, "-"))) )
+		return(1);
+
+	// added entry removes the marker of its key, a modified entry is removed
+	// by its DN and a modified key removes the marker of the key
+	bench_write(bn, LDAP_REQ_ADD,		nobody,		NULL,			NULL);
+	bench_write(bn, LDAP_REQ_MODIFY,	entries[0],	"shadowMax",	"80");
+	if ( ((bench_tuple_check(bn, "add",		"nobody",	1, 0, "nobody 60 45"))) ||
+	     ((bench_tuple_check(bn, "modify",	"tuple0",	1, 0, "tuple0 80 -"))) ||
+	     ((bench_tuple_check(bn, "load",	"tuple9",	1, 1, "-"))) )
+		return(1);
+	bench_write(bn, LDAP_REQ_MODIFY,	entries[1],	"uid",			"tuple9");
+	if ( ((bench_tuple_check(bn, "modify",	"tuple9",	1, 0, "tuple9 90 45"))) ||
+	     ((bench_tuple_check(bn, "load",	"tuple2",	1, 0, "tuple2 90 45"))) )
+		return(1);
+
+	// deleted entry is removed by its DN
+	bench_write(bn, LDAP_REQ_DELETE,	entries[2],	NULL,			NULL);
+	if ((bench_tuple_check(bn, "delete",	"tuple2",	1, 1, "-")))
+		return(1);
+
+	// rename expires every cached entry
+	if ( ((bench_tuple_check(bn, "load",	"tuple3",	1, 0, "tuple3 90 45"))) ||
+	     ((bench_tuple_check(bn, "hit",		"tuple3",	0, 0, "tuple3 90 45"))) )
+		return(1);
+	bench_write(bn, LDAP_REQ_MODRDN,	entries[4],	NULL,			NULL);
+	if ((bench_tuple_check(bn, "modrdn",	"tuple3",	1, 0, "tuple3 90 45")))
+		return(1);
+
+	// entry searched before a write is not cached after the write
+	bench_op(bn, &opbuf);
+	ber_str2bv(uids[5], 0, 0, &key);
+	tu = NULL;
+	if ( (pwdshadow_tuple_lookup(&opbuf.ob_op, bn->bn_ps, ad, &key, &gen, &tu) != -1) ||
+	     ((pwdshadow_tuple_invalidate(bn->bn_ps, &entries[0]->e_nname, NULL, 0))) ||
+	     (pwdshadow_tuple_insert(bn->bn_ps, ad, gen, pwdshadow_tuple_new(pwdshadow_cfg_get(bn->bn_ps), &key, entries[5])) != -1) ||
+	     ((bench_tuple_check(bn, "race",	"tuple5",	1, 0, "tuple5 90 45"))) )
+	{
+		fprintf(stderr, "pwdshadow-bench: tuple cache generation failed verification\n");
+		return(1);
+	};
+
+	// referenced entries get a second chance when the clock evicts, the
+	// hand stops at the first entry not referenced since it last passed
+	pwdshadow_tuple_reset(bn->bn_ps, ad, 4);
+	if ( ((bench_tuple_check(bn, "load",	"tuple0",	1, 0, "tuple0 80 -"))) ||
+	     ((bench_tuple_check(bn, "load",	"tuple3",	1, 0, "tuple3 90 45"))) ||
+	     ((bench_tuple_check(bn, "load",	"tuple4",	1, 0, "tuple4 90 45"))) ||
+	     ((bench_tuple_check(bn, "load",	"tuple5",	1, 0, "tuple5 90 45"))) ||
+	     ((bench_tuple_check(bn, "hit",		"tuple0",	0, 0, "tuple0 80 -"))) ||
+	     ((bench_tuple_check(bn, "hit",		"tuple3",	0, 0, "tuple3 90 45"))) ||
+	     ((bench_tuple_check(bn, "evict",	"tuple9",	1, 0, "tuple9 90 45"))) ||
+	     ((bench_tuple_check(bn, "hit",		"tuple0",	0, 0, "tuple0 80 -"))) ||
+	     ((bench_tuple_check(bn, "hit",		"tuple3",	0, 0, "tuple3 90 45"))) ||
+	     ((bench_tuple_check(bn, "evicted",	"tuple4",	1, 0, "tuple4 90 45"))) ||
+	     ((bench_tuple_check(bn, "evicted",	"tuple5",	1, 0, "tuple5 90 45"))) )
+		return(1);
+	count = bn->bn_ps->ps_tuple_count;
+
+	pwdshadow_tuple_reset(bn->bn_ps, NULL, 0);
+	pwdshadow_cfg_publish(bn->bn_ps);
+	bn->bn_bi.bi_op_search = NULL;
+	for(idx = 0; idx < 6; idx++)
+	{
+		stub_entry_remove(entries[idx]);
+		stub_entry_free(entries[idx]);
+	};
+	stub_entry_remove(nobody);
+	stub_entry_free(nobody);
+	if (count != 4)
+	{
+		fprintf(stderr, "pwdshadow-bench: tuple cache of %lu entries failed verification\n", count);
+		return(1);
+	};
+
+	printf("# verify: tuple_cache lookups, writes and evictions\n");
+
+	return(0);
+}
+
+
+// passes a write through the overlay, applies it and the generated
+// modifications to the entry as the backend would and returns the result
+// through the callbacks
+int
+bench_write(
+		bench_t *					bn,
+		ber_tag_t					tag,
+		Entry *						e,
+		const char *				attr,
+		const char *				value )
+{
+	int						idx;
+	const char *			text;
+	Modifications			mod;
+	Modifications *			mods;
+	OperationBuffer			opbuf;
+	SlapReply				rs;
+	struct berval			vals[2];
+
+	bench_op(bn, &opbuf);
+	opbuf.ob_op.o_tag		= tag;
+	opbuf.ob_op.o_callback	= NULL;
+	opbuf.ob_op.o_req_dn	= e->e_name;
+	opbuf.ob_op.o_req_ndn	= e->e_nname;
+	memset(&rs, 0, sizeof(rs));
+
+	switch(tag)
+	{
+		case LDAP_REQ_ADD:
+		opbuf.ob_op.ora_e = e;
+		pwdshadow_op_add(&opbuf.ob_op, &rs);
+		stub_entry_add(e);
+		break;
+
+		case LDAP_REQ_DELETE:
+		pwdshadow_op_delete(&opbuf.ob_op, &rs);
+		stub_entry_remove(e);
+		break;
+
+		case LDAP_REQ_MODIFY:
+		memset(&mod, 0, sizeof(mod));
+		ber_str2bv(value, 0, 0, &vals[0]);
+		BER_BVZERO(&vals[1]);
+		slap_str2ad(attr, &mod.sml_desc, &text);
+		mod.sml_op					= LDAP_MOD_REPLACE;
+		mod.sml_type				= mod.sml_desc->ad_cname;
+		mod.sml_numvals				= 1;
+		mod.sml_values				= vals;
+		mod.sml_nvalues				= vals;
+		opbuf.ob_op.orm_modlist		= &mod;
+		pwdshadow_op_modify(&opbuf.ob_op, &rs);
+		for(mods = opbuf.ob_op.orm_modlist; ((mods)); mods = mods->sml_next)
+		{
+			if (mods->sml_op != LDAP_MOD_ADD)
+				attr_delete(&e->e_attrs, mods->sml_desc);
+			if (mods->sml_op == LDAP_MOD_DELETE)
+				continue;
+			for(idx = 0; ((mods->sml_values[idx].bv_val)); idx++)
+				attr_merge_one(e, mods->sml_desc, &mods->sml_values[idx], NULL);
+		};
+		break;
+
+		// entry is renamed to the DN of value, or keeps its name
+		case LDAP_REQ_MODRDN:
+		ber_str2bv(((value)) ? value : e->e_nname.bv_val, 0, 0, &opbuf.ob_op.orr_newDN);
+		opbuf.ob_op.orr_nnewDN = opbuf.ob_op.orr_newDN;
+		pwdshadow_op_modrdn(&opbuf.ob_op, &rs);
+		break;
+
+		default:
+		return(-1);
+	};
+
+	send_ldap_result(&opbuf.ob_op, &rs);
+	slap_cleanup_play(&opbuf.ob_op, &rs);
+
+	// callbacks saw the old DN of a renamed entry
+	if ( (tag != LDAP_REQ_MODRDN) || (!(value)) )
+		return(0);
+	ch_free(e->e_name.bv_val);
+	ch_free(e->e_nname.bv_val);
+	ber_str2bv(value, 0, 1, &e->e_name);
+	ber_str2bv(value, 0, 1, &e->e_nname);
+
+	return(0);
+}
+
+/* end of source file */
@@ -0,0 +1,697 @@
+/*
+ *  OpenLDAP pwdPolicy/shadowAccount Overlay
+ *  Copyright (c) 2023 David M. Syzdek <david@syzdek.net>
+ *  All rights reserved.
+ *
+ *  Dominus vobiscum. Et cum spiritu tuo.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted only as authorized by the OpenLDAP
+ *  Public License.
+ *
+ *  A copy of this license is available in the file LICENSE in the
+ *  top-level directory of the distribution or, alternatively, at
+ *  <http://www.OpenLDAP.org/license.html>.
+ */
+/*
+ *  LDAP load generator used by bench/load.sh. Each client thread opens its
+ *  own connection and issues a weighted mix of password changes, unrelated
+ *  modifications, adds and searches against the users created by the
+ *  script. Results are written as a single row of tab separated values.
+ *
+ *  When a target rate is given (-r), each client sends requests on a fixed
+ *  schedule and latency is measured from the scheduled send time, which
+ *  includes time spent waiting behind a slow request. Without a target rate
+ *  the clients run closed loop and the corrected percentiles back-fill the
+ *  samples a stalled client did not send, using the mean latency as the
+ *  expected interval.
+ */
+#define LDAP_DEPRECATED 0
+
+///////////////
+//           //
+//  Headers  //
+//           //
+///////////////
+
+#include <errno.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <lber.h>
+#include <ldap.h>
+
+
+///////////////////
+//               //
+//  Definitions  //
+//               //
+///////////////////
+
+#define LOAD_OP_PASSWORD		0
+#define LOAD_OP_MODIFY			1
+#define LOAD_OP_ADD				2
+#define LOAD_OP_SEARCH			3
+#define LOAD_OP_COUNT			4
+
+#define LOAD_DEFAULT_URI		"ldapi://%2Ftmp%2Fslapo-pwdshadow%2Fvar%2Frun%2Fslapd.sock"
+#define LOAD_DEFAULT_BINDDN		"cn=Manager,dc=example,dc=com"
+#define LOAD_DEFAULT_BASE		"ou=People,dc=example,dc=com"
+#define LOAD_DEFAULT_MIX		"password=40,modify=40,add=10,search=10"
+
+
+//////////////////
+//              //
+//  Data Types  //
+//              //
+//////////////////
+
+typedef struct load_samples_t
+{
+	uint64_t *				ls_vals;
+	size_t					ls_len;
+	size_t					ls_size;
+} load_samples_t;
+
+
+typedef struct load_cfg_t
+{
+	const char *			lc_uri;
+	const char *			lc_binddn;
+	const char *			lc_passwd;
+	const char *			lc_base;
+	const char *			lc_label;
+	const char *			lc_threads;
+	int						lc_clients;
+	int						lc_duration;
+	int						lc_users;
+	double					lc_rate;
+	unsigned				lc_mix[LOAD_OP_COUNT];
+	unsigned				lc_mix_total;
+	struct timespec			lc_start;
+} load_cfg_t;
+
+
+typedef struct load_client_t
+{
+	int						cl_id;
+	load_cfg_t *			cl_cfg;
+	LDAP *					cl_ld;
+	pthread_t				cl_thread;
+	uint64_t				cl_seed;
+	unsigned long			cl_ops;
+	unsigned long			cl_errors;
+	unsigned long			cl_seq;
+	load_samples_t			cl_latency;
+	load_samples_t			cl_corrected;
+} load_client_t;
+
+
+//////////////////
+//              //
+//  Prototypes  //
+//              //
+//////////////////
+
+static void *
+load_client(
+		void *						arg );
+
+
+static int
+load_cmp(
+		const void *				a,
+		const void *				b );
+
+
+static int
+load_connect(
+		load_client_t *				cl );
+
+
+static uint64_t
+load_now(
+		void );
+
+
+static int
+load_op(
+		load_client_t *				cl,
+		int							type );
+
+
+static int
+load_parse_mix(
+		load_cfg_t *				cfg,
+		const char *				str );
+
+
+static uint64_t
+load_percentile(
+		load_samples_t *			ls,
+		double						pct );
+
+
+static uint64_t
+load_random(
+		load_client_t *				cl );
+
+
+static int
+load_record(
+		load_samples_t *			ls,
+		uint64_t					val );
+
+
+static void
+load_usage(
+		void );
+
+
+/////////////////
+//             //
+//  Variables  //
+//             //
+/////////////////
+
+static const char * load_op_names[LOAD_OP_COUNT] =
+{
+	[LOAD_OP_PASSWORD]		= "password",
+	[LOAD_OP_MODIFY]		= "modify",
+	[LOAD_OP_ADD]			= "add",
+	[LOAD_OP_SEARCH]		= "search",
+};
+
+
+/////////////////
+//             //
+//  Functions  //
+//             //
+/////////////////
+
+int
+main(
+		int							argc,
+		char *						argv[] )
+{
+	int						c;
+	int						i;
+	unsigned long			ops;
+	unsigned long			errors;
+	uint64_t				elapsed;
+	uint64_t				mean;
+	uint64_t				lat;
+	size_t					pos;
+	load_cfg_t				cfg;
+	load_client_t *			clients;
+	load_samples_t			latency;
+	load_samples_t			corrected;
+
+	memset(&cfg, 0, sizeof(cfg));
+	cfg.lc_uri			= LOAD_DEFAULT_URI;
+	cfg.lc_binddn		= LOAD_DEFAULT_BINDDN;
+	cfg.lc_base			= LOAD_DEFAULT_BASE;
+	cfg.lc_label		= "-";
+	cfg.lc_threads		= "-";
+	cfg.lc_clients		= 1;
+	cfg.lc_duration		= 10;
+	cfg.lc_users		= 1000;
+	load_parse_mix(&cfg, LOAD_DEFAULT_MIX);
+
+	while((c = getopt(argc, argv, "b:c:D:d:H:hl:m:Pr:t:u:w:")) != -1)
+	{
+		switch(c)
+		{
+			case 'b':
+			cfg.lc_base = optarg;
+			break;
+
+			case 'c':
+			if ((cfg.lc_clients = atoi(optarg)) < 1)
+			{
+				fprintf(stderr, "pwdshadow-load: invalid number of clients\n");
+				return(1);
+			};
+			break;
+
+			case 'D':
+			cfg.lc_binddn = optarg;
+			break;
+
+			case 'd':
+			if ((cfg.lc_duration = atoi(optarg)) < 1)
+			{
+				fprintf(stderr, "pwdshadow-load: invalid duration\n");
+				return(1);
+			};
+			break;
+
+			case 'H':
+			cfg.lc_uri = optarg;
+			break;
+
+			case 'h':
+			load_usage();
+			return(0);
+
+			case 'l':
+			cfg.lc_label = optarg;
+			break;
+
+			case 'm':
+			if ((load_parse_mix(&cfg, optarg)))
+			{
+				fprintf(stderr, "pwdshadow-load: invalid operation mix\n");
+				return(1);
+			};
+			break;
+
+			case 'P':
+			printf("label\tthreads\tclients\tops\terrors\tseconds\tops/s");
+			printf("\tp50_us\tp99_us\tp999_us\tco_p50_us\tco_p99_us\tco_p999_us\n");
+			return(0);
+
+			case 'r':
+			cfg.lc_rate = strtod(optarg, NULL);
+			break;
+
+			case 't':
+			cfg.lc_threads = optarg;
+			break;
+
+			case 'u':
+			if ((cfg.lc_users = atoi(optarg)) < 1)
+			{
+				fprintf(stderr, "pwdshadow-load: invalid number of users\n");
+				return(1);
+			};
+			break;
+
+			case 'w':
+			cfg.lc_passwd = optarg;
+			break;
+
+			default:
+			fprintf(stderr, "Try `pwdshadow-load -h' for more information.\n");
+			return(1);
+		};
+	};
+
+	if ((clients = calloc((size_t)cfg.lc_clients, sizeof(load_client_t))) == NULL)
+	{
+		fprintf(stderr, "pwdshadow-load: out of virtual memory\n");
+		return(1);
+	};
+
+	// connect all clients before starting the clock
+	for(i = 0; i < cfg.lc_clients; i++)
+	{
+		clients[i].cl_id	= i;
+		clients[i].cl_cfg	= &cfg;
+		clients[i].cl_seed	= 0x9e3779b97f4a7c15ULL * (uint64_t)(i + 1);
+		if ((load_connect(&clients[i])))
+			return(1);
+	};
+
+	clock_gettime(CLOCK_MONOTONIC, &cfg.lc_start);
+	for(i = 0; i < cfg.lc_clients; i++)
+		pthread_create(&clients[i].cl_thread, NULL, load_client, &clients[i]);
+	for(i = 0; i < cfg.lc_clients; i++)
+		pthread_join(clients[i].cl_thread, NULL);
+	elapsed = load_now() - ((uint64_t)cfg.lc_start.tv_sec * 1000000000ULL + (uint64_t)cfg.lc_start.tv_nsec);
+
+	// merge samples from clients
+	ops		= 0;
+	errors	= 0;
+	memset(&latency,   0, sizeof(latency));
+	memset(&corrected, 0, sizeof(corrected));
+	for(i = 0; i < cfg.lc_clients; i++)
+	{
+		ops		+= clients[i].cl_ops;
+		errors	+= clients[i].cl_errors;
+		for(pos = 0; pos < clients[i].cl_latency.ls_len; pos++)
+			load_record(&latency, clients[i].cl_latency.ls_vals[pos]);
+		for(pos = 0; pos < clients[i].cl_corrected.ls_len; pos++)
+			load_record(&corrected, clients[i].cl_corrected.ls_vals[pos]);
+		ldap_unbind_ext_s(clients[i].cl_ld, NULL, NULL);
+	};
+
+	// back-fill samples not sent by stalled closed loop clients
+	if ( (cfg.lc_rate <= 0) && ((latency.ls_len)) )
+	{
+		for(pos = 0, mean = 0; pos < latency.ls_len; pos++)
+			mean += latency.ls_vals[pos];
+		mean /= latency.ls_len;
+		for(pos = 0; pos < latency.ls_len; pos++)
+		{
+			load_record(&corrected, latency.ls_vals[pos]);
+			for(lat = latency.ls_vals[pos]; ( ((mean)) && (lat >= (mean * 2)) ); lat -= mean)
+				load_record(&corrected, lat - mean);
+		};
+	};
+
+	qsort(latency.ls_vals,   latency.ls_len,   sizeof(uint64_t), load_cmp);
+	qsort(corrected.ls_vals, corrected.ls_len, sizeof(uint64_t), load_cmp);
+
+	printf("%s\t%s\t%i\t%lu\t%lu\t%.3f\t%.1f", cfg.lc_label, cfg.lc_threads, cfg.lc_clients,
+		ops, errors, (double)elapsed / 1e9, (double)ops * 1e9 / (double)elapsed);
+	printf("\t%.1f\t%.1f\t%.1f",
+		(double)load_percentile(&latency, 50.0)  / 1e3,
+		(double)load_percentile(&latency, 99.0)  / 1e3,
+		(double)load_percentile(&latency, 99.9)  / 1e3);
+	printf("\t%.1f\t%.1f\t%.1f\n",
+		(double)load_percentile(&corrected, 50.0)  / 1e3,
+		(double)load_percentile(&corrected, 99.0)  / 1e3,
+		(double)load_percentile(&corrected, 99.9)  / 1e3);
+
+	for(i = 0; i < cfg.lc_clients; i++)
+	{
+		free(clients[i].cl_latency.ls_vals);
+		free(clients[i].cl_corrected.ls_vals);
+	};
+	free(latency.ls_vals);
+	free(corrected.ls_vals);
+	free(clients);
+
+	return( ((errors)) ? 2 : 0 );
+}
+
+
+void *
+load_client(
+		void *						arg )
+{
+	int						type;
+	unsigned				pick;
+	uint64_t				start;
+	uint64_t				stop;
+	uint64_t				deadline;
+	uint64_t				interval;
+	uint64_t				scheduled;
+	load_client_t *			cl;
+	load_cfg_t *			cfg;
+	struct timespec			ts;
+
+	cl			= arg;
+	cfg			= cl->cl_cfg;
+	start		= (uint64_t)cfg->lc_start.tv_sec * 1000000000ULL + (uint64_t)cfg->lc_start.tv_nsec;
+	deadline	= start + (uint64_t)cfg->lc_duration * 1000000000ULL;
+	interval	= (cfg->lc_rate > 0) ? (uint64_t)(1e9 * cfg->lc_clients / cfg->lc_rate) : 0;
+
+	// stagger open loop clients across one interval
+	scheduled	= start + ((interval * (uint64_t)cl->cl_id) / (uint64_t)cfg->lc_clients);
+
+	while(scheduled < deadline)
+	{
+		// wait for the scheduled send time
+		if ((interval))
+		{
+			if ((start = load_now()) < scheduled)
+			{
+				ts.tv_sec	= (time_t)(scheduled / 1000000000ULL);
+				ts.tv_nsec	= (long)(scheduled % 1000000000ULL);
+				clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+			};
+		};
+
+		// select operation
+		pick = (unsigned)(load_random(cl) % cfg->lc_mix_total);
+		for(type = 0; pick >= cfg->lc_mix[type]; type++)
+			pick -= cfg->lc_mix[type];
+
+		start = load_now();
+		if ((load_op(cl, type)))
+			cl->cl_errors++;
+		stop = load_now();
+		cl->cl_ops++;
+
+		load_record(&cl->cl_latency, stop - start);
+		if ((interval))
+		{
+			load_record(&cl->cl_corrected, stop - scheduled);
+			scheduled += interval;
+		} else {
+			scheduled = stop;
+		};
+	};
+
+	return(NULL);
+}
+
+
+int
+load_cmp(
+		const void *				a,
+		const void *				b )
+{
+	uint64_t		x = *(const uint64_t *)a;
+	uint64_t		y = *(const uint64_t *)b;
+	return( (x > y) - (x < y) );
+}
+
+
+int
+load_connect(
+		load_client_t *				cl )
+{
+	int						rc;
+	int						version;
+	struct berval			cred;
+
+	if ((rc = ldap_initialize(&cl->cl_ld, cl->cl_cfg->lc_uri)) != LDAP_SUCCESS)
+	{
+		fprintf(stderr, "pwdshadow-load: ldap_initialize(): %s\n", ldap_err2string(rc));
+		return(-1);
+	};
+
+	version = LDAP_VERSION3;
+	ldap_set_option(cl->cl_ld, LDAP_OPT_PROTOCOL_VERSION, &version);
+	ldap_set_option(cl->cl_ld, LDAP_OPT_REFERRALS, LDAP_OPT_OFF);
+
+	cred.bv_val = (char *)(((cl->cl_cfg->lc_passwd)) ? cl->cl_cfg->lc_passwd : "");
+	cred.bv_len = strlen(cred.bv_val);
+	if ((rc = ldap_sasl_bind_s(cl->cl_ld, cl->cl_cfg->lc_binddn, LDAP_SASL_SIMPLE, &cred, NULL, NULL, NULL)) != LDAP_SUCCESS)
+	{
+		fprintf(stderr, "pwdshadow-load: ldap_sasl_bind_s(): %s\n", ldap_err2string(rc));
+		return(-1);
+	};
+
+	return(0);
+}
+
+
+uint64_t
+load_now(
+		void )
+{
+	struct timespec			ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return( (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec );
+}
+
+
+int
+load_op(
+		load_client_t *				cl,
+		int							type )
+{
+	int						rc;
+	char					dn[256];
+	char					uid[64];
+	char					value[64];
+	char					num[16];
+	char *					vals[7][4];
+	LDAPMod					mods[7];
+	LDAPMod *				modp[8];
+	LDAPMessage *			res;
+	static char *			attrs[] = { "*", "+", NULL };
+
+	snprintf(uid, sizeof(uid), "load%06u", (unsigned)(load_random(cl) % (uint64_t)cl->cl_cfg->lc_users));
+	snprintf(value, sizeof(value), "load-%i-%lu", cl->cl_id, cl->cl_seq++);
+
+	memset(mods, 0, sizeof(mods));
+	memset(modp, 0, sizeof(modp));
+	memset(vals, 0, sizeof(vals));
+
+	switch(type)
+	{
+		case LOAD_OP_PASSWORD:
+		case LOAD_OP_MODIFY:
+		snprintf(dn, sizeof(dn), "uid=%s,%s", uid, cl->cl_cfg->lc_base);
+		vals[0][0]				= value;
+		mods[0].mod_op			= LDAP_MOD_REPLACE;
+		mods[0].mod_type		= (type == LOAD_OP_PASSWORD) ? "userPassword" : "description";
+		mods[0].mod_values		= vals[0];
+		modp[0]					= &mods[0];
+		rc = ldap_modify_ext_s(cl->cl_ld, dn, modp, NULL, NULL);
+		break;
+
+		case LOAD_OP_ADD:
+		snprintf(uid, sizeof(uid), "add%02i%010lu", cl->cl_id, cl->cl_seq);
+		snprintf(dn, sizeof(dn), "uid=%s,%s", uid, cl->cl_cfg->lc_base);
+		snprintf(num, sizeof(num), "%lu", 100000 + (cl->cl_seq % 100000));
+		vals[0][0] = "inetOrgPerson";
+		vals[0][1] = "posixAccount";
+		vals[0][2] = "shadowAccount";
+		vals[1][0] = uid;
+		vals[2][0] = uid;
+		vals[3][0] = num;
+		vals[4][0] = num;
+		vals[5][0] = "/nonexistent";
+		vals[6][0] = value;
+		mods[0].mod_type = "objectClass";
+		mods[1].mod_type = "uid";
+		mods[2].mod_type = "cn";
+		mods[3].mod_type = "uidNumber";
+		mods[4].mod_type = "gidNumber";
+		mods[5].mod_type = "homeDirectory";
+		mods[6].mod_type = "userPassword";
+		for(rc = 0; rc < 7; rc++)
+		{
+			mods[rc].mod_op		= LDAP_MOD_ADD;
+			mods[rc].mod_values	= vals[rc];
+			modp[rc]			= &mods[rc];
+		};
+		rc = ldap_add_ext_s(cl->cl_ld, dn, modp, NULL, NULL);
+		break;
+
+		default:
+		snprintf(dn, sizeof(dn), "uid=%s,%s", uid, cl->cl_cfg->lc_base);
+		res = NULL;
+		rc = ldap_search_ext_s(cl->cl_ld, dn, LDAP_SCOPE_BASE, "(objectClass=*)", attrs, 0, NULL, NULL, NULL, 0, &res);
+		if ((res))
+			ldap_msgfree(res);
+		break;
+	};
+
+	if (rc != LDAP_SUCCESS)
+	{
+		fprintf(stderr, "pwdshadow-load: %s %s: %s\n", load_op_names[type], dn, ldap_err2string(rc));
+		return(-1);
+	};
+
+	return(0);
+}
+
+
+int
+load_parse_mix(
+		load_cfg_t *				cfg,
+		const char *				str )
+{
+	int						type;
+	size_t					len;
+	char *					end;
+	unsigned				mix[LOAD_OP_COUNT];
+	unsigned				total;
+
+	memset(mix, 0, sizeof(mix));
+	total = 0;
+
+	// parse "name=weight,name=weight,..."
+	while((*str))
+	{
+		for(type = 0; type < LOAD_OP_COUNT; type++)
+		{
+			len = strlen(load_op_names[type]);
+			if ( (!(strncmp(str, load_op_names[type], len))) && (str[len] == '=') )
+				break;
+		};
+		if (type == LOAD_OP_COUNT)
+			return(-1);
+		str		+= len + 1;
+		mix[type] = (unsigned)strtoul(str, &end, 10);
+		if (end == str)
+			return(-1);
+		total	+= mix[type];
+		str		 = ((*end == ',')) ? end + 1 : end;
+		if ( ((*end)) && (*end != ',') )
+			return(-1);
+	};
+	if (!(total))
+		return(-1);
+
+	memcpy(cfg->lc_mix, mix, sizeof(mix));
+	cfg->lc_mix_total = total;
+
+	return(0);
+}
+
+
+uint64_t
+load_percentile(
+		load_samples_t *			ls,
+		double						pct )
+{
+	size_t			idx;
+	if (!(ls->ls_len))
+		return(0);
+	idx = (size_t)((pct / 100.0) * (double)(ls->ls_len - 1) + 0.5);
+	return(ls->ls_vals[idx]);
+}
+
+
+uint64_t
+load_random(
+		load_client_t *				cl )
+{
+	// xorshift64*
+	cl->cl_seed ^= cl->cl_seed >> 12;
+	cl->cl_seed ^= cl->cl_seed << 25;
+	cl->cl_seed ^= cl->cl_seed >> 27;
+	return(cl->cl_seed * 0x2545f4914f6cdd1dULL);
+}
+
+
+int
+load_record(
+		load_samples_t *			ls,
+		uint64_t					val )
+{
+	size_t			size;
+	uint64_t *		vals;
+
+	if (ls->ls_len >= ls->ls_size)
+	{
+		size = ((ls->ls_size)) ? ls->ls_size * 2 : 4096;
+		if ((vals = realloc(ls->ls_vals, size * sizeof(uint64_t))) == NULL)
+			return(ENOMEM);
+		ls->ls_vals = vals;
+		ls->ls_size = size;
+	};
+	ls->ls_vals[ls->ls_len++] = val;
+
+	return(0);
+}
+
+
+void
+load_usage(
+		void )
+{
+	printf("Usage: pwdshadow-load [options]\n");
+	printf("Options:\n");
+	printf("  -b dn                     base of load test users (default: %s)\n", LOAD_DEFAULT_BASE);
+	printf("  -c clients                number of concurrent clients (default: 1)\n");
+	printf("  -D dn                     bind DN (default: %s)\n", LOAD_DEFAULT_BINDDN);
+	printf("  -d seconds                duration of test (default: 10)\n");
+	printf("  -H uri                    LDAP URI (default: %s)\n", LOAD_DEFAULT_URI);
+	printf("  -h                        print this help and exit\n");
+	printf("  -l label                  label of result row\n");
+	printf("  -m mix                    operation weights (default: %s)\n", LOAD_DEFAULT_MIX);
+	printf("  -P                        print column headers and exit\n");
+	printf("  -r ops/s                  target rate of all clients (default: closed loop)\n");
+	printf("  -t threads                slapd threads reported in result row\n");
+	printf("  -u users                  number of load test users (default: 1000)\n");
+	printf("  -w passwd                 bind password\n");
+	printf("\n");
+	return;
+}
+
+/* end of source file */
@@ -0,0 +1,159 @@
+#!/bin/sh
+#
+#   OpenLDAP pwdPolicy/shadowAccount Overlay
+#   Copyright (c) 2023 David M. Syzdek <david@syzdek.net>
+#   All rights reserved.
+#
+#   Dominus vobiscum. Et cum spiritu tuo.
+#
+#   Redistribution and use in source and binary forms, with or without
+#   modification, are permitted only as authorized by the OpenLDAP
+#   Public License.
+#
+#   A copy of this license is available in the file LICENSE in the
+#   top-level directory of the distribution or, alternatively, at
+#   <http://www.OpenLDAP.org/license.html>.
+#
+#   Runs bench/pwdshadow-load against slapd from the test environment
+#   (make test-env-install) with the overlay enabled and disabled, for each
+#   value of slapd `threads' and each client concurrency. Each run starts a
+#   new slapd on an mdb database in a temporary directory, listening only on
+#   ldapi://. Results are written to stdout as tab separated values.
+#
+#   Environment:
+#      LOAD_PREFIX     OpenLDAP install prefix (/tmp/slapo-pwdshadow)
+#      LOAD_THREADS    slapd threads to test ("4 16")
+#      LOAD_CLIENTS    client concurrencies to test ("1 2 4 8 16 32 64")
+#      LOAD_DURATION   seconds per run (30)
+#      LOAD_USERS      number of pre-loaded users (10000)
+#      LOAD_MIX        operation weights (see pwdshadow-load -h)
+#      LOAD_RATE       target ops/s of all clients, 0 for closed loop (0)
+#      LOAD_OVERLAY    overlay states to test ("on off")
+#      LOAD_TIMEOUT    seconds to wait for slapd to start or stop (30)
+#
+
+LOAD_PREFIX="${LOAD_PREFIX:-/tmp/slapo-pwdshadow}"
+LOAD_THREADS="${LOAD_THREADS:-4 16}"
+LOAD_CLIENTS="${LOAD_CLIENTS:-1 2 4 8 16 32 64}"
+LOAD_DURATION="${LOAD_DURATION:-30}"
+LOAD_USERS="${LOAD_USERS:-10000}"
+LOAD_MIX="${LOAD_MIX:-password=40,modify=40,add=10,search=10}"
+LOAD_RATE="${LOAD_RATE:-0}"
+LOAD_OVERLAY="${LOAD_OVERLAY:-on off}"
+LOAD_TIMEOUT="${LOAD_TIMEOUT:-30}"
+
+SRCDIR="$(cd "$(dirname "${0}")/.." && pwd)"
+LOADGEN="${SRCDIR}/bench/pwdshadow-load"
+ROOTDN="cn=Manager,dc=example,dc=com"
+ROOTPW="drowssap"
+
+
+load_config()
+{
+	# $1: temporary directory, $2: slapd threads, $3: overlay on/off
+	sed \
+		-e "s,/tmp/slapo-pwdshadow/var/run,${1},g" \
+		-e "s,/tmp/slapo-pwdshadow/var/openldap-data,${1}/data,g" \
+		-e "s,/tmp/slapo-pwdshadow,${LOAD_PREFIX},g" \
+		"${SRCDIR}/docs/test-env/slapd.conf" \
+		|awk -v threads="${2}" '{ print } /^argsfile/ { printf("threads\t\t%s\n", threads) }' \
+		|if test "x${3}" = "xoff";then
+			grep -v -e '^overlay[[:space:]]*pwdshadow' -e '^pwdshadow_'
+		else
+			cat
+		fi
+}
+
+
+load_users()
+{
+	# $1: number of users
+	awk -v users="${1}" 'BEGIN {
+		for(i = 0; i < users; i++)
+		{
+			printf("dn: uid=load%06u,ou=People,dc=example,dc=com\n", i);
+			printf("objectClass: inetOrgPerson\n");
+			printf("objectClass: posixAccount\n");
+			printf("objectClass: shadowAccount\n");
+			printf("uid: load%06u\ncn: load%06u\nsn: load%06u\n", i, i, i);
+			printf("uidNumber: %u\ngidNumber: %u\n", 200000 + i, 200000 + i);
+			printf("homeDirectory: /nonexistent\n");
+			printf("userPassword: load%06u\n", i);
+			printf("pwdChangedTime: 20230101000000Z\n");
+			printf("pwdShadowGenerate: TRUE\n\n");
+		};
+	}'
+}
+
+
+load_run()
+{
+	# $1: slapd threads, $2: overlay on/off
+	RUNDIR="$(mktemp -d /tmp/pwdshadow-load.XXXXXX)" || exit 1
+	mkdir -p "${RUNDIR}/data"
+	SOCK="${RUNDIR}/slapd.sock"
+	URI="ldapi://$(printf '%s' "${SOCK}" |sed -e 's,/,%2F,g')"
+
+	load_config "${RUNDIR}" "${1}" "${2}" > "${RUNDIR}/slapd.conf"
+	cat "${SRCDIR}/docs/test-env/test-env.ldif" > "${RUNDIR}/load.ldif"
+	load_users "${LOAD_USERS}" >> "${RUNDIR}/load.ldif"
+
+	"${LOAD_PREFIX}/sbin/slapadd" -q -f "${RUNDIR}/slapd.conf" -l "${RUNDIR}/load.ldif" \
+		> "${RUNDIR}/slapadd.log" 2>&1 \
+		|| { cat "${RUNDIR}/slapadd.log" 1>&2; rm -Rf "${RUNDIR}"; exit 1; }
+
+	"${LOAD_PREFIX}/libexec/slapd" -f "${RUNDIR}/slapd.conf" -h "${URI}" \
+		|| { rm -Rf "${RUNDIR}"; exit 1; }
+
+	# slapd exits after forking if the database cannot be opened
+	WAIT=0
+	while test ! -S "${SOCK}";do
+		if test ${WAIT} -ge ${LOAD_TIMEOUT};then
+			echo "slapd did not listen on ${URI} within ${LOAD_TIMEOUT}s" 1>&2
+			test -f "${RUNDIR}/slapd.pid" && kill "$(cat "${RUNDIR}/slapd.pid")"
+			rm -Rf "${RUNDIR}"
+			exit 1
+		fi
+		sleep 1
+		WAIT=$((WAIT + 1))
+	done
+
+	for CLIENTS in ${LOAD_CLIENTS};do
+		"${LOADGEN}" \
+			-H "${URI}" \
+			-D "${ROOTDN}" \
+			-w "${ROOTPW}" \
+			-l "overlay-${2}" \
+			-t "${1}" \
+			-c "${CLIENTS}" \
+			-d "${LOAD_DURATION}" \
+			-u "${LOAD_USERS}" \
+			-m "${LOAD_MIX}" \
+			-r "${LOAD_RATE}"
+	done
+
+	kill "$(cat "${RUNDIR}/slapd.pid")"
+	WAIT=0
+	while test -f "${RUNDIR}/slapd.pid" && test ${WAIT} -lt ${LOAD_TIMEOUT};do
+		sleep 1
+		WAIT=$((WAIT + 1))
+	done
+	rm -Rf "${RUNDIR}"
+}
+
+
+if test ! -x "${LOADGEN}";then
+	echo "pwdshadow-load not found; run \`make load'" 1>&2
+	exit 1
+fi
+
+echo "# pwdshadow load test"
+echo "# duration: ${LOAD_DURATION}s users: ${LOAD_USERS} mix: ${LOAD_MIX} rate: ${LOAD_RATE}"
+"${LOADGEN}" -P
+for OVERLAY in ${LOAD_OVERLAY};do
+	for THREADS in ${LOAD_THREADS};do
+		load_run "${THREADS}" "${OVERLAY}"
+	done
+done
+
+# end of script
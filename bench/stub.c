@@ -0,0 +1,1751 @@
+/*
+ *  OpenLDAP pwdPolicy/shadowAccount Overlay
+ *  Copyright (c) 2023 David M. Syzdek <david@syzdek.net>
+ *  All rights reserved.
+ *
+ *  Dominus vobiscum. Et cum spiritu tuo.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted only as authorized by the OpenLDAP
+ *  Public License.
+ *
+ *  A copy of this license is available in the file LICENSE in the
+ *  top-level directory of the distribution or, alternatively, at
+ *  <http://www.OpenLDAP.org/license.html>.
+ */
+/*
+ *  Minimal implementation of the slapd functions used by pwdshadow.c which
+ *  do not depend on the database. The implementations are approximations of
+ *  slapd sufficient for benchmarking the overlay's operations and for
+ *  tools/ldif.c. The database, DNs and attribute types of the benchmarks
+ *  are provided by bench/backend.c and those of tools/ldif.c by
+ *  tools/runtime.c. Attribute descriptions must be added before other
+ *  threads are started, after which the stub may be used by multiple
+ *  threads.
+ */
+#include "portable.h"
+
+///////////////
+//           //
+//  Headers  //
+//           //
+///////////////
+
+#include <errno.h>
+#include <ldap.h>
+#include "slap.h"
+#include "stub.h"
+
+
+///////////////////
+//               //
+//  Definitions  //
+//               //
+///////////////////
+
+#define STUB_SCHEMA_MAX			128
+
+
+//////////////////
+//              //
+//  Data Types  //
+//              //
+//////////////////
+
+// sorted array used in place of libldap's AVL trees
+struct Avlnode
+{
+	size_t					av_count;
+	size_t					av_size;
+	void **					av_data;
+};
+
+
+/////////////////
+//             //
+//  Variables  //
+//             //
+/////////////////
+
+// counters and clock used by benchmarks
+unsigned long				stub_allocs			= 0;
+unsigned long				stub_tmpallocs		= 0;
+time_t						stub_clock			= 1681560000;
+int							stub_shadow_update	= 0;
+
+// slapd globals referenced by the overlay
+ldap_pvt_thread_pool_t		connection_pool;
+static BackendDB			stub_frontend;
+BackendDB *					frontendDB			= &stub_frontend;
+runqueue_t					slapd_rq			= { PTHREAD_MUTEX_INITIALIZER };
+volatile int				slapd_shutdown		= 0;
+int							slapMode			= 0;
+AttributeName				slap_anlist_no_attrs[] = { { BER_BVC("1.1"), NULL }, { BER_BVNULL, NULL } };
+struct slap_schema_t		slap_schema			= { NULL };
+
+// registered attribute descriptions
+static AttributeDescription *	stub_ads[STUB_SCHEMA_MAX];
+static int						stub_ads_count		= 0;
+
+
+//////////////////
+//              //
+//  Prototypes  //
+//              //
+//////////////////
+
+static void
+stub_filter2str(
+		Filter *					f,
+		struct berval *				bv );
+
+
+static int
+stub_response_play(
+		Operation *					op,
+		SlapReply *					rs );
+
+
+static void *
+stub_tmpcalloc(
+		ber_len_t					n,
+		ber_len_t					size,
+		void *						ctx );
+
+
+static void
+stub_tmpfree(
+		void *						ptr,
+		void *						ctx );
+
+
+static void *
+stub_tmpmalloc(
+		ber_len_t					size,
+		void *						ctx );
+
+
+static void *
+stub_tmprealloc(
+		void *						ptr,
+		ber_len_t					size,
+		void *						ctx );
+
+
+/////////////////
+//             //
+//  Variables  //
+//             //
+/////////////////
+
+static BerMemoryFunctions	stub_tmpmfuncs =
+{
+	stub_tmpmalloc,
+	stub_tmpcalloc,
+	stub_tmprealloc,
+	stub_tmpfree
+};
+
+
+/////////////////
+//             //
+//  Functions  //
+//             //
+/////////////////
+
+int
+access_allowed(
+		Operation *					op,
+		Entry *						e,
+		AttributeDescription *		ad,
+		struct berval *				val,
+		int							access,
+		void *						state )
+{
+	if ( (!(op)) || (!(e)) || (!(ad)) || (!(val)) || (!(access)) || ((state)) )
+		return(1);
+	return(1);
+}
+
+
+int
+ad_inlist(
+		AttributeDescription *		ad,
+		AttributeName *				attrs )
+{
+	for(; ( ((attrs)) && ((attrs->an_name.bv_val)) ); attrs++)
+		if (attrs->an_desc == ad)
+			return(1);
+	return(0);
+}
+
+
+Attribute *
+attr_alloc(
+		AttributeDescription *		ad )
+{
+	Attribute *		a;
+	a			= ch_calloc(1, sizeof(Attribute));
+	a->a_desc	= ad;
+	return(a);
+}
+
+
+int
+attr_delete(
+		Attribute **				attrs,
+		AttributeDescription *		ad )
+{
+	Attribute *		a;
+
+	for(; ((*attrs)); attrs = &(*attrs)->a_next)
+	{
+		if ((*attrs)->a_desc != ad)
+			continue;
+		a		= *attrs;
+		*attrs	= a->a_next;
+		ber_bvarray_free(a->a_vals);
+		ch_free(a);
+		return(LDAP_SUCCESS);
+	};
+	return(LDAP_NO_SUCH_ATTRIBUTE);
+}
+
+
+Attribute *
+attr_find(
+		Attribute *					a,
+		AttributeDescription *		ad )
+{
+	for(; ((a)); a = a->a_next)
+		if (a->a_desc == ad)
+			return(a);
+	return(NULL);
+}
+
+
+int
+attr_merge_one(
+		Entry *						e,
+		AttributeDescription *		ad,
+		struct berval *				val,
+		struct berval *				nval )
+{
+	Attribute *		a;
+	Attribute **	ap;
+
+	for(ap = &e->e_attrs; ( ((*ap)) && ((*ap)->a_desc != ad) ); ap = &(*ap)->a_next);
+	if ((a = *ap) == NULL)
+	{
+		a	= attr_alloc(ad);
+		*ap	= a;
+	};
+
+	a->a_vals = ch_realloc(a->a_vals, sizeof(struct berval) * (a->a_numvals + 2));
+	ber_dupbv(&a->a_vals[a->a_numvals], val);
+	BER_BVZERO(&a->a_vals[a->a_numvals+1]);
+	a->a_nvals = a->a_vals;
+	a->a_numvals++;
+
+	if (!(nval))
+		return(0);
+	return(0);
+}
+
+
+int
+be_isroot_dn(
+		BackendDB *					be,
+		struct berval *				ndn )
+{
+	return(bvmatch(&be->be_rootndn, ndn));
+}
+
+
+int
+be_shadow_update(
+		Operation *					op )
+{
+	if (!(op))
+		return(0);
+	return(stub_shadow_update);
+}
+
+
+int
+ber_bvarray_add(
+		BerVarray *					p,
+		struct berval *				bv )
+{
+	return(ber_bvarray_add_x(p, bv, NULL));
+}
+
+
+int
+ber_bvarray_add_x(
+		BerVarray *					p,
+		struct berval *				bv,
+		void *						ctx )
+{
+	int				n;
+
+	for(n = 0; ( ((*p)) && ((*p)[n].bv_val) ); n++);
+	*p			= ch_realloc(*p, sizeof(struct berval) * (n + 2));
+	(*p)[n]		= *bv;
+	BER_BVZERO(&(*p)[n+1]);
+
+	if ((ctx))
+		return(n);
+	return(n);
+}
+
+
+void
+ber_bvarray_free(
+		BerVarray					a )
+{
+	ber_bvarray_free_x(a, NULL);
+	return;
+}
+
+
+void
+ber_bvarray_free_x(
+		BerVarray					a,
+		void *						ctx )
+{
+	int				n;
+	if (!(a))
+		return;
+	for(n = 0; ((a[n].bv_val)); n++)
+		ch_free(a[n].bv_val);
+	ch_free(a);
+	if ((ctx))
+		return;
+	return;
+}
+
+
+int
+ber_bvcmp(
+		struct berval *				a,
+		struct berval *				b )
+{
+	if (a->bv_len != b->bv_len)
+		return( (a->bv_len < b->bv_len) ? -1 : 1 );
+	return(memcmp(a->bv_val, b->bv_val, a->bv_len));
+}
+
+
+struct berval *
+ber_dupbv(
+		struct berval *				dst,
+		struct berval *				src )
+{
+	return(ber_dupbv_x(dst, src, NULL));
+}
+
+
+struct berval *
+ber_dupbv_x(
+		struct berval *				dst,
+		struct berval *				src,
+		void *						ctx )
+{
+	dst->bv_len	= src->bv_len;
+	dst->bv_val	= ch_malloc(src->bv_len + 1);
+	memcpy(dst->bv_val, src->bv_val, src->bv_len);
+	dst->bv_val[dst->bv_len] = '\0';
+	if ((ctx))
+		return(dst);
+	return(dst);
+}
+
+
+void
+ber_memfree(
+		void *						p )
+{
+	ch_free(p);
+	return;
+}
+
+
+void
+ber_memfree_x(
+		void *						p,
+		void *						ctx )
+{
+	ch_free(p);
+	if ((ctx))
+		return;
+	return;
+}
+
+
+struct berval *
+ber_str2bv(
+		const char *				s,
+		ber_len_t					len,
+		int							dup,
+		struct berval *				bv )
+{
+	bv->bv_len = ((len)) ? len : strlen(s);
+	if ((dup))
+	{
+		bv->bv_val = ch_malloc(bv->bv_len + 1);
+		memcpy(bv->bv_val, s, bv->bv_len);
+		bv->bv_val[bv->bv_len] = '\0';
+		return(bv);
+	};
+	bv->bv_val = (char *)s;
+	return(bv);
+}
+
+
+void *
+ch_calloc(
+		size_t						nelem,
+		size_t						size )
+{
+	__atomic_add_fetch(&stub_allocs, 1, __ATOMIC_RELAXED);
+	return(calloc(nelem, size));
+}
+
+
+void
+ch_free(
+		void *						ptr )
+{
+	free(ptr);
+	return;
+}
+
+
+void *
+ch_malloc(
+		size_t						size )
+{
+	__atomic_add_fetch(&stub_allocs, 1, __ATOMIC_RELAXED);
+	return(malloc(size));
+}
+
+
+void *
+ch_realloc(
+		void *						ptr,
+		size_t						size )
+{
+	__atomic_add_fetch(&stub_allocs, 1, __ATOMIC_RELAXED);
+	return(realloc(ptr, size));
+}
+
+
+char *
+ch_strdup(
+		const char *				s )
+{
+	__atomic_add_fetch(&stub_allocs, 1, __ATOMIC_RELAXED);
+	return(strdup(s));
+}
+
+
+int
+config_register_schema(
+		ConfigTable *				ct,
+		ConfigOCs *					co )
+{
+	if ( (!(ct)) || (!(co)) )
+		return(0);
+	return(0);
+}
+
+
+void
+connection_fake_init2(
+		Connection *				conn,
+		OperationBuffer *			opbuf,
+		void *						ctx,
+		int							newmem )
+{
+	memset(opbuf, 0, sizeof(OperationBuffer));
+	opbuf->ob_op.o_hdr				= &opbuf->ob_hdr;
+	opbuf->ob_hdr.oh_tmpmfuncs		= &stub_tmpmfuncs;
+	opbuf->ob_hdr.oh_time			= stub_clock;
+	if ( (!(conn)) || ((ctx)) || ((newmem)) )
+		return;
+	return;
+}
+
+
+int
+filter_escape_value(
+		struct berval *				in,
+		struct berval *				out )
+{
+	ber_len_t		pos;
+	char *			ptr;
+
+	out->bv_val	= ch_malloc((in->bv_len * 3) + 1);
+	ptr			= out->bv_val;
+	for(pos = 0; pos < in->bv_len; pos++)
+	{
+		switch(in->bv_val[pos])
+		{
+			case '(':
+			case ')':
+			case '*':
+			case '\\':
+			case '\0':
+			ptr += sprintf(ptr, "\\%02x", (unsigned char)in->bv_val[pos]);
+			break;
+
+			default:
+			*ptr++ = in->bv_val[pos];
+			break;
+		};
+	};
+	*ptr		= '\0';
+	out->bv_len	= ptr - out->bv_val;
+
+	return(0);
+}
+
+
+Filter *
+filter_dup(
+		Filter *					f,
+		void *						memctx )
+{
+	Filter *		n;
+	Filter *		c;
+	Filter **		cp;
+
+	n			= stub_tmpcalloc(1, sizeof(Filter), memctx);
+	n->f_choice	= f->f_choice;
+	switch(f->f_choice & SLAPD_FILTER_MASK)
+	{
+		case LDAP_FILTER_AND:
+		case LDAP_FILTER_OR:
+		case LDAP_FILTER_NOT:
+		for(c = f->f_list, cp = &n->f_list; ((c)); c = c->f_next, cp = &(*cp)->f_next)
+			*cp = filter_dup(c, memctx);
+		break;
+
+		case LDAP_FILTER_EQUALITY:
+		case LDAP_FILTER_GE:
+		case LDAP_FILTER_LE:
+		n->f_ava				= stub_tmpcalloc(1, sizeof(AttributeAssertion), memctx);
+		n->f_av_desc			= f->f_av_desc;
+		n->f_av_value.bv_len	= f->f_av_value.bv_len;
+		n->f_av_value.bv_val	= stub_tmpmalloc(f->f_av_value.bv_len + 1, memctx);
+		memcpy(n->f_av_value.bv_val, f->f_av_value.bv_val, f->f_av_value.bv_len + 1);
+		break;
+
+		default:
+		n->f_un = f->f_un;
+		break;
+	};
+
+	return(n);
+}
+
+
+void
+filter_free_x(
+		Operation *					op,
+		Filter *					f,
+		int							freeme )
+{
+	Filter *		c;
+	Filter *		next;
+
+	if ( (!(op)) || (!(f)) )
+		return;
+
+	switch(f->f_choice & SLAPD_FILTER_MASK)
+	{
+		case LDAP_FILTER_AND:
+		case LDAP_FILTER_OR:
+		case LDAP_FILTER_NOT:
+		for(c = f->f_list; ((c)); c = next)
+		{
+			next = c->f_next;
+			filter_free_x(op, c, 1);
+		};
+		break;
+
+		case LDAP_FILTER_EQUALITY:
+		case LDAP_FILTER_GE:
+		case LDAP_FILTER_LE:
+		op->o_tmpfree(f->f_av_value.bv_val, op->o_tmpmemctx);
+		op->o_tmpfree(f->f_ava, op->o_tmpmemctx);
+		break;
+
+		default:
+		break;
+	};
+
+	if ((freeme))
+		op->o_tmpfree(f, op->o_tmpmemctx);
+	return;
+}
+
+
+void
+filter2bv_x(
+		Operation *					op,
+		Filter *					f,
+		struct berval *				bv )
+{
+	BER_BVZERO(bv);
+	stub_filter2str(f, bv);
+	if (!(op))
+		return;
+	return;
+}
+
+
+int
+is_at_syntax(
+		AttributeType *				at,
+		const char *				oid )
+{
+	return(!(strcmp(at->sat_syntax->ssyn_oid, oid)));
+}
+
+
+int
+is_entry_objectclass(
+		Entry *						e,
+		ObjectClass *				oc,
+		unsigned					flags )
+{
+	int				idx;
+	Attribute *		a;
+
+	if ( (!(oc)) || ((a = attr_find(e->e_attrs, slap_schema.si_ad_objectClass)) == NULL) )
+		return(0);
+	for(idx = 0; ((a->a_vals[idx].bv_val)); idx++)
+		if (!(strcasecmp(a->a_vals[idx].bv_val, oc->soc_cname.bv_val)))
+			return(1);
+	if ((flags))
+		return(0);
+	return(0);
+}
+
+
+int
+ldap_avl_dup_error(
+		void *						a,
+		void *						b )
+{
+	if ( (!(a)) || (!(b)) )
+		return(-1);
+	return(-1);
+}
+
+
+void *
+ldap_avl_delete(
+		Avlnode **					root,
+		void *						data,
+		AVL_CMP *					cmp )
+{
+	size_t			pos;
+	void *			ptr;
+
+	if (!(*root))
+		return(NULL);
+	for(pos = 0; pos < (*root)->av_count; pos++)
+	{
+		if ((cmp(data, (*root)->av_data[pos])))
+			continue;
+		ptr = (*root)->av_data[pos];
+		memmove(&(*root)->av_data[pos], &(*root)->av_data[pos+1], sizeof(void *) * ((*root)->av_count - pos - 1));
+		(*root)->av_count--;
+		return(ptr);
+	};
+
+	return(NULL);
+}
+
+
+void *
+ldap_avl_find(
+		Avlnode *					root,
+		const void *				data,
+		AVL_CMP *					cmp )
+{
+	size_t			lo;
+	size_t			hi;
+	size_t			mid;
+	int				rc;
+
+	if (!(root))
+		return(NULL);
+
+	for(lo = 0, hi = root->av_count; lo < hi; )
+	{
+		mid = (lo + hi) / 2;
+		if ((rc = cmp(data, root->av_data[mid])) == 0)
+			return(root->av_data[mid]);
+		if (rc < 0)
+			hi = mid;
+		else
+			lo = mid + 1;
+	};
+
+	return(NULL);
+}
+
+
+int
+ldap_avl_free(
+		Avlnode *					root,
+		AVL_FREE *					dfree )
+{
+	size_t			pos;
+
+	if (!(root))
+		return(0);
+	for(pos = 0; ( ((dfree)) && (pos < root->av_count) ); pos++)
+		dfree(root->av_data[pos]);
+	free(root->av_data);
+	free(root);
+
+	return(0);
+}
+
+
+int
+ldap_avl_insert(
+		Avlnode **					root,
+		void *						data,
+		AVL_CMP *					cmp,
+		AVL_DUP *					dup )
+{
+	size_t			pos;
+
+	if (!(*root))
+		*root = calloc(1, sizeof(Avlnode));
+
+	if ((ldap_avl_find(*root, data, cmp)))
+		return( ((dup)) ? dup(data, NULL) : -1 );
+
+	if ((*root)->av_count == (*root)->av_size)
+	{
+		(*root)->av_size = ((*root)->av_size) ? (*root)->av_size * 2 : 16;
+		(*root)->av_data = realloc((*root)->av_data, sizeof(void *) * (*root)->av_size);
+	};
+
+	for(pos = 0; ( (pos < (*root)->av_count) && (cmp(data, (*root)->av_data[pos]) > 0) ); pos++);
+	memmove(&(*root)->av_data[pos+1], &(*root)->av_data[pos], sizeof(void *) * ((*root)->av_count - pos));
+	(*root)->av_data[pos] = data;
+	(*root)->av_count++;
+
+	return(0);
+}
+
+
+int
+ldap_pvt_runqueue_isrunning(
+		runqueue_t *				rq,
+		struct re_s *				entry )
+{
+	if ( (!(rq)) || (!(entry)) )
+		return(0);
+	return(0);
+}
+
+
+struct re_s *
+ldap_pvt_runqueue_insert(
+		runqueue_t *				rq,
+		time_t						interval,
+		ldap_pvt_thread_start_t *	fn,
+		void *						arg,
+		char *						name,
+		char *						tname )
+{
+	struct re_s *	entry;
+
+	entry		= ch_calloc(1, sizeof(struct re_s));
+	entry->arg	= arg;
+
+	if ( (!(rq)) || (!(interval)) || (!(fn)) || (!(name)) || (!(tname)) )
+		return(entry);
+	return(entry);
+}
+
+
+void
+ldap_pvt_runqueue_remove(
+		runqueue_t *				rq,
+		struct re_s *				entry )
+{
+	ch_free(entry);
+	if (!(rq))
+		return;
+	return;
+}
+
+
+void
+ldap_pvt_runqueue_resched(
+		runqueue_t *				rq,
+		struct re_s *				entry,
+		int							defer )
+{
+	if ( (!(rq)) || (!(entry)) || ((defer)) )
+		return;
+	return;
+}
+
+
+void
+ldap_pvt_runqueue_stoptask(
+		runqueue_t *				rq,
+		struct re_s *				entry )
+{
+	if ( (!(rq)) || (!(entry)) )
+		return;
+	return;
+}
+
+
+int
+ldap_pvt_thread_cond_broadcast(
+		ldap_pvt_thread_cond_t *	cond )
+{
+	return(pthread_cond_broadcast(cond));
+}
+
+
+int
+ldap_pvt_thread_cond_destroy(
+		ldap_pvt_thread_cond_t *	cond )
+{
+	return(pthread_cond_destroy(cond));
+}
+
+
+int
+ldap_pvt_thread_cond_init(
+		ldap_pvt_thread_cond_t *	cond )
+{
+	return(pthread_cond_init(cond, NULL));
+}
+
+
+int
+ldap_pvt_thread_cond_wait(
+		ldap_pvt_thread_cond_t *	cond,
+		ldap_pvt_thread_mutex_t *	mutex )
+{
+	return(pthread_cond_wait(cond, mutex));
+}
+
+
+int
+ldap_pvt_thread_mutex_destroy(
+		ldap_pvt_thread_mutex_t *	mutex )
+{
+	return(pthread_mutex_destroy(mutex));
+}
+
+
+int
+ldap_pvt_thread_mutex_init(
+		ldap_pvt_thread_mutex_t *	mutex )
+{
+	return(pthread_mutex_init(mutex, NULL));
+}
+
+
+int
+ldap_pvt_thread_mutex_lock(
+		ldap_pvt_thread_mutex_t *	mutex )
+{
+	return(pthread_mutex_lock(mutex));
+}
+
+
+int
+ldap_pvt_thread_mutex_unlock(
+		ldap_pvt_thread_mutex_t *	mutex )
+{
+	return(pthread_mutex_unlock(mutex));
+}
+
+
+void *
+ldap_pvt_thread_pool_context(
+		void )
+{
+	return(NULL);
+}
+
+
+int
+ldap_pvt_thread_pool_pausecheck(
+		ldap_pvt_thread_pool_t *	pool )
+{
+	if (!(pool))
+		return(0);
+	return(0);
+}
+
+
+int
+ldap_pvt_thread_pool_pausing(
+		ldap_pvt_thread_pool_t *	pool )
+{
+	if (!(pool))
+		return(0);
+	return(0);
+}
+
+
+int
+ldap_pvt_thread_pool_submit(
+		ldap_pvt_thread_pool_t *	pool,
+		ldap_pvt_thread_start_t *	fn,
+		void *						arg )
+{
+	// tasks are not queued, callers run the task themselves
+	if ( (!(pool)) || (!(fn)) || (!(arg)) )
+		return(-1);
+	return(-1);
+}
+
+
+int
+ldap_pvt_thread_rdwr_destroy(
+		ldap_pvt_thread_rdwr_t *	rw )
+{
+	return(pthread_rwlock_destroy(rw));
+}
+
+
+int
+ldap_pvt_thread_rdwr_init(
+		ldap_pvt_thread_rdwr_t *	rw )
+{
+	return(pthread_rwlock_init(rw, NULL));
+}
+
+
+int
+ldap_pvt_thread_rdwr_rlock(
+		ldap_pvt_thread_rdwr_t *	rw )
+{
+	return(pthread_rwlock_rdlock(rw));
+}
+
+
+int
+ldap_pvt_thread_rdwr_runlock(
+		ldap_pvt_thread_rdwr_t *	rw )
+{
+	return(pthread_rwlock_unlock(rw));
+}
+
+
+int
+ldap_pvt_thread_rdwr_wlock(
+		ldap_pvt_thread_rdwr_t *	rw )
+{
+	return(pthread_rwlock_wrlock(rw));
+}
+
+
+int
+ldap_pvt_thread_rdwr_wunlock(
+		ldap_pvt_thread_rdwr_t *	rw )
+{
+	return(pthread_rwlock_unlock(rw));
+}
+
+
+int
+load_extop2(
+		struct berval *				oid,
+		slap_mask_t					flags,
+		BI_op_func *				fn,
+		unsigned					tmpflags )
+{
+	if ( (!(oid)) || ((flags)) || (!(fn)) || ((tmpflags)) )
+		return(0);
+	return(0);
+}
+
+
+void *
+ldap_tavl_delete(
+		TAvlnode **					root,
+		void *						data,
+		AVL_CMP *					cmp )
+{
+	TAvlnode *		node;
+	void *			ptr;
+
+	for(node = *root; ( ((node)) && ((cmp(data, node->avl_data))) ); node = node->avl_link[TAVL_DIR_RIGHT]);
+	if (!(node))
+		return(NULL);
+
+	if ((node->avl_link[TAVL_DIR_LEFT]))
+		node->avl_link[TAVL_DIR_LEFT]->avl_link[TAVL_DIR_RIGHT] = node->avl_link[TAVL_DIR_RIGHT];
+	else
+		*root = node->avl_link[TAVL_DIR_RIGHT];
+	if ((node->avl_link[TAVL_DIR_RIGHT]))
+		node->avl_link[TAVL_DIR_RIGHT]->avl_link[TAVL_DIR_LEFT] = node->avl_link[TAVL_DIR_LEFT];
+	ptr = node->avl_data;
+	free(node);
+
+	return(ptr);
+}
+
+
+TAvlnode *
+ldap_tavl_end(
+		TAvlnode *					root,
+		int							dir )
+{
+	if ( (!(root)) || (dir == TAVL_DIR_LEFT) )
+		return(root);
+	for(; ((root->avl_link[TAVL_DIR_RIGHT])); root = root->avl_link[TAVL_DIR_RIGHT]);
+	return(root);
+}
+
+
+void *
+ldap_tavl_find(
+		TAvlnode *					root,
+		const void *				data,
+		AVL_CMP *					cmp )
+{
+	int				ret;
+	TAvlnode *		node;
+
+	if ( ((node = ldap_tavl_find3(root, data, cmp, &ret)) == NULL) || ((ret)) )
+		return(NULL);
+	return(node->avl_data);
+}
+
+
+// returns the first node not less than data, otherwise the last node
+TAvlnode *
+ldap_tavl_find3(
+		TAvlnode *					root,
+		const void *				data,
+		AVL_CMP *					cmp,
+		int *						ret )
+{
+	TAvlnode *		node;
+
+	*ret = 0;
+	for(node = root; ((node)); node = node->avl_link[TAVL_DIR_RIGHT])
+	{
+		if ((*ret = cmp(data, node->avl_data)) <= 0)
+			return(node);
+		if (!(node->avl_link[TAVL_DIR_RIGHT]))
+			return(node);
+	};
+
+	return(NULL);
+}
+
+
+int
+ldap_tavl_free(
+		TAvlnode *					root,
+		AVL_FREE *					dfree )
+{
+	TAvlnode *		next;
+
+	for(; ((root)); root = next)
+	{
+		next = root->avl_link[TAVL_DIR_RIGHT];
+		if ((dfree))
+			dfree(root->avl_data);
+		free(root);
+	};
+
+	return(0);
+}
+
+
+int
+ldap_tavl_insert(
+		TAvlnode **					root,
+		void *						data,
+		AVL_CMP *					cmp,
+		AVL_DUP *					dup )
+{
+	int				ret;
+	TAvlnode *		node;
+	TAvlnode *		prev;
+
+	if ( ((prev = ldap_tavl_find3(*root, data, cmp, &ret)) != NULL) && (!(ret)) )
+		return( ((dup)) ? dup(data, NULL) : -1 );
+
+	// insert before the first greater node, or after the last node
+	node			= calloc(1, sizeof(TAvlnode));
+	node->avl_data	= data;
+	if (!(prev))
+		*root = node;
+	else if (ret > 0)
+	{
+		prev->avl_link[TAVL_DIR_RIGHT]	= node;
+		node->avl_link[TAVL_DIR_LEFT]	= prev;
+	} else {
+		node->avl_link[TAVL_DIR_RIGHT]	= prev;
+		node->avl_link[TAVL_DIR_LEFT]	= prev->avl_link[TAVL_DIR_LEFT];
+		if ((prev->avl_link[TAVL_DIR_LEFT]))
+			prev->avl_link[TAVL_DIR_LEFT]->avl_link[TAVL_DIR_RIGHT] = node;
+		else
+			*root = node;
+		prev->avl_link[TAVL_DIR_LEFT]	= node;
+	};
+
+	return(0);
+}
+
+
+TAvlnode *
+ldap_tavl_next(
+		TAvlnode *					root,
+		int							dir )
+{
+	if (!(root))
+		return(NULL);
+	return(root->avl_link[dir]);
+}
+
+
+int
+lutil_atoi(
+		int *						v,
+		const char *				s )
+{
+	long			l;
+	char *			next;
+
+	errno	= 0;
+	l		= strtol(s, &next, 10);
+	if ( (next == s) || ((*next)) || ((errno)) )
+		return(-1);
+	*v = (int)l;
+
+	return(0);
+}
+
+
+int
+lutil_atoul(
+		unsigned long *				v,
+		const char *				s )
+{
+	unsigned long	ul;
+	char *			next;
+
+	errno	= 0;
+	ul		= strtoul(s, &next, 10);
+	if ( (next == s) || ((*next)) || ((errno)) )
+		return(-1);
+	*v = ul;
+
+	return(0);
+}
+
+
+int
+lutil_parsetime(
+		char *						atm,
+		struct lutil_tm *			tm )
+{
+	int				n;
+
+	// only supports GeneralizedTime values in the form YYYYmmddHHMMSSZ
+	memset(tm, 0, sizeof(struct lutil_tm));
+	n = sscanf(atm, "%4d%2d%2d%2d%2d%2d", &tm->tm_year, &tm->tm_mon, &tm->tm_mday, &tm->tm_hour, &tm->tm_min, &tm->tm_sec);
+	if (n != 6)
+		return(-1);
+	tm->tm_year	-= 1900;
+	tm->tm_mon	-= 1;
+
+	return(0);
+}
+
+
+int
+lutil_tm2time(
+		struct lutil_tm *			tm,
+		struct lutil_timet *		tt )
+{
+	long			y;
+	long			m;
+	long			era;
+	long			yoe;
+	long			doy;
+	long			doe;
+	long			days;
+
+	// days from civil date
+	y		= tm->tm_year + 1900;
+	m		= tm->tm_mon + 1;
+	y	   -= (m <= 2) ? 1 : 0;
+	era		= ((y >= 0) ? y : y - 399) / 400;
+	yoe		= y - era * 400;
+	doy		= (153 * (m + ((m > 2) ? -3 : 9)) + 2) / 5 + tm->tm_mday - 1;
+	doe		= yoe * 365 + yoe / 4 - yoe / 100 + doy;
+	days	= era * 146097 + doe - 719468;
+
+	tt->tt_sec	= (unsigned long)(days * 86400 + tm->tm_hour * 3600 + tm->tm_min * 60 + tm->tm_sec);
+	tt->tt_gsec	= 0;
+	tt->tt_usec	= tm->tm_usec;
+
+	return(0);
+}
+
+
+// object classes registered by the overlay are not named
+ObjectClass *
+oc_bvfind(
+		struct berval *				name )
+{
+	if (!(name))
+		return(NULL);
+	return(NULL);
+}
+
+
+ObjectClass *
+oc_find(
+		const char *				name )
+{
+	if (!(name))
+		return(NULL);
+	return(NULL);
+}
+
+
+// databases of the harness are not stacked unless bd_info is an overinfo
+int
+overlay_is_inst(
+		BackendDB *					be,
+		const char *				name )
+{
+	slap_overinst *		on;
+
+	if ( (!(be)) || (!(name)) || (!(be->bd_info->bi_type)) || ((strcmp(be->bd_info->bi_type, "over"))) )
+		return(0);
+	for(on = ((slap_overinfo *)be->bd_info)->oi_list; ((on)); on = on->on_next)
+		if (!(strcmp(on->on_bi.bi_type, name)))
+			return(1);
+	return(0);
+}
+
+
+int
+overlay_register(
+		slap_overinst *				on )
+{
+	if (!(on))
+		return(0);
+	return(0);
+}
+
+
+int
+register_at(
+		const char *				def,
+		AttributeDescription **		ad,
+		int							dupok )
+{
+	const char *	name;
+	const char *	syntax;
+	const char *	end;
+	char			buff[128];
+
+	// extract NAME and SYNTAX from the attributeType definition
+	if ((name = strstr(def, "NAME")) == NULL)
+		return(-1);
+	if ((name = strchr(name, '\'')) == NULL)
+		return(-1);
+	name++;
+	if ((end = strchr(name, '\'')) == NULL)
+		return(-1);
+	if ((syntax = strstr(def, "SYNTAX ")) == NULL)
+		return(-1);
+	sscanf(syntax + 7, "%127[0-9.]", buff);
+
+	*ad = stub_ad_new(name, end - name, buff, ((strstr(def, "NO-USER-MODIFICATION"))) ? SLAP_AT_NO_USER_MOD : 0);
+
+	if ((dupok))
+		return(0);
+	return(0);
+}
+
+
+int
+register_oc(
+		const char *				def,
+		ObjectClass **				oc,
+		int							dupok )
+{
+	*oc = calloc(1, sizeof(ObjectClass));
+	if ( (!(def)) || ((dupok)) )
+		return(0);
+	return(0);
+}
+
+
+// entries of the harness are owned by the caller and modified in place
+int
+rs_entry2modifiable(
+		Operation *					op,
+		SlapReply *					rs,
+		slap_overinst *				on )
+{
+	if ( (!(op)) || (!(rs)) || (!(on)) )
+		return(0);
+	return(0);
+}
+
+
+void
+rs_flush_entry(
+		Operation *					op,
+		SlapReply *					rs,
+		slap_overinst *				on )
+{
+	rs->sr_entry = NULL;
+	if ( (!(op)) || (!(on)) )
+		return;
+	return;
+}
+
+
+int
+send_ldap_result(
+		Operation *					op,
+		SlapReply *					rs )
+{
+	rs->sr_type = REP_RESULT;
+	stub_response_play(op, rs);
+	return(0);
+}
+
+
+int
+send_search_entry(
+		Operation *					op,
+		SlapReply *					rs )
+{
+	stub_response_play(op, rs);
+	return(LDAP_SUCCESS);
+}
+
+
+int
+slap_cleanup_play(
+		Operation *					op,
+		SlapReply *					rs )
+{
+	slap_callback *		sc;
+	slap_callback *		next;
+	slap_callback **	scp;
+
+	// callbacks remove themselves by setting o_callback to NULL
+	sc = op->o_callback;
+	for(scp = &sc; ((*scp)); )
+	{
+		next			= (*scp)->sc_next;
+		op->o_callback	= *scp;
+		if ((op->o_callback->sc_cleanup))
+		{
+			op->o_callback->sc_cleanup(op, rs);
+			if (!(op->o_callback))
+			{
+				*scp = next;
+				continue;
+			};
+		};
+		scp = &(*scp)->sc_next;
+	};
+	op->o_callback = sc;
+
+	return(0);
+}
+
+
+void
+slap_mods_free(
+		Modifications *				mods,
+		int							freevals )
+{
+	Modifications *	next;
+
+	for(; ((mods)); mods = next)
+	{
+		next = mods->sml_next;
+		if ((freevals))
+		{
+			ber_bvarray_free(mods->sml_values);
+			if (mods->sml_nvalues != mods->sml_values)
+				ber_bvarray_free(mods->sml_nvalues);
+		};
+		ch_free(mods);
+	};
+
+	return;
+}
+
+
+int
+slap_mods_opattrs(
+		Operation *					op,
+		Modifications **			modsp,
+		int							manage_ctxcsn )
+{
+	if ( (!(op)) || (!(modsp)) || ((manage_ctxcsn)) )
+		return(0);
+	return(0);
+}
+
+
+Filter *
+str2filter_x(
+		Operation *					op,
+		const char *				str )
+{
+	if ( (!(op)) || (!(str)) )
+		return(NULL);
+	return(ch_calloc(1, sizeof(Filter)));
+}
+
+
+// attribute description registered with the name, names are case insensitive
+AttributeDescription *
+stub_ad_find(
+		const char *				name )
+{
+	int				idx;
+
+	for(idx = 0; idx < stub_ads_count; idx++)
+		if (!(strcasecmp(stub_ads[idx]->ad_cname.bv_val, name)))
+			return(stub_ads[idx]);
+
+	return(NULL);
+}
+
+
+AttributeDescription *
+stub_ad_new(
+		const char *				name,
+		size_t						len,
+		const char *				syntax,
+		int							flags )
+{
+	AttributeDescription *	ad;
+
+	if (stub_ads_count >= STUB_SCHEMA_MAX)
+		return(NULL);
+
+	ad								= calloc(1, sizeof(AttributeDescription));
+	ad->ad_type						= calloc(1, sizeof(AttributeType));
+	ad->ad_type->sat_syntax			= calloc(1, sizeof(Syntax));
+	ad->ad_type->sat_syntax->ssyn_oid	= strdup(syntax);
+	ad->ad_type->sat_flags			= flags;
+	ad->ad_cname.bv_val				= strndup(name, len);
+	ad->ad_cname.bv_len				= len;
+	ad->ad_type->sat_cname			= ad->ad_cname;
+	stub_ads[stub_ads_count++]		= ad;
+
+	return(ad);
+}
+
+
+void
+stub_entry_free(
+		Entry *						e )
+{
+	Attribute *		a;
+	Attribute *		next;
+
+	if (!(e))
+		return;
+
+	for(a = e->e_attrs; ((a)); a = next)
+	{
+		next = a->a_next;
+		ber_bvarray_free(a->a_vals);
+		ch_free(a);
+	};
+	ch_free(e->e_name.bv_val);
+	ch_free(e->e_nname.bv_val);
+	ch_free(e);
+
+	return;
+}
+
+
+Entry *
+stub_entry_new(
+		const char *				dn )
+{
+	Entry *			e;
+
+	e = ch_calloc(1, sizeof(Entry));
+	ber_str2bv(dn, 0, 1, &e->e_name);
+	ber_str2bv(dn, 0, 1, &e->e_nname);
+
+	return(e);
+}
+
+
+int
+stub_entry_set(
+		Entry *						e,
+		const char *				name,
+		const char *				value )
+{
+	struct berval			bv;
+	AttributeDescription *	ad;
+	const char *			text;
+
+	if (slap_str2ad(name, &ad, &text) != LDAP_SUCCESS)
+		return(-1);
+	bv.bv_val	= (char *)value;
+	bv.bv_len	= strlen(value);
+
+	return(attr_merge_one(e, ad, &bv, NULL));
+}
+
+
+void
+stub_op_init(
+		OperationBuffer *			opbuf )
+{
+	connection_fake_init2(NULL, opbuf, NULL, 0);
+	return;
+}
+
+
+// passes a reply to the response callbacks of an operation until a
+// callback does not return SLAP_CB_CONTINUE, each callback is found in
+// o_callback as in slapd
+int
+stub_response_play(
+		Operation *					op,
+		SlapReply *					rs )
+{
+	int					rc;
+	slap_callback *		sc;
+	slap_callback *		first;
+
+	rc		= SLAP_CB_CONTINUE;
+	first	= op->o_callback;
+	for(sc = first; ( ((sc)) && (rc == SLAP_CB_CONTINUE) ); sc = sc->sc_next)
+	{
+		if (!(sc->sc_response))
+			continue;
+		op->o_callback	= sc;
+		rc				= sc->sc_response(op, rs);
+	};
+	op->o_callback = first;
+
+	return(rc);
+}
+
+
+time_t
+stub_time(
+		time_t *					tp )
+{
+	if ((tp))
+		*tp = stub_clock;
+	return(stub_clock);
+}
+
+
+// appends string representation of filter to a buffer allocated with
+// malloc(), assertion values are not escaped and undefined assertions are
+// prefixed with '?' as by slapd
+void
+stub_filter2str(
+		Filter *					f,
+		struct berval *				bv )
+{
+	char			buff[256];
+	const char *	op;
+	Filter *		c;
+	size_t			len;
+
+	op = "";
+	switch(f->f_choice & SLAPD_FILTER_MASK)
+	{
+		case LDAP_FILTER_AND:	op = "&";	break;
+		case LDAP_FILTER_OR:	op = "|";	break;
+		case LDAP_FILTER_NOT:	op = "!";	break;
+		case LDAP_FILTER_EQUALITY:	op = "=";	break;
+		case LDAP_FILTER_GE:	op = ">=";	break;
+		case LDAP_FILTER_LE:	op = "<=";	break;
+		default: break;
+	};
+
+	switch(f->f_choice & SLAPD_FILTER_MASK)
+	{
+		case LDAP_FILTER_AND:
+		case LDAP_FILTER_OR:
+		case LDAP_FILTER_NOT:
+		snprintf(buff, sizeof(buff), "(%s", op);
+		break;
+
+		case LDAP_FILTER_EQUALITY:
+		case LDAP_FILTER_GE:
+		case LDAP_FILTER_LE:
+		snprintf(buff, sizeof(buff), "(%s%s%s%s)", ((f->f_choice & SLAPD_FILTER_UNDEFINED)) ? "?" : "", f->f_av_desc->ad_cname.bv_val, op, f->f_av_value.bv_val);
+		break;
+
+		case LDAP_FILTER_PRESENT:
+		snprintf(buff, sizeof(buff), "(%s=*)", f->f_desc->ad_cname.bv_val);
+		break;
+
+		default:
+		snprintf(buff, sizeof(buff), "(?=undefined)");
+		break;
+	};
+
+	len			= strlen(buff);
+	bv->bv_val	= realloc(bv->bv_val, bv->bv_len + len + 1);
+	memcpy(&bv->bv_val[bv->bv_len], buff, len + 1);
+	bv->bv_len += len;
+
+	switch(f->f_choice & SLAPD_FILTER_MASK)
+	{
+		case LDAP_FILTER_AND:
+		case LDAP_FILTER_OR:
+		case LDAP_FILTER_NOT:
+		for(c = f->f_list; ((c)); c = c->f_next)
+			stub_filter2str(c, bv);
+		bv->bv_val					= realloc(bv->bv_val, bv->bv_len + 2);
+		bv->bv_val[bv->bv_len++]	= ')';
+		bv->bv_val[bv->bv_len]		= '\0';
+		break;
+
+		default:
+		break;
+	};
+
+	return;
+}
+
+
+void *
+stub_tmpcalloc(
+		ber_len_t					n,
+		ber_len_t					size,
+		void *						ctx )
+{
+	__atomic_add_fetch(&stub_tmpallocs, 1, __ATOMIC_RELAXED);
+	if ((ctx))
+		return(calloc(n, size));
+	return(calloc(n, size));
+}
+
+
+void
+stub_tmpfree(
+		void *						ptr,
+		void *						ctx )
+{
+	free(ptr);
+	if ((ctx))
+		return;
+	return;
+}
+
+
+void *
+stub_tmpmalloc(
+		ber_len_t					size,
+		void *						ctx )
+{
+	__atomic_add_fetch(&stub_tmpallocs, 1, __ATOMIC_RELAXED);
+	if ((ctx))
+		return(malloc(size));
+	return(malloc(size));
+}
+
+
+void *
+stub_tmprealloc(
+		void *						ptr,
+		ber_len_t					size,
+		void *						ctx )
+{
+	__atomic_add_fetch(&stub_tmpallocs, 1, __ATOMIC_RELAXED);
+	if ((ctx))
+		return(realloc(ptr, size));
+	return(realloc(ptr, size));
+}
+
+
+// evaluates presence and equality assertions and their conjunctions and
+// disjunctions, other filters are treated as false
+int
+test_filter(
+		Operation *					op,
+		Entry *						e,
+		Filter *					f )
+{
+	int				idx;
+	Attribute *		a;
+
+	switch(f->f_choice)
+	{
+		case LDAP_FILTER_AND:
+		for(f = f->f_and; ((f)); f = f->f_next)
+			if ((idx = test_filter(op, e, f)) != LDAP_COMPARE_TRUE)
+				return(idx);
+		return(LDAP_COMPARE_TRUE);
+
+		case LDAP_FILTER_OR:
+		for(f = f->f_or; ((f)); f = f->f_next)
+			if ((idx = test_filter(op, e, f)) == LDAP_COMPARE_TRUE)
+				return(idx);
+		return(LDAP_COMPARE_FALSE);
+
+		case LDAP_FILTER_PRESENT:
+		return( ((attr_find(e->e_attrs, f->f_desc))) ? LDAP_COMPARE_TRUE : LDAP_COMPARE_FALSE );
+
+		case LDAP_FILTER_EQUALITY:
+		if ((a = attr_find(e->e_attrs, f->f_av_desc)) == NULL)
+			return(LDAP_COMPARE_FALSE);
+		for(idx = 0; ((a->a_nvals[idx].bv_val)); idx++)
+			if (bvmatch(&a->a_nvals[idx], &f->f_av_value))
+				return(LDAP_COMPARE_TRUE);
+		return(LDAP_COMPARE_FALSE);
+
+		default:
+		break;
+	};
+
+	return(LDAP_COMPARE_FALSE);
+}
+
+
+int
+value_add_one(
+		BerVarray *					vals,
+		struct berval *				val )
+{
+	struct berval	bv;
+	ber_dupbv(&bv, (struct berval *)val);
+	return(ber_bvarray_add(vals, &bv));
+}
+
+/* end of source file */
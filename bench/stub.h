@@ -0,0 +1,63 @@
+/*
+ *  OpenLDAP pwdPolicy/shadowAccount Overlay
+ *  Copyright (c) 2023 David M. Syzdek <david@syzdek.net>
+ *  All rights reserved.
+ *
+ *  Dominus vobiscum. Et cum spiritu tuo.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted only as authorized by the OpenLDAP
+ *  Public License.
+ *
+ *  A copy of this license is available in the file LICENSE in the
+ *  top-level directory of the distribution or, alternatively, at
+ *  <http://www.OpenLDAP.org/license.html>.
+ */
+/*
+ *  Interfaces of the slapd stub which are used by the benchmarks and by
+ *  tools/ldif.c to prepare entries and to measure allocations, and of the
+ *  database of the benchmarks in bench/backend.c.
+ */
+#ifndef _PWDSHADOW_STUB_H
+#define _PWDSHADOW_STUB_H 1
+
+
+/////////////////
+//             //
+//  Variables  //
+//             //
+/////////////////
+
+// number of allocations made through ch_*alloc() and ber_dupbv()
+extern unsigned long		stub_allocs;
+
+// number of allocations made from an operation's memory context
+extern unsigned long		stub_tmpallocs;
+
+// value returned by time()
+extern time_t				stub_clock;
+
+// value returned by be_shadow_update()
+extern int					stub_shadow_update;
+
+
+//////////////////
+//              //
+//  Prototypes  //
+//              //
+//////////////////
+
+extern AttributeDescription *	stub_ad_find( const char * name );
+extern AttributeDescription *	stub_ad_new( const char * name, size_t len, const char * syntax, int flags );
+extern void			stub_entry_free( Entry * e );
+extern Entry *		stub_entry_new( const char * dn );
+extern int			stub_entry_set( Entry * e, const char * name, const char * value );
+extern void			stub_op_init( OperationBuffer * opbuf );
+
+// database of the benchmarks, bench/backend.c
+extern int			stub_backend( BackendDB * be );
+extern int			stub_entry_add( Entry * e );
+extern int			stub_entry_remove( Entry * e );
+extern int			stub_search( Operation * op, SlapReply * rs );
+
+#endif /* end of header */
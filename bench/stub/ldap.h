@@ -0,0 +1,134 @@
+/*
+ *  OpenLDAP pwdPolicy/shadowAccount Overlay
+ *  Copyright (c) 2023 David M. Syzdek <david@syzdek.net>
+ *  All rights reserved.
+ *
+ *  Dominus vobiscum. Et cum spiritu tuo.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted only as authorized by the OpenLDAP
+ *  Public License.
+ *
+ *  A copy of this license is available in the file LICENSE in the
+ *  top-level directory of the distribution or, alternatively, at
+ *  <http://www.OpenLDAP.org/license.html>.
+ */
+/*
+ *  Minimal replacement of the libldap/liblber definitions used by
+ *  pwdshadow.c.
+ */
+#ifndef _PWDSHADOW_STUB_LDAP_H
+#define _PWDSHADOW_STUB_LDAP_H 1
+
+
+///////////////////
+//               //
+//  Definitions  //
+//               //
+///////////////////
+
+// result codes
+#define LDAP_SUCCESS				0x00
+#define LDAP_PROTOCOL_ERROR			0x02
+#define LDAP_COMPARE_FALSE			0x05
+#define LDAP_COMPARE_TRUE			0x06
+#define LDAP_NO_SUCH_ATTRIBUTE		0x10
+#define LDAP_UNDEFINED_TYPE			0x11
+#define LDAP_NO_SUCH_OBJECT			0x20
+#define LDAP_INVALID_DN_SYNTAX		0x22
+#define LDAP_INSUFFICIENT_ACCESS	0x32
+#define LDAP_BUSY					0x33
+#define LDAP_UNAVAILABLE			0x34
+#define LDAP_UNWILLING_TO_PERFORM	0x35
+#define LDAP_OTHER					0x50
+
+// modification operations
+#define LDAP_MOD_ADD				0x00
+#define LDAP_MOD_DELETE				0x01
+#define LDAP_MOD_REPLACE			0x02
+#define LDAP_MOD_INCREMENT			0x03
+
+// search parameters
+#define LDAP_SCOPE_BASE				0x00
+#define LDAP_SCOPE_ONELEVEL			0x01
+#define LDAP_SCOPE_SUBTREE			0x02
+#define LDAP_DEREF_NEVER			0x00
+#define LDAP_DEREF_SEARCHING		0x01
+
+// search filter choices
+#define LDAP_FILTER_AND				0xa0
+#define LDAP_FILTER_OR				0xa1
+#define LDAP_FILTER_NOT				0xa2
+#define LDAP_FILTER_EQUALITY		0xa3
+#define LDAP_FILTER_SUBSTRINGS		0xa4
+#define LDAP_FILTER_GE				0xa5
+#define LDAP_FILTER_LE				0xa6
+#define LDAP_FILTER_PRESENT			0x87
+#define LDAP_FILTER_APPROX			0xa8
+
+// request tags
+#define LDAP_REQ_MODIFY				0x66
+#define LDAP_REQ_ADD				0x68
+#define LDAP_REQ_DELETE				0x4a
+#define LDAP_REQ_MODRDN				0x6c
+#define LDAP_REQ_COMPARE			0x6e
+#define LDAP_REQ_SEARCH				0x63
+#define LDAP_REQ_EXTENDED			0x77
+
+// debug levels
+#define LDAP_DEBUG_TRACE			0x0001
+#define LDAP_DEBUG_CONFIG			0x0040
+#define LDAP_DEBUG_STATS			0x0100
+#define LDAP_DEBUG_ANY				(-1)
+
+#define BER_BVC(s)					{ sizeof(s) - 1, (char *)(s) }
+#define BER_BVNULL					{ 0L, NULL }
+#define BER_BVZERO(bv)				do { (bv)->bv_val = NULL; (bv)->bv_len = 0; } while(0)
+#define BER_BVISNULL(bv)			((bv)->bv_val == NULL)
+#define BER_BVISEMPTY(bv)			((bv)->bv_len == 0)
+
+
+//////////////////
+//              //
+//  Data Types  //
+//              //
+//////////////////
+
+typedef unsigned long		ber_len_t;
+typedef int					ber_int_t;
+typedef unsigned long		ber_tag_t;
+
+typedef struct berval
+{
+	ber_len_t				bv_len;
+	char *					bv_val;
+} BerValue;
+
+typedef BerValue *			BerVarray;
+
+typedef struct ldapcontrol
+{
+	char *					ldctl_oid;
+	struct berval			ldctl_value;
+	char					ldctl_iscritical;
+} LDAPControl;
+
+
+//////////////////
+//              //
+//  Prototypes  //
+//              //
+//////////////////
+
+extern int				ber_bvarray_add( BerVarray * p, struct berval * bv );
+extern int				ber_bvarray_add_x( BerVarray * p, struct berval * bv, void * ctx );
+extern void				ber_bvarray_free( BerVarray a );
+extern void				ber_bvarray_free_x( BerVarray a, void * ctx );
+extern int				ber_bvcmp( struct berval * a, struct berval * b );
+extern struct berval *	ber_dupbv( struct berval * dst, struct berval * src );
+extern struct berval *	ber_dupbv_x( struct berval * dst, struct berval * src, void * ctx );
+extern void				ber_memfree( void * p );
+extern void				ber_memfree_x( void * p, void * ctx );
+extern struct berval *	ber_str2bv( const char * s, ber_len_t len, int dup, struct berval * bv );
+
+#endif /* end of header */
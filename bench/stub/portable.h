@@ -0,0 +1,35 @@
+/*
+ *  OpenLDAP pwdPolicy/shadowAccount Overlay
+ *  Copyright (c) 2023 David M. Syzdek <david@syzdek.net>
+ *  All rights reserved.
+ *
+ *  Dominus vobiscum. Et cum spiritu tuo.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted only as authorized by the OpenLDAP
+ *  Public License.
+ *
+ *  A copy of this license is available in the file LICENSE in the
+ *  top-level directory of the distribution or, alternatively, at
+ *  <http://www.OpenLDAP.org/license.html>.
+ */
+/*
+ *  Minimal replacement of OpenLDAP's portable.h used to build pwdshadow.c
+ *  outside of an OpenLDAP source tree for benchmarks.
+ */
+#ifndef _PWDSHADOW_STUB_PORTABLE_H
+#define _PWDSHADOW_STUB_PORTABLE_H 1
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+
+// replace the system clock with the stub's adjustable clock
+extern time_t stub_time( time_t * tp );
+#define time(tp) stub_time(tp)
+
+#endif /* end of header */
@@ -0,0 +1,691 @@
+/*
+ *  OpenLDAP pwdPolicy/shadowAccount Overlay
+ *  Copyright (c) 2023 David M. Syzdek <david@syzdek.net>
+ *  All rights reserved.
+ *
+ *  Dominus vobiscum. Et cum spiritu tuo.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted only as authorized by the OpenLDAP
+ *  Public License.
+ *
+ *  A copy of this license is available in the file LICENSE in the
+ *  top-level directory of the distribution or, alternatively, at
+ *  <http://www.OpenLDAP.org/license.html>.
+ */
+/*
+ *  Minimal replacement of the slapd definitions used by pwdshadow.c. Only
+ *  the members referenced by the overlay are declared, the layouts do not
+ *  match slapd's and the stub is only suitable for building the benchmarks.
+ */
+#ifndef _PWDSHADOW_STUB_SLAP_H
+#define _PWDSHADOW_STUB_SLAP_H 1
+
+
+///////////////
+//           //
+//  Headers  //
+//           //
+///////////////
+
+#include <pthread.h>
+#include <ldap.h>
+
+
+///////////////////
+//               //
+//  Definitions  //
+//               //
+///////////////////
+
+#define SLAPD_MOD_DYNAMIC			2
+
+#define Debug(level, ...)			do { if (0) printf(__VA_ARGS__); (void)(level); } while(0)
+
+// config backend
+#define ARG_INT						0x00001000
+#define ARG_LONG					0x00002000
+#define ARG_ON_OFF					0x00008000
+#define ARG_STRING					0x00010000
+#define ARG_BERVAL					0x00020000
+#define ARG_DN						0x00040000
+#define ARG_ATDESC					0x00200000
+#define ARG_OFFSET					0x01000000
+#define ARG_MAGIC					0x02000000
+#define ARG_QUOTE					0x04000000
+#define ARG_IGNORED					0x00080000
+#define ARG_BAD_CONF				0xdead0000
+#define SLAP_CONFIG_EMIT			0x2000
+#define SLAP_CONFIG_ADD				0x4000
+
+// schema
+#define SLAPD_DN_SYNTAX				"1.3.6.1.4.1.1466.115.121.1.12"
+#define SLAPD_INTEGER_SYNTAX		"1.3.6.1.4.1.1466.115.121.1.27"
+#define SLAP_AT_MANAGEABLE			0x20000
+#define SLAP_AT_NO_USER_MOD			0x0001
+#define is_at_no_user_mod(at)		((at)->sat_flags & SLAP_AT_NO_USER_MOD)
+
+// modifications
+#define SLAP_MOD_INTERNAL			0x01
+
+// threaded AVL trees
+#define TAVL_DIR_LEFT				0
+#define TAVL_DIR_RIGHT				1
+
+// overlays and callbacks
+#define SLAPO_BFLAG_SINGLE			0x01
+#define SLAP_CB_CONTINUE			0x8000
+#define SLAP_ISGLOBALOVERLAY(be)	0
+#define SLAP_OPATTRS(flags)			((flags) & 0x02)
+#define SLAP_USERATTRS(flags)		((flags) & 0x01)
+#define SLAP_NO_LIMIT				-1
+#define SLAP_TOOL_MODE				0x1000
+#define SLAP_SERVER_RUNNING			0x8000
+#define SLAP_EXOP_WRITES			0x0001
+
+// access control
+#define ACL_COMPARE					2
+#define ACL_READ					4
+
+// search filters
+#define SLAPD_FILTER_COMPUTED		0
+#define SLAPD_FILTER_MASK			0x7fff
+#define SLAPD_FILTER_UNDEFINED		0x8000
+
+#define be_modify					bd_info->bi_op_modify
+#define be_search					bd_info->bi_op_search
+
+#define bvmatch(a, b)				( ((a)->bv_len == (b)->bv_len) && (!(memcmp((a)->bv_val, (b)->bv_val, (a)->bv_len))) )
+
+
+//////////////////
+//              //
+//  Data Types  //
+//              //
+//////////////////
+
+typedef unsigned long				ID;
+typedef unsigned long				slap_mask_t;
+
+typedef struct Entry				Entry;
+typedef struct Operation			Operation;
+typedef struct SlapReply			SlapReply;
+typedef struct BackendDB			BackendDB;
+typedef struct BackendInfo			BackendInfo;
+typedef struct Connection			Connection;
+
+// threads
+typedef pthread_mutex_t				ldap_pvt_thread_mutex_t;
+typedef pthread_cond_t				ldap_pvt_thread_cond_t;
+typedef pthread_rwlock_t			ldap_pvt_thread_rdwr_t;
+typedef struct { int tp_unused; }	ldap_pvt_thread_pool_t;
+typedef void *						ldap_pvt_thread_start_t( void * ctx, void * arg );
+
+// runqueue
+struct re_s
+{
+	void *							arg;
+};
+
+typedef struct runqueue_s
+{
+	ldap_pvt_thread_mutex_t			rq_mutex;
+} runqueue_t;
+
+// AVL trees
+typedef struct Avlnode				Avlnode;
+typedef int							(AVL_CMP)( const void * a, const void * b );
+typedef int							(AVL_DUP)( void * a, void * b );
+typedef void						(AVL_FREE)( void * ptr );
+
+// sorted list used in place of libldap's threaded AVL trees, the root is
+// the first node
+typedef struct TAvlnode
+{
+	void *							avl_data;
+	struct TAvlnode *				avl_link[2];
+} TAvlnode;
+
+// schema
+typedef struct Syntax
+{
+	char *							ssyn_oid;
+} Syntax;
+
+typedef struct MatchingRule
+{
+	int								smr_unused;
+} MatchingRule;
+
+typedef struct AttributeType
+{
+	char *							sat_oid;
+	struct berval					sat_cname;
+	Syntax *						sat_syntax;
+	int								sat_flags;
+} AttributeType;
+
+typedef struct AttributeDescription
+{
+	struct AttributeDescription *	ad_next;
+	AttributeType *					ad_type;
+	struct berval					ad_cname;
+	unsigned						ad_flags;
+} AttributeDescription;
+
+typedef struct ObjectClass
+{
+	struct berval					soc_cname;
+} ObjectClass;
+
+typedef struct AttributeName
+{
+	struct berval					an_name;
+	AttributeDescription *			an_desc;
+} AttributeName;
+
+typedef struct AttributeAssertion
+{
+	AttributeDescription *			aa_desc;
+	struct berval					aa_value;
+} AttributeAssertion;
+
+typedef struct Filter
+{
+	ber_tag_t						f_choice;
+	union
+	{
+		AttributeAssertion *		f_un_ava;
+		AttributeDescription *		f_un_desc;
+		struct Filter *				f_un_complex;
+		int							f_un_result;
+	}								f_un;
+	struct Filter *					f_next;
+} Filter;
+
+#define f_ava						f_un.f_un_ava
+#define f_av_desc					f_un.f_un_ava->aa_desc
+#define f_av_value					f_un.f_un_ava->aa_value
+#define f_desc						f_un.f_un_desc
+#define f_and						f_un.f_un_complex
+#define f_or						f_un.f_un_complex
+#define f_not						f_un.f_un_complex
+#define f_list						f_un.f_un_complex
+#define f_result					f_un.f_un_result
+
+// access controls, fields read by the overlay
+typedef struct Access
+{
+	AttributeDescription *			a_dn_at;
+	AttributeDescription *			a_realdn_at;
+	struct berval					a_set_pat;
+	struct berval					a_group_pat;
+	struct Access *					a_next;
+} Access;
+
+typedef struct AccessControl
+{
+	Filter *						a_filter;
+	struct berval					a_attrval;
+	Access *						a_access;
+	struct AccessControl *			a_next;
+} AccessControl;
+
+// entries
+typedef struct Attribute
+{
+	AttributeDescription *			a_desc;
+	BerVarray						a_vals;
+	BerVarray						a_nvals;
+	unsigned						a_numvals;
+	unsigned						a_flags;
+	struct Attribute *				a_next;
+} Attribute;
+
+struct Entry
+{
+	ID								e_id;
+	struct berval					e_name;
+	struct berval					e_nname;
+	Attribute *						e_attrs;
+};
+
+typedef struct Modification
+{
+	short							sm_op;
+	short							sm_flags;
+	unsigned						sm_numvals;
+	AttributeDescription *			sm_desc;
+	struct berval					sm_type;
+	BerVarray						sm_values;
+	BerVarray						sm_nvalues;
+} Modification;
+
+typedef struct Modifications
+{
+	Modification					sml_mod;
+	struct Modifications *			sml_next;
+} Modifications;
+
+#define sml_op						sml_mod.sm_op
+#define sml_flags					sml_mod.sm_flags
+#define sml_numvals					sml_mod.sm_numvals
+#define sml_desc					sml_mod.sm_desc
+#define sml_type					sml_mod.sm_type
+#define sml_values					sml_mod.sm_values
+#define sml_nvalues					sml_mod.sm_nvalues
+
+// config backend
+typedef struct config_reply_s
+{
+	int								err;
+	char							msg[256];
+} ConfigReply;
+
+typedef struct ConfigArgs
+{
+	int								op;
+	int								type;
+	int								argc;
+	char **							argv;
+	const char *					log;
+	char							cr_msg[256];
+	int								valx;
+	BackendInfo *					bi;
+	BackendDB *						be;
+	BerVarray						rvalue_vals;
+	BerVarray						rvalue_nvals;
+	struct berval					value_dn;
+	struct berval					value_ndn;
+	AttributeDescription *			value_ad;
+	int								value_int;
+	char *							value_string;
+} ConfigArgs;
+
+typedef int							ConfigDriver( ConfigArgs * c );
+
+typedef struct ConfigTable
+{
+	const char *					name;
+	const char *					what;
+	int								min_args;
+	int								max_args;
+	int								length;
+	unsigned int					arg_type;
+	void *							arg_item;
+	const char *					attribute;
+	void *							ad;
+	void *							notify;
+} ConfigTable;
+
+typedef enum
+{
+	Cft_Abstract = 0,
+	Cft_Global,
+	Cft_Module,
+	Cft_Schema,
+	Cft_Backend,
+	Cft_Database,
+	Cft_Overlay,
+	Cft_Misc
+} ConfigType;
+
+typedef struct ConfigOCs
+{
+	const char *					co_def;
+	ConfigType						co_type;
+	ConfigTable *					co_table;
+	void *							co_ldadd;
+	void *							co_cfadd;
+	void *							co_oc;
+	struct berval *					co_name;
+} ConfigOCs;
+
+// backends and overlays
+typedef int							(BI_op_func)( Operation * op, SlapReply * rs );
+typedef int							(BI_db_func)( BackendDB * be, ConfigReply * cr );
+typedef int							(slap_response)( Operation * op, SlapReply * rs );
+
+struct BackendInfo
+{
+	char *							bi_type;
+	int								bi_flags;
+	BI_db_func *					bi_db_init;
+	BI_db_func *					bi_db_open;
+	BI_db_func *					bi_db_close;
+	BI_db_func *					bi_db_destroy;
+	BI_op_func *					bi_op_add;
+	BI_op_func *					bi_op_compare;
+	BI_op_func *					bi_op_delete;
+	BI_op_func *					bi_op_modify;
+	BI_op_func *					bi_op_modrdn;
+	BI_op_func *					bi_op_search;
+	BI_op_func *					bi_operational;
+	ConfigOCs *						bi_cf_ocs;
+	void *							bi_private;
+};
+
+struct BackendDB
+{
+	BackendInfo *					bd_info;
+	BackendDB *						bd_self;
+	struct berval					be_rootdn;
+	struct berval					be_rootndn;
+	BerVarray						be_suffix;
+	BerVarray						be_nsuffix;
+	AccessControl *					be_acl;
+};
+
+typedef struct slap_overinst
+{
+	BackendInfo						on_bi;
+	BackendInfo *					on_info;
+	struct slap_overinst *			on_next;
+} slap_overinst;
+
+typedef struct slap_overinfo
+{
+	BackendInfo						oi_bi;
+	slap_overinst *					oi_list;
+} slap_overinfo;
+
+typedef struct slap_callback
+{
+	struct slap_callback *			sc_next;
+	slap_response *					sc_response;
+	slap_response *					sc_cleanup;
+	void *							sc_private;
+	int								sc_writewait;
+} slap_callback;
+
+// operations
+typedef struct BerMemoryFunctions
+{
+	void *							(*bmf_malloc)( ber_len_t size, void * ctx );
+	void *							(*bmf_calloc)( ber_len_t n, ber_len_t size, void * ctx );
+	void *							(*bmf_realloc)( void * p, ber_len_t size, void * ctx );
+	void							(*bmf_free)( void * p, void * ctx );
+} BerMemoryFunctions;
+
+typedef struct Opheader
+{
+	BerMemoryFunctions *			oh_tmpmfuncs;
+	int								oh_tag;
+	time_t							oh_time;
+	void *							oh_threadctx;
+	void *							oh_tmpmemctx;
+} Opheader;
+
+typedef struct req_add_s
+{
+	Entry *							rs_e;
+} req_add_s;
+
+typedef struct req_modify_s
+{
+	Modifications *					rs_modlist;
+	char							rs_no_opattrs;
+} req_modify_s;
+
+typedef struct req_modrdn_s
+{
+	struct berval					rs_newDN;
+	struct berval					rs_nnewDN;
+} req_modrdn_s;
+
+typedef struct req_search_s
+{
+	int								rs_scope;
+	int								rs_deref;
+	int								rs_slimit;
+	int								rs_tlimit;
+	void *							rs_limit;
+	int								rs_attrsonly;
+	AttributeName *					rs_attrs;
+	Filter *						rs_filter;
+	struct berval					rs_filterstr;
+} req_search_s;
+
+typedef struct req_compare_s
+{
+	AttributeAssertion *			rs_ava;
+} req_compare_s;
+
+typedef struct req_extended_s
+{
+	struct berval *					rs_reqdata;
+} req_extended_s;
+
+struct Operation
+{
+	Opheader *						o_hdr;
+	volatile int					o_abandon;
+	struct berval					o_dn;
+	struct berval					o_ndn;
+	struct berval					o_req_dn;
+	struct berval					o_req_ndn;
+	BackendDB *						o_bd;
+	slap_callback *					o_callback;
+	void *							o_ctrls;
+	int								o_dont_replicate;
+	union
+	{
+		req_add_s					oq_add;
+		req_modify_s				oq_modify;
+		req_modrdn_s				oq_modrdn;
+		req_search_s				oq_search;
+		req_compare_s				oq_compare;
+		req_extended_s				oq_extended;
+	}								o_request;
+};
+
+#define o_tag						o_hdr->oh_tag
+#define o_time						o_hdr->oh_time
+#define o_threadctx					o_hdr->oh_threadctx
+#define o_tmpmemctx					o_hdr->oh_tmpmemctx
+#define o_tmpmfuncs					o_hdr->oh_tmpmfuncs
+#define o_tmpalloc					o_tmpmfuncs->bmf_malloc
+#define o_tmpcalloc					o_tmpmfuncs->bmf_calloc
+#define o_tmprealloc				o_tmpmfuncs->bmf_realloc
+#define o_tmpfree					o_tmpmfuncs->bmf_free
+#define ora_e						o_request.oq_add.rs_e
+#define orm_modlist					o_request.oq_modify.rs_modlist
+#define orm_no_opattrs				o_request.oq_modify.rs_no_opattrs
+#define orr_newDN					o_request.oq_modrdn.rs_newDN
+#define orr_nnewDN					o_request.oq_modrdn.rs_nnewDN
+#define ors_scope					o_request.oq_search.rs_scope
+#define ors_deref					o_request.oq_search.rs_deref
+#define ors_slimit					o_request.oq_search.rs_slimit
+#define ors_tlimit					o_request.oq_search.rs_tlimit
+#define ors_limit					o_request.oq_search.rs_limit
+#define ors_attrsonly				o_request.oq_search.rs_attrsonly
+#define ors_attrs					o_request.oq_search.rs_attrs
+#define ors_filter					o_request.oq_search.rs_filter
+#define ors_filterstr				o_request.oq_search.rs_filterstr
+#define orc_ava						o_request.oq_compare.rs_ava
+#define ore_reqdata					o_request.oq_extended.rs_reqdata
+
+typedef struct OperationBuffer
+{
+	Operation						ob_op;
+	Opheader						ob_hdr;
+} OperationBuffer;
+
+struct Connection
+{
+	unsigned long					c_connid;
+};
+
+typedef enum
+{
+	REP_RESULT = 0,
+	REP_SASL,
+	REP_EXTENDED,
+	REP_SEARCH,
+	REP_SEARCHREF,
+	REP_INTERMEDIATE
+} slap_reply_t;
+
+struct SlapReply
+{
+	slap_reply_t					sr_type;
+	int								sr_err;
+	const char *					sr_text;
+	Entry *							sr_entry;
+	AttributeName *					sr_attrs;
+	Attribute *						sr_operational_attrs;
+	slap_mask_t						sr_attr_flags;
+	slap_mask_t						sr_flags;
+	struct berval *					sr_rspdata;
+};
+
+// slapd utility library
+struct lutil_tm
+{
+	int								tm_sec;
+	int								tm_min;
+	int								tm_hour;
+	int								tm_mday;
+	int								tm_mon;
+	int								tm_year;
+	int								tm_usec;
+	int								tm_usub;
+};
+
+struct lutil_timet
+{
+	unsigned long					tt_sec;
+	unsigned long					tt_gsec;
+	int								tt_usec;
+};
+
+struct slap_schema_t
+{
+	AttributeDescription *			si_ad_userPassword;
+	AttributeDescription *			si_ad_modifyTimestamp;
+	AttributeDescription *			si_ad_objectClass;
+};
+
+
+/////////////////
+//             //
+//  Variables  //
+//             //
+/////////////////
+
+extern ldap_pvt_thread_pool_t		connection_pool;
+extern BackendDB *					frontendDB;
+extern runqueue_t					slapd_rq;
+extern volatile int					slapd_shutdown;
+extern int							slapMode;
+extern AttributeName				slap_anlist_no_attrs[];
+extern struct slap_schema_t			slap_schema;
+
+
+//////////////////
+//              //
+//  Prototypes  //
+//              //
+//////////////////
+
+// memory
+extern void *		ch_calloc( size_t nelem, size_t size );
+extern void			ch_free( void * ptr );
+extern void *		ch_malloc( size_t size );
+extern void *		ch_realloc( void * ptr, size_t size );
+extern char *		ch_strdup( const char * s );
+
+// threads
+extern int			ldap_pvt_thread_cond_broadcast( ldap_pvt_thread_cond_t * cond );
+extern int			ldap_pvt_thread_cond_destroy( ldap_pvt_thread_cond_t * cond );
+extern int			ldap_pvt_thread_cond_init( ldap_pvt_thread_cond_t * cond );
+extern int			ldap_pvt_thread_cond_wait( ldap_pvt_thread_cond_t * cond, ldap_pvt_thread_mutex_t * mutex );
+extern int			ldap_pvt_thread_mutex_destroy( ldap_pvt_thread_mutex_t * mutex );
+extern int			ldap_pvt_thread_mutex_init( ldap_pvt_thread_mutex_t * mutex );
+extern int			ldap_pvt_thread_mutex_lock( ldap_pvt_thread_mutex_t * mutex );
+extern int			ldap_pvt_thread_mutex_unlock( ldap_pvt_thread_mutex_t * mutex );
+extern void *		ldap_pvt_thread_pool_context( void );
+extern int			ldap_pvt_thread_rdwr_destroy( ldap_pvt_thread_rdwr_t * rw );
+extern int			ldap_pvt_thread_rdwr_init( ldap_pvt_thread_rdwr_t * rw );
+extern int			ldap_pvt_thread_rdwr_rlock( ldap_pvt_thread_rdwr_t * rw );
+extern int			ldap_pvt_thread_rdwr_runlock( ldap_pvt_thread_rdwr_t * rw );
+extern int			ldap_pvt_thread_rdwr_wlock( ldap_pvt_thread_rdwr_t * rw );
+extern int			ldap_pvt_thread_rdwr_wunlock( ldap_pvt_thread_rdwr_t * rw );
+extern int			ldap_pvt_thread_pool_pausecheck( ldap_pvt_thread_pool_t * pool );
+extern int			ldap_pvt_thread_pool_pausing( ldap_pvt_thread_pool_t * pool );
+extern int			ldap_pvt_thread_pool_submit( ldap_pvt_thread_pool_t * pool, ldap_pvt_thread_start_t * fn, void * arg );
+
+// runqueue
+extern struct re_s *	ldap_pvt_runqueue_insert( runqueue_t * rq, time_t interval, ldap_pvt_thread_start_t * fn, void * arg, char * name, char * tname );
+extern int				ldap_pvt_runqueue_isrunning( runqueue_t * rq, struct re_s * entry );
+extern void				ldap_pvt_runqueue_remove( runqueue_t * rq, struct re_s * entry );
+extern void				ldap_pvt_runqueue_resched( runqueue_t * rq, struct re_s * entry, int defer );
+extern void				ldap_pvt_runqueue_stoptask( runqueue_t * rq, struct re_s * entry );
+
+// AVL trees
+extern int			ldap_avl_dup_error( void * a, void * b );
+extern void *		ldap_avl_delete( Avlnode ** root, void * data, AVL_CMP * cmp );
+extern void *		ldap_avl_find( Avlnode * root, const void * data, AVL_CMP * cmp );
+extern int			ldap_avl_free( Avlnode * root, AVL_FREE * dfree );
+extern int			ldap_avl_insert( Avlnode ** root, void * data, AVL_CMP * cmp, AVL_DUP * dup );
+extern void *		ldap_tavl_delete( TAvlnode ** root, void * data, AVL_CMP * cmp );
+extern TAvlnode *	ldap_tavl_end( TAvlnode * root, int dir );
+extern void *		ldap_tavl_find( TAvlnode * root, const void * data, AVL_CMP * cmp );
+extern TAvlnode *	ldap_tavl_find3( TAvlnode * root, const void * data, AVL_CMP * cmp, int * ret );
+extern int			ldap_tavl_free( TAvlnode * root, AVL_FREE * dfree );
+extern int			ldap_tavl_insert( TAvlnode ** root, void * data, AVL_CMP * cmp, AVL_DUP * dup );
+extern TAvlnode *	ldap_tavl_next( TAvlnode * root, int dir );
+
+// schema
+extern int			ad_inlist( AttributeDescription * ad, AttributeName * attrs );
+extern int			is_at_syntax( AttributeType * at, const char * oid );
+extern int			is_entry_objectclass( Entry * e, ObjectClass * oc, unsigned flags );
+extern ObjectClass *	oc_bvfind( struct berval * name );
+extern ObjectClass *	oc_find( const char * name );
+extern int			register_at( const char * def, AttributeDescription ** ad, int dupok );
+extern int			register_oc( const char * def, ObjectClass ** oc, int dupok );
+extern int			slap_str2ad( const char * name, AttributeDescription ** ad, const char ** text );
+
+// entries and attributes
+extern int			access_allowed( Operation * op, Entry * e, AttributeDescription * ad, struct berval * val, int access, void * state );
+extern Attribute *	attr_alloc( AttributeDescription * ad );
+extern int			attr_delete( Attribute ** attrs, AttributeDescription * ad );
+extern Attribute *	attr_find( Attribute * a, AttributeDescription * ad );
+extern int			attr_merge_one( Entry * e, AttributeDescription * ad, struct berval * val, struct berval * nval );
+extern int			dnIsSuffix( struct berval * dn, struct berval * suffix );
+extern int			dnNormalize( slap_mask_t use, Syntax * syntax, MatchingRule * mr, struct berval * val, struct berval * out, void * ctx );
+extern void			dnParent( struct berval * dn, struct berval * pdn );
+extern int			filter_escape_value( struct berval * in, struct berval * out );
+extern Filter *		filter_dup( Filter * f, void * memctx );
+extern void			filter_free_x( Operation * op, Filter * f, int freeme );
+extern void			filter2bv_x( Operation * op, Filter * f, struct berval * bv );
+extern void			slap_mods_free( Modifications * mods, int freevals );
+extern int			slap_mods_opattrs( Operation * op, Modifications ** modsp, int manage_ctxcsn );
+extern Filter *		str2filter_x( Operation * op, const char * str );
+extern int			test_filter( Operation * op, Entry * e, Filter * f );
+
+// backends and overlays
+extern int			be_entry_get_rw( Operation * op, struct berval * ndn, ObjectClass * oc, AttributeDescription * at, int rw, Entry ** e );
+extern int			be_entry_release_r( Operation * op, Entry * e );
+extern int			be_isroot_dn( BackendDB * be, struct berval * ndn );
+extern int			be_shadow_update( Operation * op );
+extern int			config_register_schema( ConfigTable * ct, ConfigOCs * co );
+extern void			connection_fake_init2( Connection * conn, OperationBuffer * opbuf, void * ctx, int newmem );
+extern int			load_extop2( struct berval * oid, slap_mask_t flags, BI_op_func * fn, unsigned tmpflags );
+extern int			overlay_is_inst( BackendDB * be, const char * name );
+extern int			overlay_register( slap_overinst * on );
+extern BackendDB *	select_backend( struct berval * dn, int noSubordinates );
+extern int			send_ldap_result( Operation * op, SlapReply * rs );
+extern int			send_search_entry( Operation * op, SlapReply * rs );
+extern int			rs_entry2modifiable( Operation * op, SlapReply * rs, slap_overinst * on );
+extern void			rs_flush_entry( Operation * op, SlapReply * rs, slap_overinst * on );
+extern int			slap_cleanup_play( Operation * op, SlapReply * rs );
+extern int			value_add_one( BerVarray * vals, struct berval * val );
+
+// slapd utility library
+extern int			lutil_atoi( int * v, const char * s );
+extern int			lutil_atoul( unsigned long * v, const char * s );
+extern int			lutil_parsetime( char * atm, struct lutil_tm * tm );
+extern int			lutil_tm2time( struct lutil_tm * tm, struct lutil_timet * tt );
+
+#endif /* end of header */
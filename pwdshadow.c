@@ -25,12 +25,21 @@
 #	pragma mark - Headers
 #endif
 
+#include <limits.h>
+#include <stdint.h>
+#include <time.h>
 #include <ldap.h>
 #include "slap.h"
 #include "slap-config.h"
+#ifdef SLAPD_MONITOR
+#	include "back-monitor/back-monitor.h"
+#endif
 #ifdef SLAPD_MODULES
 #	include <ltdl.h>
 #endif
+#ifdef PWDSHADOW_SDT
+#	include <sys/sdt.h>
+#endif
 
 
 ///////////////////
@@ -44,6 +53,87 @@
 
 #define PWDSHADOW_CFG_DEF_POLICY	0x01
 #define PWDSHADOW_CFG_POLICY_AD		0x02
+#define PWDSHADOW_CFG_OVERRIDES		0x03
+#define PWDSHADOW_CFG_MODE			0x04
+#define PWDSHADOW_CFG_SUBTREE		0x05
+#define PWDSHADOW_CFG_USE_POLICIES	0x06
+#define PWDSHADOW_CFG_TRUST_REPL	0x07
+#define PWDSHADOW_CFG_CACHE_TTL		0x08
+#define PWDSHADOW_CFG_ALIAS			0x09
+#define PWDSHADOW_CFG_TUPLE_CACHE	0x0A
+#define PWDSHADOW_CFG_EXPIRY		0x0B
+
+#define PWDSHADOW_MODE_STORED		0
+#define PWDSHADOW_MODE_VIRTUAL		1
+
+#define PWDSHADOW_CACHE_TTL			300
+#define PWDSHADOW_CACHE_MAX			1024
+
+#define PWDSHADOW_SLOTS				32
+#define PWDSHADOW_SLOT_COUNT		24
+#define PWDSHADOW_HASH_SIZE			64
+#define PWDSHADOW_HASH_MASK			( PWDSHADOW_HASH_SIZE - 1 )
+
+#define PWDSHADOW_RULES				7
+#define PWDSHADOW_RULE_POLICY		0x01
+
+#define PWDSHADOW_SCAN_ENTRY		0x01
+#define PWDSHADOW_SCAN_POLICY		0x02
+#define PWDSHADOW_SCAN_MODLIST		0x04
+#define PWDSHADOW_SCAN_OVERRIDE		0x08
+#define PWDSHADOW_SCAN_VIRTUAL		0x10
+
+#define PWDSHADOW_REGEN_OID			"1.3.6.1.4.1.27893.4.2.6.1"
+#define PWDSHADOW_REGEN_BATCH		256
+#define PWDSHADOW_REGEN_WORKERS		4
+#define PWDSHADOW_REGEN_IDLE		0
+#define PWDSHADOW_REGEN_RUNNING		1
+#define PWDSHADOW_REGEN_STOPPING	2
+
+#define PWDSHADOW_EXPIRY_OID		"1.3.6.1.4.1.27893.4.2.6.2"
+#define PWDSHADOW_EXPIRY_EXPIRE		0
+#define PWDSHADOW_EXPIRY_MAXAGE		1
+#define PWDSHADOW_EXPIRY_KINDS		2
+#define PWDSHADOW_EXPIRY_OFF		0
+#define PWDSHADOW_EXPIRY_BUILDING	1
+#define PWDSHADOW_EXPIRY_READY		2
+#define PWDSHADOW_EXPIRY_PAGE		1000
+
+#define PWDSHADOW_POLICY_EXISTS		0x01
+#define PWDSHADOW_POLICY_LOADING	0x02
+#define PWDSHADOW_POLICY_STALE		0x04
+#define PWDSHADOW_POLICY_CACHED		0x08
+
+#define PWDSHADOW_TUPLE_REF			0x01
+#define PWDSHADOW_TUPLE_BYPASS		0x02
+#define PWDSHADOW_TUPLE_SHADOW		0x04
+#define PWDSHADOW_TUPLE_SAMEVAL		0x08
+#define PWDSHADOW_TUPLE_SAMEDN		0x10
+#define PWDSHADOW_TUPLE_MAX			100000000
+
+#define PWDSHADOW_GENERATED			7
+#define PWDSHADOW_INT_LEN			12
+
+#define PWDSHADOW_STAT_ADDS			0
+#define PWDSHADOW_STAT_MODIFIES		1
+#define PWDSHADOW_STAT_SKIPPED		2
+#define PWDSHADOW_STAT_FETCHES		3
+#define PWDSHADOW_STAT_POLICIES		4
+#define PWDSHADOW_STAT_POLICY_FAILS	5
+#define PWDSHADOW_STAT_REPLICATED	6
+#define PWDSHADOW_STAT_TUPLE_HITS	7
+#define PWDSHADOW_STAT_TUPLE_MISSES	8
+#define PWDSHADOW_STAT_COUNT		9
+
+#define PWDSHADOW_PHASE_FETCH		0
+#define PWDSHADOW_PHASE_POLICY		1
+#define PWDSHADOW_PHASE_EVAL		2
+#define PWDSHADOW_PHASE_MODS		3
+#define PWDSHADOW_PHASE_COUNT		4
+
+#define PWDSHADOW_STATS_SHARDS		16
+#define PWDSHADOW_STATS_BUCKETS		32
+#define PWDSHADOW_CACHELINE			64
 
 #define PWDSHADOW_OP_UNKNOWN		-2
 #define PWDSHADOW_OP_DELETE			-1
@@ -53,39 +143,100 @@
 #define PWDSHADOW_FLG_EXISTS		0x0001
 #define PWDSHADOW_FLG_USERADD		0x0002
 #define PWDSHADOW_FLG_USERDEL		0x0004
-#define PWDSHADOW_FLG_USERMODS		( PWDSHADOW_FLG_USERADD | PWDSHADOW_FLG_USERDEL )
-#define PWDSHADOW_FLG_EVALADD		0x0008
-#define PWDSHADOW_FLG_EVALDEL		0x0010
-#define PWDSHADOW_FLG_OVERRIDE		0x0020
-//PWDSHADOW_FLG_UNUSED				0x0040
-//PWDSHADOW_FLG_UNUSED				0x0080
+#define PWDSHADOW_STATE				( PWDSHADOW_FLG_EXISTS | PWDSHADOW_FLG_USERADD | PWDSHADOW_FLG_USERDEL )
+
 #define PWDSHADOW_TYPE_EXISTS		0x0100
 #define PWDSHADOW_TYPE_BOOL			0x0200
 #define PWDSHADOW_TYPE_TIME			0x0400
 #define PWDSHADOW_TYPE_SECS			0x0800
 #define PWDSHADOW_TYPE_DAYS			0x1000
 #define PWDSHADOW_TYPE_INTEGER		0x2000
-#define PWDSHADOW_TYPE				0xff00
-#define PWDSHADOW_OPS				( PWDSHADOW_FLG_EVALADD | PWDSHADOW_FLG_EVALDEL )
-#define PWDSHADOW_STATE				( PWDSHADOW_FLG_EXISTS | PWDSHADOW_FLG_USERADD | PWDSHADOW_FLG_USERDEL )
-#define PWDSHADOW_HAS_MODS			( PWDSHADOW_DAT_ADD | PWDSHADOW_DAT_DEL )
-
-// query individual flags
-#define pwdshadow_flg_useradd(dat)	((dat)->dt_flag & PWDSHADOW_FLG_USERADD)
-#define pwdshadow_flg_userdel(dat)	((dat)->dt_flag & PWDSHADOW_FLG_USERDEL)
-#define pwdshadow_flg_usermods(dat)	((dat)->dt_flag & PWDSHADOW_FLG_USERMODS)
-#define pwdshadow_flg_exists(dat)	((dat)->dt_flag & PWDSHADOW_FLG_EXISTS)
-#define pwdshadow_flg_evaladd(dat)	((dat)->dt_flag & PWDSHADOW_FLG_EVALADD)
-#define pwdshadow_flg_evaldel(dat)	((dat)->dt_flag & PWDSHADOW_FLG_EVALDEL)
-#define pwdshadow_flg_override(dat)	((dat)->dt_flag & PWDSHADOW_FLG_OVERRIDE)
-
-// retrieve class of flags
-#define pwdshadow_ops(flags)		(flags & PWDSHADOW_OPS)
-#define pwdshadow_state(flags)		(flags & PWDSHADOW_STATE)
-#define pwdshadow_type(flags)		(flags & PWDSHADOW_TYPE)
+
+// slots of attributes tracked by the overlay's state, see pwdshadow_slots[]
+#define PWDSHADOW_SL_policySubentry			0
+#define PWDSHADOW_SL_pwdChangedTime			1
+#define PWDSHADOW_SL_pwdEndTime				2
+#define PWDSHADOW_SL_pwdExpireWarning		3
+#define PWDSHADOW_SL_pwdGraceExpiry			4
+#define PWDSHADOW_SL_pwdMaxAge				5
+#define PWDSHADOW_SL_pwdMinAge				6
+#define PWDSHADOW_SL_pwdShadowAutoExpire	7
+#define PWDSHADOW_SL_pwdShadowExpire		8
+#define PWDSHADOW_SL_pwdShadowFlag			9
+#define PWDSHADOW_SL_pwdShadowGenerate		10
+#define PWDSHADOW_SL_pwdShadowInactive		11
+#define PWDSHADOW_SL_pwdShadowLastChange	12
+#define PWDSHADOW_SL_pwdShadowMax			13
+#define PWDSHADOW_SL_pwdShadowMin			14
+#define PWDSHADOW_SL_pwdShadowWarning		15
+#define PWDSHADOW_SL_shadowExpire			16
+#define PWDSHADOW_SL_shadowFlag				17
+#define PWDSHADOW_SL_shadowInactive			18
+#define PWDSHADOW_SL_shadowLastChange		19
+#define PWDSHADOW_SL_shadowMax				20
+#define PWDSHADOW_SL_shadowMin				21
+#define PWDSHADOW_SL_shadowWarning			22
+#define PWDSHADOW_SL_userPassword			23
+
+// sets of slots
+#define pwdshadow_bit(slot)			( 1U << (slot) )
+#define PWDSHADOW_SL_GENERATED		( pwdshadow_bit(PWDSHADOW_SL_pwdShadowExpire) | \
+									  pwdshadow_bit(PWDSHADOW_SL_pwdShadowFlag) | \
+									  pwdshadow_bit(PWDSHADOW_SL_pwdShadowInactive) | \
+									  pwdshadow_bit(PWDSHADOW_SL_pwdShadowLastChange) | \
+									  pwdshadow_bit(PWDSHADOW_SL_pwdShadowMax) | \
+									  pwdshadow_bit(PWDSHADOW_SL_pwdShadowMin) | \
+									  pwdshadow_bit(PWDSHADOW_SL_pwdShadowWarning) )
+#define PWDSHADOW_SL_POLICY			( pwdshadow_bit(PWDSHADOW_SL_pwdExpireWarning) | \
+									  pwdshadow_bit(PWDSHADOW_SL_pwdGraceExpiry) | \
+									  pwdshadow_bit(PWDSHADOW_SL_pwdMaxAge) | \
+									  pwdshadow_bit(PWDSHADOW_SL_pwdMinAge) | \
+									  pwdshadow_bit(PWDSHADOW_SL_pwdShadowAutoExpire) )
+
+// query individual flags of a slot
+#define pwdshadow_flg_useradd(st, slot)		((st)->st_useradd & pwdshadow_bit(slot))
+#define pwdshadow_flg_userdel(st, slot)		((st)->st_userdel & pwdshadow_bit(slot))
+#define pwdshadow_flg_usermods(st, slot)	(((st)->st_useradd | (st)->st_userdel) & pwdshadow_bit(slot))
+#define pwdshadow_flg_exists(st, slot)		((st)->st_exists & pwdshadow_bit(slot))
+#define pwdshadow_flg_evaladd(st, slot)		((st)->st_evaladd & pwdshadow_bit(slot))
+#define pwdshadow_flg_evaldel(st, slot)		((st)->st_evaldel & pwdshadow_bit(slot))
+#define pwdshadow_flg_override(st, slot)	((st)->st_override & pwdshadow_bit(slot))
+#define pwdshadow_flg_willexist(st, slot)	(pwdshadow_willexist(st) & pwdshadow_bit(slot))
+
+// query flags of every slot, live slots have a value once the user's
+// modifications are applied
+#define pwdshadow_live(st)			( ((st)->st_exists & ~(st)->st_userdel) | (st)->st_useradd )
+#define pwdshadow_willexist(st)		( ((st)->st_exists | (st)->st_useradd | (st)->st_evaladd) & ~((st)->st_userdel | (st)->st_evaldel) )
 
 // set flags
-#define pwdshadow_purge(dat)		(dat)->dt_flag |= ((pwdshadow_flg_exists(dat))) ? PWDSHADOW_FLG_EVALDEL : 0
+#define pwdshadow_purge(st, slot)	(st)->st_evaldel |= (st)->st_exists & pwdshadow_bit(slot)
+
+// map attribute descriptions and slots
+#define pwdshadow_hash(ad)			( ((uintptr_t)(ad) >> 4) ^ ((uintptr_t)(ad) >> 10) )
+
+// configuration snapshot published by pwdshadow_cfg_publish(), the pointer
+// is not referenced and must not be kept across a call into the backend,
+// which may pause the thread pool, see pwdshadow_cfg_hold()
+#define pwdshadow_cfg_get(ps)		__atomic_load_n(&(ps)->ps_cfg, __ATOMIC_ACQUIRE)
+#define pwdshadow_rule_reads(ru, slot)	( ((ru)->ru_triggers | (ru)->ru_inputs) & pwdshadow_bit(slot) )
+
+// statistics counters
+#define pwdshadow_stats_inc(sx, idx)	__atomic_add_fetch(&(sx)->sx_counters[idx], 1, __ATOMIC_RELAXED)
+
+// USDT static tracepoints of provider "pwdshadow", compiled in with
+// PWDSHADOW_SDT and a single nop at each site until a tracer attaches,
+// otherwise the arguments are not evaluated
+#ifdef PWDSHADOW_SDT
+#	define pwdshadow_probe1(name, a)				DTRACE_PROBE1(pwdshadow, name, a)
+#	define pwdshadow_probe2(name, a, b)				DTRACE_PROBE2(pwdshadow, name, a, b)
+#	define pwdshadow_probe3(name, a, b, c)			DTRACE_PROBE3(pwdshadow, name, a, b, c)
+#	define pwdshadow_probe4(name, a, b, c, d)		DTRACE_PROBE4(pwdshadow, name, a, b, c, d)
+#else
+#	define pwdshadow_probe1(name, a)				((void)sizeof(a))
+#	define pwdshadow_probe2(name, a, b)				((void)sizeof(a), (void)sizeof(b))
+#	define pwdshadow_probe3(name, a, b, c)			((void)sizeof(a), (void)sizeof(b), (void)sizeof(c))
+#	define pwdshadow_probe4(name, a, b, c, d)		((void)sizeof(a), (void)sizeof(b), (void)sizeof(c), (void)sizeof(d))
+#endif
 
 
 /////////////////
@@ -111,64 +262,320 @@ typedef struct pwdshadow_oc_t
 } pwdshadow_oc_t;
 
 
-typedef struct pwdshadow_data_t
+typedef struct pwdshadow_policy_t
 {
-	AttributeDescription *		dt_ad;
-	int							dt_flag;
-	int							dt_prev;
-	int							dt_mod;
-	int							dt_post;
-} pwdshadow_data_t;
+	struct berval				pp_ndn;
+	int							pp_flags;
+	int							pp_refcnt;
+	time_t						pp_expires;
+
+	// slots of the policy attributes present in the policy entry
+	uint32_t					pp_exists;
+
+	// slapo-ppolicy attributes (IETF draft-behera-ldap-password-policy-11)
+	int							pp_pwdExpireWarning;
+	int							pp_pwdGraceExpiry;
+	int							pp_pwdMaxAge;
+	int							pp_pwdMinAge;
+
+	// slapo-pwdshadow policy attributes
+	int							pp_pwdShadowAutoExpire;
+} pwdshadow_policy_t;
 
 
 typedef struct pwdshadow_state_t
 {
+	struct pwdshadow_cfg_t *	st_cfg;
+	BerValue					st_ndn;
 	BerValue					st_policy;
+	int							st_today;
 	int							st_purge;
 	int							st_autoexpire;
-	pwdshadow_data_t			st_policySubentry;
+	int							st_force;
+
+	// flags of tracked attributes with one bit per slot of pwdshadow_slots[],
+	// the slots with a verified syntax are copied from the template
+	uint32_t					st_exists;
+	uint32_t					st_useradd;
+	uint32_t					st_userdel;
+	uint32_t					st_evaladd;
+	uint32_t					st_evaldel;
+	uint32_t					st_override;
+	uint32_t					st_valid;
+
+	// values of tracked attributes before and after the operation
+	int							st_prev[PWDSHADOW_SLOTS];
+	int							st_post[PWDSHADOW_SLOTS];
+} pwdshadow_state_t;
 
-	// slapo-ppolicy attributes (IETF draft-behera-ldap-password-policy-11)
-	pwdshadow_data_t			st_pwdChangedTime;
-	pwdshadow_data_t			st_pwdEndTime;
-	pwdshadow_data_t			st_pwdExpireWarning;
-	pwdshadow_data_t			st_pwdGraceExpiry;
-	pwdshadow_data_t			st_pwdMaxAge;
-	pwdshadow_data_t			st_pwdMinAge;
 
-	// slapo-pwdshadow policy attributes
-	pwdshadow_data_t			st_pwdShadowAutoExpire;
+typedef struct pwdshadow_slot_t
+{
+	AttributeDescription **		sl_ad;
+	int							sl_type;
+	int							sl_scan;
+} pwdshadow_slot_t;
 
-	// slapo-pwdshadow attributes
-	pwdshadow_data_t			st_pwdShadowExpire;
-	pwdshadow_data_t			st_pwdShadowFlag;
-	pwdshadow_data_t			st_pwdShadowGenerate;
-	pwdshadow_data_t			st_pwdShadowInactive;
-	pwdshadow_data_t			st_pwdShadowLastChange;
-	pwdshadow_data_t			st_pwdShadowMax;
-	pwdshadow_data_t			st_pwdShadowMin;
-	pwdshadow_data_t			st_pwdShadowWarning;
 
-	// LDAP NIS attributes (RFC 2307)
-	pwdshadow_data_t			st_shadowExpire;
-	pwdshadow_data_t			st_shadowFlag;
-	pwdshadow_data_t			st_shadowInactive;
-	pwdshadow_data_t			st_shadowLastChange;
-	pwdshadow_data_t			st_shadowMax;
-	pwdshadow_data_t			st_shadowMin;
-	pwdshadow_data_t			st_shadowWarning;
+// derivation of a generated attribute, triggers and inputs are sets of slots
+typedef struct pwdshadow_rule_t
+{
+	int							ru_slot;
+	int							ru_override;
+	uint32_t					ru_triggers;
+	uint32_t					ru_inputs;
+	int							ru_flags;
+	int							(*ru_compute)( pwdshadow_state_t * st, int slot );
+} pwdshadow_rule_t;
 
-	// User Schema (RFC 2256)
-	pwdshadow_data_t			st_userPassword;
-} pwdshadow_state_t;
+
+typedef struct pwdshadow_hash_t
+{
+	AttributeDescription *		ha_ad;
+	int							ha_slot;
+	int							ha_scan;
+} pwdshadow_hash_t;
+
+
+typedef struct pwdshadow_batch_t
+{
+	struct pwdshadow_batch_t *	rb_next;
+	struct pwdshadow_t *		rb_ps;
+	ID							rb_last;
+	int							rb_count;
+	int							rb_done;
+	struct berval				rb_ndn[PWDSHADOW_REGEN_BATCH];
+} pwdshadow_batch_t;
+
+
+// rewritten search filter of an operation, the original filter is restored
+// by pwdshadow_filter_cleanup() before the frontend frees it
+typedef struct pwdshadow_filter_t
+{
+	slap_callback				fl_cb;
+	Filter *					fl_filter;
+	struct berval				fl_filterstr;
+} pwdshadow_filter_t;
+
+
+// generated modifications of an operation allocated as a single block from
+// the operation's memory context, see pwdshadow_mods_cleanup()
+typedef struct pwdshadow_mods_t
+{
+	slap_callback				mb_cb;
+	int							mb_count;
+	Modifications				mb_mods[PWDSHADOW_GENERATED];
+	struct berval				mb_vals[PWDSHADOW_GENERATED][2];
+	char						mb_buff[PWDSHADOW_GENERATED][PWDSHADOW_INT_LEN];
+} pwdshadow_mods_t;
+
+
+// node of the reversed RDN trie of pwdshadow_subtree_policy suffixes, RDNs
+// reference the normalized suffixes stored in the configuration
+typedef struct pwdshadow_trie_t
+{
+	struct berval				tr_rdn;
+	struct berval *				tr_policy;
+	struct pwdshadow_trie_t *	tr_child;
+	struct pwdshadow_trie_t *	tr_next;
+} pwdshadow_trie_t;
+
+
+// entry cached by the value of the key attribute of pwdshadow_tuple_cache,
+// the normalized key, key, normalized DN and DN follow the structure in the
+// same allocation, see pwdshadow_tuple_strings()
+typedef struct pwdshadow_tuple_t
+{
+	struct pwdshadow_tuple_t *	tu_knext;
+	struct pwdshadow_tuple_t *	tu_dnext;
+	uint32_t					tu_khash;
+	uint32_t					tu_dhash;
+	uint32_t					tu_ring;
+	uint32_t					tu_epoch;
+	uint32_t					tu_size;
+	uint32_t					tu_exists;
+	uint16_t					tu_flags;
+	uint16_t					tu_nklen;
+	uint16_t					tu_klen;
+	uint16_t					tu_ndnlen;
+	uint16_t					tu_dnlen;
+
+	// values of the shadow and generated attribute of each rule
+	int							tu_vals[PWDSHADOW_RULES][2];
+} pwdshadow_tuple_t;
+
+
+// internal search selecting the entries of a key
+typedef struct pwdshadow_tuple_load_t
+{
+	slap_callback				tl_cb;
+	struct pwdshadow_cfg_t *	tl_cfg;
+	struct berval				tl_key;
+	int							tl_count;
+	pwdshadow_tuple_t *			tl_tuple;
+} pwdshadow_tuple_load_t;
+
+
+// write which removes cached entries once the backend has applied it
+typedef struct pwdshadow_tuple_watch_t
+{
+	slap_callback				tw_cb;
+	struct pwdshadow_t *		tw_ps;
+	int							tw_flush;
+	BerVarray					tw_keys;
+} pwdshadow_tuple_watch_t;
+
+
+// entry of the expiry index, the DN is allocated with the entry and a day
+// of -1 is not indexed
+typedef struct pwdshadow_expiry_t
+{
+	struct berval				ex_ndn;
+	int							ex_days[PWDSHADOW_EXPIRY_KINDS];
+} pwdshadow_expiry_t;
+
+
+// internal search building the expiry index
+typedef struct pwdshadow_expiry_build_t
+{
+	slap_callback				eb_cb;
+	struct pwdshadow_t *		eb_ps;
+	unsigned long				eb_gen;
+} pwdshadow_expiry_build_t;
+
+
+// counters and latency histograms updated by threads mapped to the shard,
+// a shard is padded to cache lines to avoid false sharing between shards
+typedef struct pwdshadow_stats_t
+{
+	unsigned long				sx_counters[PWDSHADOW_STAT_COUNT];
+	unsigned long				sx_mods[PWDSHADOW_SLOTS][3];
+	unsigned long				sx_latency[PWDSHADOW_PHASE_COUNT][PWDSHADOW_STATS_BUCKETS];
+} __attribute__((aligned(PWDSHADOW_CACHELINE))) pwdshadow_stats_t;
+
+
+// immutable snapshot of the configuration read by operations, replaced as a
+// whole when the configuration changes and released after a grace period
+typedef struct pwdshadow_cfg_t
+{
+	struct berval				cf_def_policy;
+	int							cf_mode;
+	int							cf_overrides;
+	int							cf_use_policies;
+	int							cf_trust_replication;
+	int							cf_cache_ttl;
+	int							cf_alias;
+	AttributeDescription *		cf_policy_ad;
+	AttributeDescription *		cf_tuple_ad;
+	int							cf_expiry;
+
+	// password policies assigned by subtree
+	BerVarray					cf_subtree_dns;
+	BerVarray					cf_subtree_policies;
+	pwdshadow_trie_t *			cf_subtree;
+
+	// attribute descriptions and types prepared from the configuration
+	pwdshadow_state_t			cf_template;
+	AttributeDescription *		cf_ads[PWDSHADOW_SLOTS];
+	pwdshadow_hash_t			cf_hash[PWDSHADOW_HASH_SIZE];
+	int							cf_hash_entry;
+	int							cf_hash_policy;
+
+	// evaluation order of rules and rules reachable from each slot
+	int							cf_rule_count;
+	int							cf_rule_order[PWDSHADOW_RULES];
+	unsigned					cf_rule_mask[PWDSHADOW_SLOTS];
+
+	// references held beyond a single operation and the publishing instance
+	unsigned long				cf_refcnt;
+	struct pwdshadow_cfg_t *	cf_next;
+} pwdshadow_cfg_t;
 
 
 typedef struct pwdshadow_t
 {
+	// configuration directives, only accessed by the configuration thread
 	struct berval				ps_def_policy;
+	int							ps_mode;
 	int							ps_overrides;
 	int							ps_use_policies;
+	int							ps_trust_replication;
+	int							ps_cache_ttl;
+	int							ps_alias;
 	AttributeDescription *		ps_policy_ad;
+	BerVarray					ps_subtree_dns;
+	BerVarray					ps_subtree_policies;
+
+	// snapshot of the directives used by operations and retired snapshots
+	pwdshadow_cfg_t *			ps_cfg;
+	pwdshadow_cfg_t *			ps_cfg_retired;
+
+	// cache of parsed password policies, the tree and its nodes are guarded
+	// by the lock while threads waiting for a policy being loaded sleep on
+	// the mutex
+	int							ps_cache_count;
+	Avlnode *					ps_cache;
+	ldap_pvt_thread_rdwr_t		ps_cache_rwlock;
+	ldap_pvt_thread_mutex_t		ps_cache_mutex;
+	ldap_pvt_thread_cond_t		ps_cache_cond;
+
+	// entries cached by value of a key attribute, the key attribute and size
+	// are set by pwdshadow_tuple_reset() while holding the mutex
+	AttributeDescription *		ps_tuple_ad;
+	unsigned long				ps_tuple_max;
+	unsigned long				ps_tuple_count;
+	unsigned long				ps_tuple_mask;
+	unsigned long				ps_tuple_hand;
+	unsigned long				ps_tuple_gen;
+	uint32_t					ps_tuple_epoch;
+	size_t						ps_tuple_bytes;
+	pwdshadow_tuple_t **		ps_tuple_keys;
+	pwdshadow_tuple_t **		ps_tuple_dns;
+	pwdshadow_tuple_t **		ps_tuple_ring;
+	ldap_pvt_thread_mutex_t		ps_tuple_mutex;
+
+	// entries ordered by day of expiry and by DN, a build is abandoned once
+	// the generation changes
+	int							ps_expiry;
+	int							ps_expiry_state;
+	int							ps_expiry_running;
+	unsigned long				ps_expiry_gen;
+	unsigned long				ps_expiry_count;
+	size_t						ps_expiry_bytes;
+	TAvlnode *					ps_expiry_dns;
+	TAvlnode *					ps_expiry_days[PWDSHADOW_EXPIRY_KINDS];
+	struct re_s *				ps_expiry_task;
+	ldap_pvt_thread_mutex_t		ps_expiry_mutex;
+
+	// bulk regeneration of generated attributes
+	int							ps_regen_rate;
+	int							ps_regen_workers;
+	int							ps_regen_state;
+	int							ps_regen_full;
+	int							ps_regen_resumable;
+	int							ps_regen_inflight;
+	int							ps_regen_persisting;
+	ID							ps_regen_cursor;
+	time_t						ps_regen_started;
+	unsigned long				ps_regen_submitted;
+	unsigned long				ps_regen_processed;
+	unsigned long				ps_regen_modified;
+	BackendDB *					ps_regen_be;
+	slap_overinst *				ps_regen_on;
+	pwdshadow_batch_t *			ps_regen_fill;
+	pwdshadow_batch_t *			ps_regen_head;
+	pwdshadow_batch_t *			ps_regen_tail;
+	BerVarray					ps_regen_policies;
+	BerVarray					ps_regen_subtrees;
+	struct re_s *				ps_regen_task;
+	ldap_pvt_thread_mutex_t		ps_regen_mutex;
+
+	// statistics published under cn=monitor
+	pwdshadow_stats_t *			ps_stats;
+	void *						ps_stats_mem;
+	int							ps_stats_timing;
+	void *						ps_monitor_cb;
+	struct berval				ps_monitor_ndn;
 } pwdshadow_t;
 
 
@@ -187,23 +594,72 @@ init_module(
 		char *						argv[] );
 
 
+static int
+pwdshadow_callback_cleanup(
+		Operation *					op,
+		SlapReply *					rs );
+
+
+static void
+pwdshadow_cfg_free(
+		pwdshadow_cfg_t *			cf );
+
+
 static int
 pwdshadow_cfg_gen(
 		ConfigArgs *				c );
 
 
+static pwdshadow_cfg_t *
+pwdshadow_cfg_hold(
+		pwdshadow_t *				ps );
+
+
+static int
+pwdshadow_cfg_publish(
+		pwdshadow_t *				ps );
+
+
+static size_t
+pwdshadow_cfg_quote(
+		struct berval *				bv,
+		char *						str );
+
+
+static int
+pwdshadow_cfg_reclaim(
+		pwdshadow_t *				ps,
+		int							force );
+
+
+static void
+pwdshadow_cfg_release(
+		pwdshadow_cfg_t *			cf );
+
+
 static void
 pwdshadow_copy_int_bv(
 		int							i,
 		BerValue *					bv );
 
 
+static int
+pwdshadow_db_close(
+		BackendDB *					be,
+		ConfigReply *				cr );
+
+
 static int
 pwdshadow_db_destroy(
 		BackendDB *					be,
 		ConfigReply *				cr );
 
 
+static void
+pwdshadow_db_free(
+		pwdshadow_t *				ps );
+
+
 static int
 pwdshadow_db_init(
 		BackendDB *					be,
@@ -216,6 +672,17 @@ pwdshadow_db_open(
 		ConfigReply *				cr );
 
 
+static void *
+pwdshadow_db_reap(
+		void *						ctx,
+		void *						arg );
+
+
+static int
+pwdshadow_db_running(
+		pwdshadow_t *				ps );
+
+
 static int
 pwdshadow_eval(
 		Operation *					op,
@@ -230,33 +697,161 @@ pwdshadow_eval_policy(
 
 static int
 pwdshadow_eval_postcheck(
-		pwdshadow_data_t *			dat );
+		pwdshadow_state_t *			st,
+		int							slot );
 
 
 static int
 pwdshadow_eval_precheck(
-		Operation *					op,
 		pwdshadow_state_t *			st,
-		pwdshadow_data_t *			dat,
-		pwdshadow_data_t *			override,
-		pwdshadow_data_t *			triggers[] );
+		const pwdshadow_rule_t *	ru );
+
+
+static void *
+pwdshadow_expiry_build(
+		void *						ctx,
+		void *						arg );
+
+
+static int
+pwdshadow_expiry_cmp(
+		const pwdshadow_expiry_t *	a,
+		const pwdshadow_expiry_t *	b,
+		int							kind );
+
+
+static int
+pwdshadow_expiry_cmp_dn(
+		const void *				a,
+		const void *				b );
+
+
+static int
+pwdshadow_expiry_cmp_expire(
+		const void *				a,
+		const void *				b );
+
+
+static int
+pwdshadow_expiry_cmp_maxage(
+		const void *				a,
+		const void *				b );
+
+
+static int
+pwdshadow_expiry_collect(
+		Operation *					op,
+		SlapReply *					rs );
 
 
 static int
-pwdshadow_flg_willexist(
-		pwdshadow_data_t *			dat);
+pwdshadow_expiry_config(
+		pwdshadow_t *				ps );
+
+
+static int
+pwdshadow_expiry_day(
+		const char *				str,
+		int							today,
+		int *						dayp );
 
 
 static int
-pwdshadow_get_attr(
+pwdshadow_expiry_days(
 		Entry *						entry,
-		pwdshadow_data_t *			dat,
-		int							flags );
+		int *						days );
 
 
 static int
-pwdshadow_get_attrs(
+pwdshadow_expiry_extop(
+		Operation *					op,
+		SlapReply *					rs );
+
+
+static int
+pwdshadow_expiry_insert(
+		pwdshadow_t *				ps,
+		struct berval *				ndn,
+		int *						days );
+
+
+static int
+pwdshadow_expiry_open(
+		pwdshadow_t *				ps );
+
+
+static int
+pwdshadow_expiry_purge(
+		pwdshadow_t *				ps );
+
+
+static void
+pwdshadow_expiry_remove(
+		pwdshadow_t *				ps,
+		pwdshadow_expiry_t *		ex );
+
+
+static int
+pwdshadow_expiry_rename(
+		pwdshadow_t *				ps,
+		struct berval *				ndn,
+		struct berval *				newndn );
+
+
+static int
+pwdshadow_expiry_reset(
+		pwdshadow_t *				ps );
+
+
+static int
+pwdshadow_expiry_response(
+		Operation *					op,
+		SlapReply *					rs );
+
+
+static int
+pwdshadow_expiry_update(
 		pwdshadow_t *				ps,
+		struct berval *				ndn,
+		int *						days );
+
+
+static int
+pwdshadow_expiry_watch(
+		Operation *					op,
+		pwdshadow_t *				ps,
+		pwdshadow_cfg_t *			cf );
+
+
+static int
+pwdshadow_filter_cleanup(
+		Operation *					op,
+		SlapReply *					rs );
+
+
+static Filter *
+pwdshadow_filter_new(
+		Operation *					op,
+		ber_tag_t					choice,
+		AttributeDescription *		ad,
+		int							val );
+
+
+static int
+pwdshadow_filter_rewrite(
+		Operation *					op,
+		pwdshadow_cfg_t *			cf,
+		Filter *					f );
+
+
+static const pwdshadow_rule_t *
+pwdshadow_filter_rule(
+		pwdshadow_cfg_t *			cf,
+		Filter *					f );
+
+
+static int
+pwdshadow_get_attrs(
 		pwdshadow_state_t *			st,
 		Entry *						entry,
 		int							flags );
@@ -265,8 +860,8 @@ pwdshadow_get_attrs(
 static int
 pwdshadow_get_mods(
 		Modifications *				mods,
-		pwdshadow_data_t *			dat,
-		int							flags );
+		pwdshadow_state_t *			st,
+		int							slot );
 
 
 extern int
@@ -274,6 +869,70 @@ pwdshadow_initialize(
 		void );
 
 
+static ber_len_t
+pwdshadow_int2str(
+		int							i,
+		char *						buff );
+
+
+static pwdshadow_mods_t *
+pwdshadow_mods_alloc(
+		Operation *					op );
+
+
+static int
+pwdshadow_mods_cleanup(
+		Operation *					op,
+		SlapReply *					rs );
+
+
+static void
+pwdshadow_mods_unlink(
+		Modifications **			modsp,
+		pwdshadow_mods_t *			mb );
+
+
+static int
+pwdshadow_monitor_close(
+		BackendDB *					be );
+
+
+#ifdef SLAPD_MONITOR
+static int
+pwdshadow_monitor_free(
+		Entry *						e,
+		void **						priv );
+#endif
+
+
+static int
+pwdshadow_monitor_initialize(
+		void );
+
+
+static int
+pwdshadow_monitor_open(
+		BackendDB *					be,
+		slap_overinst *				on );
+
+
+#ifdef SLAPD_MONITOR
+static int
+pwdshadow_monitor_set(
+		Entry *						e,
+		AttributeDescription *		ad,
+		BerVarray					vals );
+
+
+static int
+pwdshadow_monitor_update(
+		Operation *					op,
+		SlapReply *					rs,
+		Entry *						e,
+		void *						priv );
+#endif
+
+
 static int
 pwdshadow_op_add(
 		Operation *					op,
@@ -281,9 +940,22 @@ pwdshadow_op_add(
 
 
 static int
-pwdshadow_op_add_attr(
+pwdshadow_op_add_attrs(
+		pwdshadow_stats_t *			sx,
 		Entry *						entry,
-		pwdshadow_data_t *			dat );
+		pwdshadow_state_t *			st );
+
+
+static int
+pwdshadow_op_compare(
+		Operation *					op,
+		SlapReply *					rs );
+
+
+static int
+pwdshadow_op_delete(
+		Operation *					op,
+		SlapReply *					rs );
 
 
 static int
@@ -294,47 +966,452 @@ pwdshadow_op_modify(
 
 static int
 pwdshadow_op_modify_mods(
-		pwdshadow_data_t *			dat,
+		pwdshadow_stats_t *			sx,
+		pwdshadow_mods_t *			mb,
+		pwdshadow_state_t *			st,
 		Modifications ***			nextp );
 
 
 static int
-pwdshadow_set(
-		pwdshadow_data_t *			dat,
-		BerValue *					bv,
-		int							flags );
+pwdshadow_op_modrdn(
+		Operation *					op,
+		SlapReply *					rs );
 
 
 static int
-pwdshadow_set_value(
-		pwdshadow_data_t *			dat,
-		int							val,
-		int							flags );
+pwdshadow_op_search(
+		Operation *					op,
+		SlapReply *					rs );
 
 
 static int
-pwdshadow_state_initialize(
+pwdshadow_op_timestamp(
+		Operation *					op,
 		pwdshadow_state_t *			st,
-		pwdshadow_t *				ps );
+		BerValue *					vals );
 
 
-/////////////////
-//             //
-//  Variables  //
-//             //
-/////////////////
-#ifndef SLAPD_OVER_HELLOWORLD
-#	pragma mark - Variables
-#endif
+static int
+pwdshadow_operational(
+		Operation *					op,
+		SlapReply *					rs );
 
-static slap_overinst				pwdshadow;
-static ldap_pvt_thread_mutex_t		pwdshadow_ad_mutex;
-static int							pwdshadow_schema			= 0;
 
-// internal attribute descriptions
-static AttributeDescription *		ad_pwdShadowAutoExpire		= NULL;
-static AttributeDescription *		ad_pwdShadowLastChange		= NULL;
-static AttributeDescription *		ad_pwdShadowMin				= NULL;
+static Attribute **
+pwdshadow_operational_append(
+		Attribute **				ap,
+		AttributeDescription *		ad,
+		int							val );
+
+
+static int
+pwdshadow_parse_int(
+		BerValue *					bv,
+		int64_t *					valp );
+
+
+static int
+pwdshadow_parse_time(
+		BerValue *					bv,
+		int64_t *					daysp );
+
+
+static int
+pwdshadow_parse_time_fast(
+		BerValue *					bv,
+		int64_t *					daysp );
+
+
+static int
+pwdshadow_policy_cmp(
+		const void *				a,
+		const void *				b );
+
+
+static void
+pwdshadow_policy_free(
+		void *						ptr );
+
+
+static int
+pwdshadow_policy_get(
+		Operation *					op,
+		pwdshadow_t *				ps,
+		pwdshadow_cfg_t *			cf,
+		struct berval *				ndn,
+		pwdshadow_policy_t *		pp );
+
+
+static int
+pwdshadow_policy_invalidate(
+		pwdshadow_t *				ps,
+		struct berval *				ndn );
+
+
+static int
+pwdshadow_policy_load(
+		Operation *					op,
+		pwdshadow_cfg_t *			cf,
+		struct berval *				ndn,
+		pwdshadow_policy_t *		pp );
+
+
+static int
+pwdshadow_policy_response(
+		Operation *					op,
+		SlapReply *					rs );
+
+
+static int
+pwdshadow_policy_watch(
+		Operation *					op,
+		pwdshadow_t *				ps,
+		pwdshadow_cfg_t *			cf );
+
+
+static void *
+pwdshadow_regen_batch(
+		void *						ctx,
+		void *						arg );
+
+
+static int
+pwdshadow_regen_collect(
+		Operation *					op,
+		SlapReply *					rs );
+
+
+static int
+pwdshadow_regen_cursor(
+		Operation *					op,
+		pwdshadow_t *				ps,
+		ID							cursor );
+
+
+static int
+pwdshadow_regen_dependents(
+		pwdshadow_t *				ps,
+		pwdshadow_cfg_t *			cf,
+		struct berval *				filter );
+
+
+static int
+pwdshadow_regen_entry(
+		Operation *					op,
+		pwdshadow_t *				ps,
+		struct berval *				ndn );
+
+
+static int
+pwdshadow_regen_extop(
+		Operation *					op,
+		SlapReply *					rs );
+
+
+static int
+pwdshadow_regen_open(
+		BackendDB *					be,
+		slap_overinst *				on );
+
+
+static int
+pwdshadow_regen_policy(
+		pwdshadow_t *				ps,
+		struct berval *				ndn );
+
+
+static int
+pwdshadow_regen_response(
+		Operation *					op,
+		SlapReply *					rs );
+
+
+static void *
+pwdshadow_regen_resume(
+		void *						ctx,
+		void *						arg );
+
+
+static void *
+pwdshadow_regen_run(
+		void *						ctx,
+		void *						arg );
+
+
+static int
+pwdshadow_regen_start(
+		pwdshadow_t *				ps,
+		ID							cursor,
+		int							full );
+
+
+static int
+pwdshadow_regen_submit(
+		pwdshadow_t *				ps,
+		pwdshadow_batch_t *			batch );
+
+
+static int
+pwdshadow_regen_subtree(
+		pwdshadow_t *				ps,
+		struct berval *				ndn );
+
+
+static int
+pwdshadow_regen_wait(
+		pwdshadow_t *				ps,
+		int							limit );
+
+
+static int
+pwdshadow_rule_expire(
+		pwdshadow_state_t *			st,
+		int							slot );
+
+
+static int
+pwdshadow_rule_lastchange(
+		pwdshadow_state_t *			st,
+		int							slot );
+
+
+static int
+pwdshadow_rules_build(
+		pwdshadow_cfg_t *			cf );
+
+
+static int
+pwdshadow_scan_attrs(
+		pwdshadow_state_t *			st,
+		Attribute *					attrs,
+		int							scan,
+		int							flags );
+
+
+static int
+pwdshadow_set(
+		pwdshadow_state_t *			st,
+		int							slot,
+		BerValue *					bv,
+		int							flags );
+
+
+static int
+pwdshadow_set_value(
+		pwdshadow_state_t *			st,
+		int							slot,
+		int							val,
+		int							flags );
+
+
+static pwdshadow_hash_t *
+pwdshadow_slot_find(
+		pwdshadow_cfg_t *			cf,
+		AttributeDescription *		ad );
+
+
+static int
+pwdshadow_state_build(
+		pwdshadow_cfg_t *			cf );
+
+
+static int
+pwdshadow_state_initialize(
+		pwdshadow_state_t *			st,
+		pwdshadow_cfg_t *			cf );
+
+
+static uint64_t
+pwdshadow_stats_clock(
+		pwdshadow_t *				ps );
+
+
+static void
+pwdshadow_stats_latency(
+		pwdshadow_stats_t *			sx,
+		int							phase,
+		uint64_t					start );
+
+
+static void
+pwdshadow_stats_mod(
+		pwdshadow_stats_t *			sx,
+		int							slot,
+		int							mod_op );
+
+
+static pwdshadow_stats_t *
+pwdshadow_stats_shard(
+		pwdshadow_t *				ps,
+		Operation *					op );
+
+
+static void
+pwdshadow_stats_sum(
+		pwdshadow_t *				ps,
+		pwdshadow_stats_t *			sum );
+
+
+static int
+pwdshadow_subtree_build(
+		pwdshadow_cfg_t *			cf );
+
+
+static struct berval *
+pwdshadow_subtree_find(
+		pwdshadow_cfg_t *			cf,
+		struct berval *				ndn,
+		int *						nestedp );
+
+
+static void
+pwdshadow_subtree_free(
+		pwdshadow_trie_t *			node );
+
+
+static int
+pwdshadow_subtree_response(
+		Operation *					op,
+		SlapReply *					rs );
+
+
+static int
+pwdshadow_tuple_access(
+		BackendDB *					be );
+
+
+static int
+pwdshadow_tuple_cleanup(
+		Operation *					op,
+		SlapReply *					rs );
+
+
+static int
+pwdshadow_tuple_collect(
+		Operation *					op,
+		SlapReply *					rs );
+
+
+static pwdshadow_tuple_t *
+pwdshadow_tuple_find(
+		pwdshadow_t *				ps,
+		struct berval *				key,
+		uint32_t					hash );
+
+
+static uint32_t
+pwdshadow_tuple_hash(
+		struct berval *				bv );
+
+
+static int
+pwdshadow_tuple_insert(
+		pwdshadow_t *				ps,
+		AttributeDescription *		ad,
+		unsigned long				gen,
+		pwdshadow_tuple_t *			tu );
+
+
+static int
+pwdshadow_tuple_invalidate(
+		pwdshadow_t *				ps,
+		struct berval *				ndn,
+		BerVarray					keys,
+		int							flush );
+
+
+static int
+pwdshadow_tuple_load(
+		Operation *					op,
+		pwdshadow_t *				ps,
+		pwdshadow_cfg_t *			cf,
+		struct berval *				key,
+		unsigned long				gen,
+		pwdshadow_tuple_t **		tup );
+
+
+static int
+pwdshadow_tuple_lookup(
+		Operation *					op,
+		pwdshadow_t *				ps,
+		AttributeDescription *		ad,
+		struct berval *				key,
+		unsigned long *				genp,
+		pwdshadow_tuple_t **		tup );
+
+
+static pwdshadow_tuple_t *
+pwdshadow_tuple_new(
+		pwdshadow_cfg_t *			cf,
+		struct berval *				key,
+		Entry *						entry );
+
+
+static void
+pwdshadow_tuple_remove(
+		pwdshadow_t *				ps,
+		pwdshadow_tuple_t *			tu );
+
+
+static int
+pwdshadow_tuple_reset(
+		pwdshadow_t *				ps,
+		AttributeDescription *		ad,
+		unsigned long				max );
+
+
+static int
+pwdshadow_tuple_response(
+		Operation *					op,
+		SlapReply *					rs );
+
+
+static int
+pwdshadow_tuple_search(
+		Operation *					op,
+		SlapReply *					rs,
+		pwdshadow_t *				ps,
+		pwdshadow_cfg_t *			cf );
+
+
+static void
+pwdshadow_tuple_strings(
+		pwdshadow_tuple_t *			tu,
+		struct berval *				bvs );
+
+
+static int
+pwdshadow_tuple_watch(
+		Operation *					op,
+		pwdshadow_t *				ps,
+		pwdshadow_cfg_t *			cf );
+
+
+static int
+pwdshadow_virtual_eval(
+		Operation *					op,
+		pwdshadow_cfg_t *			cf,
+		pwdshadow_state_t *			st,
+		Entry *						entry );
+
+
+/////////////////
+//             //
+//  Variables  //
+//             //
+/////////////////
+#ifndef SLAPD_OVER_HELLOWORLD
+#	pragma mark - Variables
+#endif
+
+static slap_overinst				pwdshadow;
+static ldap_pvt_thread_mutex_t		pwdshadow_ad_mutex;
+static int							pwdshadow_schema			= 0;
+
+// internal attribute descriptions
+static AttributeDescription *		ad_pwdShadowAutoExpire		= NULL;
+static AttributeDescription *		ad_pwdShadowLastChange		= NULL;
+static AttributeDescription *		ad_pwdShadowMin				= NULL;
 static AttributeDescription *		ad_pwdShadowMax				= NULL;
 static AttributeDescription *		ad_pwdShadowWarning			= NULL;
 static AttributeDescription *		ad_pwdShadowInactive		= NULL;
@@ -343,1491 +1420,6804 @@ static AttributeDescription *		ad_pwdShadowFlag			= NULL;
 static AttributeDescription *		ad_pwdShadowGenerate		= NULL;
 static AttributeDescription *		ad_pwdShadowPolicySubentry	= NULL;
 
-// slapo-ppolicy attributes (IETF draft-behera-ldap-password-policy-11)
-static AttributeDescription *		ad_pwdChangedTime			= NULL;
-static AttributeDescription *		ad_pwdEndTime				= NULL;
-static AttributeDescription *		ad_pwdExpireWarning			= NULL;
-static AttributeDescription *		ad_pwdGraceExpiry			= NULL;
-static AttributeDescription *		ad_pwdMaxAge				= NULL;
-static AttributeDescription *		ad_pwdMinAge				= NULL;
+// slapo-ppolicy attributes (IETF draft-behera-ldap-password-policy-11)
+static AttributeDescription *		ad_pwdChangedTime			= NULL;
+static AttributeDescription *		ad_pwdEndTime				= NULL;
+static AttributeDescription *		ad_pwdExpireWarning			= NULL;
+static AttributeDescription *		ad_pwdGraceExpiry			= NULL;
+static AttributeDescription *		ad_pwdMaxAge				= NULL;
+static AttributeDescription *		ad_pwdMinAge				= NULL;
+
+// LDAP NIS attributes (RFC 2307)
+static AttributeDescription *		ad_shadowExpire				= NULL;
+static AttributeDescription *		ad_shadowFlag				= NULL;
+static AttributeDescription *		ad_shadowInactive			= NULL;
+static AttributeDescription *		ad_shadowLastChange			= NULL;
+static AttributeDescription *		ad_shadowMax				= NULL;
+static AttributeDescription *		ad_shadowMin				= NULL;
+static AttributeDescription *		ad_shadowWarning			= NULL;
+
+// User Schema (RFC 2256)
+static AttributeDescription *		ad_userPassword				= NULL;
+
+// Directory Information Models (RFC 4512)
+static AttributeDescription *		ad_objectClass				= NULL;
+static AttributeDescription *		ad_modifyTimestamp			= NULL;
+
+// overlay's internal attributes
+static AttributeDescription *		ad_pwdShadowRegenCursor		= NULL;
+
+// user objectClasses
+static ObjectClass *				oc_pwdShadowPolicy			= NULL;
+
+// LDAP NIS objectClasses (RFC 2307)
+static ObjectClass *				oc_shadowAccount			= NULL;
+
+#ifdef SLAPD_MONITOR
+// monitor attributes
+static AttributeDescription *		ad_pwdShadowMonAdds				= NULL;
+static AttributeDescription *		ad_pwdShadowMonModifies			= NULL;
+static AttributeDescription *		ad_pwdShadowMonModifiesSkipped	= NULL;
+static AttributeDescription *		ad_pwdShadowMonEntryFetches		= NULL;
+static AttributeDescription *		ad_pwdShadowMonPolicyLookups	= NULL;
+static AttributeDescription *		ad_pwdShadowMonPolicyFailures	= NULL;
+static AttributeDescription *		ad_pwdShadowMonGeneratedAdd		= NULL;
+static AttributeDescription *		ad_pwdShadowMonGeneratedReplace	= NULL;
+static AttributeDescription *		ad_pwdShadowMonGeneratedDelete	= NULL;
+static AttributeDescription *		ad_pwdShadowMonFetchLatency		= NULL;
+static AttributeDescription *		ad_pwdShadowMonPolicyLatency	= NULL;
+static AttributeDescription *		ad_pwdShadowMonEvalLatency		= NULL;
+static AttributeDescription *		ad_pwdShadowMonModsLatency		= NULL;
+static AttributeDescription *		ad_pwdShadowMonRegenState		= NULL;
+static AttributeDescription *		ad_pwdShadowMonRegenProcessed	= NULL;
+static AttributeDescription *		ad_pwdShadowMonRegenModified	= NULL;
+static AttributeDescription *		ad_pwdShadowMonReplicated		= NULL;
+static AttributeDescription *		ad_pwdShadowMonTupleHits		= NULL;
+static AttributeDescription *		ad_pwdShadowMonTupleMisses		= NULL;
+static AttributeDescription *		ad_pwdShadowMonTupleEntries		= NULL;
+static AttributeDescription *		ad_pwdShadowMonTupleBytes		= NULL;
+static AttributeDescription *		ad_pwdShadowMonExpiryEntries	= NULL;
+static AttributeDescription *		ad_pwdShadowMonExpiryBytes		= NULL;
+
+// monitor objectClasses
+static ObjectClass *				oc_pwdShadowMonitor				= NULL;
+#endif
+
+// extended operation used to start bulk regeneration
+static const struct berval			pwdshadow_regen_oid			= BER_BVC(PWDSHADOW_REGEN_OID);
+static struct berval				pwdshadow_regen_filter		= BER_BVC("(objectClass=*)");
+
+// extended operation listing entries of the expiry index
+static const struct berval			pwdshadow_expiry_oid		= BER_BVC(PWDSHADOW_EXPIRY_OID);
+
+// orders of the expiry index by kind of day
+static AVL_CMP * const				pwdshadow_expiry_cmps[PWDSHADOW_EXPIRY_KINDS] = { pwdshadow_expiry_cmp_expire, pwdshadow_expiry_cmp_maxage };
+
+
+// attributes tracked by the overlay's state
+static pwdshadow_slot_t pwdshadow_slots[PWDSHADOW_SLOT_COUNT + 1] =
+{
+	// slapo-ppolicy policy subentry (replaced by pwdshadow_policy_ad)
+	[PWDSHADOW_SL_policySubentry]		= { &ad_pwdShadowPolicySubentry,		PWDSHADOW_TYPE_EXISTS,		PWDSHADOW_SCAN_ENTRY|PWDSHADOW_SCAN_MODLIST },
+
+	// slapo-ppolicy attributes (IETF draft-behera-ldap-password-policy-11)
+	[PWDSHADOW_SL_pwdChangedTime]		= { &ad_pwdChangedTime,				PWDSHADOW_TYPE_TIME,		PWDSHADOW_SCAN_ENTRY|PWDSHADOW_SCAN_MODLIST },
+	[PWDSHADOW_SL_pwdEndTime]			= { &ad_pwdEndTime,					PWDSHADOW_TYPE_TIME,		PWDSHADOW_SCAN_ENTRY|PWDSHADOW_SCAN_MODLIST },
+	[PWDSHADOW_SL_pwdExpireWarning]		= { &ad_pwdExpireWarning,				PWDSHADOW_TYPE_SECS,		PWDSHADOW_SCAN_POLICY },
+	[PWDSHADOW_SL_pwdGraceExpiry]		= { &ad_pwdGraceExpiry,				PWDSHADOW_TYPE_SECS,		PWDSHADOW_SCAN_POLICY },
+	[PWDSHADOW_SL_pwdMaxAge]			= { &ad_pwdMaxAge,					PWDSHADOW_TYPE_SECS,		PWDSHADOW_SCAN_POLICY },
+	[PWDSHADOW_SL_pwdMinAge]			= { &ad_pwdMinAge,					PWDSHADOW_TYPE_SECS,		PWDSHADOW_SCAN_POLICY },
+
+	// slapo-pwdshadow policy attributes
+	[PWDSHADOW_SL_pwdShadowAutoExpire]	= { &ad_pwdShadowAutoExpire,			PWDSHADOW_TYPE_BOOL,		PWDSHADOW_SCAN_POLICY },
+
+	// slapo-pwdshadow attributes
+	[PWDSHADOW_SL_pwdShadowExpire]		= { &ad_pwdShadowExpire,				PWDSHADOW_TYPE_DAYS,		PWDSHADOW_SCAN_ENTRY|PWDSHADOW_SCAN_MODLIST|PWDSHADOW_SCAN_VIRTUAL },
+	[PWDSHADOW_SL_pwdShadowFlag]		= { &ad_pwdShadowFlag,				PWDSHADOW_TYPE_INTEGER,		PWDSHADOW_SCAN_ENTRY|PWDSHADOW_SCAN_MODLIST|PWDSHADOW_SCAN_VIRTUAL },
+	[PWDSHADOW_SL_pwdShadowGenerate]	= { &ad_pwdShadowGenerate,			PWDSHADOW_TYPE_BOOL,		PWDSHADOW_SCAN_ENTRY|PWDSHADOW_SCAN_MODLIST },
+	[PWDSHADOW_SL_pwdShadowInactive]	= { &ad_pwdShadowInactive,			PWDSHADOW_TYPE_DAYS,		PWDSHADOW_SCAN_ENTRY|PWDSHADOW_SCAN_MODLIST|PWDSHADOW_SCAN_VIRTUAL },
+	[PWDSHADOW_SL_pwdShadowLastChange]	= { &ad_pwdShadowLastChange,			PWDSHADOW_TYPE_DAYS,		PWDSHADOW_SCAN_ENTRY|PWDSHADOW_SCAN_MODLIST|PWDSHADOW_SCAN_VIRTUAL },
+	[PWDSHADOW_SL_pwdShadowMax]			= { &ad_pwdShadowMax,					PWDSHADOW_TYPE_DAYS,		PWDSHADOW_SCAN_ENTRY|PWDSHADOW_SCAN_MODLIST|PWDSHADOW_SCAN_VIRTUAL },
+	[PWDSHADOW_SL_pwdShadowMin]			= { &ad_pwdShadowMin,					PWDSHADOW_TYPE_DAYS,		PWDSHADOW_SCAN_ENTRY|PWDSHADOW_SCAN_MODLIST|PWDSHADOW_SCAN_VIRTUAL },
+	[PWDSHADOW_SL_pwdShadowWarning]		= { &ad_pwdShadowWarning,				PWDSHADOW_TYPE_DAYS,		PWDSHADOW_SCAN_ENTRY|PWDSHADOW_SCAN_MODLIST|PWDSHADOW_SCAN_VIRTUAL },
+
+	// LDAP NIS attributes (RFC 2307)
+	[PWDSHADOW_SL_shadowExpire]			= { &ad_shadowExpire,					PWDSHADOW_TYPE_DAYS,		PWDSHADOW_SCAN_ENTRY|PWDSHADOW_SCAN_OVERRIDE },
+	[PWDSHADOW_SL_shadowFlag]			= { &ad_shadowFlag,					PWDSHADOW_TYPE_INTEGER,		PWDSHADOW_SCAN_ENTRY|PWDSHADOW_SCAN_OVERRIDE },
+	[PWDSHADOW_SL_shadowInactive]		= { &ad_shadowInactive,				PWDSHADOW_TYPE_DAYS,		PWDSHADOW_SCAN_ENTRY|PWDSHADOW_SCAN_OVERRIDE },
+	[PWDSHADOW_SL_shadowLastChange]		= { &ad_shadowLastChange,				PWDSHADOW_TYPE_DAYS,		PWDSHADOW_SCAN_ENTRY|PWDSHADOW_SCAN_OVERRIDE },
+	[PWDSHADOW_SL_shadowMax]			= { &ad_shadowMax,					PWDSHADOW_TYPE_DAYS,		PWDSHADOW_SCAN_ENTRY|PWDSHADOW_SCAN_OVERRIDE },
+	[PWDSHADOW_SL_shadowMin]			= { &ad_shadowMin,					PWDSHADOW_TYPE_DAYS,		PWDSHADOW_SCAN_ENTRY|PWDSHADOW_SCAN_OVERRIDE },
+	[PWDSHADOW_SL_shadowWarning]		= { &ad_shadowWarning,				PWDSHADOW_TYPE_DAYS,		PWDSHADOW_SCAN_ENTRY|PWDSHADOW_SCAN_OVERRIDE },
+
+	// User Schema (RFC 2256)
+	[PWDSHADOW_SL_userPassword]			= { &ad_userPassword,					PWDSHADOW_TYPE_EXISTS,		PWDSHADOW_SCAN_ENTRY|PWDSHADOW_SCAN_MODLIST },
+
+	[PWDSHADOW_SLOT_COUNT]				= { NULL, 0, 0 }
+};
+
+
+// derivation of generated attributes, ordered and mapped to the attributes
+// which trigger each rule by pwdshadow_rules_build()
+static const pwdshadow_rule_t pwdshadow_rules[PWDSHADOW_RULES + 1] =
+{
+	// pwdShadowExpire
+	{	PWDSHADOW_SL_pwdShadowExpire,
+		PWDSHADOW_SL_shadowExpire,
+		(	pwdshadow_bit(PWDSHADOW_SL_pwdShadowLastChange) |
+			pwdshadow_bit(PWDSHADOW_SL_pwdShadowAutoExpire) |
+			pwdshadow_bit(PWDSHADOW_SL_pwdMaxAge) |
+			pwdshadow_bit(PWDSHADOW_SL_pwdGraceExpiry) |
+			pwdshadow_bit(PWDSHADOW_SL_pwdEndTime) ),
+		(	pwdshadow_bit(PWDSHADOW_SL_pwdShadowMax) |
+			pwdshadow_bit(PWDSHADOW_SL_pwdShadowInactive) ),
+		PWDSHADOW_RULE_POLICY,
+		pwdshadow_rule_expire },
+
+	// pwdShadowFlag
+	{	PWDSHADOW_SL_pwdShadowFlag,
+		PWDSHADOW_SL_shadowFlag,
+		0,
+		0,
+		0,
+		NULL },
+
+	// pwdShadowInactive
+	{	PWDSHADOW_SL_pwdShadowInactive,
+		PWDSHADOW_SL_shadowInactive,
+		pwdshadow_bit(PWDSHADOW_SL_pwdGraceExpiry),
+		0,
+		PWDSHADOW_RULE_POLICY,
+		NULL },
+
+	// pwdShadowLastChange
+	{	PWDSHADOW_SL_pwdShadowLastChange,
+		PWDSHADOW_SL_shadowLastChange,
+		pwdshadow_bit(PWDSHADOW_SL_userPassword),
+		pwdshadow_bit(PWDSHADOW_SL_pwdChangedTime),
+		0,
+		pwdshadow_rule_lastchange },
+
+	// pwdShadowMax
+	{	PWDSHADOW_SL_pwdShadowMax,
+		PWDSHADOW_SL_shadowMax,
+		pwdshadow_bit(PWDSHADOW_SL_pwdMaxAge),
+		0,
+		PWDSHADOW_RULE_POLICY,
+		NULL },
+
+	// pwdShadowMin
+	{	PWDSHADOW_SL_pwdShadowMin,
+		PWDSHADOW_SL_shadowMin,
+		pwdshadow_bit(PWDSHADOW_SL_pwdMinAge),
+		0,
+		PWDSHADOW_RULE_POLICY,
+		NULL },
+
+	// pwdShadowWarning
+	{	PWDSHADOW_SL_pwdShadowWarning,
+		PWDSHADOW_SL_shadowWarning,
+		pwdshadow_bit(PWDSHADOW_SL_pwdExpireWarning),
+		0,
+		PWDSHADOW_RULE_POLICY,
+		NULL },
+
+	{ 0, 0, 0, 0, 0, NULL }
+};
+
+
+// # OID Base is iso(1) org(3) dod(6) internet(1) private(4) enterprise(1)
+//	dms(27893) software(4) slapo-pwdshadow(2).
+//	i.e. slapo-pwdshadow is 1.3.6.1.4.1.27893.4.2
+//
+//	LDAP operational attribute types are under 1.3.6.1.4.1.27893.4.2.1
+//	LDAP user attribute types are under 1.3.6.1.4.1.27893.4.2.2
+//	LDAP object classes are under 1.3.6.1.4.1.27893.4.2.3
+//	Configuration attribute types are under 1.3.6.1.4.1.27893.4.2.4
+//	Configuration object classes are under 1.3.6.1.4.1.27893.4.2.5
+//	LDAP extended operations are under 1.3.6.1.4.1.27893.4.2.6
+//	Monitor attribute types are under 1.3.6.1.4.1.27893.4.2.7
+//	Monitor object classes are under 1.3.6.1.4.1.27893.4.2.8
+
+
+// overlay's LDAP operational and user attributes
+static pwdshadow_at_t pwdshadow_ats[] =
+{
+	{	// pwdShadowLastChange: The number of days since January 1, 1970 on
+		// which the password was last changed.  This attribute is the
+		// equivalent of 'shadowLastChange'.  The value of this attribute is
+		// set when the password is changed and is not calculated at the time
+		// of the query.
+		.def	= "( 1.3.6.1.4.1.27893.4.2.1.5"
+				" NAME ( 'pwdShadowLastChange' )"
+				" DESC 'The generated value for shadowLastChange'"
+				" EQUALITY integerMatch"
+				" ORDERING integerOrderingMatch"
+				" SYNTAX 1.3.6.1.4.1.1466.115.121.1.27"
+				" SINGLE-VALUE"
+				" NO-USER-MODIFICATION"
+				" USAGE directoryOperation )",
+		.ad		= &ad_pwdShadowLastChange
+	},
+	{	// pwdShadowMin: The minimum number of days before a password can be
+		// changed.  This attribute is the equivalent of 'shadowMin', but is
+		// derived from the value of 'pwdMinAge' in current password policy
+		// (pwdMinAge / 60 / 60 /24).
+		.def	= "( 1.3.6.1.4.1.27893.4.2.1.6"
+				" NAME ( 'pwdShadowMin' )"
+				" DESC 'shadowMin equivalent derived from pwdMinAge'"
+				" EQUALITY integerMatch"
+				" SYNTAX 1.3.6.1.4.1.1466.115.121.1.27"
+				" SINGLE-VALUE"
+				" NO-USER-MODIFICATION"
+				" USAGE directoryOperation )",
+		.ad		= &ad_pwdShadowMin
+	},
+	{	// pwdShadowMax: The maximum number of days before a password expires.
+		// This attribute is the equivalent of 'shadowMax', but is derived
+		// from the value of 'pwdMaxAge' in current password policy
+		// (pwdMaxAge / 60 / 60 /24).
+		.def	= "( 1.3.6.1.4.1.27893.4.2.1.7"
+				" NAME ( 'pwdShadowMax' )"
+				" DESC 'shadowMax equivalent derived from pwdMaxAge'"
+				" EQUALITY integerMatch"
+				" SYNTAX 1.3.6.1.4.1.1466.115.121.1.27"
+				" SINGLE-VALUE"
+				" NO-USER-MODIFICATION"
+				" USAGE directoryOperation )",
+		.ad		= &ad_pwdShadowMax
+	},
+	{	// pwdShadowWarning: The number of days before a password expires
+		// during which a user should be warned.  This attribute is the
+		// equivalent of 'shadowWarning', but is derived from the value of
+		// 'pwdExpireWarning' in current password policy (pwdExpireWarning /
+		// 60 / 60 /24).
+		.def	= "( 1.3.6.1.4.1.27893.4.2.1.8"
+				" NAME ( 'pwdShadowWarning' )"
+				" DESC 'shadowWarning equivalent derived from pwdExpireWarning'"
+				" EQUALITY integerMatch"
+				" SYNTAX 1.3.6.1.4.1.1466.115.121.1.27"
+				" SINGLE-VALUE"
+				" NO-USER-MODIFICATION"
+				" USAGE directoryOperation )",
+		.ad		= &ad_pwdShadowWarning
+	},
+	{	// pwdShadowInactive: The number of days after a password expires
+		// during which the password should still be accepted.  This attribute
+		// is the equivalent of 'shadowInactive', but is derived from the
+		// value of 'pwdGraceExpiry' in current password policy
+		// (pwdGraceExpiry / 60 / 60 /24).
+		.def	= "( 1.3.6.1.4.1.27893.4.2.1.9"
+				" NAME ( 'pwdShadowInactive' )"
+				" DESC 'shadowInactive equivalent derived from pwdGraceExpiry'"
+				" EQUALITY integerMatch"
+				" SYNTAX 1.3.6.1.4.1.1466.115.121.1.27"
+				" SINGLE-VALUE"
+				" NO-USER-MODIFICATION"
+				" USAGE directoryOperation )",
+		.ad		= &ad_pwdShadowInactive
+	},
+	{	// pwdShadowExpire: The number of days after January 1, 1970 on which
+		// the account expires. This attribute is the equivalent of
+		// 'shadowExpire', but is derived from the value of 'pwdEndTime' of
+		// the entry.
+		.def	= "( 1.3.6.1.4.1.27893.4.2.1.10"
+				" NAME ( 'pwdShadowExpire' )"
+				" DESC 'shadowExpire equivalent derived from pwdEndTime'"
+				" EQUALITY integerMatch"
+				" ORDERING integerOrderingMatch"
+				" SYNTAX 1.3.6.1.4.1.1466.115.121.1.27"
+				" SINGLE-VALUE"
+				" NO-USER-MODIFICATION"
+				" USAGE directoryOperation )",
+		.ad		= &ad_pwdShadowExpire
+	},
+	{	// pwdShadowFlag: This attribute is the equivalent of 'shadowFlag'.
+		// This attribute is not used by the overlay and is included so
+		// pwdShadowAccount is able to be used as a one for one replacement
+		// with shadowAccount.
+		.def	= "( 1.3.6.1.4.1.27893.4.2.1.11"
+				" NAME ( 'pwdShadowFlag' )"
+				" DESC 'duplicates shadowFlag'"
+				" EQUALITY integerMatch"
+				" SYNTAX 1.3.6.1.4.1.1466.115.121.1.27"
+				" SINGLE-VALUE"
+				" NO-USER-MODIFICATION"
+				" USAGE directoryOperation )",
+		.ad		= &ad_pwdShadowFlag
+	},
+	{	// pwdShadowRegenCursor: The highest entry ID processed by an
+		// interrupted bulk regeneration.  The attribute is maintained by the
+		// overlay on the database's suffix entry and is removed once the
+		// regeneration completes.
+		.def	= "( 1.3.6.1.4.1.27893.4.2.1.12"
+				" NAME ( 'pwdShadowRegenCursor' )"
+				" DESC 'resume position of an interrupted regeneration'"
+				" EQUALITY integerMatch"
+				" SYNTAX 1.3.6.1.4.1.1466.115.121.1.27"
+				" SINGLE-VALUE"
+				" NO-USER-MODIFICATION"
+				" USAGE dSAOperation )",
+		.ad		= &ad_pwdShadowRegenCursor
+	},
+	{	// pwdShadowGenerate: This attribute enables or disables the
+		// generation of shadow compatible attributes from the password policy
+		// attributes.
+		.def	= "( 1.3.6.1.4.1.27893.4.2.2.1"
+				" NAME ( 'pwdShadowGenerate' )"
+				" DESC 'generate shadowAccount equivalent attributes'"
+				" EQUALITY booleanMatch"
+				" SYNTAX 1.3.6.1.4.1.1466.115.121.1.7"
+				" SINGLE-VALUE "
+				" USAGE directoryOperation )",
+		.ad		= &ad_pwdShadowGenerate
+	},
+	{	// pwdShadowAutoExpire: This attribute, when added to the subentry
+		// specified by pwdPolicySubentry, enables the generation of
+		// 'pwdShadowExpire' from 'pwdShadowLastChange', 'pwdShadowMax', and
+		// 'pwdGraceExpiry' if neither 'shadowExpire' or 'pwdEndTime' are set
+		// on the user's entry.
+		.def	= "( 1.3.6.1.4.1.27893.4.2.2.2"
+				" NAME ( 'pwdShadowAutoExpire' )"
+				" DESC 'generate pwdShadowExpire from pwdShadow attributes'"
+				" EQUALITY booleanMatch"
+				" SYNTAX 1.3.6.1.4.1.1466.115.121.1.7"
+				" SINGLE-VALUE )",
+		.ad		= &ad_pwdShadowAutoExpire
+	},
+	{	// pwdShadowPolicySubentry: This attribute specifies the
+		// pwdShadowPolicy subentry in effect for this object.  The attribute
+		// used to specify the pwdShadowPolicy subentry in affect may be
+		// changed using either olcPwdShadowPolicyAttr attribute in the config
+		// backend or by the pwdshadow_policy_attr option in slapd.conf.
+		.def	= "( 1.3.6.1.4.1.27893.4.2.2.3"
+				" NAME ( 'pwdShadowPolicySubentry' )"
+				" DESC 'The pwdShadowPolicy subentry in effect for this object'"
+				" EQUALITY distinguishedNameMatch"
+				" SYNTAX 1.3.6.1.4.1.1466.115.121.1.12"
+				" SINGLE-VALUE "
+				" USAGE directoryOperation )",
+		.ad		= &ad_pwdShadowPolicySubentry
+	},
+	{
+		.def	= NULL,
+		.ad		= NULL
+	}
+};
+
+
+// overlay's LDAP user object classes
+static pwdshadow_oc_t pwdshadow_ocs[] =
+{
+	{	.def	= "( 1.3.6.1.4.1.27893.4.2.3.1"
+				" NAME 'pwdShadowPolicy'"
+				" DESC 'Attributes for controlling pwdShadow overlay'"
+				" SUP top"
+				" AUXILIARY"
+				" MAY ( pwdShadowAutoExpire ) )",
+		.oc		= &oc_pwdShadowPolicy
+    },
+	{	.def	= NULL,
+		.oc		= NULL
+	}
+};
+
+
+#ifdef SLAPD_MONITOR
+// overlay's monitor attribute types
+static pwdshadow_at_t pwdshadow_monitor_ats[] =
+{
+	{	.def	= "( 1.3.6.1.4.1.27893.4.2.7.1"
+				" NAME ( 'pwdShadowMonAdds' )"
+				" DESC 'Number of add operations processed'"
+				" EQUALITY integerMatch"
+				" ORDERING integerOrderingMatch"
+				" SYNTAX 1.3.6.1.4.1.1466.115.121.1.27"
+				" SINGLE-VALUE"
+				" NO-USER-MODIFICATION"
+				" USAGE dSAOperation )",
+		.ad		= &ad_pwdShadowMonAdds
+	},
+	{	.def	= "( 1.3.6.1.4.1.27893.4.2.7.2"
+				" NAME ( 'pwdShadowMonModifies' )"
+				" DESC 'Number of modify operations processed'"
+				" EQUALITY integerMatch"
+				" ORDERING integerOrderingMatch"
+				" SYNTAX 1.3.6.1.4.1.1466.115.121.1.27"
+				" SINGLE-VALUE"
+				" NO-USER-MODIFICATION"
+				" USAGE dSAOperation )",
+		.ad		= &ad_pwdShadowMonModifies
+	},
+	{	.def	= "( 1.3.6.1.4.1.27893.4.2.7.3"
+				" NAME ( 'pwdShadowMonModifiesSkipped' )"
+				" DESC 'Number of modify operations without tracked attributes'"
+				" EQUALITY integerMatch"
+				" ORDERING integerOrderingMatch"
+				" SYNTAX 1.3.6.1.4.1.1466.115.121.1.27"
+				" SINGLE-VALUE"
+				" NO-USER-MODIFICATION"
+				" USAGE dSAOperation )",
+		.ad		= &ad_pwdShadowMonModifiesSkipped
+	},
+	{	.def	= "( 1.3.6.1.4.1.27893.4.2.7.4"
+				" NAME ( 'pwdShadowMonEntryFetches' )"
+				" DESC 'Number of entries retrieved from the database'"
+				" EQUALITY integerMatch"
+				" ORDERING integerOrderingMatch"
+				" SYNTAX 1.3.6.1.4.1.1466.115.121.1.27"
+				" SINGLE-VALUE"
+				" NO-USER-MODIFICATION"
+				" USAGE dSAOperation )",
+		.ad		= &ad_pwdShadowMonEntryFetches
+	},
+	{	.def	= "( 1.3.6.1.4.1.27893.4.2.7.5"
+				" NAME ( 'pwdShadowMonPolicyLookups' )"
+				" DESC 'Number of password policy lookups'"
+				" EQUALITY integerMatch"
+				" ORDERING integerOrderingMatch"
+				" SYNTAX 1.3.6.1.4.1.1466.115.121.1.27"
+				" SINGLE-VALUE"
+				" NO-USER-MODIFICATION"
+				" USAGE dSAOperation )",
+		.ad		= &ad_pwdShadowMonPolicyLookups
+	},
+	{	.def	= "( 1.3.6.1.4.1.27893.4.2.7.6"
+				" NAME ( 'pwdShadowMonPolicyFailures' )"
+				" DESC 'Number of evaluations without a password policy'"
+				" EQUALITY integerMatch"
+				" ORDERING integerOrderingMatch"
+				" SYNTAX 1.3.6.1.4.1.1466.115.121.1.27"
+				" SINGLE-VALUE"
+				" NO-USER-MODIFICATION"
+				" USAGE dSAOperation )",
+		.ad		= &ad_pwdShadowMonPolicyFailures
+	},
+	{	.def	= "( 1.3.6.1.4.1.27893.4.2.7.7"
+				" NAME ( 'pwdShadowMonGeneratedAdd' )"
+				" DESC 'Generated values added per attribute'"
+				" EQUALITY caseIgnoreMatch"
+				" SYNTAX 1.3.6.1.4.1.1466.115.121.1.15"
+				" NO-USER-MODIFICATION"
+				" USAGE dSAOperation )",
+		.ad		= &ad_pwdShadowMonGeneratedAdd
+	},
+	{	.def	= "( 1.3.6.1.4.1.27893.4.2.7.8"
+				" NAME ( 'pwdShadowMonGeneratedReplace' )"
+				" DESC 'Generated values replaced per attribute'"
+				" EQUALITY caseIgnoreMatch"
+				" SYNTAX 1.3.6.1.4.1.1466.115.121.1.15"
+				" NO-USER-MODIFICATION"
+				" USAGE dSAOperation )",
+		.ad		= &ad_pwdShadowMonGeneratedReplace
+	},
+	{	.def	= "( 1.3.6.1.4.1.27893.4.2.7.9"
+				" NAME ( 'pwdShadowMonGeneratedDelete' )"
+				" DESC 'Generated values deleted per attribute'"
+				" EQUALITY caseIgnoreMatch"
+				" SYNTAX 1.3.6.1.4.1.1466.115.121.1.15"
+				" NO-USER-MODIFICATION"
+				" USAGE dSAOperation )",
+		.ad		= &ad_pwdShadowMonGeneratedDelete
+	},
+	{	.def	= "( 1.3.6.1.4.1.27893.4.2.7.10"
+				" NAME ( 'pwdShadowMonFetchLatency' )"
+				" DESC 'Histogram of entry retrieval latency'"
+				" EQUALITY caseIgnoreMatch"
+				" SYNTAX 1.3.6.1.4.1.1466.115.121.1.15"
+				" NO-USER-MODIFICATION"
+				" USAGE dSAOperation )",
+		.ad		= &ad_pwdShadowMonFetchLatency
+	},
+	{	.def	= "( 1.3.6.1.4.1.27893.4.2.7.11"
+				" NAME ( 'pwdShadowMonPolicyLatency' )"
+				" DESC 'Histogram of password policy lookup latency'"
+				" EQUALITY caseIgnoreMatch"
+				" SYNTAX 1.3.6.1.4.1.1466.115.121.1.15"
+				" NO-USER-MODIFICATION"
+				" USAGE dSAOperation )",
+		.ad		= &ad_pwdShadowMonPolicyLatency
+	},
+	{	.def	= "( 1.3.6.1.4.1.27893.4.2.7.12"
+				" NAME ( 'pwdShadowMonEvalLatency' )"
+				" DESC 'Histogram of evaluation latency'"
+				" EQUALITY caseIgnoreMatch"
+				" SYNTAX 1.3.6.1.4.1.1466.115.121.1.15"
+				" NO-USER-MODIFICATION"
+				" USAGE dSAOperation )",
+		.ad		= &ad_pwdShadowMonEvalLatency
+	},
+	{	.def	= "( 1.3.6.1.4.1.27893.4.2.7.13"
+				" NAME ( 'pwdShadowMonModsLatency' )"
+				" DESC 'Histogram of modification generation latency'"
+				" EQUALITY caseIgnoreMatch"
+				" SYNTAX 1.3.6.1.4.1.1466.115.121.1.15"
+				" NO-USER-MODIFICATION"
+				" USAGE dSAOperation )",
+		.ad		= &ad_pwdShadowMonModsLatency
+	},
+	{	.def	= "( 1.3.6.1.4.1.27893.4.2.7.14"
+				" NAME ( 'pwdShadowMonRegenState' )"
+				" DESC 'State of regeneration'"
+				" EQUALITY caseIgnoreMatch"
+				" SYNTAX 1.3.6.1.4.1.1466.115.121.1.15"
+				" SINGLE-VALUE"
+				" NO-USER-MODIFICATION"
+				" USAGE dSAOperation )",
+		.ad		= &ad_pwdShadowMonRegenState
+	},
+	{	.def	= "( 1.3.6.1.4.1.27893.4.2.7.15"
+				" NAME ( 'pwdShadowMonRegenProcessed' )"
+				" DESC 'Number of entries processed by regeneration'"
+				" EQUALITY integerMatch"
+				" ORDERING integerOrderingMatch"
+				" SYNTAX 1.3.6.1.4.1.1466.115.121.1.27"
+				" SINGLE-VALUE"
+				" NO-USER-MODIFICATION"
+				" USAGE dSAOperation )",
+		.ad		= &ad_pwdShadowMonRegenProcessed
+	},
+	{	.def	= "( 1.3.6.1.4.1.27893.4.2.7.16"
+				" NAME ( 'pwdShadowMonRegenModified' )"
+				" DESC 'Number of entries modified by regeneration'"
+				" EQUALITY integerMatch"
+				" ORDERING integerOrderingMatch"
+				" SYNTAX 1.3.6.1.4.1.1466.115.121.1.27"
+				" SINGLE-VALUE"
+				" NO-USER-MODIFICATION"
+				" USAGE dSAOperation )",
+		.ad		= &ad_pwdShadowMonRegenModified
+	},
+	{	.def	= "( 1.3.6.1.4.1.27893.4.2.7.17"
+				" NAME ( 'pwdShadowMonReplicated' )"
+				" DESC 'Number of replicated operations accepted without evaluation'"
+				" EQUALITY integerMatch"
+				" ORDERING integerOrderingMatch"
+				" SYNTAX 1.3.6.1.4.1.1466.115.121.1.27"
+				" SINGLE-VALUE"
+				" NO-USER-MODIFICATION"
+				" USAGE dSAOperation )",
+		.ad		= &ad_pwdShadowMonReplicated
+	},
+	{	.def	= "( 1.3.6.1.4.1.27893.4.2.7.18"
+				" NAME ( 'pwdShadowMonTupleHits' )"
+				" DESC 'Number of searches answered from cached entries'"
+				" EQUALITY integerMatch"
+				" ORDERING integerOrderingMatch"
+				" SYNTAX 1.3.6.1.4.1.1466.115.121.1.27"
+				" SINGLE-VALUE"
+				" NO-USER-MODIFICATION"
+				" USAGE dSAOperation )",
+		.ad		= &ad_pwdShadowMonTupleHits
+	},
+	{	.def	= "( 1.3.6.1.4.1.27893.4.2.7.19"
+				" NAME ( 'pwdShadowMonTupleMisses' )"
+				" DESC 'Number of searches by key not answered from cached entries'"
+				" EQUALITY integerMatch"
+				" ORDERING integerOrderingMatch"
+				" SYNTAX 1.3.6.1.4.1.1466.115.121.1.27"
+				" SINGLE-VALUE"
+				" NO-USER-MODIFICATION"
+				" USAGE dSAOperation )",
+		.ad		= &ad_pwdShadowMonTupleMisses
+	},
+	{	.def	= "( 1.3.6.1.4.1.27893.4.2.7.20"
+				" NAME ( 'pwdShadowMonTupleEntries' )"
+				" DESC 'Number of cached entries'"
+				" EQUALITY integerMatch"
+				" ORDERING integerOrderingMatch"
+				" SYNTAX 1.3.6.1.4.1.1466.115.121.1.27"
+				" SINGLE-VALUE"
+				" NO-USER-MODIFICATION"
+				" USAGE dSAOperation )",
+		.ad		= &ad_pwdShadowMonTupleEntries
+	},
+	{	.def	= "( 1.3.6.1.4.1.27893.4.2.7.21"
+				" NAME ( 'pwdShadowMonTupleBytes' )"
+				" DESC 'Bytes of memory allocated for cached entries'"
+				" EQUALITY integerMatch"
+				" ORDERING integerOrderingMatch"
+				" SYNTAX 1.3.6.1.4.1.1466.115.121.1.27"
+				" SINGLE-VALUE"
+				" NO-USER-MODIFICATION"
+				" USAGE dSAOperation )",
+		.ad		= &ad_pwdShadowMonTupleBytes
+	},
+	{	.def	= "( 1.3.6.1.4.1.27893.4.2.7.22"
+				" NAME ( 'pwdShadowMonExpiryEntries' )"
+				" DESC 'Number of entries in the expiry index'"
+				" EQUALITY integerMatch"
+				" ORDERING integerOrderingMatch"
+				" SYNTAX 1.3.6.1.4.1.1466.115.121.1.27"
+				" SINGLE-VALUE"
+				" NO-USER-MODIFICATION"
+				" USAGE dSAOperation )",
+		.ad		= &ad_pwdShadowMonExpiryEntries
+	},
+	{	.def	= "( 1.3.6.1.4.1.27893.4.2.7.23"
+				" NAME ( 'pwdShadowMonExpiryBytes' )"
+				" DESC 'Bytes of memory allocated for the expiry index'"
+				" EQUALITY integerMatch"
+				" ORDERING integerOrderingMatch"
+				" SYNTAX 1.3.6.1.4.1.1466.115.121.1.27"
+				" SINGLE-VALUE"
+				" NO-USER-MODIFICATION"
+				" USAGE dSAOperation )",
+		.ad		= &ad_pwdShadowMonExpiryBytes
+	},
+	{
+		.def	= NULL,
+		.ad		= NULL
+	}
+};
+
+
+// overlay's monitor object classes
+static pwdshadow_oc_t pwdshadow_monitor_ocs[] =
+{
+	{	.def	= "( 1.3.6.1.4.1.27893.4.2.8.1"
+				" NAME 'pwdShadowMonitor'"
+				" DESC 'Statistics of pwdShadow overlay'"
+				" SUP top"
+				" AUXILIARY"
+				" MAY ( pwdShadowMonAdds $ pwdShadowMonModifies $"
+				" pwdShadowMonModifiesSkipped $ pwdShadowMonEntryFetches $"
+				" pwdShadowMonPolicyLookups $ pwdShadowMonPolicyFailures $"
+				" pwdShadowMonGeneratedAdd $ pwdShadowMonGeneratedReplace $"
+				" pwdShadowMonGeneratedDelete $ pwdShadowMonFetchLatency $"
+				" pwdShadowMonPolicyLatency $ pwdShadowMonEvalLatency $"
+				" pwdShadowMonModsLatency $ pwdShadowMonRegenState $"
+				" pwdShadowMonRegenProcessed $ pwdShadowMonRegenModified $"
+				" pwdShadowMonReplicated $ pwdShadowMonTupleHits $"
+				" pwdShadowMonTupleMisses $ pwdShadowMonTupleEntries $"
+				" pwdShadowMonTupleBytes $ pwdShadowMonExpiryEntries $"
+				" pwdShadowMonExpiryBytes ) )",
+		.oc		= &oc_pwdShadowMonitor
+	},
+	{	.def	= NULL,
+		.oc		= NULL
+	}
+};
+#endif
+
+
+// overlay's configuration attribute types
+static ConfigTable pwdshadow_cfg_ats[] =
+{
+	{	.name		= "pwdshadow_default",
+		.what		= "policyDN",
+		.min_args	= 2,
+		.max_args	= 2,
+		.length		= 0,
+		.arg_type	= ARG_DN|ARG_QUOTE|ARG_MAGIC|PWDSHADOW_CFG_DEF_POLICY,
+		.arg_item	= pwdshadow_cfg_gen,
+		.attribute	= "( 1.3.6.1.4.1.27893.4.2.4.1"
+					" NAME 'olcPwdShadowDefault'"
+					" DESC 'DN of a pwdPolicy object for uncustomized objects'"
+					" EQUALITY distinguishedNameMatch"
+					" SYNTAX OMsDN"
+					" SINGLE-VALUE )"
+	},
+	{	.name		= "pwdshadow_overrides",
+		.what		= "on|off",
+		.min_args	= 2,
+		.max_args	= 2,
+		.length		= 0,
+		.arg_type	= ARG_ON_OFF|ARG_MAGIC|PWDSHADOW_CFG_OVERRIDES,
+		.arg_item	= pwdshadow_cfg_gen,
+		.attribute	= "( 1.3.6.1.4.1.27893.4.2.4.2"
+					" NAME 'olcPwdShadowOverrides'"
+					" DESC 'Allow shadow attributes to override the values of generated attribtues.'"
+					" EQUALITY booleanMatch"
+					" SYNTAX OMsBoolean"
+					" SINGLE-VALUE )"
+	},
+	{	.name		= "pwdshadow_use_policies",
+		.what		= "on|off",
+		.min_args	= 2,
+		.max_args	= 2,
+		.length		= 0,
+		.arg_type	= ARG_ON_OFF|ARG_MAGIC|PWDSHADOW_CFG_USE_POLICIES,
+		.arg_item	= pwdshadow_cfg_gen,
+		.attribute	= "( 1.3.6.1.4.1.27893.4.2.4.3"
+					" NAME 'olcPwdShadowUsePolicies'"
+					" DESC 'Use pwdPolicy to determine values of generated attributes'"
+					" EQUALITY booleanMatch"
+					" SYNTAX OMsBoolean"
+					" SINGLE-VALUE )"
+	},
+	{	.name		= "pwdshadow_policy_ad",
+		.what		= "pwdShadowPolicySubentry attribute",
+		.min_args	= 2,
+		.max_args	= 2,
+		.length		= 0,
+		.arg_type	= ARG_MAGIC|ARG_ATDESC|PWDSHADOW_CFG_POLICY_AD,
+		.arg_item	= pwdshadow_cfg_gen,
+		.attribute	= "( 1.3.6.1.4.1.27893.4.2.4.4"
+					" NAME 'olcPwdShadowPolicyAD'"
+					" DESC 'Use pwdPolicy to determine values of generated attributes'"
+					" EQUALITY caseIgnoreMatch"
+					" SYNTAX OMsDirectoryString"
+					" SINGLE-VALUE )"
+	},
+	{	.name		= "pwdshadow_subtree_policy",
+		.what		= "suffixDN policyDN",
+		.min_args	= 3,
+		.max_args	= 3,
+		.length		= 0,
+		.arg_type	= ARG_MAGIC|PWDSHADOW_CFG_SUBTREE,
+		.arg_item	= pwdshadow_cfg_gen,
+		.attribute	= "( 1.3.6.1.4.1.27893.4.2.4.9"
+					" NAME 'olcPwdShadowSubtreePolicy'"
+					" DESC 'DN of a pwdPolicy object for entries within a subtree'"
+					" EQUALITY caseIgnoreMatch"
+					" SYNTAX OMsDirectoryString"
+					" X-ORDERED 'VALUES' )"
+	},
+	{	.name		= "pwdshadow_trust_replication",
+		.what		= "on|off",
+		.min_args	= 2,
+		.max_args	= 2,
+		.length		= 0,
+		.arg_type	= ARG_ON_OFF|ARG_MAGIC|PWDSHADOW_CFG_TRUST_REPL,
+		.arg_item	= pwdshadow_cfg_gen,
+		.attribute	= "( 1.3.6.1.4.1.27893.4.2.4.10"
+					" NAME 'olcPwdShadowTrustReplication'"
+					" DESC 'Accept generated attributes of replicated operations without evaluation'"
+					" EQUALITY booleanMatch"
+					" SYNTAX OMsBoolean"
+					" SINGLE-VALUE )"
+	},
+	{	.name		= "pwdshadow_alias",
+		.what		= "on|off",
+		.min_args	= 2,
+		.max_args	= 2,
+		.length		= 0,
+		.arg_type	= ARG_ON_OFF|ARG_MAGIC|PWDSHADOW_CFG_ALIAS,
+		.arg_item	= pwdshadow_cfg_gen,
+		.attribute	= "( 1.3.6.1.4.1.27893.4.2.4.11"
+					" NAME 'olcPwdShadowAlias'"
+					" DESC 'Return generated attributes as the requested shadow attributes'"
+					" EQUALITY booleanMatch"
+					" SYNTAX OMsBoolean"
+					" SINGLE-VALUE )"
+	},
+	{	.name		= "pwdshadow_tuple_cache",
+		.what		= "attribute entries",
+		.min_args	= 3,
+		.max_args	= 3,
+		.length		= 0,
+		.arg_type	= ARG_MAGIC|PWDSHADOW_CFG_TUPLE_CACHE,
+		.arg_item	= pwdshadow_cfg_gen,
+		.attribute	= "( 1.3.6.1.4.1.27893.4.2.4.12"
+					" NAME 'olcPwdShadowTupleCache'"
+					" DESC 'Key attribute and maximum number of entries cached to answer searches by key'"
+					" EQUALITY caseIgnoreMatch"
+					" SYNTAX OMsDirectoryString"
+					" SINGLE-VALUE )"
+	},
+	{	.name		= "pwdshadow_expiry_index",
+		.what		= "on|off",
+		.min_args	= 2,
+		.max_args	= 2,
+		.length		= 0,
+		.arg_type	= ARG_ON_OFF|ARG_MAGIC|PWDSHADOW_CFG_EXPIRY,
+		.arg_item	= pwdshadow_cfg_gen,
+		.attribute	= "( 1.3.6.1.4.1.27893.4.2.4.13"
+					" NAME 'olcPwdShadowExpiryIndex'"
+					" DESC 'Index entries by day of expiry to list expiring entries'"
+					" EQUALITY booleanMatch"
+					" SYNTAX OMsBoolean"
+					" SINGLE-VALUE )"
+	},
+	{	.name		= "pwdshadow_cache_ttl",
+		.what		= "seconds",
+		.min_args	= 2,
+		.max_args	= 2,
+		.length		= 0,
+		.arg_type	= ARG_INT|ARG_MAGIC|PWDSHADOW_CFG_CACHE_TTL,
+		.arg_item	= pwdshadow_cfg_gen,
+		.attribute	= "( 1.3.6.1.4.1.27893.4.2.4.5"
+					" NAME 'olcPwdShadowCacheTTL'"
+					" DESC 'Number of seconds a parsed password policy is cached'"
+					" EQUALITY integerMatch"
+					" SYNTAX OMsInteger"
+					" SINGLE-VALUE )"
+	},
+	{	.name		= "pwdshadow_mode",
+		.what		= "stored|virtual",
+		.min_args	= 2,
+		.max_args	= 2,
+		.length		= 0,
+		.arg_type	= ARG_STRING|ARG_MAGIC|PWDSHADOW_CFG_MODE,
+		.arg_item	= pwdshadow_cfg_gen,
+		.attribute	= "( 1.3.6.1.4.1.27893.4.2.4.8"
+					" NAME 'olcPwdShadowMode'"
+					" DESC 'Store generated attributes or generate them when read'"
+					" EQUALITY caseIgnoreMatch"
+					" SYNTAX OMsDirectoryString"
+					" SINGLE-VALUE )"
+	},
+	{	.name		= "pwdshadow_regen_rate",
+		.what		= "entries",
+		.min_args	= 2,
+		.max_args	= 2,
+		.length		= 0,
+		.arg_type	= ARG_INT|ARG_OFFSET,
+		.arg_item	= (void *)offsetof(pwdshadow_t,ps_regen_rate),
+		.attribute	= "( 1.3.6.1.4.1.27893.4.2.4.6"
+					" NAME 'olcPwdShadowRegenRate'"
+					" DESC 'Maximum number of entries per second processed by regeneration'"
+					" EQUALITY integerMatch"
+					" SYNTAX OMsInteger"
+					" SINGLE-VALUE )"
+	},
+	{	.name		= "pwdshadow_regen_workers",
+		.what		= "threads",
+		.min_args	= 2,
+		.max_args	= 2,
+		.length		= 0,
+		.arg_type	= ARG_INT|ARG_OFFSET,
+		.arg_item	= (void *)offsetof(pwdshadow_t,ps_regen_workers),
+		.attribute	= "( 1.3.6.1.4.1.27893.4.2.4.7"
+					" NAME 'olcPwdShadowRegenWorkers'"
+					" DESC 'Number of batches regenerated concurrently'"
+					" EQUALITY integerMatch"
+					" SYNTAX OMsInteger"
+					" SINGLE-VALUE )"
+	},
+	{	.name		= NULL,
+		.what		= NULL,
+		.min_args	= 0,
+		.max_args	= 0,
+		.length	= 0,
+		.arg_type	= ARG_IGNORED,
+		.arg_item	= NULL,
+		.attribute	= NULL
+	}
+};
+
+
+// overlay's configuration object classes
+static ConfigOCs pwdshadow_cfg_ocs[] =
+{
+	{	.co_def		= "( 1.3.6.1.4.1.27893.4.2.5.1"
+					" NAME 'olcPwdShadowConfig'"
+					" DESC 'Password Shadow configuration'"
+					" SUP olcOverlayConfig"
+					" MAY ( olcPwdShadowDefault $"
+						" olcPwdShadowUsePolicies $"
+						" olcPwdShadowOverrides $"
+						" olcPwdShadowCacheTTL $"
+						" olcPwdShadowMode $"
+						" olcPwdShadowSubtreePolicy $"
+						" olcPwdShadowTrustReplication $"
+						" olcPwdShadowAlias $"
+						" olcPwdShadowTupleCache $"
+						" olcPwdShadowExpiryIndex $"
+						" olcPwdShadowRegenRate $"
+						" olcPwdShadowRegenWorkers ) )",
+		.co_type	= Cft_Overlay,
+		.co_table	= pwdshadow_cfg_ats
+	},
+	{	.co_def		= NULL,
+		.co_type	= 0,
+		.co_table	= NULL
+	}
+};
+
+
+/////////////////
+//             //
+//  Functions  //
+//             //
+/////////////////
+#ifndef SLAPD_OVER_HELLOWORLD
+#	pragma mark - Functions
+#endif
+
+#if SLAPD_OVER_PWDSHADOW == SLAPD_MOD_DYNAMIC
+int
+init_module(
+		int							argc,
+		char *						argv[] )
+{
+	if ((argc))
+		return( pwdshadow_initialize() );
+	if ((argv))
+		return( pwdshadow_initialize() );
+	return( pwdshadow_initialize() );
+}
+#endif
+
+
+// frees a callback allocated from the operation's memory whose private data
+// is not owned by the callback
+int
+pwdshadow_callback_cleanup(
+		Operation *					op,
+		SlapReply *					rs )
+{
+	slap_callback *		sc;
+
+	sc				= op->o_callback;
+	op->o_callback	= NULL;
+	op->o_tmpfree(sc, op->o_tmpmemctx);
+
+	if (!(rs))
+		return(0);
+
+	return(0);
+}
+
+
+void
+pwdshadow_cfg_free(
+		pwdshadow_cfg_t *			cf )
+{
+	if (!(cf))
+		return;
+	pwdshadow_subtree_free(cf->cf_subtree);
+	ber_bvarray_free(cf->cf_subtree_dns);
+	ber_bvarray_free(cf->cf_subtree_policies);
+	ber_memfree(cf->cf_def_policy.bv_val);
+	ch_free(cf);
+	return;
+}
+
+
+int
+pwdshadow_cfg_gen(
+		ConfigArgs *				c )
+{
+	slap_overinst *			on;
+	pwdshadow_t *			ps;
+	int						rc;
+	int						idx;
+	unsigned long			max;
+	const char *			text;
+	AttributeDescription *	ad;
+	struct berval			bv;
+	struct berval			ndn;
+	struct berval			policy;
+
+	on		= (slap_overinst *)c->bi;
+	ps		= (pwdshadow_t *)on->on_bi.bi_private;
+	rc		= ARG_BAD_CONF;
+
+	Debug(LDAP_DEBUG_TRACE, "==> pwdshadow_cfg_gen\n" );
+
+	switch ( c->op )
+	{
+		case SLAP_CONFIG_EMIT:
+		switch( c->type )
+		{
+			case PWDSHADOW_CFG_DEF_POLICY:
+			if ( ps->ps_def_policy.bv_val != NULL)
+			{
+				if ((rc = value_add_one( &c->rvalue_vals, &ps->ps_def_policy )) != 0)
+					return(rc);
+				return( value_add_one( &c->rvalue_nvals, &ps->ps_def_policy ) );
+			};
+			return(0);
+
+			case PWDSHADOW_CFG_POLICY_AD:
+			c->value_ad = ps->ps_policy_ad;
+			return(0);
+
+			case PWDSHADOW_CFG_OVERRIDES:
+			c->value_int = ps->ps_overrides;
+			return(0);
+
+			case PWDSHADOW_CFG_MODE:
+			c->value_string = ch_strdup( (ps->ps_mode == PWDSHADOW_MODE_VIRTUAL) ? "virtual" : "stored" );
+			return(0);
+
+			case PWDSHADOW_CFG_USE_POLICIES:
+			c->value_int = ps->ps_use_policies;
+			return(0);
+
+			case PWDSHADOW_CFG_TRUST_REPL:
+			c->value_int = ps->ps_trust_replication;
+			return(0);
+
+			case PWDSHADOW_CFG_CACHE_TTL:
+			c->value_int = ps->ps_cache_ttl;
+			return(0);
+
+			case PWDSHADOW_CFG_ALIAS:
+			c->value_int = ps->ps_alias;
+			return(0);
+
+			case PWDSHADOW_CFG_EXPIRY:
+			c->value_int = ps->ps_expiry;
+			return(0);
+
+			case PWDSHADOW_CFG_TUPLE_CACHE:
+			if (!(ps->ps_tuple_ad))
+				return(0);
+			bv.bv_len = ps->ps_tuple_ad->ad_cname.bv_len + PWDSHADOW_INT_LEN + 1;
+			bv.bv_val = ch_malloc(bv.bv_len + 1);
+			bv.bv_len = snprintf(bv.bv_val, bv.bv_len + 1, "%s %lu", ps->ps_tuple_ad->ad_cname.bv_val, ps->ps_tuple_max);
+			ber_bvarray_add(&c->rvalue_vals, &bv);
+			return(0);
+
+			case PWDSHADOW_CFG_SUBTREE:
+			for(idx = 0; ( ((ps->ps_subtree_dns)) && ((ps->ps_subtree_dns[idx].bv_val)) ); idx++)
+			{
+				// DN and policy are quoted and escaped for the tokenizer
+				bv.bv_len = ((ps->ps_subtree_dns[idx].bv_len + ps->ps_subtree_policies[idx].bv_len) * 2) + 5;
+				bv.bv_val = ch_malloc(bv.bv_len + 1);
+				bv.bv_len = pwdshadow_cfg_quote(&ps->ps_subtree_dns[idx], bv.bv_val);
+				bv.bv_val[bv.bv_len++] = ' ';
+				bv.bv_len += pwdshadow_cfg_quote(&ps->ps_subtree_policies[idx], &bv.bv_val[bv.bv_len]);
+				ber_bvarray_add(&c->rvalue_vals, &bv);
+			};
+			return(0);
+
+			default:
+			Debug(LDAP_DEBUG_ANY, "pwdshadow_cfg_gen: unknown configuration option\n" );
+			return( ARG_BAD_CONF );
+		};
+		break;
+
+		case LDAP_MOD_DELETE:
+		switch( c->type )
+		{
+			case PWDSHADOW_CFG_DEF_POLICY:
+			Debug(LDAP_DEBUG_TRACE, "==> pwdshadow_cfg_gen delete\n" );
+			if ( ps->ps_def_policy.bv_val )
+			{
+				ber_memfree ( ps->ps_def_policy.bv_val );
+				ps->ps_def_policy.bv_val = NULL;
+			};
+			ps->ps_def_policy.bv_len = 0;
+			return(pwdshadow_cfg_publish(ps));
+
+			case PWDSHADOW_CFG_POLICY_AD:
+			ps->ps_policy_ad = ad_pwdShadowPolicySubentry;
+			return(pwdshadow_cfg_publish(ps));
+
+			case PWDSHADOW_CFG_OVERRIDES:
+			ps->ps_overrides = 1;
+			return(pwdshadow_cfg_publish(ps));
+
+			case PWDSHADOW_CFG_MODE:
+			ps->ps_mode = PWDSHADOW_MODE_STORED;
+			pwdshadow_expiry_config(ps);
+			return(pwdshadow_cfg_publish(ps));
+
+			case PWDSHADOW_CFG_USE_POLICIES:
+			ps->ps_use_policies = 1;
+			return(pwdshadow_cfg_publish(ps));
+
+			case PWDSHADOW_CFG_TRUST_REPL:
+			ps->ps_trust_replication = 1;
+			return(pwdshadow_cfg_publish(ps));
+
+			case PWDSHADOW_CFG_CACHE_TTL:
+			ps->ps_cache_ttl = PWDSHADOW_CACHE_TTL;
+			return(pwdshadow_cfg_publish(ps));
+
+			case PWDSHADOW_CFG_ALIAS:
+			ps->ps_alias = 0;
+			return(pwdshadow_cfg_publish(ps));
+
+			case PWDSHADOW_CFG_EXPIRY:
+			ps->ps_expiry = 0;
+			pwdshadow_expiry_config(ps);
+			return(pwdshadow_cfg_publish(ps));
+
+			case PWDSHADOW_CFG_TUPLE_CACHE:
+			pwdshadow_tuple_reset(ps, NULL, 0);
+			return(pwdshadow_cfg_publish(ps));
+
+			case PWDSHADOW_CFG_SUBTREE:
+			if (c->valx < 0)
+			{
+				ber_bvarray_free(ps->ps_subtree_dns);
+				ber_bvarray_free(ps->ps_subtree_policies);
+				ps->ps_subtree_dns		= NULL;
+				ps->ps_subtree_policies	= NULL;
+				return(pwdshadow_cfg_publish(ps));
+			};
+			for(idx = 0; ( ((ps->ps_subtree_dns)) && ((ps->ps_subtree_dns[idx].bv_val)) ); idx++);
+			if (c->valx >= idx)
+				return(ARG_BAD_CONF);
+			ber_memfree(ps->ps_subtree_dns[c->valx].bv_val);
+			ber_memfree(ps->ps_subtree_policies[c->valx].bv_val);
+			memmove(&ps->ps_subtree_dns[c->valx], &ps->ps_subtree_dns[c->valx+1], sizeof(struct berval) * (idx - c->valx));
+			memmove(&ps->ps_subtree_policies[c->valx], &ps->ps_subtree_policies[c->valx+1], sizeof(struct berval) * (idx - c->valx));
+			if (idx == 1)
+			{
+				ber_bvarray_free(ps->ps_subtree_dns);
+				ber_bvarray_free(ps->ps_subtree_policies);
+				ps->ps_subtree_dns		= NULL;
+				ps->ps_subtree_policies	= NULL;
+			};
+			return(pwdshadow_cfg_publish(ps));
+
+			default:
+			Debug(LDAP_DEBUG_ANY, "pwdshadow_cfg_gen: unknown configuration option\n" );
+			return( ARG_BAD_CONF );
+		};
+		break;
+
+		case SLAP_CONFIG_ADD:
+		// fallthru to LDAP_MOD_ADD
+
+		case LDAP_MOD_ADD:
+		switch( c->type )
+		{
+			case PWDSHADOW_CFG_DEF_POLICY:
+			Debug(LDAP_DEBUG_TRACE, "==> pwdshadow_cfg_gen add\n" );
+			if (( ps->ps_def_policy.bv_val ))
+			{
+				ber_memfree ( ps->ps_def_policy.bv_val );
+			};
+			ps->ps_def_policy = c->value_ndn;
+			ber_memfree( c->value_dn.bv_val );
+			BER_BVZERO( &c->value_dn );
+			BER_BVZERO( &c->value_ndn );
+			return(pwdshadow_cfg_publish(ps));
+
+			case PWDSHADOW_CFG_POLICY_AD:
+			ad = c->value_ad;
+			if (!(is_at_syntax(ad->ad_type, SLAPD_DN_SYNTAX)))
+			{
+				snprintf( c->cr_msg,
+							sizeof( c->cr_msg ),
+							"pwdshadow_policy_attr attribute=\"%s\" must have DN (%s) syntax",
+							c->argv[1],
+							SLAPD_DN_SYNTAX );
+				Debug(LDAP_DEBUG_CONFIG, "%s: %s.\n", c->log, c->cr_msg);
+				return(ARG_BAD_CONF);
+			};
+			ps->ps_policy_ad = ad;
+			return(pwdshadow_cfg_publish(ps));
+
+			case PWDSHADOW_CFG_OVERRIDES:
+			ps->ps_overrides = c->value_int;
+			return(pwdshadow_cfg_publish(ps));
+
+			case PWDSHADOW_CFG_MODE:
+			if (!(strcasecmp(c->value_string, "stored")))
+				rc = PWDSHADOW_MODE_STORED;
+			else if (!(strcasecmp(c->value_string, "virtual")))
+				rc = PWDSHADOW_MODE_VIRTUAL;
+			else
+				rc = -1;
+			ch_free(c->value_string);
+			c->value_string = NULL;
+			if (rc < 0)
+			{
+				snprintf( c->cr_msg, sizeof( c->cr_msg ), "pwdshadow_mode must be \"stored\" or \"virtual\"" );
+				Debug(LDAP_DEBUG_CONFIG, "%s: %s.\n", c->log, c->cr_msg);
+				return(ARG_BAD_CONF);
+			};
+			ps->ps_mode = rc;
+			pwdshadow_expiry_config(ps);
+			return(pwdshadow_cfg_publish(ps));
+
+			case PWDSHADOW_CFG_USE_POLICIES:
+			ps->ps_use_policies = c->value_int;
+			return(pwdshadow_cfg_publish(ps));
+
+			case PWDSHADOW_CFG_TRUST_REPL:
+			ps->ps_trust_replication = c->value_int;
+			return(pwdshadow_cfg_publish(ps));
+
+			case PWDSHADOW_CFG_CACHE_TTL:
+			ps->ps_cache_ttl = c->value_int;
+			return(pwdshadow_cfg_publish(ps));
+
+			case PWDSHADOW_CFG_ALIAS:
+			ps->ps_alias = c->value_int;
+			return(pwdshadow_cfg_publish(ps));
+
+			case PWDSHADOW_CFG_EXPIRY:
+			ps->ps_expiry = c->value_int;
+			pwdshadow_expiry_config(ps);
+			return(pwdshadow_cfg_publish(ps));
+
+			case PWDSHADOW_CFG_TUPLE_CACHE:
+			ad = NULL;
+			if (slap_str2ad(c->argv[1], &ad, &text) != LDAP_SUCCESS)
+			{
+				snprintf( c->cr_msg, sizeof( c->cr_msg ), "pwdshadow_tuple_cache attribute \"%s\" is undefined", c->argv[1] );
+				Debug(LDAP_DEBUG_CONFIG, "%s: %s.\n", c->log, c->cr_msg);
+				return(ARG_BAD_CONF);
+			};
+			if ( (lutil_atoul(&max, c->argv[2]) != 0) || (max < 1) || (max > PWDSHADOW_TUPLE_MAX) )
+			{
+				snprintf( c->cr_msg, sizeof( c->cr_msg ), "pwdshadow_tuple_cache entries must be between 1 and %d", PWDSHADOW_TUPLE_MAX );
+				Debug(LDAP_DEBUG_CONFIG, "%s: %s.\n", c->log, c->cr_msg);
+				return(ARG_BAD_CONF);
+			};
+			pwdshadow_tuple_reset(ps, ad, max);
+			return(pwdshadow_cfg_publish(ps));
+
+			case PWDSHADOW_CFG_SUBTREE:
+			ber_str2bv(c->argv[1], 0, 0, &bv);
+			if (dnNormalize(0, NULL, NULL, &bv, &ndn, NULL) != LDAP_SUCCESS)
+			{
+				snprintf( c->cr_msg, sizeof( c->cr_msg ), "pwdshadow_subtree_policy suffix \"%s\" is not a valid DN", c->argv[1] );
+				Debug(LDAP_DEBUG_CONFIG, "%s: %s.\n", c->log, c->cr_msg);
+				return(ARG_BAD_CONF);
+			};
+			ber_str2bv(c->argv[2], 0, 0, &bv);
+			if (dnNormalize(0, NULL, NULL, &bv, &policy, NULL) != LDAP_SUCCESS)
+			{
+				snprintf( c->cr_msg, sizeof( c->cr_msg ), "pwdshadow_subtree_policy policy \"%s\" is not a valid DN", c->argv[2] );
+				Debug(LDAP_DEBUG_CONFIG, "%s: %s.\n", c->log, c->cr_msg);
+				ber_memfree(ndn.bv_val);
+				return(ARG_BAD_CONF);
+			};
+			for(idx = 0; ( ((ps->ps_subtree_dns)) && ((ps->ps_subtree_dns[idx].bv_val)) ); idx++)
+				if ((bvmatch(&ps->ps_subtree_dns[idx], &ndn)))
+					break;
+			if ( ((ps->ps_subtree_dns)) && ((ps->ps_subtree_dns[idx].bv_val)) )
+			{
+				snprintf( c->cr_msg, sizeof( c->cr_msg ), "pwdshadow_subtree_policy suffix \"%s\" is already assigned a policy", c->argv[1] );
+				Debug(LDAP_DEBUG_CONFIG, "%s: %s.\n", c->log, c->cr_msg);
+				ber_memfree(ndn.bv_val);
+				ber_memfree(policy.bv_val);
+				return(ARG_BAD_CONF);
+			};
+			ber_bvarray_add(&ps->ps_subtree_dns, &ndn);
+			ber_bvarray_add(&ps->ps_subtree_policies, &policy);
+			return(pwdshadow_cfg_publish(ps));
+
+			default:
+			Debug(LDAP_DEBUG_ANY, "pwdshadow_cfg_gen: unknown configuration option\n" );
+			return( ARG_BAD_CONF );
+		};
+		break;
+		
+		default:
+		Debug(LDAP_DEBUG_ANY, "pwdshadow_cfg_gen: unknown configuration operation\n" );
+		abort ();
+	};
+
+	return(rc);
+}
+
+
+// references a snapshot beyond the current operation, such as across a
+// pause of the thread pool
+pwdshadow_cfg_t *
+pwdshadow_cfg_hold(
+		pwdshadow_t *				ps )
+{
+	pwdshadow_cfg_t *		cf;
+
+	cf = pwdshadow_cfg_get(ps);
+	__atomic_add_fetch(&cf->cf_refcnt, 1, __ATOMIC_RELAXED);
+
+	return(cf);
+}
+
+
+// builds a snapshot of the configuration directives and replaces the
+// snapshot used by operations
+int
+pwdshadow_cfg_publish(
+		pwdshadow_t *				ps )
+{
+	int						idx;
+	pwdshadow_cfg_t *		cf;
+	pwdshadow_cfg_t *		prev;
+	struct berval			bv;
+
+	cf							= ch_calloc(1, sizeof(pwdshadow_cfg_t));
+	cf->cf_mode					= ps->ps_mode;
+	cf->cf_overrides			= ps->ps_overrides;
+	cf->cf_use_policies			= ps->ps_use_policies;
+	cf->cf_trust_replication	= ps->ps_trust_replication;
+	cf->cf_cache_ttl			= ps->ps_cache_ttl;
+	cf->cf_alias				= ps->ps_alias;
+	cf->cf_policy_ad			= ps->ps_policy_ad;
+	cf->cf_tuple_ad				= ps->ps_tuple_ad;
+	cf->cf_expiry				= ps->ps_expiry;
+	cf->cf_refcnt				= 1;
+	if ((ps->ps_def_policy.bv_val))
+		ber_dupbv(&cf->cf_def_policy, &ps->ps_def_policy);
+
+	// trie references the suffixes and policies owned by the snapshot
+	for(idx = 0; ( ((ps->ps_subtree_dns)) && ((ps->ps_subtree_dns[idx].bv_val)) ); idx++)
+	{
+		ber_dupbv(&bv, &ps->ps_subtree_dns[idx]);
+		ber_bvarray_add(&cf->cf_subtree_dns, &bv);
+		ber_dupbv(&bv, &ps->ps_subtree_policies[idx]);
+		ber_bvarray_add(&cf->cf_subtree_policies, &bv);
+	};
+	pwdshadow_subtree_build(cf);
+
+	// prepare attribute descriptions used by operations
+	pwdshadow_state_build(cf);
+
+	// readers load the snapshot once per operation
+	prev = __atomic_exchange_n(&ps->ps_cfg, cf, __ATOMIC_ACQ_REL);
+	if ((prev))
+	{
+		prev->cf_next		= ps->ps_cfg_retired;
+		ps->ps_cfg_retired	= prev;
+		pwdshadow_cfg_release(prev);
+	};
+	pwdshadow_cfg_reclaim(ps, 0);
+
+	return(0);
+}
+
+
+// quotes a value of a directive for slapd's tokenizer, which removes
+// backslashes and treats double quotes as delimiters, escaped characters of
+// normalized DNs such as \2C are preserved, str holds (bv_len * 2) + 3 bytes
+size_t
+pwdshadow_cfg_quote(
+		struct berval *				bv,
+		char *						str )
+{
+	size_t					pos;
+	size_t					len;
+
+	len			= 0;
+	str[len++]	= '"';
+	for(pos = 0; pos < bv->bv_len; pos++)
+	{
+		if ( (bv->bv_val[pos] == '\\') || (bv->bv_val[pos] == '"') )
+			str[len++] = '\\';
+		str[len++] = bv->bv_val[pos];
+	};
+	str[len++]	= '"';
+	str[len]	= '\0';
+
+	return(len);
+}
+
+
+// frees retired snapshots which are no longer referenced, slapd pauses the
+// thread pool while cn=config is modified and an unheld snapshot is not kept
+// across a pause, snapshots held across a call into the backend are freed by
+// a later pause
+int
+pwdshadow_cfg_reclaim(
+		pwdshadow_t *				ps,
+		int							force )
+{
+	pwdshadow_cfg_t *		cf;
+	pwdshadow_cfg_t **		cfp;
+
+	if ( (!(force)) && ((slapMode & SLAP_SERVER_RUNNING)) && (!(ldap_pvt_thread_pool_pausing(&connection_pool))) )
+		return(0);
+
+	for(cfp = &ps->ps_cfg_retired; ((*cfp)); )
+	{
+		cf = *cfp;
+		if ( (!(force)) && ((__atomic_load_n(&cf->cf_refcnt, __ATOMIC_ACQUIRE))) )
+		{
+			cfp = &cf->cf_next;
+			continue;
+		};
+		*cfp = cf->cf_next;
+		pwdshadow_cfg_free(cf);
+	};
+
+	return(0);
+}
+
+
+void
+pwdshadow_cfg_release(
+		pwdshadow_cfg_t *			cf )
+{
+	// retired snapshot is freed by the next pwdshadow_cfg_reclaim()
+	__atomic_sub_fetch(&cf->cf_refcnt, 1, __ATOMIC_RELEASE);
+	return;
+}
+
+
+void
+pwdshadow_copy_int_bv(
+		int							i,
+		BerValue *					bv )
+{
+	char		buff[PWDSHADOW_INT_LEN];
+
+	bv->bv_len = pwdshadow_int2str(i, buff);
+	bv->bv_val = ch_malloc(bv->bv_len + 1);
+	memcpy(bv->bv_val, buff, bv->bv_len + 1);
+	return;
+}
+
+
+int
+pwdshadow_db_close(
+		BackendDB *					be,
+		ConfigReply *				cr )
+{
+	int					running;
+	slap_overinst *		on;
+	pwdshadow_t *		ps;
+	pwdshadow_stats_t	sum;
+	struct timespec		ts;
+
+	on		= (slap_overinst *) be->bd_info;
+	ps		= on->on_bi.bi_private;
+
+	ts.tv_sec	= 0;
+	ts.tv_nsec	= 10000000;
+
+	pwdshadow_stats_sum(ps, &sum);
+	Debug(LDAP_DEBUG_STATS, "pwdshadow_db_close: %lu entry fetches skipped for unrelated modifications\n", sum.sx_counters[PWDSHADOW_STAT_SKIPPED] );
+
+	// remove statistics from cn=monitor
+	pwdshadow_monitor_close(be);
+
+	// cancel pending resume of regeneration
+	ldap_pvt_thread_mutex_lock(&slapd_rq.rq_mutex);
+	if ((ps->ps_regen_task))
+	{
+		if ((ldap_pvt_runqueue_isrunning(&slapd_rq, ps->ps_regen_task)))
+			ldap_pvt_runqueue_stoptask(&slapd_rq, ps->ps_regen_task);
+		ldap_pvt_runqueue_remove(&slapd_rq, ps->ps_regen_task);
+		ps->ps_regen_task = NULL;
+	};
+	ldap_pvt_thread_mutex_unlock(&slapd_rq.rq_mutex);
+
+	// stop running regeneration, cursor is kept for resuming, while the
+	// thread pool is paused the regeneration stops at its next check once
+	// the pause ends and pwdshadow_db_destroy() defers freeing the instance
+	ldap_pvt_thread_mutex_lock(&ps->ps_regen_mutex);
+	if (ps->ps_regen_state == PWDSHADOW_REGEN_RUNNING)
+		ps->ps_regen_state = PWDSHADOW_REGEN_STOPPING;
+	ldap_pvt_thread_mutex_unlock(&ps->ps_regen_mutex);
+	if (!(ldap_pvt_thread_pool_pausing(&connection_pool)))
+		pwdshadow_regen_wait(ps, -1);
+
+	// cancel building of the expiry index and free the index
+	ldap_pvt_thread_mutex_lock(&slapd_rq.rq_mutex);
+	if ((ps->ps_expiry_task))
+	{
+		if ((ldap_pvt_runqueue_isrunning(&slapd_rq, ps->ps_expiry_task)))
+			ldap_pvt_runqueue_stoptask(&slapd_rq, ps->ps_expiry_task);
+		ldap_pvt_runqueue_remove(&slapd_rq, ps->ps_expiry_task);
+		ps->ps_expiry_task = NULL;
+	};
+	ldap_pvt_thread_mutex_unlock(&slapd_rq.rq_mutex);
+	pwdshadow_expiry_reset(ps);
+	for(running = 1; ( ((running)) && (!(ldap_pvt_thread_pool_pausing(&connection_pool))) ); )
+	{
+		ldap_pvt_thread_mutex_lock(&ps->ps_expiry_mutex);
+		running = ps->ps_expiry_running;
+		ldap_pvt_thread_mutex_unlock(&ps->ps_expiry_mutex);
+		if ((running))
+			nanosleep(&ts, NULL);
+	};
+
+	if ((cr))
+		return(0);
+
+	return(0);
+}
+
+
+int
+pwdshadow_db_destroy(
+		BackendDB *					be,
+		ConfigReply *				cr )
+{
+	slap_overinst *		on;
+	pwdshadow_t *		ps;
+
+	on						= (slap_overinst *) be->bd_info;
+	ps						= on->on_bi.bi_private;
+	on->on_bi.bi_private	= NULL;
+
+	// a regeneration or index build interrupted while the thread pool was
+	// paused was stopped by pwdshadow_db_close() and still references the
+	// instance, the instance is freed once the task has returned
+	if ((pwdshadow_db_running(ps)))
+	{
+		Debug(LDAP_DEBUG_ANY, "pwdshadow_db_destroy: regeneration or index build still running, instance freed once stopped\n" );
+		ldap_pvt_thread_mutex_lock(&slapd_rq.rq_mutex);
+		ldap_pvt_runqueue_insert(&slapd_rq, 1, pwdshadow_db_reap, ps, "pwdshadow_db_reap", "pwdshadow");
+		ldap_pvt_thread_mutex_unlock(&slapd_rq.rq_mutex);
+		return(0);
+	};
+
+	pwdshadow_db_free(ps);
+
+	if ((cr))
+		return(0);
+
+	return(0);
+}
+
+
+void
+pwdshadow_db_free(
+		pwdshadow_t *				ps )
+{
+	if ((ps->ps_def_policy.bv_val))
+		free(ps->ps_def_policy.bv_val);
+	ps->ps_def_policy.bv_val = NULL;
+
+	// free policies assigned by subtree
+	ber_bvarray_free(ps->ps_subtree_dns);
+	ber_bvarray_free(ps->ps_subtree_policies);
+
+	// free cached password policies
+	ldap_avl_free(ps->ps_cache, pwdshadow_policy_free);
+	ldap_pvt_thread_cond_destroy(&ps->ps_cache_cond);
+	ldap_pvt_thread_mutex_destroy(&ps->ps_cache_mutex);
+	ldap_pvt_thread_rdwr_destroy(&ps->ps_cache_rwlock);
+
+	// free cached entries
+	pwdshadow_tuple_reset(ps, NULL, 0);
+	ldap_pvt_thread_mutex_destroy(&ps->ps_tuple_mutex);
+
+	// free queued regeneration
+	ber_bvarray_free(ps->ps_regen_policies);
+	ber_bvarray_free(ps->ps_regen_subtrees);
+	ldap_pvt_thread_mutex_destroy(&ps->ps_regen_mutex);
+
+	// free expiry index
+	pwdshadow_expiry_reset(ps);
+	ldap_pvt_thread_mutex_destroy(&ps->ps_expiry_mutex);
+
+	// free configuration snapshots
+	pwdshadow_cfg_free(ps->ps_cfg);
+	pwdshadow_cfg_reclaim(ps, 1);
+	ps->ps_cfg = NULL;
+
+	ch_free(ps->ps_stats_mem);
+
+	memset(ps, 0, sizeof(pwdshadow_t));
+	ch_free( ps );
+
+	return;
+}
+
+
+int
+pwdshadow_db_init(
+		BackendDB *					be,
+		ConfigReply *				cr )
+{
+	slap_overinst *			on;
+	pwdshadow_t *			ps;
+
+	if (( SLAP_ISGLOBALOVERLAY( be ) ))
+	{
+		// do not allow slapo-pwdshadow to be global
+		if (( cr ))
+		{
+			snprintf( cr->msg, sizeof(cr->msg), "slapo-pwdshadow cannot be global" );
+			Debug( LDAP_DEBUG_ANY, "%s\n", cr->msg );
+		};
+		return(1);
+	};
+
+	// allocate memory for database instance configuration
+	on								= (slap_overinst *) be->bd_info;
+	on->on_bi.bi_private			= ch_calloc( sizeof(pwdshadow_t), 1 );
+	ps								= on->on_bi.bi_private;
+
+	// set default values
+	ps->ps_overrides				= 1;
+	ps->ps_use_policies				= 1;
+	ps->ps_trust_replication		= 1;
+	ps->ps_policy_ad				= ad_pwdShadowPolicySubentry;
+	ps->ps_cache_ttl				= PWDSHADOW_CACHE_TTL;
+	ps->ps_regen_workers			= PWDSHADOW_REGEN_WORKERS;
+	pwdshadow_cfg_publish(ps);
+
+	// align statistics shards to cache lines
+	ps->ps_stats_mem				= ch_calloc( sizeof(pwdshadow_stats_t) * PWDSHADOW_STATS_SHARDS + PWDSHADOW_CACHELINE, 1 );
+	ps->ps_stats					= (pwdshadow_stats_t *)(((uintptr_t)ps->ps_stats_mem + PWDSHADOW_CACHELINE - 1) & ~((uintptr_t)PWDSHADOW_CACHELINE - 1));
+
+	ldap_pvt_thread_rdwr_init(&ps->ps_cache_rwlock);
+	ldap_pvt_thread_mutex_init(&ps->ps_cache_mutex);
+	ldap_pvt_thread_cond_init(&ps->ps_cache_cond);
+	ldap_pvt_thread_mutex_init(&ps->ps_tuple_mutex);
+	ldap_pvt_thread_mutex_init(&ps->ps_expiry_mutex);
+	ldap_pvt_thread_mutex_init(&ps->ps_regen_mutex);
+
+	return(0);
+}
+
+
+int
+pwdshadow_db_open(
+		BackendDB *					be,
+		ConfigReply *				cr )
+{
+	slap_overinst *			on;
+	pwdshadow_t *			ps;
+	const char *			text;
+
+	on		= (slap_overinst *) be->bd_info;
+	ps		= on->on_bi.bi_private;
+
+	ldap_pvt_thread_mutex_lock(&pwdshadow_ad_mutex);
+
+	// verifies schema has not aleady been retrieved
+	if ((pwdshadow_schema))
+	{
+		ldap_pvt_thread_mutex_unlock(&pwdshadow_ad_mutex);
+		pwdshadow_cfg_publish(ps);
+		pwdshadow_regen_open(be, on);
+		pwdshadow_expiry_open(ps);
+		pwdshadow_monitor_open(be, on);
+		return(0);
+	};
+	pwdshadow_schema = 1;
+
+	// slapo-ppolicy attributes (IETF draft-behera-ldap-password-policy-11)
+	slap_str2ad("pwdChangedTime",		&ad_pwdChangedTime,		&text);
+	slap_str2ad("pwdEndTime",			&ad_pwdEndTime,			&text);
+	slap_str2ad("pwdExpireWarning",		&ad_pwdExpireWarning,	&text);
+	slap_str2ad("pwdGraceExpiry",		&ad_pwdGraceExpiry,		&text);
+	slap_str2ad("pwdMaxAge",			&ad_pwdMaxAge,			&text);
+	slap_str2ad("pwdMinAge",			&ad_pwdMinAge,			&text);
+
+	// LDAP NIS attributes (RFC 2307)
+	slap_str2ad("shadowExpire",			&ad_shadowExpire,		&text);
+	slap_str2ad("shadowFlag",			&ad_shadowFlag,			&text);
+	slap_str2ad("shadowInactive",		&ad_shadowInactive,		&text);
+	slap_str2ad("shadowLastChange",		&ad_shadowLastChange,	&text);
+	slap_str2ad("shadowMax",			&ad_shadowMax,			&text);
+	slap_str2ad("shadowMin",			&ad_shadowMin,			&text);
+	slap_str2ad("shadowWarning",		&ad_shadowWarning,		&text);
+	oc_shadowAccount = oc_find("shadowAccount");
+
+	// User Schema (RFC 2256)
+	if ((ad_userPassword = slap_schema.si_ad_userPassword) == NULL)
+		slap_str2ad("userPassword",		&ad_userPassword,		&text);
+
+	// Directory Information Models (RFC 4512)
+	if ((ad_objectClass = slap_schema.si_ad_objectClass) == NULL)
+		slap_str2ad("objectClass",		&ad_objectClass,		&text);
+	if ((ad_modifyTimestamp = slap_schema.si_ad_modifyTimestamp) == NULL)
+		slap_str2ad("modifyTimestamp",	&ad_modifyTimestamp,	&text);
+
+	ldap_pvt_thread_mutex_unlock(&pwdshadow_ad_mutex);
+
+	// prepare attribute descriptions used by operations
+	pwdshadow_cfg_publish(ps);
+
+	// schedule resume of interrupted regeneration
+	pwdshadow_regen_open(be, on);
+
+	// index entries by day of expiry once the server is running
+	pwdshadow_expiry_open(ps);
+
+	// publish statistics under cn=monitor
+	pwdshadow_monitor_open(be, on);
+
+	if ((cr))
+		return(0);
+	return(0);
+}
+
+
+// frees an instance destroyed while its regeneration or index build was
+// stopped during a pause of the thread pool, polls until the task returns
+void *
+pwdshadow_db_reap(
+		void *						ctx,
+		void *						arg )
+{
+	struct re_s *			rtask;
+	pwdshadow_t *			ps;
+
+	rtask		= arg;
+	ps			= rtask->arg;
+
+	ldap_pvt_thread_mutex_lock(&slapd_rq.rq_mutex);
+	if ((ldap_pvt_runqueue_isrunning(&slapd_rq, rtask)))
+		ldap_pvt_runqueue_stoptask(&slapd_rq, rtask);
+	if ((pwdshadow_db_running(ps)))
+	{
+		ldap_pvt_runqueue_resched(&slapd_rq, rtask, 0);
+		ldap_pvt_thread_mutex_unlock(&slapd_rq.rq_mutex);
+		return(NULL);
+	};
+	ldap_pvt_runqueue_remove(&slapd_rq, rtask);
+	ldap_pvt_thread_mutex_unlock(&slapd_rq.rq_mutex);
+
+	Debug(LDAP_DEBUG_STATS, "pwdshadow_db_reap: regeneration or index build stopped, instance freed\n" );
+	pwdshadow_db_free(ps);
+
+	if (!(ctx))
+		return(NULL);
+	return(NULL);
+}
+
+
+// returns non-zero while a regeneration or index build references the
+// instance
+int
+pwdshadow_db_running(
+		pwdshadow_t *				ps )
+{
+	int						running;
+
+	ldap_pvt_thread_mutex_lock(&ps->ps_regen_mutex);
+	running = (ps->ps_regen_state != PWDSHADOW_REGEN_IDLE);
+	ldap_pvt_thread_mutex_unlock(&ps->ps_regen_mutex);
+
+	ldap_pvt_thread_mutex_lock(&ps->ps_expiry_mutex);
+	running = ((running)) ? running : ps->ps_expiry_running;
+	ldap_pvt_thread_mutex_unlock(&ps->ps_expiry_mutex);
+
+	return(running);
+}
+
+
+int
+pwdshadow_eval(
+		Operation *					op,
+		pwdshadow_state_t *			st )
+{
+	int						idx;
+	int						pos;
+	int						policy;
+	unsigned				rules;
+	uint32_t				mods;
+	const pwdshadow_rule_t *	ru;
+
+	st->st_purge		= ((st->st_post[PWDSHADOW_SL_pwdShadowGenerate])) ? 0 : 1;
+	if (!(st->st_today))
+		pwdshadow_op_timestamp(op, st, NULL);
+	pwdshadow_probe1(eval__entry, st->st_ndn.bv_val);
+
+	// determine rules reachable from modified attributes
+	rules = 0;
+	for(mods = st->st_useradd | st->st_userdel; ((mods)); mods &= mods - 1)
+		rules |= st->st_cfg->cf_rule_mask[__builtin_ctz(mods)];
+	if ((st->st_force))
+		rules = (1U << PWDSHADOW_RULES) - 1;
+	if (!(rules))
+	{
+		pwdshadow_probe3(eval__return, st->st_ndn.bv_val, st->st_evaladd, st->st_evaldel);
+		return(0);
+	};
+
+	// evaluate rules in dependency order, password policy is retrieved by
+	// the first rule which requires it
+	for(pos = 0, policy = 0; pos < st->st_cfg->cf_rule_count; pos++)
+	{
+		idx = st->st_cfg->cf_rule_order[pos];
+		if (!(rules & (1U << idx)))
+			continue;
+		ru	= &pwdshadow_rules[idx];
+
+		if ( ((ru->ru_flags & PWDSHADOW_RULE_POLICY)) && (!(policy)) && (!(st->st_purge)) )
+		{
+			pwdshadow_eval_policy(op, st);
+			policy = 1;
+		};
+
+		pwdshadow_eval_precheck(st, ru);
+		if ( ((ru->ru_compute)) && ((st->st_evaladd & ~st->st_override & pwdshadow_bit(ru->ru_slot))) )
+			ru->ru_compute(st, ru->ru_slot);
+		pwdshadow_eval_postcheck(st, ru->ru_slot);
+	};
+	pwdshadow_probe3(eval__return, st->st_ndn.bv_val, st->st_evaladd, st->st_evaldel);
+
+	return(0);
+}
+
+
+int
+pwdshadow_eval_policy(
+		Operation *					op,
+		pwdshadow_state_t *			st )
+{
+	int					rc;
+	uint64_t			start;
+	slap_overinst *		on;
+	pwdshadow_t *		ps;
+	pwdshadow_cfg_t *	cf;
+	pwdshadow_stats_t *	sx;
+	pwdshadow_policy_t	pp;
+	struct berval *		policy;
+
+	on			= (slap_overinst *)op->o_bd->bd_info;
+	ps			= on->on_bi.bi_private;
+	cf			= st->st_cfg;
+	rc			= -1;
+	policy		= NULL;
+
+	// exit if policies are disabled by the configuration
+	if (!(cf->cf_use_policies))
+		return(0);
+
+	sx			= pwdshadow_stats_shard(ps, op);
+	start		= pwdshadow_stats_clock(ps);
+	pwdshadow_probe1(eval__policy__entry, st->st_ndn.bv_val);
+
+	// attempt to retrieve entry's specific policy
+	if ((st->st_policy.bv_val))
+	{
+		pwdshadow_stats_inc(sx, PWDSHADOW_STAT_POLICIES);
+		policy	= &st->st_policy;
+		rc		= pwdshadow_policy_get(op, ps, cf, policy, &pp);
+	};
+
+	// attempt to retrieve policy of the longest matching subtree
+	if ( ((rc)) && ((cf->cf_subtree)) && ((st->st_ndn.bv_val)) )
+	{
+		if ((policy = pwdshadow_subtree_find(cf, &st->st_ndn, NULL)) != NULL)
+		{
+			pwdshadow_stats_inc(sx, PWDSHADOW_STAT_POLICIES);
+			rc = pwdshadow_policy_get(op, ps, cf, policy, &pp);
+		};
+	};
+
+	// attempt to retrieve default policy
+	if ( ((rc)) && ((cf->cf_def_policy.bv_val)) )
+	{
+		pwdshadow_stats_inc(sx, PWDSHADOW_STAT_POLICIES);
+		policy	= &cf->cf_def_policy;
+		rc		= pwdshadow_policy_get(op, ps, cf, policy, &pp);
+	};
+
+	pwdshadow_stats_latency(sx, PWDSHADOW_PHASE_POLICY, start);
+	pwdshadow_probe4(eval__policy__return, st->st_ndn.bv_val, ((policy)) ? policy->bv_val : NULL,
+		( (!(rc)) && ((pp.pp_flags & PWDSHADOW_POLICY_CACHED)) ) ? 1 : 0, rc);
+
+	// exit if a policy was not retreived
+	if ((rc))
+	{
+		pwdshadow_stats_inc(sx, PWDSHADOW_STAT_POLICY_FAILS);
+		return(0);
+	};
+
+	// copy password policy attributes
+	st->st_exists = (st->st_exists & ~PWDSHADOW_SL_POLICY) | pp.pp_exists;
+	st->st_prev[PWDSHADOW_SL_pwdExpireWarning]		= st->st_post[PWDSHADOW_SL_pwdExpireWarning]	= pp.pp_pwdExpireWarning;
+	st->st_prev[PWDSHADOW_SL_pwdGraceExpiry]		= st->st_post[PWDSHADOW_SL_pwdGraceExpiry]		= pp.pp_pwdGraceExpiry;
+	st->st_prev[PWDSHADOW_SL_pwdMaxAge]				= st->st_post[PWDSHADOW_SL_pwdMaxAge]			= pp.pp_pwdMaxAge;
+	st->st_prev[PWDSHADOW_SL_pwdMinAge]				= st->st_post[PWDSHADOW_SL_pwdMinAge]			= pp.pp_pwdMinAge;
+	st->st_prev[PWDSHADOW_SL_pwdShadowAutoExpire]	= st->st_post[PWDSHADOW_SL_pwdShadowAutoExpire]	= pp.pp_pwdShadowAutoExpire;
+
+	if ((pwdshadow_flg_exists(st, PWDSHADOW_SL_pwdShadowAutoExpire)))
+		st->st_autoexpire = ((pp.pp_pwdShadowAutoExpire)) ? 1 : 0;
+
+	return(0);
+}
+
+
+int
+pwdshadow_eval_postcheck(
+		pwdshadow_state_t *			st,
+		int							slot )
+{
+	// existing values are not replaced by the same value
+	if (!(st->st_evaladd & st->st_exists & pwdshadow_bit(slot)))
+		return(0);
+	if (st->st_prev[slot] == st->st_post[slot])
+		st->st_evaladd &= ~pwdshadow_bit(slot);
+	return(0);
+}
+
+
+int
+pwdshadow_eval_precheck(
+		pwdshadow_state_t *			st,
+		const pwdshadow_rule_t *	ru )
+{
+	int					slot;
+	uint32_t			bit;
+	uint32_t			live;
+
+	slot	= ru->ru_slot;
+	bit		= pwdshadow_bit(slot);
+
+	// determine if overlay is disabled for entry
+	if ((st->st_purge))
+	{
+		pwdshadow_purge(st, slot);
+		return(0);
+	};
+
+	// slots with a value once the user's modifications are applied
+	live = pwdshadow_live(st);
+
+	// determine if override value is set for attribute
+	if ( ((st->st_cfg->cf_overrides)) && ((live & pwdshadow_bit(ru->ru_override))) )
+	{
+		st->st_evaladd		|= bit;
+		st->st_override		|= bit;
+		st->st_post[slot]	 = st->st_post[ru->ru_override];
+		return(0);
+	};
+
+	// attribute exists while any trigger exists, rules with several triggers
+	// compute the value
+	if ((live & ru->ru_triggers))
+	{
+		st->st_evaladd		|= bit;
+		st->st_post[slot]	 = st->st_post[__builtin_ctz(live & ru->ru_triggers)];
+		return(0);
+	};
+
+	// determine if attribute should be removed
+	st->st_evaldel |= st->st_exists & bit;
+
+	return(0);
+}
+
+
+// adds the entries with indexed attributes to the expiry index, writes
+// applied while the index is built replace the values read by the search
+void *
+pwdshadow_expiry_build(
+		void *						ctx,
+		void *						arg )
+{
+	struct re_s *			rtask;
+	pwdshadow_t *			ps;
+	Connection				conn;
+	OperationBuffer			opbuf;
+	Operation *				op;
+	BackendDB				db;
+	Filter					f[3];
+	AttributeName			attrs[4];
+	pwdshadow_expiry_build_t	eb;
+	SlapReply				rs		= { REP_RESULT };
+
+	rtask		= arg;
+	ps			= rtask->arg;
+
+	// task only runs once
+	ldap_pvt_thread_mutex_lock(&slapd_rq.rq_mutex);
+	if (!(ps->ps_expiry_task))
+	{
+		ldap_pvt_thread_mutex_unlock(&slapd_rq.rq_mutex);
+		return(NULL);
+	};
+	ldap_pvt_runqueue_stoptask(&slapd_rq, rtask);
+	ldap_pvt_runqueue_remove(&slapd_rq, rtask);
+	ps->ps_expiry_task = NULL;
+	ldap_pvt_thread_mutex_unlock(&slapd_rq.rq_mutex);
+
+	memset(&eb, 0, sizeof(eb));
+	eb.eb_cb.sc_response	= pwdshadow_expiry_collect;
+	eb.eb_cb.sc_private		= &eb;
+	eb.eb_ps				= ps;
+
+	ldap_pvt_thread_mutex_lock(&ps->ps_expiry_mutex);
+	if (ps->ps_expiry_state != PWDSHADOW_EXPIRY_BUILDING)
+	{
+		ldap_pvt_thread_mutex_unlock(&ps->ps_expiry_mutex);
+		return(NULL);
+	};
+	eb.eb_gen = ps->ps_expiry_gen;
+	ps->ps_expiry_running++;
+	ldap_pvt_thread_mutex_unlock(&ps->ps_expiry_mutex);
+
+	memset(attrs, 0, sizeof(attrs));
+	attrs[0].an_desc	= ad_pwdShadowExpire;
+	attrs[0].an_name	= ad_pwdShadowExpire->ad_cname;
+	attrs[1].an_desc	= ad_pwdShadowLastChange;
+	attrs[1].an_name	= ad_pwdShadowLastChange->ad_cname;
+	attrs[2].an_desc	= ad_pwdShadowMax;
+	attrs[2].an_name	= ad_pwdShadowMax->ad_cname;
+
+	// (|(pwdShadowExpire=*)(pwdShadowLastChange=*))
+	memset(f, 0, sizeof(f));
+	f[0].f_choice		= LDAP_FILTER_OR;
+	f[0].f_or			= &f[1];
+	f[1].f_choice		= LDAP_FILTER_PRESENT;
+	f[1].f_desc			= ad_pwdShadowExpire;
+	f[1].f_next			= &f[2];
+	f[2].f_choice		= LDAP_FILTER_PRESENT;
+	f[2].f_desc			= ad_pwdShadowLastChange;
+
+	// search the database through every overlay as the rootdn
+	connection_fake_init2(&conn, &opbuf, ctx, 0);
+	op					= &opbuf.ob_op;
+	db					= *ps->ps_regen_be;
+	db.bd_info			= (BackendInfo *)ps->ps_regen_on->on_info;
+	op->o_bd			= &db;
+	op->o_dn			= db.be_rootdn;
+	op->o_ndn			= db.be_rootndn;
+	op->o_tag			= LDAP_REQ_SEARCH;
+	op->o_req_dn		= db.be_suffix[0];
+	op->o_req_ndn		= db.be_nsuffix[0];
+	op->o_callback		= &eb.eb_cb;
+	op->ors_scope		= LDAP_SCOPE_SUBTREE;
+	op->ors_deref		= LDAP_DEREF_NEVER;
+	op->ors_slimit		= SLAP_NO_LIMIT;
+	op->ors_tlimit		= SLAP_NO_LIMIT;
+	op->ors_limit		= NULL;
+	op->ors_attrsonly	= 0;
+	op->ors_attrs		= attrs;
+	op->ors_filter		= f;
+	filter2bv_x(op, f, &op->ors_filterstr);
+
+	Debug(LDAP_DEBUG_STATS, "pwdshadow_expiry_build: indexing %s\n", db.be_suffix[0].bv_val );
+
+	op->o_bd->be_search(op, &rs);
+	op->o_tmpfree(op->ors_filterstr.bv_val, op->o_tmpmemctx);
+
+	// remove entries whose indexed attributes were deleted while building
+	ldap_pvt_thread_mutex_lock(&ps->ps_expiry_mutex);
+	if ( (rs.sr_err == LDAP_SUCCESS) && (!(slapd_shutdown)) && (eb.eb_gen == ps->ps_expiry_gen) )
+	{
+		pwdshadow_expiry_purge(ps);
+		ps->ps_expiry_state = PWDSHADOW_EXPIRY_READY;
+		Debug(LDAP_DEBUG_STATS, "pwdshadow_expiry_build: indexed %s, %lu entries\n", db.be_suffix[0].bv_val, ps->ps_expiry_count );
+	} else {
+		Debug(LDAP_DEBUG_STATS, "pwdshadow_expiry_build: indexing of %s interrupted\n", db.be_suffix[0].bv_val );
+	};
+	ps->ps_expiry_running--;
+	ldap_pvt_thread_mutex_unlock(&ps->ps_expiry_mutex);
+
+	return(NULL);
+}
+
+
+// orders indexed entries by day of a kind, then by DN
+int
+pwdshadow_expiry_cmp(
+		const pwdshadow_expiry_t *	a,
+		const pwdshadow_expiry_t *	b,
+		int							kind )
+{
+	if (a->ex_days[kind] != b->ex_days[kind])
+		return( (a->ex_days[kind] < b->ex_days[kind]) ? -1 : 1 );
+	return(pwdshadow_expiry_cmp_dn(a, b));
+}
+
+
+// orders indexed entries by DN compared from the last character, so that the
+// entries of a subtree are adjacent
+int
+pwdshadow_expiry_cmp_dn(
+		const void *				a,
+		const void *				b )
+{
+	ber_len_t					pos;
+	const unsigned char *		x;
+	const unsigned char *		y;
+	const pwdshadow_expiry_t *	exa;
+	const pwdshadow_expiry_t *	exb;
+
+	exa	= a;
+	exb	= b;
+	x	= (const unsigned char *)&exa->ex_ndn.bv_val[exa->ex_ndn.bv_len];
+	y	= (const unsigned char *)&exb->ex_ndn.bv_val[exb->ex_ndn.bv_len];
+
+	for(pos = 1; ( (pos <= exa->ex_ndn.bv_len) && (pos <= exb->ex_ndn.bv_len) ); pos++)
+		if (x[-pos] != y[-pos])
+			return( (x[-pos] < y[-pos]) ? -1 : 1 );
+
+	if (exa->ex_ndn.bv_len == exb->ex_ndn.bv_len)
+		return(0);
+	return( (exa->ex_ndn.bv_len < exb->ex_ndn.bv_len) ? -1 : 1 );
+}
+
+
+int
+pwdshadow_expiry_cmp_expire(
+		const void *				a,
+		const void *				b )
+{
+	return(pwdshadow_expiry_cmp(a, b, PWDSHADOW_EXPIRY_EXPIRE));
+}
+
+
+int
+pwdshadow_expiry_cmp_maxage(
+		const void *				a,
+		const void *				b )
+{
+	return(pwdshadow_expiry_cmp(a, b, PWDSHADOW_EXPIRY_MAXAGE));
+}
+
+
+int
+pwdshadow_expiry_collect(
+		Operation *					op,
+		SlapReply *					rs )
+{
+	int							days[PWDSHADOW_EXPIRY_KINDS];
+	pwdshadow_t *				ps;
+	pwdshadow_expiry_t *		ex;
+	pwdshadow_expiry_t			probe;
+	pwdshadow_expiry_build_t *	eb;
+
+	eb	= op->o_callback->sc_private;
+	ps	= eb->eb_ps;
+
+	if (rs->sr_type != REP_SEARCH)
+		return(0);
+
+	pwdshadow_expiry_days(rs->sr_entry, days);
+
+	ldap_pvt_thread_mutex_lock(&ps->ps_expiry_mutex);
+
+	// abandon search once the index is disabled or the database is closed
+	if ( ((slapd_shutdown)) || (eb->eb_gen != ps->ps_expiry_gen) )
+	{
+		ldap_pvt_thread_mutex_unlock(&ps->ps_expiry_mutex);
+		op->o_abandon = 1;
+		return(0);
+	};
+
+	// entry written since the search started is already indexed
+	probe.ex_ndn = rs->sr_entry->e_nname;
+	if ((ex = ldap_tavl_find(ps->ps_expiry_dns, &probe, pwdshadow_expiry_cmp_dn)) == NULL)
+		if ( (days[PWDSHADOW_EXPIRY_EXPIRE] >= 0) || (days[PWDSHADOW_EXPIRY_MAXAGE] >= 0) )
+			pwdshadow_expiry_insert(ps, &rs->sr_entry->e_nname, days);
+
+	ldap_pvt_thread_mutex_unlock(&ps->ps_expiry_mutex);
+
+	return(0);
+}
+
+
+// builds or frees the expiry index after the configuration changed
+int
+pwdshadow_expiry_config(
+		pwdshadow_t *				ps )
+{
+	if ( ((ps->ps_expiry)) && (ps->ps_mode == PWDSHADOW_MODE_STORED) )
+		return(pwdshadow_expiry_open(ps));
+	return(pwdshadow_expiry_reset(ps));
+}
+
+
+// parses an absolute day or a day relative to today
+int
+pwdshadow_expiry_day(
+		const char *				str,
+		int							today,
+		int *						dayp )
+{
+	int						days;
+
+	if (lutil_atoi(&days, (str[0] == '+') ? &str[1] : str) != 0)
+		return(-1);
+	if ( (str[0] == '+') || (str[0] == '-') )
+		days += today;
+	*dayp = days;
+
+	return(0);
+}
+
+
+// days of an entry's indexed attributes, a kind without a day is -1
+int
+pwdshadow_expiry_days(
+		Entry *						entry,
+		int *						days )
+{
+	int						idx;
+	int64_t					vals[3];
+	Attribute *				a;
+	AttributeDescription *	ads[3];
+
+	ads[0]	= ad_pwdShadowExpire;
+	ads[1]	= ad_pwdShadowLastChange;
+	ads[2]	= ad_pwdShadowMax;
+
+	for(idx = 0; idx < 3; idx++)
+	{
+		vals[idx] = -1;
+		if ( ((a = attr_find(entry->e_attrs, ads[idx])) != NULL) && ((a->a_numvals)) )
+			if (pwdshadow_parse_int(&a->a_nvals[0], &vals[idx]) != 0)
+				vals[idx] = -1;
+		if ( (vals[idx] < 0) || (vals[idx] > INT_MAX) )
+			vals[idx] = -1;
+	};
+
+	days[PWDSHADOW_EXPIRY_EXPIRE] = (int)vals[0];
+	days[PWDSHADOW_EXPIRY_MAXAGE] = -1;
+	if ( (vals[1] >= 0) && (vals[2] >= 0) && ((vals[1] + vals[2]) <= INT_MAX) )
+		days[PWDSHADOW_EXPIRY_MAXAGE] = (int)(vals[1] + vals[2]);
+
+	return(0);
+}
+
+
+// returns a page of the entries within a subtree whose day of a kind is
+// within a range of days, the request is "<DN>\n<attribute> <first> <last>
+// [<size>]" optionally followed by "\n<day> <DN>" of the last entry of the
+// previous page, the response lists "<day> <DN>" of an entry per line
+int
+pwdshadow_expiry_extop(
+		Operation *					op,
+		SlapReply *					rs )
+{
+	int						rc;
+	int						ret;
+	int						kind;
+	int						size;
+	int						count;
+	int						first;
+	int						last;
+	int						today;
+	char *					eol;
+	char *					ptr;
+	ber_len_t				len;
+	ber_len_t				pos;
+	ber_len_t				need;
+	ber_len_t				alloc;
+	struct berval			lines[3];
+	struct berval			ndn;
+	struct berval			bv;
+	struct berval			data;
+	char					line[128];
+	char					params[4][PWDSHADOW_INT_LEN * 2];
+	BackendDB *				be;
+	slap_overinst *			on;
+	pwdshadow_t *			ps;
+	TAvlnode *				node;
+	pwdshadow_expiry_t *	ex;
+	pwdshadow_expiry_t		probe;
+
+	// split request into lines
+	memset(lines, 0, sizeof(lines));
+	if ( ((op->ore_reqdata)) && ((op->ore_reqdata->bv_len)) )
+	{
+		ptr = op->ore_reqdata->bv_val;
+		len = op->ore_reqdata->bv_len;
+		for(pos = 0; ( (pos < 3) && ((len)) ); pos++)
+		{
+			lines[pos].bv_val = ptr;
+			lines[pos].bv_len = ((eol = memchr(ptr, '\n', len)) != NULL) ? (ber_len_t)(eol - ptr) : len;
+			ptr += lines[pos].bv_len;
+			len -= lines[pos].bv_len;
+			ptr += ((len)) ? 1 : 0;
+			len -= ((len)) ? 1 : 0;
+		};
+	};
+	if ( (!(lines[1].bv_len)) || (lines[1].bv_len >= sizeof(line)) )
+	{
+		rs->sr_text = "pwdshadow expiry query requires the DN of a database and a range of days";
+		return(LDAP_PROTOCOL_ERROR);
+	};
+
+	// "<attribute> <first> <last> [<size>]", days preceded by a sign are
+	// relative to the current day
+	memset(params, 0, sizeof(params));
+	memcpy(line, lines[1].bv_val, lines[1].bv_len);
+	line[lines[1].bv_len] = '\0';
+	today	= (int)(op->o_time / 86400);
+	size	= PWDSHADOW_EXPIRY_PAGE;
+	rc		= sscanf(line, "%23s %23s %23s %23s", params[0], params[1], params[2], params[3]);
+	if ( (rc < 3) || (pwdshadow_expiry_day(params[1], today, &first) != 0) || (pwdshadow_expiry_day(params[2], today, &last) != 0) ||
+	     ( (rc == 4) && ( (lutil_atoi(&size, params[3]) != 0) || (size < 1) ) ) )
+	{
+		rs->sr_text = "pwdshadow expiry query has an invalid range of days";
+		return(LDAP_PROTOCOL_ERROR);
+	};
+	if (!(strcasecmp(params[0], ad_pwdShadowExpire->ad_cname.bv_val)))
+		kind = PWDSHADOW_EXPIRY_EXPIRE;
+	else if (!(strcasecmp(params[0], ad_pwdShadowMax->ad_cname.bv_val)))
+		kind = PWDSHADOW_EXPIRY_MAXAGE;
+	else
+	{
+		rs->sr_text = "pwdshadow expiry query requires pwdShadowExpire or pwdShadowMax";
+		return(LDAP_PROTOCOL_ERROR);
+	};
+
+	// locate overlay instance of database
+	if ((rc = dnNormalize(0, NULL, NULL, &lines[0], &ndn, op->o_tmpmemctx)) != LDAP_SUCCESS)
+	{
+		rs->sr_text = "pwdshadow expiry query requires the DN of a database";
+		return(LDAP_INVALID_DN_SYNTAX);
+	};
+	be = select_backend(&ndn, 0);
+	on = NULL;
+	if ( ((be)) && ((overlay_is_inst(be, pwdshadow.on_bi.bi_type))) )
+	{
+		for(on = ((slap_overinfo *)be->bd_info)->oi_list; ((on)); on = on->on_next)
+			if (!(strcmp(on->on_bi.bi_type, pwdshadow.on_bi.bi_type)))
+				break;
+	};
+	if (!(on))
+	{
+		op->o_tmpfree(ndn.bv_val, op->o_tmpmemctx);
+		rs->sr_text = "pwdshadow is not configured for database";
+		return(LDAP_UNWILLING_TO_PERFORM);
+	};
+	ps = on->on_bi.bi_private;
+
+	// index lists entries regardless of access controls
+	if (!(be_isroot_dn(be, &op->o_ndn)))
+	{
+		op->o_tmpfree(ndn.bv_val, op->o_tmpmemctx);
+		rs->sr_text = "pwdshadow expiry query requires rootdn of database";
+		return(LDAP_INSUFFICIENT_ACCESS);
+	};
+
+	// page starts after the entry of the previous page
+	memset(&probe, 0, sizeof(probe));
+	probe.ex_days[kind] = first;
+	ber_str2bv("", 0, 0, &probe.ex_ndn);
+	if ((lines[2].bv_len))
+	{
+		bv = lines[2];
+		for(len = 0; ( (len < bv.bv_len) && (bv.bv_val[len] != ' ') ); len++);
+		if ( (len >= sizeof(params[0])) || (len >= bv.bv_len) )
+			rc = LDAP_PROTOCOL_ERROR;
+		else
+		{
+			memset(params[0], 0, sizeof(params[0]));
+			memcpy(params[0], bv.bv_val, len);
+			bv.bv_val += len + 1;
+			bv.bv_len -= len + 1;
+			rc = ( (lutil_atoi(&probe.ex_days[kind], params[0]) != 0) || (probe.ex_days[kind] < first) ) ? LDAP_PROTOCOL_ERROR : LDAP_SUCCESS;
+		};
+		if ( (rc != LDAP_SUCCESS) || (dnNormalize(0, NULL, NULL, &bv, &probe.ex_ndn, op->o_tmpmemctx) != LDAP_SUCCESS) )
+		{
+			op->o_tmpfree(ndn.bv_val, op->o_tmpmemctx);
+			rs->sr_text = "pwdshadow expiry query has an invalid page";
+			return(LDAP_PROTOCOL_ERROR);
+		};
+	};
+
+	ldap_pvt_thread_mutex_lock(&ps->ps_expiry_mutex);
+	if (ps->ps_expiry_state != PWDSHADOW_EXPIRY_READY)
+	{
+		rc = ps->ps_expiry_state;
+		ldap_pvt_thread_mutex_unlock(&ps->ps_expiry_mutex);
+		op->o_tmpfree(ndn.bv_val, op->o_tmpmemctx);
+		if ((lines[2].bv_len))
+			op->o_tmpfree(probe.ex_ndn.bv_val, op->o_tmpmemctx);
+		rs->sr_text = (rc == PWDSHADOW_EXPIRY_BUILDING) ? "pwdshadow expiry index is being built" : "pwdshadow expiry index is not enabled";
+		return( (rc == PWDSHADOW_EXPIRY_BUILDING) ? LDAP_BUSY : LDAP_UNWILLING_TO_PERFORM );
+	};
+
+	// walk index from first day, or from the entry ending the previous page
+	BER_BVZERO(&data);
+	alloc = 0;
+	if ((node = ldap_tavl_find3(ps->ps_expiry_days[kind], &probe, pwdshadow_expiry_cmps[kind], &ret)) != NULL)
+		if (ret >= 0)
+			node = ldap_tavl_next(node, TAVL_DIR_RIGHT);
+	for(count = 0; ( ((node)) && (count < size) ); node = ldap_tavl_next(node, TAVL_DIR_RIGHT))
+	{
+		ex = node->avl_data;
+		if (ex->ex_days[kind] > last)
+			break;
+		if (!(dnIsSuffix(&ex->ex_ndn, &ndn)))
+			continue;
+
+		// page grows geometrically while the index is locked
+		need = data.bv_len + ex->ex_ndn.bv_len + PWDSHADOW_INT_LEN + 3;
+		if (need > alloc)
+		{
+			alloc		= ((alloc * 2) > need) ? (alloc * 2) : (need * 2);
+			data.bv_val	= ch_realloc(data.bv_val, alloc);
+		};
+		data.bv_len += sprintf(&data.bv_val[data.bv_len], "%d %s\n", ex->ex_days[kind], ex->ex_ndn.bv_val);
+		count++;
+	};
+	ldap_pvt_thread_mutex_unlock(&ps->ps_expiry_mutex);
+	op->o_tmpfree(ndn.bv_val, op->o_tmpmemctx);
+	if ((lines[2].bv_len))
+		op->o_tmpfree(probe.ex_ndn.bv_val, op->o_tmpmemctx);
+
+	if ((data.bv_val))
+	{
+		rs->sr_rspdata	= ch_malloc(sizeof(struct berval));
+		*rs->sr_rspdata	= data;
+	};
+
+	return(LDAP_SUCCESS);
+}
+
+
+// caller must hold ps_expiry_mutex
+int
+pwdshadow_expiry_insert(
+		pwdshadow_t *				ps,
+		struct berval *				ndn,
+		int *						days )
+{
+	int						kind;
+	size_t					size;
+	pwdshadow_expiry_t *	ex;
+
+	ex					= ch_malloc(sizeof(pwdshadow_expiry_t) + ndn->bv_len + 1);
+	ex->ex_ndn.bv_val	= (char *)&ex[1];
+	ex->ex_ndn.bv_len	= ndn->bv_len;
+	memcpy(ex->ex_ndn.bv_val, ndn->bv_val, ndn->bv_len);
+	ex->ex_ndn.bv_val[ndn->bv_len] = '\0';
+
+	size = sizeof(pwdshadow_expiry_t) + ndn->bv_len + 1 + sizeof(TAvlnode);
+	ldap_tavl_insert(&ps->ps_expiry_dns, ex, pwdshadow_expiry_cmp_dn, ldap_avl_dup_error);
+	for(kind = 0; kind < PWDSHADOW_EXPIRY_KINDS; kind++)
+	{
+		ex->ex_days[kind] = days[kind];
+		if (days[kind] < 0)
+			continue;
+		ldap_tavl_insert(&ps->ps_expiry_days[kind], ex, pwdshadow_expiry_cmps[kind], ldap_avl_dup_error);
+		size += sizeof(TAvlnode);
+	};
+	ps->ps_expiry_count++;
+	ps->ps_expiry_bytes += size;
+
+	return(0);
+}
+
+
+// starts building the expiry index once the server is running
+int
+pwdshadow_expiry_open(
+		pwdshadow_t *				ps )
+{
+	if ( (!(ps->ps_expiry)) || (ps->ps_mode != PWDSHADOW_MODE_STORED) || (!(ps->ps_regen_be)) || ((slapMode & SLAP_TOOL_MODE)) )
+		return(0);
+
+	ldap_pvt_thread_mutex_lock(&ps->ps_expiry_mutex);
+	if (ps->ps_expiry_state != PWDSHADOW_EXPIRY_OFF)
+	{
+		ldap_pvt_thread_mutex_unlock(&ps->ps_expiry_mutex);
+		return(0);
+	};
+	ps->ps_expiry_state = PWDSHADOW_EXPIRY_BUILDING;
+	ps->ps_expiry_gen++;
+	ldap_pvt_thread_mutex_unlock(&ps->ps_expiry_mutex);
+
+	ldap_pvt_thread_mutex_lock(&slapd_rq.rq_mutex);
+	if (!(ps->ps_expiry_task))
+		ps->ps_expiry_task = ldap_pvt_runqueue_insert(&slapd_rq, 1, pwdshadow_expiry_build, ps, "pwdshadow_expiry_build", ps->ps_regen_be->be_suffix[0].bv_val);
+	ldap_pvt_thread_mutex_unlock(&slapd_rq.rq_mutex);
+
+	return(0);
+}
+
+
+// removes entries without indexed attributes, which are kept while the index
+// is built, caller must hold ps_expiry_mutex
+int
+pwdshadow_expiry_purge(
+		pwdshadow_t *				ps )
+{
+	TAvlnode *				node;
+	pwdshadow_expiry_t *	ex;
+
+	for(node = ldap_tavl_end(ps->ps_expiry_dns, TAVL_DIR_LEFT); ((node)); )
+	{
+		ex		= node->avl_data;
+		node	= ldap_tavl_next(node, TAVL_DIR_RIGHT);
+		if ( (ex->ex_days[PWDSHADOW_EXPIRY_EXPIRE] < 0) && (ex->ex_days[PWDSHADOW_EXPIRY_MAXAGE] < 0) )
+			pwdshadow_expiry_remove(ps, ex);
+	};
+
+	return(0);
+}
+
+
+// caller must hold ps_expiry_mutex
+void
+pwdshadow_expiry_remove(
+		pwdshadow_t *				ps,
+		pwdshadow_expiry_t *		ex )
+{
+	int						kind;
+	size_t					size;
+
+	size = sizeof(pwdshadow_expiry_t) + ex->ex_ndn.bv_len + 1 + sizeof(TAvlnode);
+	ldap_tavl_delete(&ps->ps_expiry_dns, ex, pwdshadow_expiry_cmp_dn);
+	for(kind = 0; kind < PWDSHADOW_EXPIRY_KINDS; kind++)
+	{
+		if (ex->ex_days[kind] < 0)
+			continue;
+		ldap_tavl_delete(&ps->ps_expiry_days[kind], ex, pwdshadow_expiry_cmps[kind]);
+		size += sizeof(TAvlnode);
+	};
+	ps->ps_expiry_count--;
+	ps->ps_expiry_bytes -= size;
+	ch_free(ex);
+
+	return;
+}
+
+
+// moves the indexed entries of a renamed subtree
+int
+pwdshadow_expiry_rename(
+		pwdshadow_t *				ps,
+		struct berval *				ndn,
+		struct berval *				newndn )
+{
+	int						ret;
+	int						idx;
+	int						count;
+	int						days[PWDSHADOW_EXPIRY_KINDS];
+	TAvlnode *				node;
+	pwdshadow_expiry_t *	ex;
+	pwdshadow_expiry_t **	list;
+	pwdshadow_expiry_t		exact;
+	pwdshadow_expiry_t		probe;
+	struct berval			dn;
+
+	// ",<DN>" precedes the entries of the subtree
+	probe.ex_ndn.bv_len	= ndn->bv_len + 1;
+	probe.ex_ndn.bv_val	= ch_malloc(ndn->bv_len + 2);
+	probe.ex_ndn.bv_val[0] = ',';
+	memcpy(&probe.ex_ndn.bv_val[1], ndn->bv_val, ndn->bv_len + 1);
+
+	ldap_pvt_thread_mutex_lock(&ps->ps_expiry_mutex);
+
+	// entries of the subtree read by a running build are indexed with their
+	// previous DN, the build is restarted
+	if (ps->ps_expiry_state == PWDSHADOW_EXPIRY_BUILDING)
+	{
+		ldap_pvt_thread_mutex_unlock(&ps->ps_expiry_mutex);
+		ch_free(probe.ex_ndn.bv_val);
+		pwdshadow_expiry_reset(ps);
+		return(pwdshadow_expiry_open(ps));
+	};
+
+	// collect renamed entry and entries of its subtree
+	list			= NULL;
+	count			= 0;
+	exact.ex_ndn	= *ndn;
+	if ((ex = ldap_tavl_find(ps->ps_expiry_dns, &exact, pwdshadow_expiry_cmp_dn)) != NULL)
+	{
+		list			= ch_realloc(list, sizeof(pwdshadow_expiry_t *) * (count + 1));
+		list[count++]	= ex;
+	};
+	if ((node = ldap_tavl_find3(ps->ps_expiry_dns, &probe, pwdshadow_expiry_cmp_dn, &ret)) != NULL)
+		if (ret > 0)
+			node = ldap_tavl_next(node, TAVL_DIR_RIGHT);
+	for(; ((node)); node = ldap_tavl_next(node, TAVL_DIR_RIGHT))
+	{
+		ex = node->avl_data;
+		if ( (ex->ex_ndn.bv_len <= probe.ex_ndn.bv_len) ||
+		     ((memcmp(&ex->ex_ndn.bv_val[ex->ex_ndn.bv_len - probe.ex_ndn.bv_len], probe.ex_ndn.bv_val, probe.ex_ndn.bv_len))) )
+			break;
+		list			= ch_realloc(list, sizeof(pwdshadow_expiry_t *) * (count + 1));
+		list[count++]	= ex;
+	};
+
+	// index entries with the new DN
+	for(idx = 0; idx < count; idx++)
+	{
+		ex			= list[idx];
+		dn.bv_len	= ex->ex_ndn.bv_len - ndn->bv_len + newndn->bv_len;
+		dn.bv_val	= ch_malloc(dn.bv_len + 1);
+		memcpy(dn.bv_val, ex->ex_ndn.bv_val, ex->ex_ndn.bv_len - ndn->bv_len);
+		memcpy(&dn.bv_val[ex->ex_ndn.bv_len - ndn->bv_len], newndn->bv_val, newndn->bv_len + 1);
+		memcpy(days, ex->ex_days, sizeof(days));
+		pwdshadow_expiry_remove(ps, ex);
+		pwdshadow_expiry_update(ps, &dn, days);
+		ch_free(dn.bv_val);
+	};
+
+	ldap_pvt_thread_mutex_unlock(&ps->ps_expiry_mutex);
+
+	ch_free(list);
+	ch_free(probe.ex_ndn.bv_val);
+
+	return(0);
+}
+
+
+// frees the expiry index, a build in progress is abandoned
+int
+pwdshadow_expiry_reset(
+		pwdshadow_t *				ps )
+{
+	int						kind;
+
+	ldap_pvt_thread_mutex_lock(&ps->ps_expiry_mutex);
+	for(kind = 0; kind < PWDSHADOW_EXPIRY_KINDS; kind++)
+		ldap_tavl_free(ps->ps_expiry_days[kind], NULL);
+	ldap_tavl_free(ps->ps_expiry_dns, ch_free);
+	memset(ps->ps_expiry_days, 0, sizeof(ps->ps_expiry_days));
+	ps->ps_expiry_dns	= NULL;
+	ps->ps_expiry_count	= 0;
+	ps->ps_expiry_bytes	= 0;
+	ps->ps_expiry_state	= PWDSHADOW_EXPIRY_OFF;
+	ps->ps_expiry_gen++;
+	ldap_pvt_thread_mutex_unlock(&ps->ps_expiry_mutex);
+
+	return(0);
+}
+
+
+int
+pwdshadow_expiry_response(
+		Operation *					op,
+		SlapReply *					rs )
+{
+	int						rc;
+	int						days[PWDSHADOW_EXPIRY_KINDS];
+	pwdshadow_t *			ps;
+	Entry *					entry;
+	BackendInfo *			bd_info;
+	Modifications *			mods;
+
+	ps = op->o_callback->sc_private;
+
+	if ( (rs->sr_type != REP_RESULT) || (rs->sr_err != LDAP_SUCCESS) )
+		return(SLAP_CB_CONTINUE);
+
+	days[PWDSHADOW_EXPIRY_EXPIRE] = -1;
+	days[PWDSHADOW_EXPIRY_MAXAGE] = -1;
+
+	switch(op->o_tag)
+	{
+		case LDAP_REQ_ADD:
+		pwdshadow_expiry_days(op->ora_e, days);
+		break;
+
+		case LDAP_REQ_DELETE:
+		break;
+
+		case LDAP_REQ_MODRDN:
+		pwdshadow_expiry_rename(ps, &op->o_req_ndn, &op->orr_nnewDN);
+		return(SLAP_CB_CONTINUE);
+
+		case LDAP_REQ_MODIFY:
+		// modifications include the generated modifications
+		for(mods = op->orm_modlist; ((mods)); mods = mods->sml_next)
+			if ( (mods->sml_desc == ad_pwdShadowExpire) || (mods->sml_desc == ad_pwdShadowLastChange) || (mods->sml_desc == ad_pwdShadowMax) )
+				break;
+		if (!(mods))
+			return(SLAP_CB_CONTINUE);
+
+		// read values applied by the backend
+		bd_info				= op->o_bd->bd_info;
+		op->o_bd->bd_info	= (BackendInfo *)ps->ps_regen_on->on_info;
+		rc					= be_entry_get_rw(op, &op->o_req_ndn, NULL, NULL, 0, &entry);
+		pwdshadow_stats_inc(pwdshadow_stats_shard(ps, op), PWDSHADOW_STAT_FETCHES);
+		if (rc == LDAP_SUCCESS)
+		{
+			pwdshadow_expiry_days(entry, days);
+			be_entry_release_r(op, entry);
+		};
+		op->o_bd->bd_info	= bd_info;
+		if (rc != LDAP_SUCCESS)
+			return(SLAP_CB_CONTINUE);
+		break;
+
+		default:
+		return(SLAP_CB_CONTINUE);
+	};
+
+	ldap_pvt_thread_mutex_lock(&ps->ps_expiry_mutex);
+	pwdshadow_expiry_update(ps, &op->o_req_ndn, days);
+	ldap_pvt_thread_mutex_unlock(&ps->ps_expiry_mutex);
+
+	return(SLAP_CB_CONTINUE);
+}
+
+
+// replaces the days of an entry, an entry without days is kept while the
+// index is built so that the build does not index values read before the
+// change, caller must hold ps_expiry_mutex
+int
+pwdshadow_expiry_update(
+		pwdshadow_t *				ps,
+		struct berval *				ndn,
+		int *						days )
+{
+	pwdshadow_expiry_t *	ex;
+	pwdshadow_expiry_t		probe;
+
+	if (ps->ps_expiry_state == PWDSHADOW_EXPIRY_OFF)
+		return(0);
+
+	probe.ex_ndn = *ndn;
+	if ((ex = ldap_tavl_find(ps->ps_expiry_dns, &probe, pwdshadow_expiry_cmp_dn)) != NULL)
+	{
+		if (!(memcmp(ex->ex_days, days, sizeof(ex->ex_days))))
+			return(0);
+		pwdshadow_expiry_remove(ps, ex);
+	};
+
+	if ( (days[PWDSHADOW_EXPIRY_EXPIRE] < 0) && (days[PWDSHADOW_EXPIRY_MAXAGE] < 0) && (ps->ps_expiry_state != PWDSHADOW_EXPIRY_BUILDING) )
+		return(0);
+	pwdshadow_expiry_insert(ps, ndn, days);
+
+	return(0);
+}
+
+
+// updates the expiry index once the backend has applied a write
+int
+pwdshadow_expiry_watch(
+		Operation *					op,
+		pwdshadow_t *				ps,
+		pwdshadow_cfg_t *			cf )
+{
+	slap_callback *			sc;
+
+	if ( (!(cf->cf_expiry)) || (cf->cf_mode != PWDSHADOW_MODE_STORED) )
+		return(0);
+
+	sc					= op->o_tmpcalloc(1, sizeof(slap_callback), op->o_tmpmemctx);
+	sc->sc_response		= pwdshadow_expiry_response;
+	sc->sc_cleanup		= pwdshadow_callback_cleanup;
+	sc->sc_private		= ps;
+	sc->sc_next			= op->o_callback;
+	op->o_callback		= sc;
+
+	return(0);
+}
+
+
+int
+pwdshadow_filter_cleanup(
+		Operation *					op,
+		SlapReply *					rs )
+{
+	pwdshadow_filter_t *	fl;
+
+	// restore filter of the request before the frontend frees it, other
+	// overlays restored their filters when their callbacks were removed
+	fl					= op->o_callback->sc_private;
+	filter_free_x(op, op->ors_filter, 1);
+	op->o_tmpfree(op->ors_filterstr.bv_val, op->o_tmpmemctx);
+	op->ors_filter		= fl->fl_filter;
+	op->ors_filterstr	= fl->fl_filterstr;
+	op->o_callback		= NULL;
+	op->o_tmpfree(fl, op->o_tmpmemctx);
+
+	if (!(rs))
+		return(0);
+
+	return(0);
+}
+
+
+Filter *
+pwdshadow_filter_new(
+		Operation *					op,
+		ber_tag_t					choice,
+		AttributeDescription *		ad,
+		int							val )
+{
+	Filter *				f;
+
+	f				= op->o_tmpcalloc(1, sizeof(Filter), op->o_tmpmemctx);
+	f->f_choice		= choice;
+
+	switch(choice)
+	{
+		case LDAP_FILTER_PRESENT:
+		f->f_desc	= ad;
+		break;
+
+		case LDAP_FILTER_EQUALITY:
+		case LDAP_FILTER_GE:
+		case LDAP_FILTER_LE:
+		f->f_ava				= op->o_tmpcalloc(1, sizeof(AttributeAssertion), op->o_tmpmemctx);
+		f->f_av_desc			= ad;
+		f->f_av_value.bv_val	= op->o_tmpalloc(PWDSHADOW_INT_LEN, op->o_tmpmemctx);
+		f->f_av_value.bv_len	= pwdshadow_int2str(val, f->f_av_value.bv_val);
+		break;
+
+		default:
+		break;
+	};
+
+	return(f);
+}
+
+
+// rewrites assertions of shadow attributes into disjunctions which include
+// the generated attributes, returns the number of rewritten assertions or
+// only counts them if op is NULL
+int
+pwdshadow_filter_rewrite(
+		Operation *					op,
+		pwdshadow_cfg_t *			cf,
+		Filter *					f )
+{
+	int						count;
+	int						val;
+	int64_t					num;
+	ber_tag_t				choice;
+	AttributeDescription *	win;
+	const pwdshadow_rule_t *	ru;
+	Filter *				item;
+	Filter *				term;
+	Filter *				both;
+
+	for(count = 0; ((f)); f = f->f_next)
+	{
+		choice = f->f_choice & SLAPD_FILTER_MASK;
+		if ( (choice == LDAP_FILTER_AND) || (choice == LDAP_FILTER_OR) || (choice == LDAP_FILTER_NOT) )
+		{
+			count += pwdshadow_filter_rewrite(op, cf, f->f_list);
+			continue;
+		};
+		if ((ru = pwdshadow_filter_rule(cf, f)) == NULL)
+			continue;
+
+		// assertions which cannot match a generated value are not rewritten,
+		// undefined assertions of shadow attributes without an ordering rule
+		// still carry the asserted value
+		val = 0;
+		if (choice != LDAP_FILTER_PRESENT)
+		{
+			if (pwdshadow_parse_int(&f->f_av_value, &num) != 0)
+				continue;
+			if ( (num < INT_MIN) || (num > INT_MAX) )
+				continue;
+			val = (int)num;
+		};
+		count++;
+		if (!(op))
+			continue;
+
+		// move assertion of shadow attribute into a disjunction
+		item			= op->o_tmpalloc(sizeof(Filter), op->o_tmpmemctx);
+		*item			= *f;
+		item->f_next	= NULL;
+		f->f_choice		= LDAP_FILTER_OR;
+		f->f_or			= item;
+		term			= pwdshadow_filter_new(op, choice, cf->cf_ads[ru->ru_slot], val);
+
+		// (|(shadowMax=*)(pwdShadowMax=*))
+		if (choice == LDAP_FILTER_PRESENT)
+		{
+			item->f_next = term;
+			continue;
+		};
+
+		// match the value returned by pwdshadow_alias, a stored shadow value
+		// wins if overrides are enabled:
+		//    (|(shadowMax<=v)(&(pwdShadowMax<=v)(!(shadowMax=*))))
+		// otherwise the generated value wins:
+		//    (|(pwdShadowMax<=v)(&(shadowMax<=v)(!(pwdShadowMax=*))))
+		win				= ((cf->cf_overrides)) ? cf->cf_ads[ru->ru_override] : cf->cf_ads[ru->ru_slot];
+		both			= pwdshadow_filter_new(op, LDAP_FILTER_AND, NULL, 0);
+		if ((cf->cf_overrides))
+		{
+			item->f_next	= both;
+			both->f_and		= term;
+		} else {
+			f->f_or			= term;
+			term->f_next	= both;
+			both->f_and		= item;
+		};
+		both->f_and->f_next				= pwdshadow_filter_new(op, LDAP_FILTER_NOT, NULL, 0);
+		both->f_and->f_next->f_not		= pwdshadow_filter_new(op, LDAP_FILTER_PRESENT, win, 0);
+	};
+
+	return(count);
+}
+
+
+// returns rule of the generated attribute aliased by the shadow attribute
+// asserted by a filter item
+const pwdshadow_rule_t *
+pwdshadow_filter_rule(
+		pwdshadow_cfg_t *			cf,
+		Filter *					f )
+{
+	int						idx;
+	AttributeDescription *	ad;
+	const pwdshadow_rule_t *	ru;
+
+	switch(f->f_choice & SLAPD_FILTER_MASK)
+	{
+		case LDAP_FILTER_PRESENT:
+		ad = f->f_desc;
+		break;
+
+		case LDAP_FILTER_EQUALITY:
+		case LDAP_FILTER_GE:
+		case LDAP_FILTER_LE:
+		ad = f->f_av_desc;
+		break;
+
+		default:
+		return(NULL);
+	};
+	if (!(ad))
+		return(NULL);
+
+	for(idx = 0; idx < PWDSHADOW_RULES; idx++)
+	{
+		ru = &pwdshadow_rules[idx];
+		if ( (cf->cf_ads[ru->ru_override] == ad) && ((cf->cf_ads[ru->ru_slot])) )
+			return(ru);
+	};
+
+	return(NULL);
+}
+
+
+int
+pwdshadow_get_attrs(
+		pwdshadow_state_t *			st,
+		Entry *						entry,
+		int							flags )
+{
+	st->st_ndn = entry->e_nname;
+	return(pwdshadow_scan_attrs(st, entry->e_attrs, PWDSHADOW_SCAN_ENTRY, flags));
+}
+
+
+int
+pwdshadow_get_mods(
+		Modifications *				mods,
+		pwdshadow_state_t *			st,
+		int							slot )
+{
+	int						op;
+	BerValue *				bv;
+
+	// determines and sets operation type, slot was resolved from the
+	// modification's attribute description
+	op = 0;
+	op = (mods->sml_op == LDAP_MOD_ADD)		? PWDSHADOW_FLG_USERADD : op;
+	op = (mods->sml_op == LDAP_MOD_DELETE)	? PWDSHADOW_FLG_USERDEL : op;
+	if (mods->sml_op == LDAP_MOD_REPLACE)
+		op = (mods->sml_numvals < 1) ? PWDSHADOW_FLG_USERDEL : PWDSHADOW_FLG_USERADD;
+	if (op == 0)
+		return(-1);
+
+	bv = (mods->sml_numvals > 0) ? &mods->sml_values[0]: NULL;
+
+	return(pwdshadow_set(st, slot, bv, op));
+}
+
+
+int
+pwdshadow_initialize( void )
+{
+	int					i;
+	int					code;
+
+	// register user and operation attributeTypes
+	for(i = 0; ((pwdshadow_ats[i].def)); i++)
+	{
+		if ((code = register_at(pwdshadow_ats[i].def, pwdshadow_ats[i].ad, 0)) != 0)
+		{
+			Debug( LDAP_DEBUG_ANY, "pwdshadow_initialize: register_at failed\n" );
+			return(code);
+		};
+		if ((is_at_no_user_mod((*pwdshadow_ats[i].ad)->ad_type)))
+		{
+			(*pwdshadow_ats[i].ad)->ad_type->sat_flags |= SLAP_AT_MANAGEABLE;
+		};
+	};
+
+	// register user objectClasses
+	for (i = 0; ((pwdshadow_ocs[i].def)); i++)
+	{
+		if ((code = register_oc(pwdshadow_ocs[i].def, pwdshadow_ocs[i].oc, 0)) != 0)
+		{
+			Debug(LDAP_DEBUG_ANY, "pwdshadow_initialize: register_oc failed\n");
+			Debug(LDAP_DEBUG_ANY, "pwdshadow_initialize: %s\n", pwdshadow_ocs[i].def);
+			return(code);
+		};
+	};
+
+	// register monitor attributeTypes and objectClasses
+	if ((code = pwdshadow_monitor_initialize()) != 0)
+		return(code);
+
+	// register configuration options/attributes
+	if ((code = config_register_schema( pwdshadow_cfg_ats, pwdshadow_cfg_ocs )) != 0)
+	{
+		Debug( LDAP_DEBUG_ANY, "pwdshadow_initialize: config_register_schema failed\n");
+		return(code);
+	};
+
+	// register extended operation for starting regeneration
+	if ((code = load_extop2((struct berval *)&pwdshadow_regen_oid, SLAP_EXOP_WRITES, pwdshadow_regen_extop, 0)) != 0)
+	{
+		Debug( LDAP_DEBUG_ANY, "pwdshadow_initialize: load_extop2 failed\n");
+		return(code);
+	};
+
+	// register extended operation for listing expiring entries
+	if ((code = load_extop2((struct berval *)&pwdshadow_expiry_oid, 0, pwdshadow_expiry_extop, 0)) != 0)
+	{
+		Debug( LDAP_DEBUG_ANY, "pwdshadow_initialize: load_extop2 failed\n");
+		return(code);
+	};
+
+	ldap_pvt_thread_mutex_init(&pwdshadow_ad_mutex);
+
+	pwdshadow.on_bi.bi_type			= "pwdshadow";
+	pwdshadow.on_bi.bi_flags		= SLAPO_BFLAG_SINGLE;
+
+	pwdshadow.on_bi.bi_db_init		= pwdshadow_db_init;
+	pwdshadow.on_bi.bi_db_open		= pwdshadow_db_open;
+	pwdshadow.on_bi.bi_db_close		= pwdshadow_db_close;
+	pwdshadow.on_bi.bi_db_destroy	= pwdshadow_db_destroy;
+
+	pwdshadow.on_bi.bi_op_add		= pwdshadow_op_add;
+	pwdshadow.on_bi.bi_op_compare	= pwdshadow_op_compare;
+	pwdshadow.on_bi.bi_op_delete	= pwdshadow_op_delete;
+	pwdshadow.on_bi.bi_op_modify	= pwdshadow_op_modify;
+	pwdshadow.on_bi.bi_op_modrdn	= pwdshadow_op_modrdn;
+	pwdshadow.on_bi.bi_op_search	= pwdshadow_op_search;
+
+	pwdshadow.on_bi.bi_operational	= pwdshadow_operational;
+
+	pwdshadow.on_bi.bi_cf_ocs		= pwdshadow_cfg_ocs;
+
+	return(overlay_register( &pwdshadow ));
+}
+
+
+// formats integer as decimal string into buffer of PWDSHADOW_INT_LEN bytes
+// and returns the length of the string
+ber_len_t
+pwdshadow_int2str(
+		int							i,
+		char *						buff )
+{
+	char			tmp[PWDSHADOW_INT_LEN];
+	char *			ptr;
+	ber_len_t		len;
+	unsigned int	u;
+
+	u		= (i < 0) ? (0U - (unsigned int)i) : (unsigned int)i;
+	ptr		= &tmp[sizeof(tmp)];
+	do
+	{
+		*--ptr	= (char)('0' + (u % 10));
+		u	   /= 10;
+	} while(u);
+	if (i < 0)
+		*--ptr = '-';
+
+	len = (ber_len_t)(&tmp[sizeof(tmp)] - ptr);
+	memcpy(buff, ptr, len);
+	buff[len] = '\0';
+
+	return(len);
+}
+
+
+pwdshadow_mods_t *
+pwdshadow_mods_alloc(
+		Operation *					op )
+{
+	pwdshadow_mods_t *		mb;
+
+	mb					= op->o_tmpalloc(sizeof(pwdshadow_mods_t), op->o_tmpmemctx);
+	memset(&mb->mb_cb, 0, sizeof(mb->mb_cb));
+	mb->mb_cb.sc_cleanup	= pwdshadow_mods_cleanup;
+	mb->mb_cb.sc_private	= mb;
+	mb->mb_count			= 0;
+
+	return(mb);
+}
+
+
+int
+pwdshadow_mods_cleanup(
+		Operation *					op,
+		SlapReply *					rs )
+{
+	pwdshadow_mods_t *		mb;
+
+	// generated modifications must be removed before the frontend frees
+	// the modlist, other overlays may have appended to or reordered it
+	mb				= op->o_callback->sc_private;
+	pwdshadow_mods_unlink(&op->orm_modlist, mb);
+	op->o_callback	= NULL;
+	op->o_tmpfree(mb, op->o_tmpmemctx);
+
+	if (!(rs))
+		return(0);
+
+	return(0);
+}
+
+
+void
+pwdshadow_mods_unlink(
+		Modifications **			modsp,
+		pwdshadow_mods_t *			mb )
+{
+	Modifications *		mods;
+
+	while((mods = *modsp) != NULL)
+	{
+		if ( (mods >= &mb->mb_mods[0]) && (mods < &mb->mb_mods[PWDSHADOW_GENERATED]) )
+			*modsp = mods->sml_next;
+		else
+			modsp = &mods->sml_next;
+	};
+
+	return;
+}
+
+
+int
+pwdshadow_monitor_close(
+		BackendDB *					be )
+{
+#ifdef SLAPD_MONITOR
+	slap_overinst *			on;
+	pwdshadow_t *			ps;
+	BackendInfo *			mi;
+	monitor_extra_t *		mbe;
+
+	on		= (slap_overinst *) be->bd_info;
+	ps		= on->on_bi.bi_private;
+
+	if (!(ps->ps_monitor_cb))
+		return(0);
+	ps->ps_stats_timing = 0;
+
+	// callback is freed by back-monitor
+	if ( ((mi = backend_info("monitor")) != NULL) && ((mi->bi_extra)) )
+	{
+		mbe = mi->bi_extra;
+		mbe->unregister_entry_callback(&ps->ps_monitor_ndn, ps->ps_monitor_cb, NULL, 0, NULL);
+	};
+	ps->ps_monitor_cb = NULL;
+
+	if ((ps->ps_monitor_ndn.bv_val))
+		ch_free(ps->ps_monitor_ndn.bv_val);
+	BER_BVZERO(&ps->ps_monitor_ndn);
+#else
+	if (!(be))
+		return(0);
+#endif
+	return(0);
+}
+
+
+#ifdef SLAPD_MONITOR
+int
+pwdshadow_monitor_free(
+		Entry *						e,
+		void **						priv )
+{
+	int						idx;
+	Modification			mod;
+	const char *			text;
+	char					textbuf[SLAP_TEXT_BUFLEN];
+	struct berval			vals[2];
+
+	*priv = NULL;
+
+	// remove objectClass
+	memset(&mod, 0, sizeof(mod));
+	mod.sm_op		= LDAP_MOD_DELETE;
+	mod.sm_desc		= slap_schema.si_ad_objectClass;
+	mod.sm_values	= vals;
+	mod.sm_numvals	= 1;
+	vals[0]			= oc_pwdShadowMonitor->soc_cname;
+	BER_BVZERO(&vals[1]);
+	modify_delete_values(e, &mod, 1, &text, textbuf, sizeof(textbuf));
+
+	// remove statistics
+	for(idx = 0; ((pwdshadow_monitor_ats[idx].def)); idx++)
+		attr_delete(&e->e_attrs, *pwdshadow_monitor_ats[idx].ad);
+
+	return(SLAP_CB_CONTINUE);
+}
+#endif
+
+
+int
+pwdshadow_monitor_initialize( void )
+{
+#ifdef SLAPD_MONITOR
+	int					i;
+	int					code;
+
+	// register monitor attributeTypes
+	for(i = 0; ((pwdshadow_monitor_ats[i].def)); i++)
+	{
+		if ((code = register_at(pwdshadow_monitor_ats[i].def, pwdshadow_monitor_ats[i].ad, 0)) != 0)
+		{
+			Debug( LDAP_DEBUG_ANY, "pwdshadow_monitor_initialize: register_at failed\n" );
+			return(code);
+		};
+	};
+
+	// register monitor objectClasses
+	for (i = 0; ((pwdshadow_monitor_ocs[i].def)); i++)
+	{
+		if ((code = register_oc(pwdshadow_monitor_ocs[i].def, pwdshadow_monitor_ocs[i].oc, 0)) != 0)
+		{
+			Debug(LDAP_DEBUG_ANY, "pwdshadow_monitor_initialize: register_oc failed\n");
+			return(code);
+		};
+	};
+#endif
+	return(0);
+}
+
+
+int
+pwdshadow_monitor_open(
+		BackendDB *					be,
+		slap_overinst *				on )
+{
+#ifdef SLAPD_MONITOR
+	int						rc;
+	pwdshadow_t *			ps;
+	Attribute *				a;
+	BackendInfo *			mi;
+	monitor_extra_t *		mbe;
+	monitor_callback_t *	cb;
+
+	ps = on->on_bi.bi_private;
+
+	if ((ps->ps_monitor_cb))
+		return(0);
+
+	// skip if back-monitor is not loaded or the monitor database is not configured
+	if ( ((mi = backend_info("monitor")) == NULL) || (!(mi->bi_extra)) )
+		return(0);
+	mbe = mi->bi_extra;
+	if (!(mbe->is_configured()))
+		return(0);
+
+	// objectClass is added now, statistics are generated when read
+	a			= attrs_alloc(1);
+	a->a_desc	= slap_schema.si_ad_objectClass;
+	attr_valadd(a, &oc_pwdShadowMonitor->soc_cname, NULL, 1);
+
+	cb				= ch_calloc(1, sizeof(monitor_callback_t));
+	cb->mc_update	= pwdshadow_monitor_update;
+	cb->mc_free		= pwdshadow_monitor_free;
+	cb->mc_private	= ps;
+
+	// attach statistics to the overlay's entry of the database
+	BER_BVZERO(&ps->ps_monitor_ndn);
+	if ((rc = mbe->register_overlay(be, on, &ps->ps_monitor_ndn)) == 0)
+		rc = mbe->register_entry_attrs(&ps->ps_monitor_ndn, a, cb, NULL, -1, NULL);
+	attrs_free(a);
+	if ((rc))
+	{
+		Debug(LDAP_DEBUG_ANY, "pwdshadow_monitor_open: unable to register monitor entry\n");
+		if ((ps->ps_monitor_ndn.bv_val))
+			ch_free(ps->ps_monitor_ndn.bv_val);
+		BER_BVZERO(&ps->ps_monitor_ndn);
+		ch_free(cb);
+		return(0);
+	};
+
+	ps->ps_monitor_cb	= cb;
+	ps->ps_stats_timing	= 1;
+#else
+	if ( (!(be)) || (!(on)) )
+		return(0);
+#endif
+	return(0);
+}
+
+
+#ifdef SLAPD_MONITOR
+int
+pwdshadow_monitor_set(
+		Entry *						e,
+		AttributeDescription *		ad,
+		BerVarray					vals )
+{
+	attr_delete(&e->e_attrs, ad);
+	if ( (!(vals)) || (!(vals[0].bv_val)) )
+		return(0);
+	return(attr_merge(e, ad, vals, NULL));
+}
+
+
+int
+pwdshadow_monitor_update(
+		Operation *					op,
+		SlapReply *					rs,
+		Entry *						e,
+		void *						priv )
+{
+	int						idx;
+	int						phase;
+	int						last;
+	int						state;
+	unsigned long			processed;
+	unsigned long			modified;
+	unsigned long			entries;
+	size_t					bytes;
+	pwdshadow_t *			ps;
+	BerVarray				vals;
+	struct berval			bv[2];
+	char					buff[128];
+	pwdshadow_stats_t		sum;
+
+	static const int		mod_ops[3]		= { LDAP_MOD_ADD, LDAP_MOD_REPLACE, LDAP_MOD_DELETE };
+	static const char *		states[3]		= { "idle", "running", "stopping" };
+	AttributeDescription *	mod_ads[3];
+	AttributeDescription *	phase_ads[PWDSHADOW_PHASE_COUNT];
+
+	ps = priv;
+	pwdshadow_stats_sum(ps, &sum);
+
+	mod_ads[0]							= ad_pwdShadowMonGeneratedAdd;
+	mod_ads[1]							= ad_pwdShadowMonGeneratedReplace;
+	mod_ads[2]							= ad_pwdShadowMonGeneratedDelete;
+	phase_ads[PWDSHADOW_PHASE_FETCH]	= ad_pwdShadowMonFetchLatency;
+	phase_ads[PWDSHADOW_PHASE_POLICY]	= ad_pwdShadowMonPolicyLatency;
+	phase_ads[PWDSHADOW_PHASE_EVAL]		= ad_pwdShadowMonEvalLatency;
+	phase_ads[PWDSHADOW_PHASE_MODS]		= ad_pwdShadowMonModsLatency;
+
+	// counters
+	bv[0].bv_val = buff;
+	BER_BVZERO(&bv[1]);
+	bv[0].bv_len = snprintf(buff, sizeof(buff), "%lu", sum.sx_counters[PWDSHADOW_STAT_ADDS]);
+	pwdshadow_monitor_set(e, ad_pwdShadowMonAdds, bv);
+	bv[0].bv_len = snprintf(buff, sizeof(buff), "%lu", sum.sx_counters[PWDSHADOW_STAT_MODIFIES]);
+	pwdshadow_monitor_set(e, ad_pwdShadowMonModifies, bv);
+	bv[0].bv_len = snprintf(buff, sizeof(buff), "%lu", sum.sx_counters[PWDSHADOW_STAT_SKIPPED]);
+	pwdshadow_monitor_set(e, ad_pwdShadowMonModifiesSkipped, bv);
+	bv[0].bv_len = snprintf(buff, sizeof(buff), "%lu", sum.sx_counters[PWDSHADOW_STAT_FETCHES]);
+	pwdshadow_monitor_set(e, ad_pwdShadowMonEntryFetches, bv);
+	bv[0].bv_len = snprintf(buff, sizeof(buff), "%lu", sum.sx_counters[PWDSHADOW_STAT_POLICIES]);
+	pwdshadow_monitor_set(e, ad_pwdShadowMonPolicyLookups, bv);
+	bv[0].bv_len = snprintf(buff, sizeof(buff), "%lu", sum.sx_counters[PWDSHADOW_STAT_POLICY_FAILS]);
+	pwdshadow_monitor_set(e, ad_pwdShadowMonPolicyFailures, bv);
+	bv[0].bv_len = snprintf(buff, sizeof(buff), "%lu", sum.sx_counters[PWDSHADOW_STAT_REPLICATED]);
+	pwdshadow_monitor_set(e, ad_pwdShadowMonReplicated, bv);
+	bv[0].bv_len = snprintf(buff, sizeof(buff), "%lu", sum.sx_counters[PWDSHADOW_STAT_TUPLE_HITS]);
+	pwdshadow_monitor_set(e, ad_pwdShadowMonTupleHits, bv);
+	bv[0].bv_len = snprintf(buff, sizeof(buff), "%lu", sum.sx_counters[PWDSHADOW_STAT_TUPLE_MISSES]);
+	pwdshadow_monitor_set(e, ad_pwdShadowMonTupleMisses, bv);
+
+	// generated modifications per attribute, i.e. "pwdShadowMax 42"
+	for(idx = 0; idx < 3; idx++)
+	{
+		vals = NULL;
+		for(last = 0; ((pwdshadow_slots[last].sl_ad)); last++)
+		{
+			if (!(pwdshadow_slots[last].sl_scan & PWDSHADOW_SCAN_VIRTUAL))
+				continue;
+			if (!(*pwdshadow_slots[last].sl_ad))
+				continue;
+			bv[0].bv_len = snprintf(buff, sizeof(buff), "%s %lu", (*pwdshadow_slots[last].sl_ad)->ad_cname.bv_val, sum.sx_mods[last][mod_ops[idx]]);
+			value_add_one(&vals, &bv[0]);
+		};
+		pwdshadow_monitor_set(e, mod_ads[idx], vals);
+		ber_bvarray_free(vals);
+	};
+
+	// latency histograms, i.e. "<upper bound in ns> <count>", empty buckets are omitted
+	for(phase = 0; phase < PWDSHADOW_PHASE_COUNT; phase++)
+	{
+		vals = NULL;
+		for(idx = 0; idx < PWDSHADOW_STATS_BUCKETS; idx++)
+		{
+			if (!(sum.sx_latency[phase][idx]))
+				continue;
+			if (idx == (PWDSHADOW_STATS_BUCKETS - 1))
+				bv[0].bv_len = snprintf(buff, sizeof(buff), "inf %lu", sum.sx_latency[phase][idx]);
+			else
+				bv[0].bv_len = snprintf(buff, sizeof(buff), "%llu %lu", 1ULL << (idx + 1), sum.sx_latency[phase][idx]);
+			value_add_one(&vals, &bv[0]);
+		};
+		pwdshadow_monitor_set(e, phase_ads[phase], vals);
+		ber_bvarray_free(vals);
+	};
+
+	// regeneration
+	ldap_pvt_thread_mutex_lock(&ps->ps_regen_mutex);
+	state		= ps->ps_regen_state;
+	processed	= ps->ps_regen_processed;
+	modified	= ps->ps_regen_modified;
+	ldap_pvt_thread_mutex_unlock(&ps->ps_regen_mutex);
+	ber_str2bv(states[state], 0, 0, &bv[0]);
+	pwdshadow_monitor_set(e, ad_pwdShadowMonRegenState, bv);
+	bv[0].bv_val = buff;
+	bv[0].bv_len = snprintf(buff, sizeof(buff), "%lu", processed);
+	pwdshadow_monitor_set(e, ad_pwdShadowMonRegenProcessed, bv);
+	bv[0].bv_len = snprintf(buff, sizeof(buff), "%lu", modified);
+	pwdshadow_monitor_set(e, ad_pwdShadowMonRegenModified, bv);
+
+	// cached entries
+	ldap_pvt_thread_mutex_lock(&ps->ps_tuple_mutex);
+	entries		= ps->ps_tuple_count;
+	bytes		= ps->ps_tuple_bytes;
+	ldap_pvt_thread_mutex_unlock(&ps->ps_tuple_mutex);
+	bv[0].bv_len = snprintf(buff, sizeof(buff), "%lu", entries);
+	pwdshadow_monitor_set(e, ad_pwdShadowMonTupleEntries, bv);
+	bv[0].bv_len = snprintf(buff, sizeof(buff), "%lu", (unsigned long)bytes);
+	pwdshadow_monitor_set(e, ad_pwdShadowMonTupleBytes, bv);
+
+	// expiry index
+	ldap_pvt_thread_mutex_lock(&ps->ps_expiry_mutex);
+	entries		= ps->ps_expiry_count;
+	bytes		= ps->ps_expiry_bytes;
+	ldap_pvt_thread_mutex_unlock(&ps->ps_expiry_mutex);
+	bv[0].bv_len = snprintf(buff, sizeof(buff), "%lu", entries);
+	pwdshadow_monitor_set(e, ad_pwdShadowMonExpiryEntries, bv);
+	bv[0].bv_len = snprintf(buff, sizeof(buff), "%lu", (unsigned long)bytes);
+	pwdshadow_monitor_set(e, ad_pwdShadowMonExpiryBytes, bv);
+
+	if ( (!(op)) || (!(rs)) )
+		return(SLAP_CB_CONTINUE);
+
+	return(SLAP_CB_CONTINUE);
+}
+#endif
+
+
+int
+pwdshadow_op_add(
+		Operation *					op,
+		SlapReply *					rs )
+{
+	slap_overinst *			on;
+	pwdshadow_t *			ps;
+	int						count;
+	pwdshadow_stats_t *		sx;
+	pwdshadow_state_t		st;
+	Attribute *				a;
+
+	// initialize state
+	on						= (slap_overinst *)op->o_bd->bd_info;
+	ps						= on->on_bi.bi_private;
+	sx						= pwdshadow_stats_shard(ps, op);
+	pwdshadow_state_initialize(&st, pwdshadow_cfg_get(ps));
+	pwdshadow_stats_inc(sx, PWDSHADOW_STAT_ADDS);
+	pwdshadow_probe1(op__add__entry, op->o_req_ndn.bv_val);
+
+	// remove cached entries with the keys of the added entry
+	pwdshadow_tuple_watch(op, ps, st.st_cfg);
+	pwdshadow_expiry_watch(op, ps, st.st_cfg);
+
+	// generated attributes are not stored in virtual mode
+	if (st.st_cfg->cf_mode == PWDSHADOW_MODE_VIRTUAL)
+	{
+		pwdshadow_probe2(op__add__return, op->o_req_ndn.bv_val, 0);
+		return(SLAP_CB_CONTINUE);
+	};
+
+	// replicated entries contain the attributes generated by the provider
+	if ( ((st.st_cfg->cf_trust_replication)) && ((be_shadow_update(op))) )
+	{
+		pwdshadow_stats_inc(sx, PWDSHADOW_STAT_REPLICATED);
+		pwdshadow_probe2(op__add__return, op->o_req_ndn.bv_val, 0);
+		return(SLAP_CB_CONTINUE);
+	};
+
+	// determines existing attribtues
+	pwdshadow_get_attrs(&st, op->ora_e, PWDSHADOW_FLG_USERADD);
+	a = attr_find(op->ora_e->e_attrs, ad_modifyTimestamp);
+	pwdshadow_op_timestamp(op, &st, ((a)) ? a->a_nvals : NULL);
+
+	// evaluate attributes for changes
+	pwdshadow_eval(op, &st);
+
+	// processing changes
+	count = pwdshadow_op_add_attrs(sx, op->ora_e, &st);
+	pwdshadow_probe2(op__add__return, op->o_req_ndn.bv_val, count);
+
+	if (!(rs))
+		return(SLAP_CB_CONTINUE);
+
+	return(SLAP_CB_CONTINUE);
+}
+
+
+int
+pwdshadow_op_add_attrs(
+		pwdshadow_stats_t *			sx,
+		Entry *						entry,
+		pwdshadow_state_t *			st )
+{
+	int						slot;
+	int						count;
+	uint32_t				pending;
+	struct berval			bv;
+	char					bv_val[PWDSHADOW_INT_LEN];
+
+	// generated attributes added by evaluation and not provided by the user,
+	// in order of slot, returns the number of attributes added
+	count	= 0;
+	pending	= st->st_evaladd & ~(st->st_useradd | st->st_userdel) & PWDSHADOW_SL_GENERATED;
+	for( ; ((pending)); pending &= pending - 1)
+	{
+		slot = __builtin_ctz(pending);
+		if (!(st->st_cfg->cf_ads[slot]))
+			continue;
+
+		// convert int to BV
+		bv.bv_val = bv_val;
+		bv.bv_len = pwdshadow_int2str(st->st_post[slot], bv_val);
+
+		// add attribute to entry, integers are already normalized so the
+		// normalized values share the values
+		attr_merge_one(entry, st->st_cfg->cf_ads[slot], &bv, NULL);
+		pwdshadow_stats_mod(sx, slot, LDAP_MOD_ADD);
+		pwdshadow_probe4(mod, st->st_ndn.bv_val, st->st_cfg->cf_ads[slot]->ad_cname.bv_val, LDAP_MOD_ADD, st->st_post[slot]);
+		count++;
+	};
+
+	return(count);
+}
+
+
+int
+pwdshadow_op_compare(
+		Operation *					op,
+		SlapReply *					rs )
+{
+	int						rc;
+	int64_t					val;
+	slap_overinst *			on;
+	pwdshadow_t *			ps;
+	pwdshadow_cfg_t *		cf;
+	pwdshadow_hash_t *		ha;
+	Entry *					entry;
+	BackendInfo *			bd_info;
+	AttributeDescription *	ad;
+	pwdshadow_state_t		st;
+
+	on					= (slap_overinst *)op->o_bd->bd_info;
+	ps					= on->on_bi.bi_private;
+	cf					= pwdshadow_cfg_get(ps);
+	ad					= op->orc_ava->aa_desc;
+
+	// only generated attributes are compared in virtual mode
+	if (cf->cf_mode != PWDSHADOW_MODE_VIRTUAL)
+		return(SLAP_CB_CONTINUE);
+	if ((ha = pwdshadow_slot_find(cf, ad)) == NULL)
+		return(SLAP_CB_CONTINUE);
+	if (!(ha->ha_scan & PWDSHADOW_SCAN_VIRTUAL))
+		return(SLAP_CB_CONTINUE);
+
+	// retrieve entry from backend
+	bd_info				= op->o_bd->bd_info;
+	op->o_bd->bd_info	= (BackendInfo *)on->on_info;
+	rc					= be_entry_get_rw( op, &op->o_req_ndn, NULL, NULL, 0, &entry );
+	op->o_bd->bd_info	= (BackendInfo *)bd_info;
+	pwdshadow_stats_inc(pwdshadow_stats_shard(ps, op), PWDSHADOW_STAT_FETCHES);
+	if ( rc != LDAP_SUCCESS )
+		return(SLAP_CB_CONTINUE);
+
+	// stored values are compared by the backend
+	if ((attr_find(entry->e_attrs, ad)))
+	{
+		op->o_bd->bd_info = (BackendInfo *)on->on_info;
+		be_entry_release_r( op, entry );
+		op->o_bd->bd_info = (BackendInfo *)bd_info;
+		return(SLAP_CB_CONTINUE);
+	};
+
+	// generate value and compare with assertion
+	pwdshadow_virtual_eval(op, cf, &st, entry);
+	if (!(access_allowed(op, entry, ad, &op->orc_ava->aa_value, ACL_COMPARE, NULL)))
+		rs->sr_err = LDAP_INSUFFICIENT_ACCESS;
+	else if (!(pwdshadow_flg_willexist(&st, ha->ha_slot)))
+		rs->sr_err = LDAP_NO_SUCH_ATTRIBUTE;
+	else if (pwdshadow_parse_int(&op->orc_ava->aa_value, &val) != 0)
+		rs->sr_err = LDAP_COMPARE_FALSE;
+	else
+		rs->sr_err = (val == (int64_t)st.st_post[ha->ha_slot]) ? LDAP_COMPARE_TRUE : LDAP_COMPARE_FALSE;
+
+	// release entry
+	op->o_bd->bd_info = (BackendInfo *)on->on_info;
+	be_entry_release_r( op, entry );
+	op->o_bd->bd_info = (BackendInfo *)bd_info;
+
+	send_ldap_result(op, rs);
+	return(rs->sr_err);
+}
+
+
+int
+pwdshadow_op_delete(
+		Operation *					op,
+		SlapReply *					rs )
+{
+	slap_overinst *			on;
+	pwdshadow_t *			ps;
+	pwdshadow_cfg_t *		cf;
+
+	on					= (slap_overinst *)op->o_bd->bd_info;
+	ps					= on->on_bi.bi_private;
+	cf					= pwdshadow_cfg_get(ps);
+
+	// invalidate cached policy if entry is a password policy
+	pwdshadow_policy_watch(op, ps, cf);
+
+	// remove cached entry
+	pwdshadow_tuple_watch(op, ps, cf);
+	pwdshadow_expiry_watch(op, ps, cf);
+
+	if (!(rs))
+		return(SLAP_CB_CONTINUE);
+
+	return(SLAP_CB_CONTINUE);
+}
+
+
+int
+pwdshadow_op_modify(
+		Operation *					op,
+		SlapReply *					rs )
+{
+	int						rc;
+	uint64_t				start;
+	slap_overinst *			on;
+	pwdshadow_t *			ps;
+	Modifications *			mods;
+	Modifications **		next;
+	Entry *					entry;
+	BackendInfo *			bd_info;
+	BerVarray				vals;
+	slap_callback *			sc;
+	pwdshadow_hash_t *		ha;
+	pwdshadow_mods_t *		mb;
+	pwdshadow_stats_t *		sx;
+	pwdshadow_state_t		st;
+
+	// initialize state
+	on					= (slap_overinst *)op->o_bd->bd_info;
+	ps					= on->on_bi.bi_private;
+	pwdshadow_state_initialize(&st, pwdshadow_cfg_get(ps));
+	pwdshadow_probe1(op__modify__entry, op->o_req_ndn.bv_val);
+
+	// invalidate cached policy if entry is a password policy
+	pwdshadow_policy_watch(op, ps, st.st_cfg);
+
+	// remove cached entry and cached entries with the modified keys
+	pwdshadow_tuple_watch(op, ps, st.st_cfg);
+	pwdshadow_expiry_watch(op, ps, st.st_cfg);
+
+	// skip modifications generated by regeneration
+	for(sc = op->o_callback; ((sc)); sc = sc->sc_next)
+	{
+		if (sc->sc_response == pwdshadow_regen_response)
+		{
+			pwdshadow_probe2(op__modify__return, op->o_req_ndn.bv_val, 0);
+			return(SLAP_CB_CONTINUE);
+		};
+	};
+
+	sx = pwdshadow_stats_shard(ps, op);
+	pwdshadow_stats_inc(sx, PWDSHADOW_STAT_MODIFIES);
+
+	// generated attributes are not stored in virtual mode
+	if (st.st_cfg->cf_mode == PWDSHADOW_MODE_VIRTUAL)
+	{
+		pwdshadow_probe2(op__modify__return, op->o_req_ndn.bv_val, 0);
+		return(SLAP_CB_CONTINUE);
+	};
+
+	// replicated modifications contain the attributes generated by the provider
+	if ( ((st.st_cfg->cf_trust_replication)) && ((be_shadow_update(op))) )
+	{
+		pwdshadow_stats_inc(sx, PWDSHADOW_STAT_REPLICATED);
+		pwdshadow_probe2(op__modify__return, op->o_req_ndn.bv_val, 0);
+		return(SLAP_CB_CONTINUE);
+	};
+
+	// skip entry retrieval if no modification affects tracked attributes
+	for(mods = op->orm_modlist; ((mods)); mods = mods->sml_next)
+		if ( ((ha = pwdshadow_slot_find(st.st_cfg, mods->sml_desc)) != NULL) && ((ha->ha_scan & PWDSHADOW_SCAN_MODLIST)) )
+			break;
+	if (!(mods))
+	{
+		pwdshadow_stats_inc(sx, PWDSHADOW_STAT_SKIPPED);
+		pwdshadow_probe2(op__modify__return, op->o_req_ndn.bv_val, 0);
+		return(SLAP_CB_CONTINUE);
+	};
+
+	// retrieve entry from backend
+	start				= pwdshadow_stats_clock(ps);
+	bd_info				= op->o_bd->bd_info;
+	op->o_bd->bd_info	= (BackendInfo *)on->on_info;
+	rc					= be_entry_get_rw( op, &op->o_req_ndn, NULL, NULL, 0, &entry );
+	op->o_bd->bd_info	= (BackendInfo *)bd_info;
+	pwdshadow_stats_inc(sx, PWDSHADOW_STAT_FETCHES);
+	if ( rc != LDAP_SUCCESS )
+	{
+		pwdshadow_probe2(op__modify__return, op->o_req_ndn.bv_val, 0);
+		return(SLAP_CB_CONTINUE);
+	};
+
+	// determines existing attribtues
+	pwdshadow_get_attrs(&st, entry, PWDSHADOW_FLG_EXISTS);
+
+	// release entry
+	op->o_bd->bd_info = (BackendInfo *)on->on_info;
+	be_entry_release_r( op, entry );
+	op->o_bd->bd_info = (BackendInfo *)bd_info;
+	st.st_ndn = op->o_req_ndn;
+	pwdshadow_stats_latency(sx, PWDSHADOW_PHASE_FETCH, start);
+
+	// scan modifications for attributes of interest
+	for(next = &op->orm_modlist; ((*next)); next = &(*next)->sml_next)
+	{
+		mods = *next;
+
+		// dates are derived from the timestamp of the operation
+		if (mods->sml_desc == ad_modifyTimestamp)
+			pwdshadow_op_timestamp(op, &st, ((mods->sml_nvalues)) ? mods->sml_nvalues : mods->sml_values);
+
+		// resolve attribute to state slot, overrides are filtered by pwdshadow_state_build()
+		if ((ha = pwdshadow_slot_find(st.st_cfg, mods->sml_desc)) == NULL)
+			continue;
+		if (!(ha->ha_scan & PWDSHADOW_SCAN_MODLIST))
+			continue;
+		pwdshadow_get_mods(mods, &st, ha->ha_slot);
+
+		if (ha->ha_slot == PWDSHADOW_SL_policySubentry)
+		{
+			if ((pwdshadow_flg_userdel(&st, PWDSHADOW_SL_policySubentry)))
+			{
+				st.st_policy.bv_len = 0;
+				st.st_policy.bv_val = NULL;
+			};
+			if ((pwdshadow_flg_useradd(&st, PWDSHADOW_SL_policySubentry)))
+			{
+				vals = ((mods->sml_nvalues)) ? mods->sml_nvalues : mods->sml_values;
+				st.st_policy.bv_len = vals[0].bv_len;
+				st.st_policy.bv_val = vals[0].bv_val;
+			};
+		};
+	};
+
+	// evaluate attributes for changes
+	start = pwdshadow_stats_clock(ps);
+	pwdshadow_eval(op, &st);
+	pwdshadow_stats_latency(sx, PWDSHADOW_PHASE_EVAL, start);
+
+	// processing pwdShadowLastChange
+	start = pwdshadow_stats_clock(ps);
+	mb = pwdshadow_mods_alloc(op);
+	pwdshadow_op_modify_mods(sx, mb, &st, &next);
+	pwdshadow_stats_latency(sx, PWDSHADOW_PHASE_MODS, start);
+	pwdshadow_probe2(op__modify__return, op->o_req_ndn.bv_val, mb->mb_count);
+
+	// unlink generated modifications when the operation completes
+	if (!(mb->mb_count))
+	{
+		op->o_tmpfree(mb, op->o_tmpmemctx);
+		return(SLAP_CB_CONTINUE);
+	};
+	mb->mb_cb.sc_next	= op->o_callback;
+	op->o_callback		= &mb->mb_cb;
+
+	if (!(rs))
+		return(SLAP_CB_CONTINUE);
+
+	return(SLAP_CB_CONTINUE);
+}
+
+
+int
+pwdshadow_op_modify_mods(
+		pwdshadow_stats_t *			sx,
+		pwdshadow_mods_t *			mb,
+		pwdshadow_state_t *			st,
+		Modifications ***			nextp )
+{
+	int						idx;
+	int						slot;
+	uint32_t				pending;
+	AttributeDescription *	ad;
+	Modifications *			mods;
+
+	// generated attributes changed by evaluation and not modified by the
+	// user, in order of slot
+	pending = (st->st_evaladd | st->st_evaldel) & ~(st->st_useradd | st->st_userdel) & PWDSHADOW_SL_GENERATED;
+	for( ; ((pending)); pending &= pending - 1)
+	{
+		slot = __builtin_ctz(pending);
+		if ((ad = st->st_cfg->cf_ads[slot]) == NULL)
+			continue;
+
+		// create initial modification
+		idx  = mb->mb_count;
+		mods = &mb->mb_mods[idx];
+		mods->sml_op				= LDAP_MOD_DELETE;
+		mods->sml_flags				= SLAP_MOD_INTERNAL;
+		mods->sml_type.bv_val		= NULL;
+		mods->sml_desc				= ad;
+		mods->sml_numvals			= 0;
+		mods->sml_values			= NULL;
+		mods->sml_nvalues			= NULL;
+		mods->sml_next				= NULL;
+		**nextp						= mods;
+		(*nextp)					= &mods->sml_next;
+		mb->mb_count++;
+
+		// continue if deleting attribute
+		if ((pwdshadow_flg_evaldel(st, slot)))
+		{
+			pwdshadow_stats_mod(sx, slot, LDAP_MOD_DELETE);
+			pwdshadow_probe4(mod, st->st_ndn.bv_val, ad->ad_cname.bv_val, LDAP_MOD_DELETE, 0);
+			continue;
+		};
+
+		// complete modifications for adding/updating value
+		mods->sml_op				= LDAP_MOD_REPLACE;
+		mods->sml_numvals			= 1;
+		mods->sml_values			= mb->mb_vals[idx];
+		mods->sml_values[0].bv_val	= mb->mb_buff[idx];
+		mods->sml_values[0].bv_len	= pwdshadow_int2str(st->st_post[slot], mods->sml_values[0].bv_val);
+		mods->sml_values[1].bv_val	= NULL;
+		mods->sml_values[1].bv_len	= 0;
+		pwdshadow_stats_mod(sx, slot, LDAP_MOD_REPLACE);
+		pwdshadow_probe4(mod, st->st_ndn.bv_val, ad->ad_cname.bv_val, LDAP_MOD_REPLACE, st->st_post[slot]);
+	};
+
+	return(0);
+}
+
+
+int
+pwdshadow_op_modrdn(
+		Operation *					op,
+		SlapReply *					rs )
+{
+	slap_overinst *			on;
+	pwdshadow_t *			ps;
+	pwdshadow_cfg_t *		cf;
+	slap_callback *			sc;
+
+	on					= (slap_overinst *)op->o_bd->bd_info;
+	ps					= on->on_bi.bi_private;
+	cf					= pwdshadow_cfg_get(ps);
+
+	// invalidate cached policy if entry is a password policy
+	pwdshadow_policy_watch(op, ps, cf);
+
+	// expire cached entries, which may be within the renamed subtree
+	pwdshadow_tuple_watch(op, ps, cf);
+	pwdshadow_expiry_watch(op, ps, cf);
+
+	// recompute entries moved between subtrees assigned different policies
+	// after the backend has applied the change
+	if ( ((cf->cf_subtree)) && ((cf->cf_use_policies)) && (cf->cf_mode == PWDSHADOW_MODE_STORED) &&
+	     ( (!(cf->cf_trust_replication)) || (!(be_shadow_update(op))) ) )
+	{
+		sc					= op->o_tmpcalloc(1, sizeof(slap_callback), op->o_tmpmemctx);
+		sc->sc_response		= pwdshadow_subtree_response;
+		sc->sc_cleanup		= pwdshadow_callback_cleanup;
+		sc->sc_private		= ps;
+		sc->sc_next			= op->o_callback;
+		op->o_callback		= sc;
+	};
+
+	if (!(rs))
+		return(SLAP_CB_CONTINUE);
+
+	return(SLAP_CB_CONTINUE);
+}
+
+
+int
+pwdshadow_op_search(
+		Operation *					op,
+		SlapReply *					rs )
+{
+	int						rc;
+	slap_overinst *			on;
+	pwdshadow_t *			ps;
+	pwdshadow_cfg_t *		cf;
+	pwdshadow_filter_t *	fl;
+	Filter *				f;
+
+	on					= (slap_overinst *)op->o_bd->bd_info;
+	ps					= on->on_bi.bi_private;
+	cf					= pwdshadow_cfg_get(ps);
+
+	// answer searches by key from cached entries, the snapshot is held
+	// across the search of the backend which loads an entry into the cache
+	if ((cf->cf_tuple_ad))
+	{
+		cf = pwdshadow_cfg_hold(ps);
+		rc = pwdshadow_tuple_search(op, rs, ps, cf);
+		pwdshadow_cfg_release(cf);
+		if (rc != SLAP_CB_CONTINUE)
+			return(rc);
+		cf = pwdshadow_cfg_get(ps);
+	};
+
+	// only stored values of aliased attributes can be matched by filters
+	if ( (!(cf->cf_alias)) || (cf->cf_mode != PWDSHADOW_MODE_STORED) || (!(op->ors_filter)) )
+		return(SLAP_CB_CONTINUE);
+
+	if (!(pwdshadow_filter_rewrite(NULL, cf, op->ors_filter)))
+		return(SLAP_CB_CONTINUE);
+
+	// rewrite a copy of the filter, the original is restored when the
+	// operation completes
+	f = filter_dup(op->ors_filter, op->o_tmpmemctx);
+	pwdshadow_filter_rewrite(op, cf, f);
+
+	fl						= op->o_tmpcalloc(1, sizeof(pwdshadow_filter_t), op->o_tmpmemctx);
+	fl->fl_cb.sc_cleanup	= pwdshadow_filter_cleanup;
+	fl->fl_cb.sc_private	= fl;
+	fl->fl_cb.sc_next		= op->o_callback;
+	fl->fl_filter			= op->ors_filter;
+	fl->fl_filterstr		= op->ors_filterstr;
+	op->o_callback			= &fl->fl_cb;
+	op->ors_filter			= f;
+	filter2bv_x(op, op->ors_filter, &op->ors_filterstr);
+
+	if (!(rs))
+		return(SLAP_CB_CONTINUE);
+
+	return(SLAP_CB_CONTINUE);
+}
+
+
+int
+pwdshadow_op_timestamp(
+		Operation *					op,
+		pwdshadow_state_t *			st,
+		BerValue *					vals )
+{
+	int64_t					days;
+
+	// the modifyTimestamp of an operation is replicated unchanged, which
+	// allows every server to derive the same dates across midnight
+	if ( ((vals)) && ((vals[0].bv_val)) && (pwdshadow_parse_time(&vals[0], &days) == 0) )
+	{
+		st->st_today = (int)days;
+		return(0);
+	};
+
+	st->st_today = (int)(op->o_time / 86400);
+
+	return(0);
+}
+
+
+int
+pwdshadow_operational(
+		Operation *					op,
+		SlapReply *					rs )
+{
+	int						idx;
+	slap_overinst *			on;
+	pwdshadow_t *			ps;
+	pwdshadow_cfg_t *		cf;
+	const pwdshadow_rule_t *	ru;
+	uint32_t				wanted;
+	uint32_t				values;
+	uint32_t				virtual;
+	Attribute **			ap;
+	Entry *					entry;
+	pwdshadow_state_t		st;
+
+	on					= (slap_overinst *)op->o_bd->bd_info;
+	ps					= on->on_bi.bi_private;
+	cf					= pwdshadow_cfg_get(ps);
+	entry				= rs->sr_entry;
+
+	if ( (!(entry)) || ( (cf->cf_mode != PWDSHADOW_MODE_VIRTUAL) && (!(cf->cf_alias)) ) )
+		return(SLAP_CB_CONTINUE);
+
+	// skip evaluation unless a generated or aliased attribute was requested
+	for(idx = 0, wanted = 0; ((pwdshadow_slots[idx].sl_ad)); idx++)
+	{
+		if (!(cf->cf_ads[idx]))
+			continue;
+		if ( (cf->cf_mode == PWDSHADOW_MODE_VIRTUAL) && ((pwdshadow_slots[idx].sl_scan & PWDSHADOW_SCAN_VIRTUAL)) )
+			if ( ((SLAP_OPATTRS(rs->sr_attr_flags))) || ((ad_inlist(cf->cf_ads[idx], rs->sr_attrs))) )
+				wanted |= pwdshadow_bit(idx);
+		if ( ((cf->cf_alias)) && ((pwdshadow_slots[idx].sl_scan & PWDSHADOW_SCAN_OVERRIDE)) )
+			if ( ((SLAP_USERATTRS(rs->sr_attr_flags))) || ((ad_inlist(cf->cf_ads[idx], rs->sr_attrs))) )
+				wanted |= pwdshadow_bit(idx);
+	};
+	if (!(wanted))
+		return(SLAP_CB_CONTINUE);
+
+	// stored attributes are read from the entry without evaluation
+	if (cf->cf_mode == PWDSHADOW_MODE_VIRTUAL)
+	{
+		pwdshadow_virtual_eval(op, cf, &st, entry);
+	} else {
+		pwdshadow_state_initialize(&st, cf);
+		pwdshadow_get_attrs(&st, entry, PWDSHADOW_FLG_EXISTS);
+	};
+	values = pwdshadow_willexist(&st);
+
+	for(ap = &rs->sr_operational_attrs; ((*ap)); ap = &(*ap)->a_next);
+
+	// append generated attributes which are not stored in the entry
+	virtual = values & ~st.st_exists & wanted;
+	for(idx = 0; ((pwdshadow_slots[idx].sl_ad)); idx++)
+	{
+		if (!(virtual & pwdshadow_bit(idx)))
+			continue;
+		ap = pwdshadow_operational_append(ap, cf->cf_ads[idx], st.st_post[idx]);
+	};
+
+	// append shadow attributes using the values of the generated attributes,
+	// stored shadow attributes are returned unless the generated value wins
+	for(idx = 0; idx < PWDSHADOW_RULES; idx++)
+	{
+		ru = &pwdshadow_rules[idx];
+		if ( (!(wanted & pwdshadow_bit(ru->ru_override))) || (!(values & pwdshadow_bit(ru->ru_slot))) )
+			continue;
+		if ((st.st_exists & pwdshadow_bit(ru->ru_override)))
+		{
+			if ( ((cf->cf_overrides)) || (st.st_post[ru->ru_override] == st.st_post[ru->ru_slot]) )
+				continue;
+			// entry is only copied when a stored value is replaced
+			rs_entry2modifiable(op, rs, on);
+			attr_delete(&rs->sr_entry->e_attrs, cf->cf_ads[ru->ru_override]);
+		};
+		ap = pwdshadow_operational_append(ap, cf->cf_ads[ru->ru_override], st.st_post[ru->ru_slot]);
+	};
+
+	return(SLAP_CB_CONTINUE);
+}
+
+
+Attribute **
+pwdshadow_operational_append(
+		Attribute **				ap,
+		AttributeDescription *		ad,
+		int							val )
+{
+	Attribute *				a;
+
+	a				= attr_alloc(ad);
+	a->a_vals		= ch_calloc(2, sizeof(struct berval));
+	pwdshadow_copy_int_bv(val, &a->a_vals[0]);
+	a->a_nvals		= a->a_vals;
+	a->a_numvals	= 1;
+	*ap				= a;
+
+	return(&a->a_next);
+}
+
+
+// parses Integer syntax value (-?[0-9]+) into 64-bit integer, returns -1 on
+// malformed or out of range values
+int
+pwdshadow_parse_int(
+		BerValue *					bv,
+		int64_t *					valp )
+{
+	ber_len_t		pos;
+	uint64_t		val;
+	uint64_t		max;
+	unsigned		d;
+	int				neg;
+
+	if ( (!(bv)) || (!(bv->bv_val)) || (!(bv->bv_len)) )
+		return(-1);
+
+	neg		= (bv->bv_val[0] == '-') ? 1 : 0;
+	pos		= (ber_len_t)neg;
+	max		= ((neg)) ? ((uint64_t)INT64_MAX + 1) : (uint64_t)INT64_MAX;
+	if (pos == bv->bv_len)
+		return(-1);
+
+	for(val = 0; pos < bv->bv_len; pos++)
+	{
+		d = (unsigned)(unsigned char)bv->bv_val[pos] - '0';
+		if (d > 9)
+			return(-1);
+		if (val > ((max - d) / 10))
+			return(-1);
+		val = (val * 10) + d;
+	};
+
+	*valp = ((neg)) ? (int64_t)(0 - val) : (int64_t)val;
+
+	return(0);
+}
+
+
+// converts GeneralizedTime value to days since epoch, values not in the
+// normalized form are passed to the general parser of liblutil
+int
+pwdshadow_parse_time(
+		BerValue *					bv,
+		int64_t *					daysp )
+{
+	struct lutil_tm			tm;
+	struct lutil_timet		tt;
+
+	if (pwdshadow_parse_time_fast(bv, daysp) == 0)
+		return(0);
+
+	if (lutil_parsetime(bv->bv_val, &tm) != 0)
+		return(-1);
+	lutil_tm2time(&tm, &tt);
+	*daysp = (int64_t)tt.tt_sec / (60 * 60 * 24);
+
+	return(0);
+}
+
+
+// converts GeneralizedTime in the normalized form YYYYmmddHHMMSSZ written
+// by ppolicy to days since epoch, returns -1 for any other form
+int
+pwdshadow_parse_time_fast(
+		BerValue *					bv,
+		int64_t *					daysp )
+{
+	int						idx;
+	unsigned				bad;
+	unsigned				d[14];
+	int64_t					year;
+	int64_t					mon;
+	int64_t					mday;
+	int64_t					era;
+	int64_t					yoe;
+	int64_t					doy;
+	int64_t					doe;
+	static const unsigned	mdays[13] = { 0, 31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+
+	if ( (bv->bv_len != 15) || (bv->bv_val[14] != 'Z') )
+		return(-1);
+
+	// validate all digits before branching on any field
+	for(idx = 0, bad = 0; idx < 14; idx++)
+	{
+		d[idx]	= (unsigned)(unsigned char)bv->bv_val[idx] - '0';
+		bad    |= d[idx] > 9;
+	};
+	year	= (int64_t)(d[0] * 1000 + d[1] * 100 + d[2] * 10 + d[3]);
+	mon		= (int64_t)(d[4] * 10 + d[5]);
+	mday	= (int64_t)(d[6] * 10 + d[7]);
+	bad    |= ((d[8]  * 10 + d[9])  > 23);
+	bad    |= ((d[10] * 10 + d[11]) > 59);
+	bad    |= ((d[12] * 10 + d[13]) > 59);		// leap seconds use the general parser
+	if ( ((bad)) || (mon < 1) || (mon > 12) || (mday < 1) || (mday > (int64_t)mdays[mon]) )
+		return(-1);
+	if ( (mon == 2) && (mday == 29) && ( ((year % 4)) || ( (!(year % 100)) && ((year % 400)) ) ) )
+		return(-1);
+
+	// days from civil date in the proleptic Gregorian calendar
+	year   -= (mon <= 2) ? 1 : 0;
+	era		= ((year >= 0) ? year : year - 399) / 400;
+	yoe		= year - era * 400;
+	doy		= (153 * (mon + ((mon > 2) ? -3 : 9)) + 2) / 5 + mday - 1;
+	doe		= yoe * 365 + yoe / 4 - yoe / 100 + doy;
+	*daysp	= era * 146097 + doe - 719468;
+
+	return(0);
+}
+
+
+int
+pwdshadow_policy_cmp(
+		const void *				a,
+		const void *				b )
+{
+	const pwdshadow_policy_t *	pa;
+	const pwdshadow_policy_t *	pb;
+
+	pa = a;
+	pb = b;
+
+	if (pa->pp_ndn.bv_len != pb->pp_ndn.bv_len)
+		return( (pa->pp_ndn.bv_len < pb->pp_ndn.bv_len) ? -1 : 1 );
+
+	return(memcmp(pa->pp_ndn.bv_val, pb->pp_ndn.bv_val, pa->pp_ndn.bv_len));
+}
+
+
+void
+pwdshadow_policy_free(
+		void *						ptr )
+{
+	pwdshadow_policy_t *	pp;
+
+	if (!(pp = ptr))
+		return;
+
+	// nodes still referenced by another thread are freed by the last
+	// thread to release the node
+	if ( ((pp->pp_refcnt)) || ((pp->pp_flags & PWDSHADOW_POLICY_LOADING)) )
+	{
+		pp->pp_flags |= PWDSHADOW_POLICY_STALE;
+		return;
+	};
+
+	ch_free(pp);
+
+	return;
+}
+
+
+int
+pwdshadow_policy_get(
+		Operation *					op,
+		pwdshadow_t *				ps,
+		pwdshadow_cfg_t *			cf,
+		struct berval *				ndn,
+		pwdshadow_policy_t *		pp )
+{
+	int						rc;
+	pwdshadow_policy_t		key;
+	pwdshadow_policy_t *	node;
+
+	// bypass cache if disabled by the configuration
+	if (cf->cf_cache_ttl < 1)
+	{
+		pwdshadow_policy_load(op, cf, ndn, pp);
+		return( ((pp->pp_flags & PWDSHADOW_POLICY_EXISTS)) ? 0 : -1 );
+	};
+
+	key.pp_ndn = *ndn;
+
+	// return unexpired policy while sharing the cache with other readers
+	ldap_pvt_thread_rdwr_rlock(&ps->ps_cache_rwlock);
+	node = ldap_avl_find(ps->ps_cache, &key, pwdshadow_policy_cmp);
+	if ( ((node)) && (!(node->pp_flags & PWDSHADOW_POLICY_LOADING)) && (node->pp_expires > op->o_time) )
+	{
+		*pp = *node;
+		pp->pp_flags |= PWDSHADOW_POLICY_CACHED;
+		ldap_pvt_thread_rdwr_runlock(&ps->ps_cache_rwlock);
+		return( ((pp->pp_flags & PWDSHADOW_POLICY_EXISTS)) ? 0 : -1 );
+	};
+	ldap_pvt_thread_rdwr_runlock(&ps->ps_cache_rwlock);
+
+	ldap_pvt_thread_rdwr_wlock(&ps->ps_cache_rwlock);
+
+	// search cache for policy
+	if ((node = ldap_avl_find(ps->ps_cache, &key, pwdshadow_policy_cmp)) != NULL)
+	{
+		// wait for another thread to finish loading policy, the flag is
+		// checked while holding the mutex so the broadcast is not missed
+		if ((node->pp_flags & PWDSHADOW_POLICY_LOADING))
+		{
+			node->pp_refcnt++;
+			ldap_pvt_thread_rdwr_wunlock(&ps->ps_cache_rwlock);
+			ldap_pvt_thread_mutex_lock(&ps->ps_cache_mutex);
+			for(rc = 1; ((rc)); )
+			{
+				ldap_pvt_thread_rdwr_rlock(&ps->ps_cache_rwlock);
+				rc = node->pp_flags & PWDSHADOW_POLICY_LOADING;
+				ldap_pvt_thread_rdwr_runlock(&ps->ps_cache_rwlock);
+				if ((rc))
+					ldap_pvt_thread_cond_wait(&ps->ps_cache_cond, &ps->ps_cache_mutex);
+			};
+			ldap_pvt_thread_mutex_unlock(&ps->ps_cache_mutex);
+			ldap_pvt_thread_rdwr_wlock(&ps->ps_cache_rwlock);
+			node->pp_refcnt--;
+			*pp = *node;
+			pp->pp_flags |= PWDSHADOW_POLICY_CACHED;
+			if ( (!(node->pp_refcnt)) && ((node->pp_flags & PWDSHADOW_POLICY_STALE)) )
+				ch_free(node);
+			ldap_pvt_thread_rdwr_wunlock(&ps->ps_cache_rwlock);
+			return( ((pp->pp_flags & PWDSHADOW_POLICY_EXISTS)) ? 0 : -1 );
+		};
+
+		// return policy refreshed by another thread
+		if (node->pp_expires > op->o_time)
+		{
+			*pp = *node;
+			pp->pp_flags |= PWDSHADOW_POLICY_CACHED;
+			ldap_pvt_thread_rdwr_wunlock(&ps->ps_cache_rwlock);
+			return( ((pp->pp_flags & PWDSHADOW_POLICY_EXISTS)) ? 0 : -1 );
+		};
+
+		// remove expired policy
+		ldap_avl_delete(&ps->ps_cache, node, pwdshadow_policy_cmp);
+		ps->ps_cache_count--;
+		pwdshadow_policy_free(node);
+	};
+
+	// add placeholder so concurrent lookups wait on this thread
+	node = NULL;
+	if (ps->ps_cache_count < PWDSHADOW_CACHE_MAX)
+	{
+		node = ch_calloc(1, sizeof(pwdshadow_policy_t) + ndn->bv_len + 1);
+		node->pp_ndn.bv_val	= (char *)&node[1];
+		node->pp_ndn.bv_len	= ndn->bv_len;
+		node->pp_flags		= PWDSHADOW_POLICY_LOADING;
+		memcpy(node->pp_ndn.bv_val, ndn->bv_val, ndn->bv_len);
+		ldap_avl_insert(&ps->ps_cache, node, pwdshadow_policy_cmp, ldap_avl_dup_error);
+		ps->ps_cache_count++;
+	};
+
+	ldap_pvt_thread_rdwr_wunlock(&ps->ps_cache_rwlock);
+
+	// retrieve policy from backend
+	pwdshadow_policy_load(op, cf, ndn, pp);
+	rc = ((pp->pp_flags & PWDSHADOW_POLICY_EXISTS)) ? 0 : -1;
+
+	if (!(node))
+		return(rc);
+
+	// store policy and wake waiting threads
+	ldap_pvt_thread_rdwr_wlock(&ps->ps_cache_rwlock);
+	node->pp_flags					= (node->pp_flags & PWDSHADOW_POLICY_STALE) | pp->pp_flags;
+	node->pp_expires				= op->o_time + cf->cf_cache_ttl;
+	node->pp_exists					= pp->pp_exists;
+	node->pp_pwdExpireWarning		= pp->pp_pwdExpireWarning;
+	node->pp_pwdGraceExpiry			= pp->pp_pwdGraceExpiry;
+	node->pp_pwdMaxAge				= pp->pp_pwdMaxAge;
+	node->pp_pwdMinAge				= pp->pp_pwdMinAge;
+	node->pp_pwdShadowAutoExpire	= pp->pp_pwdShadowAutoExpire;
+	if ( (!(node->pp_refcnt)) && ((node->pp_flags & PWDSHADOW_POLICY_STALE)) )
+		ch_free(node);
+	ldap_pvt_thread_rdwr_wunlock(&ps->ps_cache_rwlock);
+	ldap_pvt_thread_mutex_lock(&ps->ps_cache_mutex);
+	ldap_pvt_thread_cond_broadcast(&ps->ps_cache_cond);
+	ldap_pvt_thread_mutex_unlock(&ps->ps_cache_mutex);
+
+	return(rc);
+}
+
+
+int
+pwdshadow_policy_invalidate(
+		pwdshadow_t *				ps,
+		struct berval *				ndn )
+{
+	pwdshadow_policy_t		key;
+	pwdshadow_policy_t *	node;
+
+	key.pp_ndn = *ndn;
+
+	ldap_pvt_thread_rdwr_wlock(&ps->ps_cache_rwlock);
+	if ((node = ldap_avl_delete(&ps->ps_cache, &key, pwdshadow_policy_cmp)) != NULL)
+	{
+		ps->ps_cache_count--;
+		pwdshadow_policy_free(node);
+	};
+	ldap_pvt_thread_rdwr_wunlock(&ps->ps_cache_rwlock);
+
+	return(0);
+}
+
+
+int
+pwdshadow_policy_load(
+		Operation *					op,
+		pwdshadow_cfg_t *			cf,
+		struct berval *				ndn,
+		pwdshadow_policy_t *		pp )
+{
+	int					rc;
+	BackendDB *			bd_orig;
+	Entry *				entry;
+	struct berval		save_dn;
+	struct berval		save_ndn;
+	pwdshadow_state_t	st;
+
+	memset(pp, 0, sizeof(pwdshadow_policy_t));
+	st = cf->cf_template;
+
+	bd_orig		= op->o_bd;
+	entry		= NULL;
+	save_dn		= op->o_dn;
+	save_ndn	= op->o_ndn;
+
+	// retrieve policy entry as the rootdn of the policy's database
+	if ((op->o_bd = select_backend(ndn, 0)) != NULL)
+	{
+		op->o_dn 	= op->o_bd->be_rootdn;
+		op->o_ndn	= op->o_bd->be_rootndn;
+		rc			= be_entry_get_rw(op, ndn, NULL, NULL, 0, &entry);
+		entry		= ((rc)) ? NULL : entry;
+	};
+	op->o_bd	= bd_orig;
+
+	// exit if a policy was not retreived
+	if ((entry))
+	{
+		pp->pp_flags |= PWDSHADOW_POLICY_EXISTS;
+
+		// retrieve password policy attributes
+		pwdshadow_scan_attrs(&st, entry->e_attrs, PWDSHADOW_SCAN_POLICY, PWDSHADOW_FLG_EXISTS);
+	};
+	pp->pp_exists				= st.st_exists & PWDSHADOW_SL_POLICY;
+	pp->pp_pwdExpireWarning		= st.st_post[PWDSHADOW_SL_pwdExpireWarning];
+	pp->pp_pwdGraceExpiry		= st.st_post[PWDSHADOW_SL_pwdGraceExpiry];
+	pp->pp_pwdMaxAge			= st.st_post[PWDSHADOW_SL_pwdMaxAge];
+	pp->pp_pwdMinAge			= st.st_post[PWDSHADOW_SL_pwdMinAge];
+	pp->pp_pwdShadowAutoExpire	= st.st_post[PWDSHADOW_SL_pwdShadowAutoExpire];
+
+	// exit if a policy was not retreived
+	if (!(entry))
+	{
+		op->o_dn	= save_dn;
+		op->o_ndn	= save_ndn;
+		return(0);
+	};
+
+	// release entry
+	be_entry_release_r(op, entry);
+	op->o_dn	= save_dn;
+	op->o_ndn	= save_ndn;
+
+	return(0);
+}
 
-// LDAP NIS attributes (RFC 2307)
-static AttributeDescription *		ad_shadowExpire				= NULL;
-static AttributeDescription *		ad_shadowFlag				= NULL;
-static AttributeDescription *		ad_shadowInactive			= NULL;
-static AttributeDescription *		ad_shadowLastChange			= NULL;
-static AttributeDescription *		ad_shadowMax				= NULL;
-static AttributeDescription *		ad_shadowMin				= NULL;
-static AttributeDescription *		ad_shadowWarning			= NULL;
 
-// User Schema (RFC 2256)
-static AttributeDescription *		ad_userPassword				= NULL;
+int
+pwdshadow_policy_response(
+		Operation *					op,
+		SlapReply *					rs )
+{
+	pwdshadow_t *		ps;
+	pwdshadow_cfg_t *	cf;
 
-// user objectClasses
-static ObjectClass *				oc_pwdShadowPolicy			= NULL;
+	ps = op->o_callback->sc_private;
 
+	if (rs->sr_type != REP_RESULT)
+		return(SLAP_CB_CONTINUE);
 
-// # OID Base is iso(1) org(3) dod(6) internet(1) private(4) enterprise(1)
-//	dms(27893) software(4) slapo-pwdshadow(2).
-//	i.e. slapo-pwdshadow is 1.3.6.1.4.1.27893.4.2
-//
-//	LDAP operational attribute types are under 1.3.6.1.4.1.27893.4.2.1
-//	LDAP user attribute types are under 1.3.6.1.4.1.27893.4.2.2
-//	LDAP object classes are under 1.3.6.1.4.1.27893.4.2.3
-//	Configuration attribute types are under 1.3.6.1.4.1.27893.4.2.4
-//	Configuration object classes are under 1.3.6.1.4.1.27893.4.2.5
+	pwdshadow_policy_invalidate(ps, &op->o_req_ndn);
 
+	// recompute entries which depend upon the changed policy
+	cf = pwdshadow_cfg_get(ps);
+	if ( (rs->sr_err == LDAP_SUCCESS) && ((cf->cf_use_policies)) && (cf->cf_mode == PWDSHADOW_MODE_STORED) )
+		if ( (!(cf->cf_trust_replication)) || (!(be_shadow_update(op))) )
+			pwdshadow_regen_policy(ps, &op->o_req_ndn);
 
-// overlay's LDAP operational and user attributes
-static pwdshadow_at_t pwdshadow_ats[] =
+	return(SLAP_CB_CONTINUE);
+}
+
+
+int
+pwdshadow_policy_watch(
+		Operation *					op,
+		pwdshadow_t *				ps,
+		pwdshadow_cfg_t *			cf )
 {
-	{	// pwdShadowLastChange: The number of days since January 1, 1970 on
-		// which the password was last changed.  This attribute is the
-		// equivalent of 'shadowLastChange'.  The value of this attribute is
-		// set when the password is changed and is not calculated at the time
-		// of the query.
-		.def	= "( 1.3.6.1.4.1.27893.4.2.1.5"
-				" NAME ( 'pwdShadowLastChange' )"
-				" DESC 'The generated value for shadowLastChange'"
-				" EQUALITY integerMatch"
-				" ORDERING integerOrderingMatch"
-				" SYNTAX 1.3.6.1.4.1.1466.115.121.1.27"
-				" SINGLE-VALUE"
-				" NO-USER-MODIFICATION"
-				" USAGE directoryOperation )",
-		.ad		= &ad_pwdShadowLastChange
-	},
-	{	// pwdShadowMin: The minimum number of days before a password can be
-		// changed.  This attribute is the equivalent of 'shadowMin', but is
-		// derived from the value of 'pwdMinAge' in current password policy
-		// (pwdMinAge / 60 / 60 /24).
-		.def	= "( 1.3.6.1.4.1.27893.4.2.1.6"
-				" NAME ( 'pwdShadowMin' )"
-				" DESC 'shadowMin equivalent derived from pwdMinAge'"
-				" EQUALITY integerMatch"
-				" SYNTAX 1.3.6.1.4.1.1466.115.121.1.27"
-				" SINGLE-VALUE"
-				" NO-USER-MODIFICATION"
-				" USAGE directoryOperation )",
-		.ad		= &ad_pwdShadowMin
-	},
-	{	// pwdShadowMax: The maximum number of days before a password expires.
-		// This attribute is the equivalent of 'shadowMax', but is derived
-		// from the value of 'pwdMaxAge' in current password policy
-		// (pwdMaxAge / 60 / 60 /24).
-		.def	= "( 1.3.6.1.4.1.27893.4.2.1.7"
-				" NAME ( 'pwdShadowMax' )"
-				" DESC 'shadowMax equivalent derived from pwdMaxAge'"
-				" EQUALITY integerMatch"
-				" SYNTAX 1.3.6.1.4.1.1466.115.121.1.27"
-				" SINGLE-VALUE"
-				" NO-USER-MODIFICATION"
-				" USAGE directoryOperation )",
-		.ad		= &ad_pwdShadowMax
-	},
-	{	// pwdShadowWarning: The number of days before a password expires
-		// during which a user should be warned.  This attribute is the
-		// equivalent of 'shadowWarning', but is derived from the value of
-		// 'pwdExpireWarning' in current password policy (pwdExpireWarning /
-		// 60 / 60 /24).
-		.def	= "( 1.3.6.1.4.1.27893.4.2.1.8"
-				" NAME ( 'pwdShadowWarning' )"
-				" DESC 'shadowWarning equivalent derived from pwdExpireWarning'"
-				" EQUALITY integerMatch"
-				" SYNTAX 1.3.6.1.4.1.1466.115.121.1.27"
-				" SINGLE-VALUE"
-				" NO-USER-MODIFICATION"
-				" USAGE directoryOperation )",
-		.ad		= &ad_pwdShadowWarning
-	},
-	{	// pwdShadowInactive: The number of days after a password expires
-		// during which the password should still be accepted.  This attribute
-		// is the equivalent of 'shadowInactive', but is derived from the
-		// value of 'pwdGraceExpiry' in current password policy
-		// (pwdGraceExpiry / 60 / 60 /24).
-		.def	= "( 1.3.6.1.4.1.27893.4.2.1.9"
-				" NAME ( 'pwdShadowInactive' )"
-				" DESC 'shadowInactive equivalent derived from pwdGraceExpiry'"
-				" EQUALITY integerMatch"
-				" SYNTAX 1.3.6.1.4.1.1466.115.121.1.27"
-				" SINGLE-VALUE"
-				" NO-USER-MODIFICATION"
-				" USAGE directoryOperation )",
-		.ad		= &ad_pwdShadowInactive
-	},
-	{	// pwdShadowExpire: The number of days after January 1, 1970 on which
-		// the account expires. This attribute is the equivalent of
-		// 'shadowExpire', but is derived from the value of 'pwdEndTime' of
-		// the entry.
-		.def	= "( 1.3.6.1.4.1.27893.4.2.1.10"
-				" NAME ( 'pwdShadowExpire' )"
-				" DESC 'shadowExpire equivalent derived from pwdEndTime'"
-				" EQUALITY integerMatch"
-				" ORDERING integerOrderingMatch"
-				" SYNTAX 1.3.6.1.4.1.1466.115.121.1.27"
-				" SINGLE-VALUE"
-				" NO-USER-MODIFICATION"
-				" USAGE directoryOperation )",
-		.ad		= &ad_pwdShadowExpire
-	},
-	{	// pwdShadowFlag: This attribute is the equivalent of 'shadowFlag'.
-		// This attribute is not used by the overlay and is included so
-		// pwdShadowAccount is able to be used as a one for one replacement
-		// with shadowAccount.
-		.def	= "( 1.3.6.1.4.1.27893.4.2.1.11"
-				" NAME ( 'pwdShadowFlag' )"
-				" DESC 'duplicates shadowFlag'"
-				" EQUALITY integerMatch"
-				" SYNTAX 1.3.6.1.4.1.1466.115.121.1.27"
-				" SINGLE-VALUE"
-				" NO-USER-MODIFICATION"
-				" USAGE directoryOperation )",
-		.ad		= &ad_pwdShadowFlag
-	},
-	{	// pwdShadowGenerate: This attribute enables or disables the
-		// generation of shadow compatible attributes from the password policy
-		// attributes.
-		.def	= "( 1.3.6.1.4.1.27893.4.2.2.1"
-				" NAME ( 'pwdShadowGenerate' )"
-				" DESC 'generate shadowAccount equivalent attributes'"
-				" EQUALITY booleanMatch"
-				" SYNTAX 1.3.6.1.4.1.1466.115.121.1.7"
-				" SINGLE-VALUE "
-				" USAGE directoryOperation )",
-		.ad		= &ad_pwdShadowGenerate
-	},
-	{	// pwdShadowAutoExpire: This attribute, when added to the subentry
-		// specified by pwdPolicySubentry, enables the generation of
-		// 'pwdShadowExpire' from 'pwdShadowLastChange', 'pwdShadowMax', and
-		// 'pwdGraceExpiry' if neither 'shadowExpire' or 'pwdEndTime' are set
-		// on the user's entry.
-		.def	= "( 1.3.6.1.4.1.27893.4.2.2.2"
-				" NAME ( 'pwdShadowAutoExpire' )"
-				" DESC 'generate pwdShadowExpire from pwdShadow attributes'"
-				" EQUALITY booleanMatch"
-				" SYNTAX 1.3.6.1.4.1.1466.115.121.1.7"
-				" SINGLE-VALUE )",
-		.ad		= &ad_pwdShadowAutoExpire
-	},
-	{	// pwdShadowPolicySubentry: This attribute specifies the
-		// pwdShadowPolicy subentry in effect for this object.  The attribute
-		// used to specify the pwdShadowPolicy subentry in affect may be
-		// changed using either olcPwdShadowPolicyAttr attribute in the config
-		// backend or by the pwdshadow_policy_attr option in slapd.conf.
-		.def	= "( 1.3.6.1.4.1.27893.4.2.2.3"
-				" NAME ( 'pwdShadowPolicySubentry' )"
-				" DESC 'The pwdShadowPolicy subentry in effect for this object'"
-				" EQUALITY distinguishedNameMatch"
-				" SYNTAX 1.3.6.1.4.1.1466.115.121.1.12"
-				" SINGLE-VALUE "
-				" USAGE directoryOperation )",
-		.ad		= &ad_pwdShadowPolicySubentry
-	},
+	pwdshadow_policy_t		key;
+	pwdshadow_policy_t *	node;
+	slap_callback *			sc;
+	Modifications *			mods;
+	pwdshadow_hash_t *		ha;
+
+	// writes of regeneration only change generated attributes and the cursor
+	for(sc = op->o_callback; ((sc)); sc = sc->sc_next)
+		if (sc->sc_response == pwdshadow_regen_response)
+			return(0);
+
+	// watch entries which are cached as password policies
+	key.pp_ndn = op->o_req_ndn;
+	ldap_pvt_thread_rdwr_rlock(&ps->ps_cache_rwlock);
+	node = ldap_avl_find(ps->ps_cache, &key, pwdshadow_policy_cmp);
+	ldap_pvt_thread_rdwr_runlock(&ps->ps_cache_rwlock);
+
+	// watch default policy and entries with modified policy attributes
+	if ( (!(node)) && ( (!(cf->cf_def_policy.bv_val)) || (!(bvmatch(&cf->cf_def_policy, &op->o_req_ndn))) ) )
 	{
-		.def	= NULL,
-		.ad		= NULL
-	}
-};
+		if (op->o_tag != LDAP_REQ_MODIFY)
+			return(0);
+		for(mods = op->orm_modlist; ((mods)); mods = mods->sml_next)
+			if ( ((ha = pwdshadow_slot_find(cf, mods->sml_desc)) != NULL) && ((ha->ha_scan & PWDSHADOW_SCAN_POLICY)) )
+				break;
+		if (!(mods))
+			return(0);
+	};
 
+	// invalidate cached policy and recompute dependent entries after the
+	// backend has applied the change
+	sc					= op->o_tmpcalloc(1, sizeof(slap_callback), op->o_tmpmemctx);
+	sc->sc_response		= pwdshadow_policy_response;
+	sc->sc_cleanup		= pwdshadow_callback_cleanup;
+	sc->sc_private		= ps;
+	sc->sc_next			= op->o_callback;
+	op->o_callback		= sc;
 
-// overlay's LDAP user object classes
-static pwdshadow_oc_t pwdshadow_ocs[] =
+	return(0);
+}
+
+
+void *
+pwdshadow_regen_batch(
+		void *						ctx,
+		void *						arg )
 {
-	{	.def	= "( 1.3.6.1.4.1.27893.4.2.3.1"
-				" NAME 'pwdShadowPolicy'"
-				" DESC 'Attributes for controlling pwdShadow overlay'"
-				" SUP top"
-				" AUXILIARY"
-				" MAY ( pwdShadowAutoExpire ) )",
-		.oc		= &oc_pwdShadowPolicy
-    },
-	{	.def	= NULL,
-		.oc		= NULL
-	}
-};
+	int						idx;
+	int						modified;
+	int						persist;
+	ID						cursor;
+	pwdshadow_t *			ps;
+	pwdshadow_batch_t *		batch;
+	pwdshadow_batch_t *		head;
+	Connection				conn;
+	OperationBuffer			opbuf;
+	Operation *				op;
+	BackendDB				db;
+
+	batch		= arg;
+	ps			= batch->rb_ps;
+	modified	= 0;
+
+	// prepare internal operation as rootdn of the database
+	connection_fake_init2(&conn, &opbuf, ctx, 0);
+	op			= &opbuf.ob_op;
+	db			= *ps->ps_regen_be;
+	op->o_bd	= &db;
+	op->o_dn	= db.be_rootdn;
+	op->o_ndn	= db.be_rootndn;
+
+	// regenerate entries of batch
+	for(idx = 0; idx < batch->rb_count; idx++)
+	{
+		if ( (!(slapd_shutdown)) && (ps->ps_regen_state == PWDSHADOW_REGEN_RUNNING) )
+			modified += pwdshadow_regen_entry(op, ps, &batch->rb_ndn[idx]);
+		ber_memfree(batch->rb_ndn[idx].bv_val);
+	};
+
+	ldap_pvt_thread_mutex_lock(&ps->ps_regen_mutex);
+	batch->rb_done			= 1;
+	ps->ps_regen_processed	+= batch->rb_count;
+	ps->ps_regen_modified	+= modified;
+
+	// advance cursor past batches completed in entry ID order
+	cursor = 0;
+	while ( ((ps->ps_regen_head)) && ((ps->ps_regen_head->rb_done)) )
+	{
+		head				= ps->ps_regen_head;
+		ps->ps_regen_head	= head->rb_next;
+		ps->ps_regen_tail	= ((ps->ps_regen_head)) ? ps->ps_regen_tail : NULL;
+		cursor				= head->rb_last;
+		ps->ps_regen_inflight--;
+		ch_free(head);
+	};
+
+	// persist cursor of a full regeneration unless it was interrupted, the
+	// write is made without holding the mutex and a single thread writes the
+	// cursor so a later cursor is not replaced by an earlier one
+	persist = 0;
+	if ( ((cursor)) && (ps->ps_regen_state == PWDSHADOW_REGEN_RUNNING) && (!(slapd_shutdown)) )
+	{
+		ps->ps_regen_cursor = cursor;
+		if ( ((ps->ps_regen_resumable)) && (!(ps->ps_regen_persisting)) )
+			persist = ps->ps_regen_persisting = 1;
+	};
+	while((persist))
+	{
+		cursor = ps->ps_regen_cursor;
+		ldap_pvt_thread_mutex_unlock(&ps->ps_regen_mutex);
+		pwdshadow_regen_cursor(op, ps, cursor);
+		ldap_pvt_thread_mutex_lock(&ps->ps_regen_mutex);
+		persist = (ps->ps_regen_cursor != cursor) && (ps->ps_regen_state == PWDSHADOW_REGEN_RUNNING) && (!(slapd_shutdown)) && ((ps->ps_regen_resumable));
+		ps->ps_regen_persisting = persist;
+	};
+	ldap_pvt_thread_mutex_unlock(&ps->ps_regen_mutex);
+
+	return(NULL);
+}
+
+
+int
+pwdshadow_regen_collect(
+		Operation *					op,
+		SlapReply *					rs )
+{
+	pwdshadow_t *			ps;
+	pwdshadow_batch_t *		batch;
+	Entry *					entry;
+
+	ps		= op->o_callback->sc_private;
+	entry	= rs->sr_entry;
+
+	if (rs->sr_type != REP_SEARCH)
+		return(0);
+
+	// abandon search once regeneration is stopped
+	if ( ((slapd_shutdown)) || (ps->ps_regen_state != PWDSHADOW_REGEN_RUNNING) )
+	{
+		op->o_abandon = 1;
+		return(0);
+	};
+
+	// skip entries processed before regeneration was interrupted
+	if (entry->e_id <= ps->ps_regen_cursor)
+		return(0);
+
+	// add entry to batch
+	if ((batch = ps->ps_regen_fill) == NULL)
+	{
+		batch				= ch_calloc(1, sizeof(pwdshadow_batch_t));
+		batch->rb_ps		= ps;
+		ps->ps_regen_fill	= batch;
+	};
+	ber_dupbv(&batch->rb_ndn[batch->rb_count], &entry->e_nname);
+	batch->rb_last = (entry->e_id > batch->rb_last) ? entry->e_id : batch->rb_last;
+	batch->rb_count++;
+
+	// hand full batch to thread pool
+	if (batch->rb_count == PWDSHADOW_REGEN_BATCH)
+	{
+		ps->ps_regen_fill = NULL;
+		pwdshadow_regen_submit(ps, batch);
+	};
 
+	return(0);
+}
 
-// overlay's configuration attribute types
-static ConfigTable pwdshadow_cfg_ats[] =
+
+int
+pwdshadow_regen_cursor(
+		Operation *					op,
+		pwdshadow_t *				ps,
+		ID							cursor )
 {
-	{	.name		= "pwdshadow_default",
-		.what		= "policyDN",
-		.min_args	= 2,
-		.max_args	= 2,
-		.length		= 0,
-		.arg_type	= ARG_DN|ARG_QUOTE|ARG_MAGIC|PWDSHADOW_CFG_DEF_POLICY,
-		.arg_item	= pwdshadow_cfg_gen,
-		.attribute	= "( 1.3.6.1.4.1.27893.4.2.4.1"
-					" NAME 'olcPwdShadowDefault'"
-					" DESC 'DN of a pwdPolicy object for uncustomized objects'"
-					" EQUALITY distinguishedNameMatch"
-					" SYNTAX OMsDN"
-					" SINGLE-VALUE )"
-	},
-	{	.name		= "pwdshadow_overrides",
-		.what		= "on|off",
-		.min_args	= 2,
-		.max_args	= 2,
-		.length		= 0,
-		.arg_type	= ARG_ON_OFF|ARG_OFFSET,
-		.arg_item	= (void *)offsetof(pwdshadow_t,ps_overrides),
-		.attribute	= "( 1.3.6.1.4.1.27893.4.2.4.2"
-					" NAME 'olcPwdShadowOverrides'"
-					" DESC 'Allow shadow attributes to override the values of generated attribtues.'"
-					" EQUALITY booleanMatch"
-					" SYNTAX OMsBoolean"
-					" SINGLE-VALUE )"
-	},
-	{	.name		= "pwdshadow_use_policies",
-		.what		= "on|off",
-		.min_args	= 2,
-		.max_args	= 2,
-		.length		= 0,
-		.arg_type	= ARG_ON_OFF|ARG_OFFSET,
-		.arg_item	= (void *)offsetof(pwdshadow_t,ps_use_policies),
-		.attribute	= "( 1.3.6.1.4.1.27893.4.2.4.3"
-					" NAME 'olcPwdShadowUsePolicies'"
-					" DESC 'Use pwdPolicy to determine values of generated attributes'"
-					" EQUALITY booleanMatch"
-					" SYNTAX OMsBoolean"
-					" SINGLE-VALUE )"
-	},
-	{	.name		= "pwdshadow_policy_ad",
-		.what		= "pwdShadowPolicySubentry attribute",
-		.min_args	= 2,
-		.max_args	= 2,
-		.length		= 0,
-		.arg_type	= ARG_MAGIC|ARG_ATDESC|PWDSHADOW_CFG_POLICY_AD,
-		.arg_item	= pwdshadow_cfg_gen,
-		.attribute	= "( 1.3.6.1.4.1.27893.4.2.4.4"
-					" NAME 'olcPwdShadowPolicyAD'"
-					" DESC 'Use pwdPolicy to determine values of generated attributes'"
-					" EQUALITY caseIgnoreMatch"
-					" SYNTAX OMsDirectoryString"
-					" SINGLE-VALUE )"
-	},
-	{	.name		= NULL,
-		.what		= NULL,
-		.min_args	= 0,
-		.max_args	= 0,
-		.length	= 0,
-		.arg_type	= ARG_IGNORED,
-		.arg_item	= NULL,
-		.attribute	= NULL
-	}
-};
+	Operation				op2;
+	SlapReply				rs2		= { REP_RESULT };
+	slap_callback			cb;
+	Modifications			mod;
+	struct berval			vals[2];
+	char					buf[32];
+
+	if (!(ad_pwdShadowRegenCursor))
+		return(0);
+
+	// a cursor of zero removes the attribute
+	vals[0].bv_val		= buf;
+	vals[0].bv_len		= snprintf(buf, sizeof(buf), "%lu", (unsigned long)cursor);
+	BER_BVZERO(&vals[1]);
+
+	memset(&mod, 0, sizeof(mod));
+	mod.sml_op			= LDAP_MOD_REPLACE;
+	mod.sml_flags		= SLAP_MOD_INTERNAL;
+	mod.sml_desc		= ad_pwdShadowRegenCursor;
+	mod.sml_type		= ad_pwdShadowRegenCursor->ad_cname;
+	mod.sml_numvals		= ((cursor)) ? 1 : 0;
+	mod.sml_values		= ((cursor)) ? vals : NULL;
+	mod.sml_nvalues		= NULL;
+	mod.sml_next		= NULL;
+
+	// store cursor on suffix entry, cursor is local to this server
+	memset(&cb, 0, sizeof(cb));
+	cb.sc_response				= pwdshadow_regen_response;
+	op2							= *op;
+	memset(&op2.o_request, 0, sizeof(op2.o_request));
+	op2.o_tag					= LDAP_REQ_MODIFY;
+	op2.o_req_dn				= ps->ps_regen_be->be_suffix[0];
+	op2.o_req_ndn				= ps->ps_regen_be->be_nsuffix[0];
+	op2.orm_modlist				= &mod;
+	op2.orm_no_opattrs			= 1;
+	op2.o_dont_replicate		= 1;
+	op2.o_callback				= &cb;
+	op2.o_bd->be_modify(&op2, &rs2);
+
+	return(rs2.sr_err);
+}
 
 
-// overlay's configuration object classes
-static ConfigOCs pwdshadow_cfg_ocs[] =
+int
+pwdshadow_regen_dependents(
+		pwdshadow_t *				ps,
+		pwdshadow_cfg_t *			cf,
+		struct berval *				filter )
 {
-	{	.co_def		= "( 1.3.6.1.4.1.27893.4.2.5.1"
-					" NAME 'olcPwdShadowConfig'"
-					" DESC 'Password Shadow configuration'"
-					" SUP olcOverlayConfig"
-					" MAY ( olcPwdShadowDefault $"
-						" olcPwdShadowUsePolicies $"
-						" olcPwdShadowOverrides ) )",
-		.co_type	= Cft_Overlay,
-		.co_table	= pwdshadow_cfg_ats
-	},
-	{	.co_def		= NULL,
-		.co_type	= 0,
-		.co_table	= NULL
-	}
-};
+	int						idx;
+	int						pos;
+	int						def;
+	char *					ptr;
+	BerVarray				vals;
+	struct berval *			ad;
+	struct berval *			gen;
+
+	ad		= &cf->cf_policy_ad->ad_cname;
+	gen		= &ad_pwdShadowGenerate->ad_cname;
+	vals	= NULL;
+	def		= 0;
+
+	// escape queued policy DNs, entries without a policy use the default or
+	// the policy of their subtree
+	filter->bv_len = gen->bv_len + 13;
+	for(idx = 0; ( ((ps->ps_regen_policies)) && ((ps->ps_regen_policies[idx].bv_val)) ); idx++)
+	{
+		if ( ((cf->cf_def_policy.bv_val)) && ((bvmatch(&cf->cf_def_policy, &ps->ps_regen_policies[idx]))) )
+			def = 1;
+		for(pos = 0; ( ((cf->cf_subtree_policies)) && ((cf->cf_subtree_policies[pos].bv_val)) ); pos++)
+			if ((bvmatch(&cf->cf_subtree_policies[pos], &ps->ps_regen_policies[idx])))
+				def = 1;
+		vals = ch_realloc(vals, sizeof(struct berval) * (idx + 2));
+		filter_escape_value(&ps->ps_regen_policies[idx], &vals[idx]);
+		BER_BVZERO(&vals[idx+1]);
+		filter->bv_len += ad->bv_len + vals[idx].bv_len + 3;
+	};
+	filter->bv_len += ((def)) ? ad->bv_len + 7 : 0;
+	ber_bvarray_free(ps->ps_regen_policies);
+	ps->ps_regen_policies = NULL;
+
+	// (&(pwdShadowGenerate=TRUE)(|(<policy_ad>=<dn>)...(!(<policy_ad>=*))))
+	filter->bv_val	= ch_malloc(filter->bv_len + 1);
+	ptr				= filter->bv_val;
+	ptr			   += sprintf(ptr, "(&(%s=TRUE)(|", gen->bv_val);
+	for(idx = 0; ( ((vals)) && ((vals[idx].bv_val)) ); idx++)
+		ptr += sprintf(ptr, "(%s=%s)", ad->bv_val, vals[idx].bv_val);
+	if ((def))
+		ptr += sprintf(ptr, "(!(%s=*))", ad->bv_val);
+	ptr			   += sprintf(ptr, "))");
+	filter->bv_len	= ptr - filter->bv_val;
+	ber_bvarray_free(vals);
 
+	return(0);
+}
 
-/////////////////
-//             //
-//  Functions  //
-//             //
-/////////////////
-#ifndef SLAPD_OVER_HELLOWORLD
-#	pragma mark - Functions
-#endif
 
-#if SLAPD_OVER_PWDSHADOW == SLAPD_MOD_DYNAMIC
 int
-init_module(
-		int							argc,
-		char *						argv[] )
+pwdshadow_regen_entry(
+		Operation *					op,
+		pwdshadow_t *				ps,
+		struct berval *				ndn )
 {
-	if ((argc))
-		return( pwdshadow_initialize() );
-	if ((argv))
-		return( pwdshadow_initialize() );
-	return( pwdshadow_initialize() );
+	int						rc;
+	Entry *					entry;
+	BackendInfo *			bd_info;
+	Modifications *			mods;
+	Modifications **		next;
+	slap_callback			cb;
+	SlapReply				rs		= { REP_RESULT };
+	pwdshadow_mods_t *		mb;
+	pwdshadow_stats_t *		sx;
+	pwdshadow_state_t		st;
+
+	sx = pwdshadow_stats_shard(ps, op);
+	pwdshadow_state_initialize(&st, pwdshadow_cfg_get(ps));
+	memset(&op->o_request, 0, sizeof(op->o_request));
+	op->o_tag			= LDAP_REQ_MODIFY;
+	op->o_req_dn		= *ndn;
+	op->o_req_ndn		= *ndn;
+	bd_info				= op->o_bd->bd_info;
+
+	// retrieve entry from backend
+	op->o_bd->bd_info	= (BackendInfo *)ps->ps_regen_on->on_info;
+	rc					= be_entry_get_rw(op, ndn, NULL, NULL, 0, &entry);
+	pwdshadow_stats_inc(sx, PWDSHADOW_STAT_FETCHES);
+	if (rc != LDAP_SUCCESS)
+	{
+		op->o_bd->bd_info = bd_info;
+		return(0);
+	};
+
+	// skip entry if regeneration was stopped while the thread pool paused
+	// within the backend, the overlay may have been removed
+	if ( (ps->ps_regen_state != PWDSHADOW_REGEN_RUNNING) || ((slapd_shutdown)) )
+	{
+		be_entry_release_r(op, entry);
+		op->o_bd->bd_info = bd_info;
+		return(0);
+	};
+	pwdshadow_get_attrs(&st, entry, PWDSHADOW_FLG_EXISTS);
+
+	// evaluate entry as if every tracked attribute was modified
+	op->o_bd->bd_info	= (BackendInfo *)ps->ps_regen_on;
+	st.st_force			= 1;
+	pwdshadow_eval(op, &st);
+
+	// release entry
+	op->o_bd->bd_info	= (BackendInfo *)ps->ps_regen_on->on_info;
+	be_entry_release_r(op, entry);
+	op->o_bd->bd_info	= bd_info;
+
+	// generate modifications
+	mods = NULL;
+	next = &mods;
+	mb   = pwdshadow_mods_alloc(op);
+	pwdshadow_op_modify_mods(sx, mb, &st, &next);
+	if (!(mods))
+	{
+		op->o_tmpfree(mb, op->o_tmpmemctx);
+		return(0);
+	};
+
+	// apply modifications through the database's overlays
+	memset(&cb, 0, sizeof(cb));
+	cb.sc_response		= pwdshadow_regen_response;
+	op->orm_modlist		= mods;
+	op->orm_no_opattrs	= 0;
+	op->o_callback		= &cb;
+	slap_mods_opattrs(op, &op->orm_modlist, 1);
+	op->o_bd->be_modify(op, &rs);
+	pwdshadow_mods_unlink(&op->orm_modlist, mb);
+	slap_mods_free(op->orm_modlist, 1);
+	op->o_tmpfree(mb, op->o_tmpmemctx);
+	op->orm_modlist		= NULL;
+	op->o_callback		= NULL;
+
+	return( (rs.sr_err == LDAP_SUCCESS) ? 1 : 0 );
 }
-#endif
 
 
 int
-pwdshadow_cfg_gen(
-		ConfigArgs *				c )
+pwdshadow_regen_extop(
+		Operation *					op,
+		SlapReply *					rs )
 {
+	int						rc;
+	struct berval			ndn;
+	BackendDB *				be;
 	slap_overinst *			on;
+
+	// request value is a DN within the database to regenerate
+	if ( (!(op->ore_reqdata)) || (!(op->ore_reqdata->bv_len)) )
+	{
+		rs->sr_text = "pwdshadow regeneration requires the DN of a database";
+		return(LDAP_PROTOCOL_ERROR);
+	};
+	if ((rc = dnNormalize(0, NULL, NULL, op->ore_reqdata, &ndn, op->o_tmpmemctx)) != LDAP_SUCCESS)
+	{
+		rs->sr_text = "pwdshadow regeneration requires the DN of a database";
+		return(LDAP_INVALID_DN_SYNTAX);
+	};
+	be = select_backend(&ndn, 0);
+	op->o_tmpfree(ndn.bv_val, op->o_tmpmemctx);
+
+	// locate overlay instance of database
+	on = NULL;
+	if ( ((be)) && ((overlay_is_inst(be, pwdshadow.on_bi.bi_type))) )
+	{
+		for(on = ((slap_overinfo *)be->bd_info)->oi_list; ((on)); on = on->on_next)
+			if (!(strcmp(on->on_bi.bi_type, pwdshadow.on_bi.bi_type)))
+				break;
+	};
+	if (!(on))
+	{
+		rs->sr_text = "pwdshadow is not configured for database";
+		return(LDAP_UNWILLING_TO_PERFORM);
+	};
+
+	if (((pwdshadow_t *)on->on_bi.bi_private)->ps_mode == PWDSHADOW_MODE_VIRTUAL)
+	{
+		rs->sr_text = "pwdshadow regeneration is not used in virtual mode";
+		return(LDAP_UNWILLING_TO_PERFORM);
+	};
+
+	// only the database's rootdn may start regeneration
+	if (!(be_isroot_dn(be, &op->o_ndn)))
+	{
+		rs->sr_text = "pwdshadow regeneration requires rootdn of database";
+		return(LDAP_INSUFFICIENT_ACCESS);
+	};
+
+	if ((pwdshadow_regen_start(on->on_bi.bi_private, 0, 1)))
+	{
+		rs->sr_text = "pwdshadow regeneration is already running";
+		return(LDAP_BUSY);
+	};
+
+	return(LDAP_SUCCESS);
+}
+
+
+int
+pwdshadow_regen_open(
+		BackendDB *					be,
+		slap_overinst *				on )
+{
 	pwdshadow_t *			ps;
-	int						rc;
-	AttributeDescription *	ad;
 
-	on		= (slap_overinst *)c->bi;
-	ps		= (pwdshadow_t *)on->on_bi.bi_private;
-	rc		= ARG_BAD_CONF;
+	ps					= on->on_bi.bi_private;
+	ps->ps_regen_be		= be->bd_self;
+	ps->ps_regen_on		= on;
 
-	Debug(LDAP_DEBUG_TRACE, "==> pwdshadow_cfg_gen\n" );
+	if ((slapMode & SLAP_TOOL_MODE))
+		return(0);
 
-	switch ( c->op )
+	// check for interrupted regeneration once the server is running
+	ldap_pvt_thread_mutex_lock(&slapd_rq.rq_mutex);
+	if (!(ps->ps_regen_task))
+		ps->ps_regen_task = ldap_pvt_runqueue_insert(&slapd_rq, 1, pwdshadow_regen_resume, ps, "pwdshadow_regen_resume", be->be_suffix[0].bv_val);
+	ldap_pvt_thread_mutex_unlock(&slapd_rq.rq_mutex);
+
+	return(0);
+}
+
+
+int
+pwdshadow_regen_policy(
+		pwdshadow_t *				ps,
+		struct berval *				ndn )
+{
+	int						idx;
+	struct berval			dn;
+
+	if ( ((slapd_shutdown)) || (!(ps->ps_regen_be)) )
+		return(0);
+
+	// queue policy, a running regeneration processes queued policies once
+	// it has completed
+	ldap_pvt_thread_mutex_lock(&ps->ps_regen_mutex);
+	for(idx = 0; ( ((ps->ps_regen_policies)) && ((ps->ps_regen_policies[idx].bv_val)) ); idx++)
+		if ((bvmatch(&ps->ps_regen_policies[idx], ndn)))
+			break;
+	if ( (!(ps->ps_regen_policies)) || (!(ps->ps_regen_policies[idx].bv_val)) )
 	{
-		case SLAP_CONFIG_EMIT:
-		switch( c->type )
-		{
-			case PWDSHADOW_CFG_DEF_POLICY:
-			if ( ps->ps_def_policy.bv_val != NULL)
-			{
-				if ((rc = value_add_one( &c->rvalue_vals, &ps->ps_def_policy )) != 0)
-					return(rc);
-				return( value_add_one( &c->rvalue_nvals, &ps->ps_def_policy ) );
-			};
-			return(0);
+		ber_dupbv(&dn, ndn);
+		ber_bvarray_add(&ps->ps_regen_policies, &dn);
+	};
+	ldap_pvt_thread_mutex_unlock(&ps->ps_regen_mutex);
 
-			case PWDSHADOW_CFG_POLICY_AD:
-			c->value_ad = ps->ps_policy_ad;
-			return(0);
+	Debug(LDAP_DEBUG_STATS, "pwdshadow_regen_policy: recomputing entries using policy %s\n", ndn->bv_val );
+	pwdshadow_regen_start(ps, 0, 0);
 
-			default:
-			Debug(LDAP_DEBUG_ANY, "pwdshadow_cfg_gen: unknown configuration option\n" );
-			return( ARG_BAD_CONF );
-		};
-		break;
+	return(0);
+}
 
-		case LDAP_MOD_DELETE:
-		switch( c->type )
-		{
-			case PWDSHADOW_CFG_DEF_POLICY:
-			Debug(LDAP_DEBUG_TRACE, "==> pwdshadow_cfg_gen delete\n" );
-			if ( ps->ps_def_policy.bv_val )
-			{
-				ber_memfree ( ps->ps_def_policy.bv_val );
-				ps->ps_def_policy.bv_val = NULL;
-			};
-			ps->ps_def_policy.bv_len = 0;
-			return(0);
 
-			case PWDSHADOW_CFG_POLICY_AD:
-			ps->ps_policy_ad = ad_pwdShadowPolicySubentry;
-			return(0);
+int
+pwdshadow_regen_response(
+		Operation *					op,
+		SlapReply *					rs )
+{
+	// marks internal operations and discards their results
+	if (!(op))
+		return(0);
+	if (!(rs))
+		return(0);
+	return(0);
+}
 
-			default:
-			Debug(LDAP_DEBUG_ANY, "pwdshadow_cfg_gen: unknown configuration option\n" );
-			return( ARG_BAD_CONF );
-		};
-		break;
 
-		case SLAP_CONFIG_ADD:
-		// fallthru to LDAP_MOD_ADD
+void *
+pwdshadow_regen_resume(
+		void *						ctx,
+		void *						arg )
+{
+	int						rc;
+	unsigned long			cursor;
+	struct re_s *			rtask;
+	pwdshadow_t *			ps;
+	Entry *					entry;
+	Attribute *				a;
+	Connection				conn;
+	OperationBuffer			opbuf;
+	Operation *				op;
+	BackendDB				db;
+
+	rtask		= arg;
+	ps			= rtask->arg;
+
+	// task only runs once
+	ldap_pvt_thread_mutex_lock(&slapd_rq.rq_mutex);
+	if (!(ps->ps_regen_task))
+	{
+		ldap_pvt_thread_mutex_unlock(&slapd_rq.rq_mutex);
+		return(NULL);
+	};
+	ldap_pvt_runqueue_stoptask(&slapd_rq, rtask);
+	ldap_pvt_runqueue_remove(&slapd_rq, rtask);
+	ps->ps_regen_task = NULL;
+	ldap_pvt_thread_mutex_unlock(&slapd_rq.rq_mutex);
+
+	// prepare internal operation as rootdn of the database
+	connection_fake_init2(&conn, &opbuf, ctx, 0);
+	op			= &opbuf.ob_op;
+	db			= *ps->ps_regen_be;
+	db.bd_info	= (BackendInfo *)ps->ps_regen_on->on_info;
+	op->o_bd	= &db;
+	op->o_dn	= db.be_rootdn;
+	op->o_ndn	= db.be_rootndn;
+
+	// read cursor stored on suffix entry
+	cursor = 0;
+	if ((rc = be_entry_get_rw(op, &db.be_nsuffix[0], NULL, NULL, 0, &entry)) == LDAP_SUCCESS)
+	{
+		if ((a = attr_find(entry->e_attrs, ad_pwdShadowRegenCursor)) != NULL)
+			if (a->a_numvals > 0)
+				lutil_atoul(&cursor, a->a_vals[0].bv_val);
+		be_entry_release_r(op, entry);
+	};
+	if (!(cursor))
+		return(NULL);
+
+	Debug(LDAP_DEBUG_STATS, "pwdshadow_regen_resume: resuming regeneration of %s after entry %lu\n", db.be_suffix[0].bv_val, cursor );
+	pwdshadow_regen_start(ps, (ID)cursor, 1);
+
+	return(NULL);
+}
 
-		case LDAP_MOD_ADD:
-		switch( c->type )
+
+void *
+pwdshadow_regen_run(
+		void *						ctx,
+		void *						arg )
+{
+	int						idx;
+	int						more;
+	int						finished;
+	int						resumable;
+	pwdshadow_t *			ps;
+	pwdshadow_cfg_t *		cf;
+	pwdshadow_batch_t *		batch;
+	Connection				conn;
+	OperationBuffer			opbuf;
+	Operation *				op;
+	BackendDB				db;
+	slap_callback			cb;
+	struct berval			filter;
+	struct berval			base;
+	struct berval			subtree;
+	SlapReply				rs		= { REP_RESULT };
+
+	ps				= arg;
+	memset(&cb, 0, sizeof(cb));
+	cb.sc_response	= pwdshadow_regen_collect;
+	cb.sc_private	= ps;
+
+	// prepare internal search of database as rootdn
+	connection_fake_init2(&conn, &opbuf, ctx, 0);
+	op					= &opbuf.ob_op;
+	db					= *ps->ps_regen_be;
+	op->o_bd			= &db;
+	op->o_dn			= db.be_rootdn;
+	op->o_ndn			= db.be_rootndn;
+
+	for(more = 1; ((more)); )
+	{
+		// select every entry, entries of a renamed subtree, or only entries of
+		// changed policies
+		base = db.be_nsuffix[0];
+		BER_BVZERO(&subtree);
+
+		// policy assignments selecting the entries are kept for the pass,
+		// which spans pauses of the thread pool
+		cf = pwdshadow_cfg_hold(ps);
+
+		ldap_pvt_thread_mutex_lock(&ps->ps_regen_mutex);
+		if ((ps->ps_regen_full))
 		{
-			case PWDSHADOW_CFG_DEF_POLICY:
-			Debug(LDAP_DEBUG_TRACE, "==> pwdshadow_cfg_gen add\n" );
-			if (( ps->ps_def_policy.bv_val ))
+			ber_bvarray_free(ps->ps_regen_policies);
+			ber_bvarray_free(ps->ps_regen_subtrees);
+			ps->ps_regen_policies = NULL;
+			ps->ps_regen_subtrees = NULL;
+			ber_dupbv(&filter, &pwdshadow_regen_filter);
+		} else if ((ps->ps_regen_subtrees)) {
+			for(idx = 0; ((ps->ps_regen_subtrees[idx+1].bv_val)); idx++);
+			subtree = ps->ps_regen_subtrees[idx];
+			base	= subtree;
+			BER_BVZERO(&ps->ps_regen_subtrees[idx]);
+			if (!(idx))
 			{
-				ber_memfree ( ps->ps_def_policy.bv_val );
+				ber_bvarray_free(ps->ps_regen_subtrees);
+				ps->ps_regen_subtrees = NULL;
 			};
-			ps->ps_def_policy = c->value_ndn;
-			ber_memfree( c->value_dn.bv_val );
-			BER_BVZERO( &c->value_dn );
-			BER_BVZERO( &c->value_ndn );
-			return(0);
+			ber_dupbv(&filter, &pwdshadow_regen_filter);
+		} else {
+			pwdshadow_regen_dependents(ps, cf, &filter);
+		};
 
-			case PWDSHADOW_CFG_POLICY_AD:
-			ad = c->value_ad;
-			if (!(is_at_syntax(ad->ad_type, SLAPD_DN_SYNTAX)))
+		// only the cursor of a full regeneration is stored on the suffix
+		// entry and resumed at startup, dependents and subtree passes leave
+		// the cursor of an interrupted full regeneration in place
+		ps->ps_regen_resumable	= ps->ps_regen_full;
+		ps->ps_regen_full		= 0;
+		ldap_pvt_thread_mutex_unlock(&ps->ps_regen_mutex);
+
+		memset(&op->o_request, 0, sizeof(op->o_request));
+		rs.sr_err			= LDAP_SUCCESS;
+		op->o_tag			= LDAP_REQ_SEARCH;
+		op->o_req_dn		= base;
+		op->o_req_ndn		= base;
+		op->o_callback		= &cb;
+		op->o_abandon		= 0;
+		op->ors_scope		= LDAP_SCOPE_SUBTREE;
+		op->ors_deref		= LDAP_DEREF_NEVER;
+		op->ors_slimit		= SLAP_NO_LIMIT;
+		op->ors_tlimit		= SLAP_NO_LIMIT;
+		op->ors_limit		= NULL;
+		op->ors_attrsonly	= 1;
+		op->ors_attrs		= slap_anlist_no_attrs;
+		op->ors_filterstr	= filter;
+		op->ors_filter		= str2filter_x(op, op->ors_filterstr.bv_val);
+
+		Debug(LDAP_DEBUG_STATS, "pwdshadow_regen_run: regenerating %s with %s after entry %lu\n", base.bv_val, filter.bv_val, (unsigned long)ps->ps_regen_cursor );
+
+		// collect entries into batches, a renamed subtree may have been
+		// removed since it was queued
+		if ((op->ors_filter))
+		{
+			op->o_bd->be_search(op, &rs);
+			filter_free_x(op, op->ors_filter, 1);
+		};
+		if ( ((subtree.bv_val)) && (rs.sr_err == LDAP_NO_SUCH_OBJECT) )
+			rs.sr_err = LDAP_SUCCESS;
+		if ((batch = ps->ps_regen_fill) != NULL)
+		{
+			ps->ps_regen_fill = NULL;
+			pwdshadow_regen_submit(ps, batch);
+		};
+
+		// wait for outstanding batches
+		pwdshadow_regen_wait(ps, 0);
+
+		// remove cursor once every entry has been processed, the write is made
+		// without holding the mutex
+		more = 0;
+		ldap_pvt_thread_mutex_lock(&ps->ps_regen_mutex);
+		finished = (ps->ps_regen_state == PWDSHADOW_REGEN_RUNNING) && (!(slapd_shutdown)) && (rs.sr_err == LDAP_SUCCESS);
+		if ((finished))
+			ps->ps_regen_cursor = 0;
+		resumable = ps->ps_regen_resumable;
+		ldap_pvt_thread_mutex_unlock(&ps->ps_regen_mutex);
+		if ( ((finished)) && ((resumable)) )
+			pwdshadow_regen_cursor(op, ps, 0);
+
+		ldap_pvt_thread_mutex_lock(&ps->ps_regen_mutex);
+		if ((finished))
+		{
+			Debug(LDAP_DEBUG_STATS, "pwdshadow_regen_run: regenerated %s, %lu entries processed, %lu entries modified\n", db.be_suffix[0].bv_val, ps->ps_regen_processed, ps->ps_regen_modified );
+
+			// process policies and subtrees changed while regeneration was running
+			if ( ((ps->ps_regen_policies)) || ((ps->ps_regen_subtrees)) )
 			{
-				snprintf( c->cr_msg,
-							sizeof( c->cr_msg ),
-							"pwdshadow_policy_attr attribute=\"%s\" must have DN (%s) syntax",
-							c->argv[1],
-							SLAPD_DN_SYNTAX );
-				Debug(LDAP_DEBUG_CONFIG, "%s: %s.\n", c->log, c->cr_msg);
-				return(ARG_BAD_CONF);
+				more					= 1;
+				ps->ps_regen_started	= time(NULL);
+				ps->ps_regen_submitted	= 0;
+				ps->ps_regen_processed	= 0;
+				ps->ps_regen_modified	= 0;
 			};
-			ps->ps_policy_ad = ad;
-			return(0);
-
-			default:
-			Debug(LDAP_DEBUG_ANY, "pwdshadow_cfg_gen: unknown configuration option\n" );
-			return( ARG_BAD_CONF );
+		} else {
+			Debug(LDAP_DEBUG_STATS, "pwdshadow_regen_run: regeneration of %s interrupted after entry %lu\n", db.be_suffix[0].bv_val, (unsigned long)ps->ps_regen_cursor );
 		};
-		break;
-		
-		default:
-		Debug(LDAP_DEBUG_ANY, "pwdshadow_cfg_gen: unknown configuration operation\n" );
-		abort ();
+		if (!(more))
+			ps->ps_regen_state = PWDSHADOW_REGEN_IDLE;
+		ldap_pvt_thread_mutex_unlock(&ps->ps_regen_mutex);
+
+		ber_memfree(filter.bv_val);
+		ber_memfree(subtree.bv_val);
+		pwdshadow_cfg_release(cf);
 	};
 
-	return(rc);
+	return(NULL);
 }
 
 
-void
-pwdshadow_copy_int_bv(
-		int							i,
-		BerValue *					bv )
+int
+pwdshadow_regen_start(
+		pwdshadow_t *				ps,
+		ID							cursor,
+		int							full )
 {
-	bv->bv_len = snprintf(NULL, 0, "%i", i);
-	bv->bv_len++;
-	bv->bv_val = ch_malloc( (size_t)bv->bv_len );
-	bv->bv_len = snprintf(bv->bv_val, bv->bv_len, "%i", i);
-	return;
+	ldap_pvt_thread_mutex_lock(&ps->ps_regen_mutex);
+	if (ps->ps_regen_state != PWDSHADOW_REGEN_IDLE)
+	{
+		ldap_pvt_thread_mutex_unlock(&ps->ps_regen_mutex);
+		return(-1);
+	};
+	ps->ps_regen_state		= PWDSHADOW_REGEN_RUNNING;
+	ps->ps_regen_full		= full;
+	ps->ps_regen_cursor		= cursor;
+	ps->ps_regen_started	= time(NULL);
+	ps->ps_regen_submitted	= 0;
+	ps->ps_regen_processed	= 0;
+	ps->ps_regen_modified	= 0;
+	ps->ps_regen_inflight	= 0;
+	ps->ps_regen_persisting	= 0;
+	ps->ps_regen_fill		= NULL;
+	ps->ps_regen_head		= NULL;
+	ps->ps_regen_tail		= NULL;
+	ldap_pvt_thread_mutex_unlock(&ps->ps_regen_mutex);
+
+	if ((ldap_pvt_thread_pool_submit(&connection_pool, pwdshadow_regen_run, ps)))
+	{
+		ldap_pvt_thread_mutex_lock(&ps->ps_regen_mutex);
+		ps->ps_regen_state = PWDSHADOW_REGEN_IDLE;
+		ldap_pvt_thread_mutex_unlock(&ps->ps_regen_mutex);
+		return(-1);
+	};
+
+	return(0);
 }
 
 
 int
-pwdshadow_db_destroy(
-		BackendDB *					be,
-		ConfigReply *				cr )
+pwdshadow_regen_submit(
+		pwdshadow_t *				ps,
+		pwdshadow_batch_t *			batch )
 {
-	slap_overinst *		on;
-	pwdshadow_t *		ps;
+	int						limit;
+	unsigned long			allowed;
+	struct timespec			ts;
+
+	// limit number of batches processed concurrently
+	limit = (ps->ps_regen_workers > 0) ? ps->ps_regen_workers : 1;
+	pwdshadow_regen_wait(ps, limit - 1);
+
+	// queue batches in entry ID order for advancing cursor
+	ldap_pvt_thread_mutex_lock(&ps->ps_regen_mutex);
+	if ((ps->ps_regen_tail))
+		ps->ps_regen_tail->rb_next = batch;
+	else
+		ps->ps_regen_head = batch;
+	ps->ps_regen_tail		= batch;
+	ps->ps_regen_inflight++;
+	ps->ps_regen_submitted	+= batch->rb_count;
+	ldap_pvt_thread_mutex_unlock(&ps->ps_regen_mutex);
+
+	if ((ldap_pvt_thread_pool_submit(&connection_pool, pwdshadow_regen_batch, batch)))
+		pwdshadow_regen_batch(ldap_pvt_thread_pool_context(), batch);
+
+	// throttle to configured number of entries per second
+	ts.tv_sec	= 0;
+	ts.tv_nsec	= 10000000;
+	while ( (ps->ps_regen_rate > 0) && (!(slapd_shutdown)) && (ps->ps_regen_state == PWDSHADOW_REGEN_RUNNING) )
+	{
+		allowed = (unsigned long)(time(NULL) - ps->ps_regen_started + 1) * (unsigned long)ps->ps_regen_rate;
+		if (ps->ps_regen_submitted <= allowed)
+			break;
+		ldap_pvt_thread_pool_pausecheck(&connection_pool);
+		nanosleep(&ts, NULL);
+	};
 
-	on						= (slap_overinst *) be->bd_info;
-	ps						= on->on_bi.bi_private;
-	on->on_bi.bi_private	= NULL;
+	return(0);
+}
 
-	if ((ps->ps_def_policy.bv_val))
-		free(ps->ps_def_policy.bv_val);
-	ps->ps_def_policy.bv_val = NULL;
 
-	memset(ps, 0, sizeof(pwdshadow_t));
-	ch_free( ps );
+int
+pwdshadow_regen_subtree(
+		pwdshadow_t *				ps,
+		struct berval *				ndn )
+{
+	int						idx;
+	struct berval			dn;
 
-	if ((cr))
+	if ( ((slapd_shutdown)) || (!(ps->ps_regen_be)) )
 		return(0);
 
+	// queue subtree, a running regeneration processes queued subtrees once
+	// it has completed
+	ldap_pvt_thread_mutex_lock(&ps->ps_regen_mutex);
+	for(idx = 0; ( ((ps->ps_regen_subtrees)) && ((ps->ps_regen_subtrees[idx].bv_val)) ); idx++)
+		if ((bvmatch(&ps->ps_regen_subtrees[idx], ndn)))
+			break;
+	if ( (!(ps->ps_regen_subtrees)) || (!(ps->ps_regen_subtrees[idx].bv_val)) )
+	{
+		ber_dupbv(&dn, ndn);
+		ber_bvarray_add(&ps->ps_regen_subtrees, &dn);
+	};
+	ldap_pvt_thread_mutex_unlock(&ps->ps_regen_mutex);
+
+	Debug(LDAP_DEBUG_STATS, "pwdshadow_regen_subtree: recomputing entries within %s\n", ndn->bv_val );
+	pwdshadow_regen_start(ps, 0, 0);
+
 	return(0);
 }
 
 
 int
-pwdshadow_db_init(
-		BackendDB *					be,
-		ConfigReply *				cr )
+pwdshadow_regen_wait(
+		pwdshadow_t *				ps,
+		int							limit )
 {
-	slap_overinst *			on;
-	pwdshadow_t *			ps;
+	int						done;
+	struct timespec			ts;
 
-	if (( SLAP_ISGLOBALOVERLAY( be ) ))
+	ts.tv_sec	= 0;
+	ts.tv_nsec	= 10000000;
+
+	// polls instead of waiting on a condition so the thread pool is able to
+	// pause, a negative limit waits for regeneration to stop, a batch writing
+	// the cursor counts as outstanding
+	for(done = 0; (!(done)); )
 	{
-		// do not allow slapo-pwdshadow to be global
-		if (( cr ))
-		{
-			snprintf( cr->msg, sizeof(cr->msg), "slapo-pwdshadow cannot be global" );
-			Debug( LDAP_DEBUG_ANY, "%s\n", cr->msg );
-		};
-		return(1);
+		ldap_pvt_thread_mutex_lock(&ps->ps_regen_mutex);
+		if (limit < 0)
+			done = (ps->ps_regen_state == PWDSHADOW_REGEN_IDLE);
+		else
+			done = (ps->ps_regen_inflight + ps->ps_regen_persisting <= limit);
+		ldap_pvt_thread_mutex_unlock(&ps->ps_regen_mutex);
+		if ((done))
+			break;
+		if (limit >= 0)
+			ldap_pvt_thread_pool_pausecheck(&connection_pool);
+		nanosleep(&ts, NULL);
 	};
 
-	// allocate memory for database instance configuration
-	on								= (slap_overinst *) be->bd_info;
-	on->on_bi.bi_private			= ch_calloc( sizeof(pwdshadow_t), 1 );
-	ps								= on->on_bi.bi_private;
+	return(0);
+}
 
-	// set default values
-	ps->ps_overrides				= 1;
-	ps->ps_use_policies				= 1;
-	ps->ps_policy_ad				= ad_pwdShadowPolicySubentry;
 
+int
+pwdshadow_rule_expire(
+		pwdshadow_state_t *			st,
+		int							slot )
+{
+	uint32_t		willexist;
+
+	willexist = pwdshadow_willexist(st);
+	if ((willexist & pwdshadow_bit(PWDSHADOW_SL_pwdEndTime)))
+		st->st_post[slot] = st->st_post[PWDSHADOW_SL_pwdEndTime];
+	else if ( ((st->st_autoexpire)) &&
+		((willexist & pwdshadow_bit(PWDSHADOW_SL_pwdShadowLastChange))) &&
+		((willexist & pwdshadow_bit(PWDSHADOW_SL_pwdShadowMax))) )
+	{
+		st->st_post[slot]  = st->st_post[PWDSHADOW_SL_pwdShadowLastChange];
+		st->st_post[slot] += st->st_post[PWDSHADOW_SL_pwdShadowMax];
+		if ((willexist & pwdshadow_bit(PWDSHADOW_SL_pwdShadowInactive)))
+			st->st_post[slot] += st->st_post[PWDSHADOW_SL_pwdShadowInactive];
+	}
+	else
+	{
+		st->st_evaladd &= ~pwdshadow_bit(slot);
+		pwdshadow_purge(st, slot);
+	};
 	return(0);
 }
 
 
 int
-pwdshadow_db_open(
-		BackendDB *					be,
-		ConfigReply *				cr )
+pwdshadow_rule_lastchange(
+		pwdshadow_state_t *			st,
+		int							slot )
 {
-	slap_overinst *			on;
-	pwdshadow_t *			ps;
-	const char *			text;
-
-	on		= (slap_overinst *) be->bd_info;
-	ps		= on->on_bi.bi_private;
+	// slapo-ppolicy stacked above the overlay appends pwdChangedTime to the
+	// modifications of a password change, using it keeps both attributes in
+	// agreement without a later correction
+	if ((pwdshadow_flg_useradd(st, PWDSHADOW_SL_pwdChangedTime)))
+		st->st_post[slot] = st->st_post[PWDSHADOW_SL_pwdChangedTime];
+	else if ((pwdshadow_flg_useradd(st, PWDSHADOW_SL_userPassword)))
+		st->st_post[slot] = st->st_today;
+	else if ((pwdshadow_flg_exists(st, PWDSHADOW_SL_pwdChangedTime)))
+		st->st_post[slot] = st->st_post[PWDSHADOW_SL_pwdChangedTime];
+	else if ( ((st->st_force)) && ((pwdshadow_flg_exists(st, slot))) )
+		st->st_post[slot] = st->st_prev[slot];
+	else if ((st->st_force))
+		st->st_evaladd &= ~pwdshadow_bit(slot);
+	else
+		st->st_post[slot] = st->st_today;
+	return(0);
+}
 
-	ldap_pvt_thread_mutex_lock(&pwdshadow_ad_mutex);
 
-	// verifies schema has not aleady been retrieved
-	if ((pwdshadow_schema))
+int
+pwdshadow_rules_build(
+		pwdshadow_cfg_t *			cf )
+{
+	int						idx;
+	int						dep;
+	int						pos;
+	unsigned				done;
+	unsigned				deps[PWDSHADOW_RULES];
+	unsigned				reach[PWDSHADOW_RULES];
+	const pwdshadow_rule_t *	ru;
+
+	memset(cf->cf_rule_mask, 0, sizeof(cf->cf_rule_mask));
+	cf->cf_rule_count = 0;
+
+	// edges from rules generating an attribute to rules reading it
+	for(idx = 0; idx < PWDSHADOW_RULES; idx++)
 	{
-		ldap_pvt_thread_mutex_unlock(&pwdshadow_ad_mutex);
-		return(0);
+		deps[idx] = 0;
+		for(dep = 0; dep < PWDSHADOW_RULES; dep++)
+			if ( (dep != idx) && ((pwdshadow_rule_reads(&pwdshadow_rules[idx], pwdshadow_rules[dep].ru_slot))) )
+				deps[idx] |= 1U << dep;
 	};
-	pwdshadow_schema = 1;
-
-	// slapo-ppolicy attributes (IETF draft-behera-ldap-password-policy-11)
-	slap_str2ad("pwdChangedTime",		&ad_pwdChangedTime,		&text);
-	slap_str2ad("pwdEndTime",			&ad_pwdEndTime,			&text);
-	slap_str2ad("pwdExpireWarning",		&ad_pwdExpireWarning,	&text);
-	slap_str2ad("pwdGraceExpiry",		&ad_pwdGraceExpiry,		&text);
-	slap_str2ad("pwdMaxAge",			&ad_pwdMaxAge,			&text);
-	slap_str2ad("pwdMinAge",			&ad_pwdMinAge,			&text);
 
-	// LDAP NIS attributes (RFC 2307)
-	slap_str2ad("shadowExpire",			&ad_shadowExpire,		&text);
-	slap_str2ad("shadowFlag",			&ad_shadowFlag,			&text);
-	slap_str2ad("shadowInactive",		&ad_shadowInactive,		&text);
-	slap_str2ad("shadowLastChange",		&ad_shadowLastChange,	&text);
-	slap_str2ad("shadowMax",			&ad_shadowMax,			&text);
-	slap_str2ad("shadowMin",			&ad_shadowMin,			&text);
-	slap_str2ad("shadowWarning",		&ad_shadowWarning,		&text);
+	// order rules so each rule is evaluated after the rules it reads
+	for(done = 0; cf->cf_rule_count < PWDSHADOW_RULES; )
+	{
+		for(idx = 0; idx < PWDSHADOW_RULES; idx++)
+			if ( (!(done & (1U << idx))) && (!(deps[idx] & ~done)) )
+				break;
+		if (idx == PWDSHADOW_RULES)
+		{
+			Debug(LDAP_DEBUG_ANY, "pwdshadow_rules_build: evaluation rules contain a cycle\n" );
+			cf->cf_rule_count = 0;
+			return(-1);
+		};
+		cf->cf_rule_order[cf->cf_rule_count++] = idx;
+		done |= 1U << idx;
+	};
 
-	// User Schema (RFC 2256)
-	if ((ad_userPassword = slap_schema.si_ad_userPassword) == NULL)
-		slap_str2ad("userPassword",		&ad_userPassword,		&text);
+	// rules reachable from each rule, readers are ordered after the rule
+	for(pos = PWDSHADOW_RULES - 1; pos >= 0; pos--)
+	{
+		idx			= cf->cf_rule_order[pos];
+		reach[idx]	= 1U << idx;
+		for(dep = 0; dep < PWDSHADOW_RULES; dep++)
+			if ((deps[dep] & (1U << idx)))
+				reach[idx] |= reach[dep];
+	};
 
-	ldap_pvt_thread_mutex_unlock(&pwdshadow_ad_mutex);
+	// map attributes to the rules reachable when a user modifies them, every
+	// rule is affected by pwdShadowGenerate and rules requiring a password
+	// policy are affected by the entry's policy
+	for(idx = 0; ((pwdshadow_slots[idx].sl_ad)); idx++)
+	{
+		for(dep = 0; dep < PWDSHADOW_RULES; dep++)
+		{
+			ru = &pwdshadow_rules[dep];
+			if ( ((pwdshadow_rule_reads(ru, idx))) ||
+				(idx == PWDSHADOW_SL_pwdShadowGenerate) ||
+				( ((cf->cf_overrides)) && (idx == ru->ru_override) ) ||
+				( ((ru->ru_flags & PWDSHADOW_RULE_POLICY)) && (idx == PWDSHADOW_SL_policySubentry) ) )
+				cf->cf_rule_mask[idx] |= reach[dep];
+		};
+	};
 
-	if ((ps))
-		return(0);
-	if ((cr))
-		return(0);
 	return(0);
 }
 
-
 int
-pwdshadow_eval(
-		Operation *					op,
-		pwdshadow_state_t *			st )
+pwdshadow_scan_attrs(
+		pwdshadow_state_t *			st,
+		Attribute *					attrs,
+		int							scan,
+		int							flags )
 {
-	int					count;
-	slap_overinst *		on;
-	pwdshadow_t *		ps;
-	pwdshadow_data_t *	dat;
+	int						remaining;
+	Attribute *				a;
+	pwdshadow_cfg_t *		cf;
+	pwdshadow_hash_t *		ha;
 
-	on					= (slap_overinst *)op->o_bd->bd_info;
-	ps					= on->on_bi.bi_private;
-	st->st_purge		= ((st->st_pwdShadowGenerate.dt_post)) ? 0 : 1;
-
-	// determine modification count
-	count  = 0;
-	count += ((pwdshadow_flg_usermods(&st->st_pwdEndTime)))			? 1 : 0;
-	count += ((pwdshadow_flg_usermods(&st->st_policySubentry)))		? 1 : 0;
-	count += ((pwdshadow_flg_usermods(&st->st_pwdShadowGenerate)))	? 1 : 0;
-	count += ((pwdshadow_flg_usermods(&st->st_shadowExpire)))		? 1 : 0;
-	count += ((pwdshadow_flg_usermods(&st->st_shadowFlag)))			? 1 : 0;
-	count += ((pwdshadow_flg_usermods(&st->st_shadowLastChange)))	? 1 : 0;
-	count += ((pwdshadow_flg_usermods(&st->st_shadowMin)))			? 1 : 0;
-	count += ((pwdshadow_flg_usermods(&st->st_shadowMax)))			? 1 : 0;
-	count += ((pwdshadow_flg_usermods(&st->st_shadowWarning)))		? 1 : 0;
-	count += ((pwdshadow_flg_usermods(&st->st_shadowInactive)))		? 1 : 0;
-	count += ((pwdshadow_flg_usermods(&st->st_userPassword)))		? 1 : 0;
-	if (!(count))
-		return(0);
+	cf			= st->st_cfg;
+	remaining	= (scan == PWDSHADOW_SCAN_POLICY) ? cf->cf_hash_policy : cf->cf_hash_entry;
 
-	// retrieve password policy
-	if (!(st->st_purge))
-		pwdshadow_eval_policy(op, st);
-
-	// process pwdShadowFlag
-	dat = &st->st_pwdShadowFlag;
-	pwdshadow_eval_precheck(
-		op,
-		st,
-		dat,							// data
-		&st->st_shadowFlag,				// override attribute
-		NULL							// triggering attributes
-	);
-	pwdshadow_eval_postcheck(dat);
-
-	// process pwdShadowInactive
-	dat = &st->st_pwdShadowInactive;
-	pwdshadow_eval_precheck(
-		op,
-		st,
-		dat,							// data
-		&st->st_shadowInactive,			// override attribute
-		(pwdshadow_data_t *[])			// triggering attributes
-		{	&st->st_pwdGraceExpiry,
-			NULL
-		}
-	);
-	pwdshadow_eval_postcheck(dat);
-
-	// process pwdShadowLastChange
-	dat = &st->st_pwdShadowLastChange;
-	pwdshadow_eval_precheck(
-		op,
-		st,
-		dat,							// data
-		&st->st_shadowLastChange,		// override attribute
-		(pwdshadow_data_t *[])			// triggering attributes
-		{	&st->st_userPassword,
-			NULL
-		}
-	);
-	if ( ((pwdshadow_flg_evaladd(dat))) && (!(pwdshadow_flg_override(dat))) )
-	{
-		if ((pwdshadow_flg_useradd(&st->st_userPassword)))
-			dat->dt_post = ((int)time(NULL)) / 60 / 60 /24;
-		else if ((pwdshadow_flg_exists(&st->st_pwdChangedTime)))
-			dat->dt_post = st->st_pwdChangedTime.dt_post;
-		else
-			dat->dt_post = ((int)time(NULL)) / 60 / 60 /24;
-	};
-	pwdshadow_eval_postcheck(dat);
-
-	// process pwdShadowMax
-	dat = &st->st_pwdShadowMax;
-	pwdshadow_eval_precheck(
-		op,
-		st,
-		dat,							// data
-		&st->st_shadowMax,				// override attribute
-		(pwdshadow_data_t *[])			// triggering attributes
-		{	&st->st_pwdMaxAge,
-			NULL
-		}
-	);
-	pwdshadow_eval_postcheck(dat);
-
-	// process pwdShadowMin
-	dat = &st->st_pwdShadowMin;
-	pwdshadow_eval_precheck(
-		op,
-		st,
-		dat,							// data
-		&st->st_shadowMin,				// override attribute
-		(pwdshadow_data_t *[])			// triggering attributes
-		{	&st->st_pwdMinAge,
-			NULL
-		}
-	);
-	pwdshadow_eval_postcheck(dat);
-
-	// process pwdShadowWarning
-	dat = &st->st_pwdShadowWarning;
-	pwdshadow_eval_precheck(
-		op,
-		st,
-		dat,							// data
-		&st->st_shadowWarning,			// override attribute
-		(pwdshadow_data_t *[])			// triggering attributes
-		{	&st->st_pwdExpireWarning,
-			NULL
-		}
-	);
-	pwdshadow_eval_postcheck(dat);
-
-	// process pwdShadowExpire
-	dat = &st->st_pwdShadowExpire;
-	pwdshadow_eval_precheck(
-		op,
-		st,
-		dat,							// data
-		&st->st_shadowExpire,			// override attribute
-		(pwdshadow_data_t *[])			// triggering attributes
-		{	&st->st_pwdShadowLastChange,
-			&st->st_pwdShadowAutoExpire,
-			&st->st_pwdMaxAge,
-			&st->st_pwdGraceExpiry,
-			&st->st_pwdEndTime,
-			NULL
-		}
-	);
-	if ( ((pwdshadow_flg_evaladd(dat))) && (!(pwdshadow_flg_override(dat))) )
-	{
-		if ((pwdshadow_flg_willexist(&st->st_pwdEndTime)))
-			dat->dt_post = st->st_pwdEndTime.dt_post;
-		else if ( ((st->st_autoexpire)) &&
-			((pwdshadow_flg_willexist(&st->st_pwdShadowLastChange))) &&
-			((pwdshadow_flg_willexist(&st->st_pwdShadowMax))) )
-		{
-			dat->dt_post =  st->st_pwdShadowLastChange.dt_post;
-			dat->dt_post += st->st_pwdShadowMax.dt_post;
-			if ((pwdshadow_flg_willexist(&st->st_pwdShadowInactive)))
-				dat->dt_post += st->st_pwdShadowInactive.dt_post;
-		}
-		else
+	// single pass over attributes, stops once every tracked slot is found
+	for(a = attrs; ( ((a)) && (remaining > 0) ); a = a->a_next)
+	{
+		if ((ha = pwdshadow_slot_find(cf, a->a_desc)) == NULL)
+			continue;
+		if (!(ha->ha_scan & scan))
+			continue;
+		remaining--;
+		if (a->a_numvals < 1)
+			continue;
+
+		pwdshadow_set(st, ha->ha_slot, &a->a_nvals[0], flags);
+
+		// update pwdPolicy
+		if ( (ha->ha_slot == PWDSHADOW_SL_policySubentry) && ((cf->cf_use_policies)) )
 		{
-			dat->dt_flag &= ~PWDSHADOW_FLG_EVALADD;
-			if ((pwdshadow_flg_exists(dat)))
-				dat->dt_flag |= PWDSHADOW_FLG_EVALDEL;
+			st->st_policy.bv_len = a->a_nvals[0].bv_len;
+			st->st_policy.bv_val = a->a_nvals[0].bv_val;
 		};
 	};
-	pwdshadow_eval_postcheck(dat);
-
-	if (!(ps))
-		return(0);
 
 	return(0);
 }
 
 
 int
-pwdshadow_eval_policy(
-		Operation *					op,
-		pwdshadow_state_t *			st )
+pwdshadow_set(
+		pwdshadow_state_t *			st,
+		int							slot,
+		BerValue *					bv,
+		int							flags )
 {
-	int					rc;
-	int					flags;
-	slap_overinst *		on;
-	pwdshadow_t *		ps;
-	BackendDB *			bd_orig;
-	Entry *				entry;
-	BerVarray			vals;
-	struct berval		save_dn;
-	struct berval		save_ndn;
+	int						type;
+	int						ival;
+	int64_t					val;
 
-	on			= (slap_overinst *)op->o_bd->bd_info;
-	ps			= on->on_bi.bi_private;
-	bd_orig		= op->o_bd;
-	entry		= NULL;
-	save_dn		= op->o_dn;
-	save_ndn	= op->o_ndn;
+	type	= pwdshadow_slots[slot].sl_type;
 
-	// exit if policies are disabled by the configuration
-	if (!(ps->ps_use_policies))
-		return(0);
+	if ((flags & PWDSHADOW_FLG_USERDEL))
+		return(pwdshadow_set_value(st, slot, 0, flags));
+	if (!(bv))
+		return(-1);
 
-	// attempt to retrieve entry's specific policy
-	if ((st->st_policy.bv_val))
+	// syntax of attribute was verified by pwdshadow_state_build()
+	if (!(st->st_valid & pwdshadow_bit(slot)))
+		return(-1);
+
+	switch(type)
 	{
-		vals = &st->st_policy;
-		if ((op->o_bd = select_backend(vals, 0)) != NULL)
-		{
-			op->o_dn 	= op->o_bd->be_rootdn;
-			op->o_ndn	= op->o_bd->be_rootndn;
-			rc			= be_entry_get_rw(op, vals, NULL, NULL, 0, &entry);
-			op->o_bd	= bd_orig;
-			if ((rc))
-				entry = NULL;
-		};
-	};
+		case PWDSHADOW_TYPE_BOOL:
+		ival = 0;
+		if ( (bv->bv_len == 4) && (!(strncasecmp(bv->bv_val, "TRUE", 4))) )
+			ival = 1;
+		return(pwdshadow_set_value(st, slot, ival, flags));
+
+		case PWDSHADOW_TYPE_DAYS:
+		if (pwdshadow_parse_int(bv, &val) != 0)
+			return(-1);
+		if ( (val < INT_MIN) || (val > INT_MAX) )
+			return(-1);
+		return(pwdshadow_set_value(st, slot, (int)val, flags));
+
+		case PWDSHADOW_TYPE_EXISTS:
+		ival = ( ((bv)) && ((bv->bv_len)) ) ? 1 : 0;
+		return(pwdshadow_set_value(st, slot, ival, flags));
+
+		case PWDSHADOW_TYPE_INTEGER:
+		if (pwdshadow_parse_int(bv, &val) != 0)
+			return(-1);
+		if ( (val < INT_MIN) || (val > INT_MAX) )
+			return(-1);
+		return(pwdshadow_set_value(st, slot, (int)val, flags));
+
+		case PWDSHADOW_TYPE_SECS:
+		if (pwdshadow_parse_int(bv, &val) != 0)
+			return(-1);
+		val /= 60 * 60 * 24;
+		if ( (val < INT_MIN) || (val > INT_MAX) )
+			return(-1);
+		return(pwdshadow_set_value(st, slot, (int)val, flags));
+
+		case PWDSHADOW_TYPE_TIME:
+		if (pwdshadow_parse_time(bv, &val) != 0)
+			return(-1);
+		if ( (val < INT_MIN) || (val > INT_MAX) )
+			return(-1);
+		return(pwdshadow_set_value(st, slot, (int)val, flags)); // days since epoch
 
-	// attempt to retrieve entry's specific policy
-	if ( (!(entry)) && ((ps->ps_def_policy.bv_val)) )
-	{
-		vals = &ps->ps_def_policy;
-		if ((op->o_bd = select_backend(vals, 0)) != NULL)
-		{
-			op->o_dn 	= op->o_bd->be_rootdn;
-			op->o_ndn	= op->o_bd->be_rootndn;
-			rc 			= be_entry_get_rw(op, vals, NULL, NULL, 0, &entry);
-			op->o_bd	= bd_orig;
-			if ((rc))
-				entry = NULL;
-		};
+		default:
+		Debug( LDAP_DEBUG_ANY, "pwdshadow: pwdshadow_set(): unknown data type\n" );
+		return(-1);
 	};
 
-	// exit if a policy was not retreived
-	if (!(entry))
+	return(0);
+}
+
+
+int
+pwdshadow_set_value(
+		pwdshadow_state_t *			st,
+		int							slot,
+		int							val,
+		int							flags )
+{
+	switch(flags & PWDSHADOW_STATE)
 	{
-		op->o_dn	= save_dn;
-		op->o_ndn	= save_ndn;
-		return(0);
-	};
+		case PWDSHADOW_FLG_EXISTS:
+		st->st_exists		|= pwdshadow_bit(slot);
+		st->st_prev[slot]	 = val;
+		st->st_post[slot]	 = val;
+		break;
 
-	// retrieve password policy attributes
-	flags = PWDSHADOW_FLG_EXISTS | PWDSHADOW_TYPE_SECS;
-	pwdshadow_get_attr(entry, &st->st_pwdExpireWarning,		flags);
-	pwdshadow_get_attr(entry, &st->st_pwdGraceExpiry,		flags);
-	pwdshadow_get_attr(entry, &st->st_pwdMaxAge,			flags);
-	pwdshadow_get_attr(entry, &st->st_pwdMinAge,			flags);
-	flags = PWDSHADOW_FLG_EXISTS | PWDSHADOW_TYPE_BOOL;
-	pwdshadow_get_attr(entry, &st->st_pwdShadowAutoExpire,	flags);
+		case PWDSHADOW_FLG_USERADD:
+		st->st_useradd		|= pwdshadow_bit(slot);
+		st->st_post[slot]	 = val;
+		break;
 
-	if ((pwdshadow_flg_exists(&st->st_pwdShadowAutoExpire)))
-		st->st_autoexpire = ((st->st_pwdShadowAutoExpire.dt_post)) ? 1 : 0;
+		case PWDSHADOW_FLG_USERDEL:
+		st->st_userdel		|= pwdshadow_bit(slot);
+		st->st_post[slot]	 = 0;
+		break;
 
-	// release entry
-	be_entry_release_r(op, entry);
-	op->o_dn	= save_dn;
-	op->o_ndn	= save_ndn;
+		default:
+		return(-1);
+	};
 
 	return(0);
 }
 
 
-int
-pwdshadow_eval_postcheck(
-		pwdshadow_data_t *			dat )
+pwdshadow_hash_t *
+pwdshadow_slot_find(
+		pwdshadow_cfg_t *			cf,
+		AttributeDescription *		ad )
 {
-	if (!(pwdshadow_flg_evaladd(dat)))
-		return(0);
-	if (!(pwdshadow_flg_exists(dat)))
-		return(0);
+	unsigned				pos;
+	pwdshadow_hash_t *		ha;
 
-	if (dat->dt_prev == dat->dt_post)
+	// open addressing with linear probing, table is never full
+	for(pos = pwdshadow_hash(ad) & PWDSHADOW_HASH_MASK; ; pos = (pos + 1) & PWDSHADOW_HASH_MASK)
 	{
-		dat->dt_flag &= ~PWDSHADOW_FLG_EVALADD;
-		return(0);
+		ha = &cf->cf_hash[pos];
+		if (ha->ha_ad == ad)
+			return(ha);
+		if (!(ha->ha_ad))
+			return(NULL);
 	};
 
-	return(0);
+	return(NULL);
 }
 
 
 int
-pwdshadow_eval_precheck(
-		Operation *					op,
-		pwdshadow_state_t *			st,
-		pwdshadow_data_t *			dat,
-		pwdshadow_data_t *			override,
-		pwdshadow_data_t *			triggers[] )
+pwdshadow_state_build(
+		pwdshadow_cfg_t *			cf )
 {
-	int					idx;
-	int					should_exist;
-	slap_overinst *		on;
-	pwdshadow_t *		ps;
+	int						idx;
+	unsigned				pos;
+	const char *			syntax;
+	AttributeDescription *	ad;
 
-	on					= (slap_overinst *)op->o_bd->bd_info;
-	ps					= on->on_bi.bi_private;
-	should_exist		= 0;
+	memset(&cf->cf_template, 0, sizeof(pwdshadow_state_t));
+	memset(cf->cf_ads, 0, sizeof(cf->cf_ads));
+	memset(cf->cf_hash, 0, sizeof(cf->cf_hash));
+	cf->cf_hash_entry	= 0;
+	cf->cf_hash_policy	= 0;
 
-	// determine if overlay is disabled for entry
-	if ((st->st_purge))
+	for(idx = 0; ((pwdshadow_slots[idx].sl_ad)); idx++)
 	{
-		pwdshadow_purge(dat);
-		return(0);
-	};
+		ad	= *pwdshadow_slots[idx].sl_ad;
+		if (idx == PWDSHADOW_SL_policySubentry)
+			ad = cf->cf_policy_ad;
 
-	// determine if override value is set for attribute
-	if ( ((ps->ps_overrides)) && ((override)) )
-	{
-		if ((pwdshadow_flg_useradd(override)))
-		{
-			dat->dt_flag |= (PWDSHADOW_FLG_EVALADD | PWDSHADOW_FLG_OVERRIDE);
-			dat->dt_post = override->dt_post;
-			return(0);
-		};
-		if ( ((pwdshadow_flg_exists(override))) && (!(pwdshadow_flg_userdel(override))) )
+		cf->cf_ads[idx] = ad;
+		if (!(ad))
+			continue;
+
+		// map attribute description to slot
+		pos = pwdshadow_hash(ad) & PWDSHADOW_HASH_MASK;
+		while ( ((cf->cf_hash[pos].ha_ad)) && (cf->cf_hash[pos].ha_ad != ad) )
+			pos = (pos + 1) & PWDSHADOW_HASH_MASK;
+		if (!(cf->cf_hash[pos].ha_ad))
 		{
-			dat->dt_flag |= (PWDSHADOW_FLG_EVALADD | PWDSHADOW_FLG_OVERRIDE);
-			dat->dt_post = override->dt_post;
-			return(0);
+			cf->cf_hash[pos].ha_ad		= ad;
+			cf->cf_hash[pos].ha_slot	= idx;
+			cf->cf_hash[pos].ha_scan	= pwdshadow_slots[idx].sl_scan;
+			if ( ((cf->cf_overrides)) && ((pwdshadow_slots[idx].sl_scan & PWDSHADOW_SCAN_OVERRIDE)) )
+				cf->cf_hash[pos].ha_scan |= PWDSHADOW_SCAN_MODLIST;
+			cf->cf_hash_entry			+= (pwdshadow_slots[idx].sl_scan & PWDSHADOW_SCAN_ENTRY)  ? 1 : 0;
+			cf->cf_hash_policy			+= (pwdshadow_slots[idx].sl_scan & PWDSHADOW_SCAN_POLICY) ? 1 : 0;
 		};
-	};
 
-	// check triggers
-	for(idx = 0; ( ((triggers)) && ((triggers[idx])) ); idx++)
-	{
-		if ((pwdshadow_flg_useradd(triggers[idx])))
+		// verify attribute's syntax is compatible with slot's type
+		switch(pwdshadow_slots[idx].sl_type)
 		{
-			dat->dt_flag |= PWDSHADOW_FLG_EVALADD;
-			dat->dt_post = triggers[idx]->dt_post;
-		} else
-		if ( ((pwdshadow_flg_exists(triggers[idx]))) &&
-			(!(pwdshadow_flg_userdel(triggers[idx]))) )
+			case PWDSHADOW_TYPE_BOOL:		syntax = "1.3.6.1.4.1.1466.115.121.1.7"; break;
+			case PWDSHADOW_TYPE_DAYS:		syntax = SLAPD_INTEGER_SYNTAX; break;
+			case PWDSHADOW_TYPE_INTEGER:	syntax = SLAPD_INTEGER_SYNTAX; break;
+			case PWDSHADOW_TYPE_SECS:		syntax = SLAPD_INTEGER_SYNTAX; break;
+			case PWDSHADOW_TYPE_TIME:		syntax = "1.3.6.1.4.1.1466.115.121.1.24"; break;
+			default:						syntax = NULL; break;
+		};
+		if ( ((syntax)) && (!(is_at_syntax(ad->ad_type, syntax))) )
 		{
-			dat->dt_flag |= PWDSHADOW_FLG_EVALADD;
-			dat->dt_post = triggers[idx]->dt_post;
+			Debug(LDAP_DEBUG_ANY, "pwdshadow_state_build: attribute %s has incompatible syntax\n", ad->ad_cname.bv_val );
+			continue;
 		};
-		if ( ((pwdshadow_flg_exists(triggers[idx]))) && (!(pwdshadow_flg_userdel(triggers[idx]))) )
-			should_exist++;
-		else if ((pwdshadow_flg_useradd(triggers[idx])))
-			should_exist++;
+		cf->cf_template.st_valid |= pwdshadow_bit(idx);
 	};
+	cf->cf_template.st_cfg = cf;
 
-	// determine if attribute should be removed
-	if ( ((pwdshadow_flg_exists(dat))) && (!(should_exist)) )
-			dat->dt_flag |= PWDSHADOW_FLG_EVALDEL;
+	// order evaluation rules and map attributes to dependent rules
+	pwdshadow_rules_build(cf);
 
 	return(0);
 }
 
 
 int
-pwdshadow_flg_willexist(
-		pwdshadow_data_t *			dat )
+pwdshadow_state_initialize(
+		pwdshadow_state_t *			st,
+		pwdshadow_cfg_t *			cf )
 {
-	if ((dat->dt_flag & PWDSHADOW_FLG_EVALDEL))
-		return(0);
-	if ((dat->dt_flag & PWDSHADOW_FLG_USERDEL))
-		return(0);
-	if ((dat->dt_flag & PWDSHADOW_FLG_EXISTS))
-		return(1);
-	if ((dat->dt_flag & PWDSHADOW_FLG_USERADD))
-		return(1);
-	if ((dat->dt_flag & PWDSHADOW_FLG_EVALADD))
-		return(1);
+	// copy slots verified by pwdshadow_state_build() from the snapshot of the
+	// configuration used by the operation
+	*st = cf->cf_template;
 	return(0);
 }
 
 
-int
-pwdshadow_get_attr(
-		Entry *						entry,
-		pwdshadow_data_t *			dat,
-		int							flags )
+
+uint64_t
+pwdshadow_stats_clock(
+		pwdshadow_t *				ps )
 {
-	Attribute *			a;
-	BerValue *			bv;
+	struct timespec			ts;
 
-	if (!(dat->dt_ad))
+	// latency is only measured while statistics are published
+	if (!(ps->ps_stats_timing))
 		return(0);
 
-	if ((a = attr_find(entry->e_attrs, dat->dt_ad)) != NULL)
-		a = (a->a_numvals > 0) ? a : NULL;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return( ((uint64_t)ts.tv_sec * 1000000000ULL) + (uint64_t)ts.tv_nsec );
+}
+
+
+void
+pwdshadow_stats_latency(
+		pwdshadow_stats_t *			sx,
+		int							phase,
+		uint64_t					start )
+{
+	int						idx;
+	uint64_t				ns;
+	struct timespec			ts;
+
+	if (!(start))
+		return;
 
-	bv = ((a)) ? &a->a_nvals[0] : NULL;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	ns = ((uint64_t)ts.tv_sec * 1000000000ULL) + (uint64_t)ts.tv_nsec - start;
 
-	return(pwdshadow_set(dat, bv, flags));
+	// bucket n contains latencies from 2^n to 2^(n+1) nanoseconds
+	idx = 63 - __builtin_clzll(ns | 1);
+	if (idx >= PWDSHADOW_STATS_BUCKETS)
+		idx = PWDSHADOW_STATS_BUCKETS - 1;
+
+	__atomic_add_fetch(&sx->sx_latency[phase][idx], 1, __ATOMIC_RELAXED);
+
+	return;
 }
 
 
-int
-pwdshadow_get_attrs(
+void
+pwdshadow_stats_mod(
+		pwdshadow_stats_t *			sx,
+		int							slot,
+		int							mod_op )
+{
+	__atomic_add_fetch(&sx->sx_mods[slot][mod_op], 1, __ATOMIC_RELAXED);
+
+	return;
+}
+
+
+pwdshadow_stats_t *
+pwdshadow_stats_shard(
 		pwdshadow_t *				ps,
-		pwdshadow_state_t *			st,
-		Entry *						entry,
-		int							flags )
+		Operation *					op )
 {
-	int						flags_bool;
-	int						flags_days;
-	int						flags_exists;
-	int						flags_time;
-	int						flags_integer;
-	Attribute *				a;
-	AttributeDescription *	ad;
+	uint64_t				key;
 
-	if (!(ps))
-		return(0);
+	// a thread's context is stable for the life of the thread
+	key = (uint64_t)(uintptr_t)(((op)) ? op->o_threadctx : NULL);
+	key = (key * 0x9e3779b97f4a7c15ULL) >> 32;
 
-	flags_bool		= flags | PWDSHADOW_TYPE_BOOL;
-	flags_days		= flags | PWDSHADOW_TYPE_DAYS;
-	flags_exists	= flags | PWDSHADOW_TYPE_EXISTS;
-	flags_time		= flags | PWDSHADOW_TYPE_TIME;
-	flags_integer	= flags | PWDSHADOW_TYPE_INTEGER;
+	return(&ps->ps_stats[key % PWDSHADOW_STATS_SHARDS]);
+}
 
-	// slapo-ppolicy policy subentry
-	pwdshadow_get_attr(entry, &st->st_policySubentry,		flags_exists);
 
-	// slapo-ppolicy attributes (IETF draft-behera-ldap-password-policy-11)
-	pwdshadow_get_attr(entry, &st->st_pwdChangedTime,		flags_time);
-	pwdshadow_get_attr(entry, &st->st_pwdEndTime,			flags_time);
+void
+pwdshadow_stats_sum(
+		pwdshadow_t *				ps,
+		pwdshadow_stats_t *			sum )
+{
+	int						shard;
+	int						idx;
+	int						pos;
+	pwdshadow_stats_t *		sx;
 
-	// slapo-pwdshadow attributes
-	pwdshadow_get_attr(entry, &st->st_pwdShadowExpire,		flags_days);
-	pwdshadow_get_attr(entry, &st->st_pwdShadowFlag,		flags_integer);
-	pwdshadow_get_attr(entry, &st->st_pwdShadowGenerate,	flags_bool);
-	pwdshadow_get_attr(entry, &st->st_pwdShadowInactive,	flags_days);
-	pwdshadow_get_attr(entry, &st->st_pwdShadowLastChange,	flags_days);
-	pwdshadow_get_attr(entry, &st->st_pwdShadowMax,			flags_days);
-	pwdshadow_get_attr(entry, &st->st_pwdShadowMin,			flags_days);
-	pwdshadow_get_attr(entry, &st->st_pwdShadowWarning,		flags_days);
+	memset(sum, 0, sizeof(pwdshadow_stats_t));
 
-	// LDAP NIS attributes (RFC 2307)
-	pwdshadow_get_attr(entry, &st->st_shadowExpire,			flags_days);
-	pwdshadow_get_attr(entry, &st->st_shadowFlag,			flags_integer);
-	pwdshadow_get_attr(entry, &st->st_shadowInactive,		flags_days);
-	pwdshadow_get_attr(entry, &st->st_shadowLastChange,		flags_days);
-	pwdshadow_get_attr(entry, &st->st_shadowMax,			flags_days);
-	pwdshadow_get_attr(entry, &st->st_shadowMin,			flags_days);
-	pwdshadow_get_attr(entry, &st->st_shadowWarning,		flags_days);
+	for(shard = 0; shard < PWDSHADOW_STATS_SHARDS; shard++)
+	{
+		sx = &ps->ps_stats[shard];
+		for(idx = 0; idx < PWDSHADOW_STAT_COUNT; idx++)
+			sum->sx_counters[idx] += __atomic_load_n(&sx->sx_counters[idx], __ATOMIC_RELAXED);
+		for(idx = 0; idx < PWDSHADOW_SLOTS; idx++)
+			for(pos = 0; pos < 3; pos++)
+				sum->sx_mods[idx][pos] += __atomic_load_n(&sx->sx_mods[idx][pos], __ATOMIC_RELAXED);
+		for(idx = 0; idx < PWDSHADOW_PHASE_COUNT; idx++)
+			for(pos = 0; pos < PWDSHADOW_STATS_BUCKETS; pos++)
+				sum->sx_latency[idx][pos] += __atomic_load_n(&sx->sx_latency[idx][pos], __ATOMIC_RELAXED);
+	};
 
-	// User Schema (RFC 2256)
-	pwdshadow_get_attr(entry, &st->st_userPassword,			flags_exists);
+	return;
+}
+
+
+int
+pwdshadow_subtree_build(
+		pwdshadow_cfg_t *			cf )
+{
+	int						idx;
+	ber_len_t				end;
+	ber_len_t				pos;
+	struct berval			rdn;
+	struct berval *			ndn;
+	pwdshadow_trie_t *		node;
+	pwdshadow_trie_t *		child;
+
+	pwdshadow_subtree_free(cf->cf_subtree);
+	cf->cf_subtree = NULL;
+	if (!(cf->cf_subtree_dns))
+		return(0);
 
-	// update pwdPolicy
-	if ((ps->ps_use_policies))
+	// insert RDNs of each suffix starting with the RDN nearest the root, the
+	// separators of a normalized DN are never escaped
+	cf->cf_subtree = ch_calloc(1, sizeof(pwdshadow_trie_t));
+	for(idx = 0; ((cf->cf_subtree_dns[idx].bv_val)); idx++)
 	{
-		ad = st->st_policySubentry.dt_ad;
-		if ((a = attr_find(entry->e_attrs, ad)) != NULL)
+		ndn		= &cf->cf_subtree_dns[idx];
+		node	= cf->cf_subtree;
+		for(end = ndn->bv_len, pos = 0; end > 0; end = ((pos)) ? pos - 1 : 0)
 		{
-			if ((a = (a->a_numvals > 0) ? a : NULL) != NULL)
+			for(pos = end; ( (pos > 0) && (ndn->bv_val[pos-1] != ',') ); pos--);
+			rdn.bv_val = &ndn->bv_val[pos];
+			rdn.bv_len = end - pos;
+			for(child = node->tr_child; ( ((child)) && (!(bvmatch(&child->tr_rdn, &rdn))) ); child = child->tr_next);
+			if (!(child))
 			{
-				st->st_policy.bv_len = a->a_nvals[0].bv_len;
-				st->st_policy.bv_val = a->a_nvals[0].bv_val;
+				child			= ch_calloc(1, sizeof(pwdshadow_trie_t));
+				child->tr_rdn	= rdn;
+				child->tr_next	= node->tr_child;
+				node->tr_child	= child;
 			};
+			node = child;
 		};
+		node->tr_policy = &cf->cf_subtree_policies[idx];
 	};
 
 	return(0);
 }
 
 
-int
-pwdshadow_get_mods(
-		Modifications *				mods,
-		pwdshadow_data_t *			dat,
-		int							flags )
+struct berval *
+pwdshadow_subtree_find(
+		pwdshadow_cfg_t *			cf,
+		struct berval *				ndn,
+		int *						nestedp )
 {
-	int						op;
-	BerValue *				bv;
+	ber_len_t				end;
+	ber_len_t				pos;
+	struct berval			rdn;
+	struct berval *			policy;
+	pwdshadow_trie_t *		node;
+	pwdshadow_trie_t *		child;
+
+	if ((nestedp))
+		*nestedp = 0;
+	if ((node = cf->cf_subtree) == NULL)
+		return(NULL);
+	policy = node->tr_policy;
+
+	// descend while RDNs match, the deepest suffix with a policy is the
+	// longest matching suffix
+	for(end = ndn->bv_len, pos = 0; end > 0; end = ((pos)) ? pos - 1 : 0)
+	{
+		for(pos = end; ( (pos > 0) && (ndn->bv_val[pos-1] != ',') ); pos--);
+		rdn.bv_val = &ndn->bv_val[pos];
+		rdn.bv_len = end - pos;
+		for(child = node->tr_child; ( ((child)) && (!(bvmatch(&child->tr_rdn, &rdn))) ); child = child->tr_next);
+		if (!(child))
+			return(policy);
+		node	= child;
+		policy	= ((node->tr_policy)) ? node->tr_policy : policy;
+	};
 
-	// set attribute description
-	dat->dt_ad = ((dat->dt_ad)) ? dat->dt_ad : mods->sml_desc;
-	if (dat->dt_ad != mods->sml_desc)
-		return(-1);
+	// every RDN matched, remaining nodes are suffixes beneath the DN
+	if ((nestedp))
+		*nestedp = ((node->tr_child)) ? 1 : 0;
 
-	// determines and sets operation type
-	op = 0;
-	op = (mods->sml_op == LDAP_MOD_ADD)		? PWDSHADOW_FLG_USERADD : op;
-	op = (mods->sml_op == LDAP_MOD_DELETE)	? PWDSHADOW_FLG_USERDEL : op;
-	if (mods->sml_op == LDAP_MOD_REPLACE)
-		op = (mods->sml_numvals < 1) ? PWDSHADOW_FLG_USERDEL : PWDSHADOW_FLG_USERADD;
-	if (op == 0)
-		return(-1);
-	flags &= ~(PWDSHADOW_FLG_USERADD | PWDSHADOW_FLG_USERDEL | PWDSHADOW_FLG_EXISTS);
-	flags |= op;
+	return(policy);
+}
 
-	bv = (mods->sml_numvals > 0) ? &mods->sml_values[0]: NULL;
 
-	return(pwdshadow_set(dat, bv, flags));
+void
+pwdshadow_subtree_free(
+		pwdshadow_trie_t *			node )
+{
+	pwdshadow_trie_t *		next;
+
+	for(; ((node)); node = next)
+	{
+		next = node->tr_next;
+		pwdshadow_subtree_free(node->tr_child);
+		ch_free(node);
+	};
+
+	return;
 }
 
 
 int
-pwdshadow_initialize( void )
+pwdshadow_subtree_response(
+		Operation *					op,
+		SlapReply *					rs )
 {
-	int					i;
-	int					code;
+	int						nested[2];
+	pwdshadow_t *			ps;
+	pwdshadow_cfg_t *		cf;
+	struct berval *			prev;
+	struct berval *			post;
 
-	// register user and operation attributeTypes
-	for(i = 0; ((pwdshadow_ats[i].def)); i++)
-	{
-		if ((code = register_at(pwdshadow_ats[i].def, pwdshadow_ats[i].ad, 0)) != 0)
-		{
-			Debug( LDAP_DEBUG_ANY, "pwdshadow_initialize: register_at failed\n" );
-			return(code);
-		};
-		if ((is_at_no_user_mod((*pwdshadow_ats[i].ad)->ad_type)))
-		{
-			(*pwdshadow_ats[i].ad)->ad_type->sat_flags |= SLAP_AT_MANAGEABLE;
-		};
-	};
+	ps = op->o_callback->sc_private;
 
-	// register user objectClasses
-	for (i = 0; ((pwdshadow_ocs[i].def)); i++)
+	if ( (rs->sr_type != REP_RESULT) || (rs->sr_err != LDAP_SUCCESS) )
+		return(SLAP_CB_CONTINUE);
+
+	// recompute renamed entry and its descendants if the policy of the new
+	// DN differs or a configured suffix was beneath either DN
+	cf		= pwdshadow_cfg_get(ps);
+	prev	= pwdshadow_subtree_find(cf, &op->o_req_ndn, &nested[0]);
+	post	= pwdshadow_subtree_find(cf, &op->orr_nnewDN, &nested[1]);
+	if ( (prev == post) || ( ((prev)) && ((post)) && ((bvmatch(prev, post))) ) )
+		if ( (!(nested[0])) && (!(nested[1])) )
+			return(SLAP_CB_CONTINUE);
+	pwdshadow_regen_subtree(ps, &op->orr_nnewDN);
+
+	return(SLAP_CB_CONTINUE);
+}
+
+
+// returns 1 when the access controls of a database only depend on the DN
+// of an entry, the requestor and the requested attributes, otherwise access
+// to the cached entry may differ from access to the entry of the backend
+int
+pwdshadow_tuple_access(
+		BackendDB *					be )
+{
+	int						idx;
+	AccessControl *			acls[2];
+	AccessControl *			ac;
+	Access *				ax;
+
+	// rules of the database precede the global rules
+	acls[0]	= be->be_acl;
+	acls[1]	= frontendDB->be_acl;
+	for(idx = 0; idx < 2; idx++)
 	{
-		if ((code = register_oc(pwdshadow_ocs[i].def, pwdshadow_ocs[i].oc, 0)) != 0)
+		for(ac = acls[idx]; ((ac)); ac = ac->a_next)
 		{
-			Debug(LDAP_DEBUG_ANY, "pwdshadow_initialize: register_oc failed\n");
-			Debug(LDAP_DEBUG_ANY, "pwdshadow_initialize: %s\n", pwdshadow_ocs[i].def);
-			return(code);
+			// to filter=<filter> and to attrs=<attr> val=<value>
+			if ( ((ac->a_filter)) || ((ac->a_attrval.bv_val)) )
+				return(0);
+			for(ax = ac->a_access; ((ax)); ax = ax->a_next)
+			{
+				// by dnattr=<attr>, by realdnattr=<attr>, by set=<set>
+				// and by group=<group>
+				if ( ((ax->a_dn_at)) || ((ax->a_realdn_at)) )
+					return(0);
+				if ( ((ax->a_set_pat.bv_len)) || ((ax->a_group_pat.bv_len)) )
+					return(0);
+#ifdef SLAP_DYNACL
+				// by aci=<attr> and other dynamic access controls
+				if ((ax->a_dynacl))
+					return(0);
+#endif
+			};
 		};
 	};
 
-	// register configuration options/attributes
-	if ((code = config_register_schema( pwdshadow_cfg_ats, pwdshadow_cfg_ocs )) != 0)
-	{
-		Debug( LDAP_DEBUG_ANY, "pwdshadow_initialize: config_register_schema failed\n");
-		return(code);
-	};
-
-	ldap_pvt_thread_mutex_init(&pwdshadow_ad_mutex);
+	return(1);
+}
 
-	pwdshadow.on_bi.bi_type			= "pwdshadow";
-	pwdshadow.on_bi.bi_flags		= SLAPO_BFLAG_SINGLE;
 
-	pwdshadow.on_bi.bi_db_init		= pwdshadow_db_init;
-	pwdshadow.on_bi.bi_db_open		= pwdshadow_db_open;
-	pwdshadow.on_bi.bi_db_destroy	= pwdshadow_db_destroy;
+// frees a write watched by pwdshadow_tuple_watch()
+int
+pwdshadow_tuple_cleanup(
+		Operation *					op,
+		SlapReply *					rs )
+{
+	pwdshadow_tuple_watch_t *	tw;
 
-	pwdshadow.on_bi.bi_op_add		= pwdshadow_op_add;
-	pwdshadow.on_bi.bi_op_modify	= pwdshadow_op_modify;
+	tw				= op->o_callback->sc_private;
+	op->o_callback	= NULL;
+	ber_bvarray_free_x(tw->tw_keys, op->o_tmpmemctx);
+	op->o_tmpfree(tw, op->o_tmpmemctx);
 
-	pwdshadow.on_bi.bi_cf_ocs		= pwdshadow_cfg_ocs;
+	if (!(rs))
+		return(0);
 
-	return(overlay_register( &pwdshadow ));
+	return(0);
 }
 
 
 int
-pwdshadow_op_add(
+pwdshadow_tuple_collect(
 		Operation *					op,
 		SlapReply *					rs )
 {
-	slap_overinst *			on;
-	pwdshadow_t *			ps;
-	pwdshadow_state_t		st;
+	pwdshadow_tuple_load_t *	tl;
 
-	// initialize state
-	on						= (slap_overinst *)op->o_bd->bd_info;
-	ps						= on->on_bi.bi_private;
-	pwdshadow_state_initialize(&st, ps);
+	tl = op->o_callback->sc_private;
 
+	if (rs->sr_type != REP_SEARCH)
+		return(0);
 
-	// determines existing attribtues
-	pwdshadow_get_attrs(ps, &st, op->ora_e, PWDSHADOW_FLG_USERADD);
+	// only the first entry is packed, a key selecting multiple entries is
+	// not cached
+	if ((tl->tl_count++))
+		return(0);
+	tl->tl_tuple = pwdshadow_tuple_new(tl->tl_cfg, &tl->tl_key, rs->sr_entry);
 
-	// evaluate attributes for changes
-	pwdshadow_eval(op, &st);
+	return(0);
+}
+
+
+// caller must hold ps_tuple_mutex
+pwdshadow_tuple_t *
+pwdshadow_tuple_find(
+		pwdshadow_t *				ps,
+		struct berval *				key,
+		uint32_t					hash )
+{
+	pwdshadow_tuple_t *		tu;
+
+	for(tu = ps->ps_tuple_keys[hash & ps->ps_tuple_mask]; ((tu)); tu = tu->tu_knext)
+	{
+		if ( (tu->tu_khash != hash) || (tu->tu_nklen != key->bv_len) )
+			continue;
+		if (!(memcmp(&tu[1], key->bv_val, key->bv_len)))
+			return(tu);
+	};
+
+	return(NULL);
+}
+
+
+// FNV-1a hash of keys and normalized DNs
+uint32_t
+pwdshadow_tuple_hash(
+		struct berval *				bv )
+{
+	ber_len_t				pos;
+	uint32_t				hash;
+
+	hash = 2166136261U;
+	for(pos = 0; pos < bv->bv_len; pos++)
+		hash = (hash ^ (unsigned char)bv->bv_val[pos]) * 16777619U;
+
+	return(hash);
+}
+
+
+// caches an entry unless cached entries were removed since generation gen
+// was read, once the cache is full the first entry not referenced since the
+// clock hand last passed is evicted
+int
+pwdshadow_tuple_insert(
+		pwdshadow_t *				ps,
+		AttributeDescription *		ad,
+		unsigned long				gen,
+		pwdshadow_tuple_t *			tu )
+{
+	pwdshadow_tuple_t *		old;
+	pwdshadow_tuple_t **	bucket;
+	struct berval			bvs[4];
+
+	pwdshadow_tuple_strings(tu, bvs);
+
+	ldap_pvt_thread_mutex_lock(&ps->ps_tuple_mutex);
+
+	// entry may have been changed while it was searched
+	if ( (ps->ps_tuple_ad != ad) || (ps->ps_tuple_gen != gen) )
+	{
+		ldap_pvt_thread_mutex_unlock(&ps->ps_tuple_mutex);
+		ch_free(tu);
+		return(-1);
+	};
+
+	// replace entry cached by a concurrent search of the key
+	if ((old = pwdshadow_tuple_find(ps, &bvs[0], tu->tu_khash)) != NULL)
+		pwdshadow_tuple_remove(ps, old);
+
+	// evict entries, expired entries are evicted without a second chance
+	while (ps->ps_tuple_count >= ps->ps_tuple_max)
+	{
+		if (ps->ps_tuple_hand >= ps->ps_tuple_count)
+			ps->ps_tuple_hand = 0;
+		old = ps->ps_tuple_ring[ps->ps_tuple_hand];
+		if ( ((old->tu_flags & PWDSHADOW_TUPLE_REF)) && (old->tu_epoch == ps->ps_tuple_epoch) )
+		{
+			old->tu_flags &= ~PWDSHADOW_TUPLE_REF;
+			ps->ps_tuple_hand++;
+			continue;
+		};
+		pwdshadow_tuple_remove(ps, old);
+	};
 
-	// processing changes
-	pwdshadow_op_add_attr(op->ora_e, &st.st_pwdShadowExpire);
-	pwdshadow_op_add_attr(op->ora_e, &st.st_pwdShadowFlag);
-	pwdshadow_op_add_attr(op->ora_e, &st.st_pwdShadowInactive);
-	pwdshadow_op_add_attr(op->ora_e, &st.st_pwdShadowLastChange);
-	pwdshadow_op_add_attr(op->ora_e, &st.st_pwdShadowMax);
-	pwdshadow_op_add_attr(op->ora_e, &st.st_pwdShadowMin);
-	pwdshadow_op_add_attr(op->ora_e, &st.st_pwdShadowWarning);
+	// link entry
+	tu->tu_epoch							= ps->ps_tuple_epoch;
+	tu->tu_ring								= ps->ps_tuple_count;
+	ps->ps_tuple_ring[ps->ps_tuple_count++]	= tu;
+	ps->ps_tuple_bytes						+= tu->tu_size;
+	bucket									= &ps->ps_tuple_keys[tu->tu_khash & ps->ps_tuple_mask];
+	tu->tu_knext							= *bucket;
+	*bucket									= tu;
+	if (!(tu->tu_flags & PWDSHADOW_TUPLE_BYPASS))
+	{
+		bucket			= &ps->ps_tuple_dns[tu->tu_dhash & ps->ps_tuple_mask];
+		tu->tu_dnext	= *bucket;
+		*bucket			= tu;
+	};
 
-	if (!(rs))
-		return(SLAP_CB_CONTINUE);
+	ldap_pvt_thread_mutex_unlock(&ps->ps_tuple_mutex);
 
-	return(SLAP_CB_CONTINUE);
+	return(0);
 }
 
 
+// removes the cached entry of a DN and the cached entries of keys, or
+// expires every cached entry
 int
-pwdshadow_op_add_attr(
-		Entry *						entry,
-		pwdshadow_data_t *			dat )
+pwdshadow_tuple_invalidate(
+		pwdshadow_t *				ps,
+		struct berval *				ndn,
+		BerVarray					keys,
+		int							flush )
 {
-	struct berval	bv;
-	char			bv_val[128];
+	int						idx;
+	uint32_t				hash;
+	pwdshadow_tuple_t *		tu;
+	pwdshadow_tuple_t **	tup;
+	struct berval			bvs[4];
+
+	ldap_pvt_thread_mutex_lock(&ps->ps_tuple_mutex);
 
-	if ((pwdshadow_flg_usermods(dat)))
+	// searches started before the change do not cache their result
+	ps->ps_tuple_gen++;
+	if (!(ps->ps_tuple_count))
+	{
+		ldap_pvt_thread_mutex_unlock(&ps->ps_tuple_mutex);
 		return(0);
-	if ( (!(dat->dt_ad)) || (!(dat->dt_flag & PWDSHADOW_FLG_EVALADD)) )
+	};
+
+	// entries are expired and evicted later
+	if ((flush))
+	{
+		ps->ps_tuple_epoch++;
+		ldap_pvt_thread_mutex_unlock(&ps->ps_tuple_mutex);
 		return(0);
+	};
+
+	hash = pwdshadow_tuple_hash(ndn);
+	for(tup = &ps->ps_tuple_dns[hash & ps->ps_tuple_mask]; ((*tup)); )
+	{
+		tu = *tup;
+		pwdshadow_tuple_strings(tu, bvs);
+		if ( (tu->tu_dhash != hash) || (!(bvmatch(&bvs[2], ndn))) )
+		{
+			tup = &tu->tu_dnext;
+			continue;
+		};
+		pwdshadow_tuple_remove(ps, tu);
+	};
 
-	// convert int to BV
-	bv.bv_val = bv_val;
-	bv.bv_len = snprintf(bv_val, sizeof(bv_val), "%i", dat->dt_post);
+	for(idx = 0; ( ((keys)) && ((keys[idx].bv_val)) ); idx++)
+		if ((tu = pwdshadow_tuple_find(ps, &keys[idx], pwdshadow_tuple_hash(&keys[idx]))) != NULL)
+			pwdshadow_tuple_remove(ps, tu);
 
-	// add attribute to entry
-	attr_merge_one(entry, dat->dt_ad, &bv, &bv);
+	ldap_pvt_thread_mutex_unlock(&ps->ps_tuple_mutex);
 
 	return(0);
 }
 
 
+// selects the entries of a key as the rootdn and caches the result, returns
+// 0 with a copy of the cached entry in the operation's memory, otherwise the
+// key bypasses the cache, the caller holds the snapshot across the search
 int
-pwdshadow_op_modify(
+pwdshadow_tuple_load(
 		Operation *					op,
-		SlapReply *					rs )
+		pwdshadow_t *				ps,
+		pwdshadow_cfg_t *			cf,
+		struct berval *				key,
+		unsigned long				gen,
+		pwdshadow_tuple_t **		tup )
 {
 	int						rc;
 	slap_overinst *			on;
-	pwdshadow_t *			ps;
-	Modifications *			mods;
-	Modifications **		next;
-	Entry *					entry;
-	BackendInfo *			bd_info;
-	pwdshadow_state_t		st;
+	Operation				op2;
+	BackendDB				db;
+	Filter					f;
+	AttributeAssertion		ava;
+	pwdshadow_tuple_t *		tu;
+	pwdshadow_tuple_load_t	tl;
+	SlapReply				rs2		= { REP_RESULT };
 
-	// initialize state
-	on					= (slap_overinst *)op->o_bd->bd_info;
-	ps					= on->on_bi.bi_private;
-	pwdshadow_state_initialize(&st, ps);
+	on						= (slap_overinst *)op->o_bd->bd_info;
 
-	// retrieve entry from backend
-	bd_info				= op->o_bd->bd_info;
-	op->o_bd->bd_info	= (BackendInfo *)on->on_info;
-	rc					= be_entry_get_rw( op, &op->o_req_ndn, NULL, NULL, 0, &entry );
-	op->o_bd->bd_info	= (BackendInfo *)bd_info;
-	if ( rc != LDAP_SUCCESS )
-		return(SLAP_CB_CONTINUE);
+	memset(&tl, 0, sizeof(tl));
+	tl.tl_cb.sc_response	= pwdshadow_tuple_collect;
+	tl.tl_cb.sc_private		= &tl;
+	tl.tl_cfg				= cf;
+	tl.tl_key				= *key;
+
+	memset(&ava, 0, sizeof(ava));
+	memset(&f, 0, sizeof(f));
+	ava.aa_desc				= cf->cf_tuple_ad;
+	ava.aa_value			= *key;
+	f.f_choice				= LDAP_FILTER_EQUALITY;
+	f.f_ava					= &ava;
+
+	// search the database through every overlay, pwdshadow_tuple_search()
+	// passes the search to the backend
+	op2						= *op;
+	db						= *op->o_bd;
+	db.bd_info				= (BackendInfo *)on->on_info;
+	op2.o_bd				= &db;
+	op2.o_dn				= db.be_rootdn;
+	op2.o_ndn				= db.be_rootndn;
+	op2.o_req_dn			= db.be_suffix[0];
+	op2.o_req_ndn			= db.be_nsuffix[0];
+	op2.o_callback			= &tl.tl_cb;
+	op2.ors_scope			= LDAP_SCOPE_SUBTREE;
+	op2.ors_deref			= LDAP_DEREF_NEVER;
+	op2.ors_slimit			= SLAP_NO_LIMIT;
+	op2.ors_tlimit			= SLAP_NO_LIMIT;
+	op2.ors_limit			= NULL;
+	op2.ors_attrsonly		= 0;
+	op2.ors_attrs			= NULL;
+	op2.ors_filter			= &f;
+	filter2bv_x(&op2, &f, &op2.ors_filterstr);
+	op2.o_bd->be_search(&op2, &rs2);
+	op->o_tmpfree(op2.ors_filterstr.bv_val, op->o_tmpmemctx);
+
+	// result of a failed search is not cached
+	if (rs2.sr_err != LDAP_SUCCESS)
+	{
+		ch_free(tl.tl_tuple);
+		return(1);
+	};
+	if (tl.tl_count != 1)
+	{
+		ch_free(tl.tl_tuple);
+		tl.tl_tuple = pwdshadow_tuple_new(cf, key, NULL);
+	};
 
-	// determines existing attribtues
-	pwdshadow_get_attrs(ps, &st, entry, PWDSHADOW_FLG_EXISTS);
+	// copy entry before it may be evicted by other operations
+	rc = 1;
+	tu = tl.tl_tuple;
+	if (!(tu->tu_flags & PWDSHADOW_TUPLE_BYPASS))
+	{
+		*tup = op->o_tmpalloc(tu->tu_size, op->o_tmpmemctx);
+		memcpy(*tup, tu, tu->tu_size);
+		rc = 0;
+	};
+	pwdshadow_tuple_insert(ps, cf->cf_tuple_ad, gen, tu);
 
-	// release entry
-	op->o_bd->bd_info = (BackendInfo *)on->on_info;
-	be_entry_release_r( op, entry );
-	op->o_bd->bd_info = (BackendInfo *)bd_info;
+	return(rc);
+}
 
-	// scan modifications for attributes of interest
-	for(next = &op->orm_modlist; ((*next)); next = &(*next)->sml_next)
-	{
-		mods = *next;
 
-		if (mods->sml_desc == st.st_pwdEndTime.dt_ad)
-			pwdshadow_get_mods(mods, &st.st_pwdEndTime, PWDSHADOW_TYPE_TIME);
+// copies the cached entry of a key into the operation's memory, returns 0
+// if the entry is cached, 1 if the key bypasses the cache and -1 with the
+// generation to be passed to pwdshadow_tuple_insert() if the key is not
+// cached
+int
+pwdshadow_tuple_lookup(
+		Operation *					op,
+		pwdshadow_t *				ps,
+		AttributeDescription *		ad,
+		struct berval *				key,
+		unsigned long *				genp,
+		pwdshadow_tuple_t **		tup )
+{
+	uint32_t				hash;
+	pwdshadow_tuple_t *		tu;
+
+	hash = pwdshadow_tuple_hash(key);
 
-		if (mods->sml_desc == st.st_pwdShadowExpire.dt_ad)
-			pwdshadow_get_mods(mods, &st.st_pwdShadowExpire, PWDSHADOW_TYPE_DAYS);
+	ldap_pvt_thread_mutex_lock(&ps->ps_tuple_mutex);
+
+	// cache was reconfigured since the operation started
+	if (ps->ps_tuple_ad != ad)
+	{
+		ldap_pvt_thread_mutex_unlock(&ps->ps_tuple_mutex);
+		return(1);
+	};
 
-		if (mods->sml_desc == st.st_pwdShadowFlag.dt_ad)
-			pwdshadow_get_mods(mods, &st.st_pwdShadowFlag, PWDSHADOW_TYPE_INTEGER);
+	*genp = ps->ps_tuple_gen;
+	if ( ((tu = pwdshadow_tuple_find(ps, key, hash)) != NULL) && (tu->tu_epoch != ps->ps_tuple_epoch) )
+	{
+		pwdshadow_tuple_remove(ps, tu);
+		tu = NULL;
+	};
+	if (!(tu))
+	{
+		ldap_pvt_thread_mutex_unlock(&ps->ps_tuple_mutex);
+		return(-1);
+	};
 
-		if (mods->sml_desc == st.st_pwdShadowGenerate.dt_ad)
-			pwdshadow_get_mods(mods, &st.st_pwdShadowGenerate, PWDSHADOW_TYPE_BOOL);
+	tu->tu_flags |= PWDSHADOW_TUPLE_REF;
+	if ((tu->tu_flags & PWDSHADOW_TUPLE_BYPASS))
+	{
+		ldap_pvt_thread_mutex_unlock(&ps->ps_tuple_mutex);
+		return(1);
+	};
+	*tup = op->o_tmpalloc(tu->tu_size, op->o_tmpmemctx);
+	memcpy(*tup, tu, tu->tu_size);
 
-		if (mods->sml_desc == st.st_pwdShadowInactive.dt_ad)
-			pwdshadow_get_mods(mods, &st.st_pwdShadowInactive, PWDSHADOW_TYPE_DAYS);
+	ldap_pvt_thread_mutex_unlock(&ps->ps_tuple_mutex);
 
-		if (mods->sml_desc == st.st_pwdShadowLastChange.dt_ad)
-			pwdshadow_get_mods(mods, &st.st_pwdShadowLastChange, PWDSHADOW_TYPE_DAYS);
+	return(0);
+}
 
-		if (mods->sml_desc == st.st_pwdShadowMax.dt_ad)
-			pwdshadow_get_mods(mods, &st.st_pwdShadowMax, PWDSHADOW_TYPE_DAYS);
 
-		if (mods->sml_desc == st.st_pwdShadowMin.dt_ad)
-			pwdshadow_get_mods(mods, &st.st_pwdShadowMin, PWDSHADOW_TYPE_DAYS);
+// packs the key and the attributes of an entry, a key without an entry or
+// an entry whose attributes can not be cached bypasses the cache
+pwdshadow_tuple_t *
+pwdshadow_tuple_new(
+		pwdshadow_cfg_t *			cf,
+		struct berval *				key,
+		Entry *						entry )
+{
+	int						idx;
+	int						pos;
+	int						slot;
+	int						flags;
+	unsigned				count;
+	size_t					size;
+	char *					ptr;
+	Attribute *				a;
+	Attribute *				ka;
+	const pwdshadow_rule_t *	ru;
+	pwdshadow_tuple_t *		tu;
+	struct berval			val;
+	struct berval			ndn;
+	struct berval			dn;
+	pwdshadow_state_t		st;
 
-		if (mods->sml_desc == st.st_pwdShadowWarning.dt_ad)
-			pwdshadow_get_mods(mods, &st.st_pwdShadowWarning, PWDSHADOW_TYPE_DAYS);
+	flags	= PWDSHADOW_TUPLE_BYPASS;
+	ka		= NULL;
+	pwdshadow_state_initialize(&st, cf);
 
-		if (mods->sml_desc == st.st_userPassword.dt_ad)
-			pwdshadow_get_mods(mods, &st.st_userPassword, PWDSHADOW_TYPE_EXISTS);
+	if ((entry))
+	{
+		// key attribute, including subtypes, must have a single value
+		for(a = entry->e_attrs, count = 0; ((a)); a = a->a_next)
+		{
+			if (a->a_desc->ad_type != cf->cf_tuple_ad->ad_type)
+				continue;
+			count	+= a->a_numvals;
+			ka		= (a->a_desc == cf->cf_tuple_ad) ? a : ka;
+		};
+		if ( (count == 1) && ((ka)) && (ka->a_vals[0].bv_len <= UINT16_MAX) &&
+		     (entry->e_name.bv_len <= UINT16_MAX) && (entry->e_nname.bv_len <= UINT16_MAX) )
+			flags = 0;
 
-		if (mods->sml_desc == st.st_policySubentry.dt_ad)
+		// values of shadow and generated attributes must be valid
+		pwdshadow_get_attrs(&st, entry, PWDSHADOW_FLG_EXISTS);
+		for(idx = 0; idx < PWDSHADOW_RULES; idx++)
 		{
-			pwdshadow_get_mods(mods, &st.st_policySubentry, PWDSHADOW_TYPE_EXISTS);
-			if ((pwdshadow_flg_userdel(&st.st_policySubentry)))
-			{
-				st.st_policy.bv_len = 0;
-				st.st_policy.bv_val = NULL;
-			};
-			if ((pwdshadow_flg_useradd(&st.st_policySubentry)))
+			ru = &pwdshadow_rules[idx];
+			for(pos = 0; pos < 2; pos++)
 			{
-				st.st_policy.bv_len = mods->sml_values[0].bv_len;
-				st.st_policy.bv_val = mods->sml_values[0].bv_val;
+				slot = (pos) ? ru->ru_slot : ru->ru_override;
+				if ( (!(cf->cf_ads[slot])) || ((st.st_exists & pwdshadow_bit(slot))) )
+					continue;
+				if ((attr_find(entry->e_attrs, cf->cf_ads[slot])))
+					flags = PWDSHADOW_TUPLE_BYPASS;
 			};
 		};
+	};
 
-		// skip remaining attributes if override is disabled
-		if (!(ps->ps_overrides))
-			continue;
-
-		if (mods->sml_desc == st.st_shadowExpire.dt_ad)
-			pwdshadow_get_mods(mods, &st.st_shadowExpire, PWDSHADOW_TYPE_DAYS);
-
-		if (mods->sml_desc == st.st_shadowFlag.dt_ad)
-			pwdshadow_get_mods(mods, &st.st_shadowFlag, PWDSHADOW_TYPE_INTEGER);
+	// strings of the entry
+	val = *key;
+	BER_BVZERO(&ndn);
+	BER_BVZERO(&dn);
+	if (!(flags & PWDSHADOW_TUPLE_BYPASS))
+	{
+		val		= ka->a_vals[0];
+		ndn		= entry->e_nname;
+		dn		= entry->e_name;
+		flags	|= ( ((oc_shadowAccount)) && ((is_entry_objectclass(entry, oc_shadowAccount, 0))) ) ? PWDSHADOW_TUPLE_SHADOW : 0;
+	};
+	flags |= (bvmatch(&val, key)) ? PWDSHADOW_TUPLE_SAMEVAL : 0;
+	flags |= ( ((flags & PWDSHADOW_TUPLE_BYPASS)) || ((bvmatch(&dn, &ndn))) ) ? PWDSHADOW_TUPLE_SAMEDN : 0;
+
+	size  = sizeof(pwdshadow_tuple_t);
+	size += key->bv_len + 1;
+	size += (flags & PWDSHADOW_TUPLE_SAMEVAL) ? 0 : val.bv_len + 1;
+	size += ndn.bv_len + 1;
+	size += (flags & PWDSHADOW_TUPLE_SAMEDN) ? 0 : dn.bv_len + 1;
+
+	tu				= ch_calloc(1, size);
+	tu->tu_size		= size;
+	tu->tu_flags	= flags;
+	tu->tu_nklen	= key->bv_len;
+	tu->tu_klen		= val.bv_len;
+	tu->tu_ndnlen	= ndn.bv_len;
+	tu->tu_dnlen	= dn.bv_len;
+	tu->tu_khash	= pwdshadow_tuple_hash(key);
+	tu->tu_dhash	= pwdshadow_tuple_hash(&ndn);
+
+	// values of shadow and generated attributes
+	for(idx = 0; ( (!(flags & PWDSHADOW_TUPLE_BYPASS)) && (idx < PWDSHADOW_RULES) ); idx++)
+	{
+		ru						= &pwdshadow_rules[idx];
+		tu->tu_exists			|= st.st_exists & (pwdshadow_bit(ru->ru_override) | pwdshadow_bit(ru->ru_slot));
+		tu->tu_vals[idx][0]		= st.st_post[ru->ru_override];
+		tu->tu_vals[idx][1]		= st.st_post[ru->ru_slot];
+	};
 
-		if (mods->sml_desc == st.st_shadowInactive.dt_ad)
-			pwdshadow_get_mods(mods, &st.st_shadowInactive, PWDSHADOW_TYPE_DAYS);
+	// strings are terminated by the zeroed allocation
+	ptr = (char *)&tu[1];
+	memcpy(ptr, key->bv_val, key->bv_len);
+	ptr += key->bv_len + 1;
+	if (!(flags & PWDSHADOW_TUPLE_SAMEVAL))
+	{
+		memcpy(ptr, val.bv_val, val.bv_len);
+		ptr += val.bv_len + 1;
+	};
+	if ((ndn.bv_len))
+		memcpy(ptr, ndn.bv_val, ndn.bv_len);
+	ptr += ndn.bv_len + 1;
+	if (!(flags & PWDSHADOW_TUPLE_SAMEDN))
+		memcpy(ptr, dn.bv_val, dn.bv_len);
 
-		if (mods->sml_desc == st.st_shadowLastChange.dt_ad)
-			pwdshadow_get_mods(mods, &st.st_shadowLastChange, PWDSHADOW_TYPE_DAYS);
+	return(tu);
+}
 
-		if (mods->sml_desc == st.st_shadowMax.dt_ad)
-			pwdshadow_get_mods(mods, &st.st_shadowMax, PWDSHADOW_TYPE_DAYS);
 
-		if (mods->sml_desc == st.st_shadowMin.dt_ad)
-			pwdshadow_get_mods(mods, &st.st_shadowMin, PWDSHADOW_TYPE_DAYS);
+// caller must hold ps_tuple_mutex
+void
+pwdshadow_tuple_remove(
+		pwdshadow_t *				ps,
+		pwdshadow_tuple_t *			tu )
+{
+	pwdshadow_tuple_t **	tup;
 
-		if (mods->sml_desc == st.st_shadowWarning.dt_ad)
-			pwdshadow_get_mods(mods, &st.st_shadowWarning, PWDSHADOW_TYPE_DAYS);
+	// unlink from hash chains
+	for(tup = &ps->ps_tuple_keys[tu->tu_khash & ps->ps_tuple_mask]; (*tup != tu); tup = &(*tup)->tu_knext);
+	*tup = tu->tu_knext;
+	if (!(tu->tu_flags & PWDSHADOW_TUPLE_BYPASS))
+	{
+		for(tup = &ps->ps_tuple_dns[tu->tu_dhash & ps->ps_tuple_mask]; (*tup != tu); tup = &(*tup)->tu_dnext);
+		*tup = tu->tu_dnext;
 	};
 
-	// evaluate attributes for changes
-	pwdshadow_eval(op, &st);
-
-	// processing pwdShadowLastChange
-	pwdshadow_op_modify_mods(&st.st_pwdShadowExpire,		&next);
-	pwdshadow_op_modify_mods(&st.st_pwdShadowFlag,			&next);
-	pwdshadow_op_modify_mods(&st.st_pwdShadowInactive,		&next);
-	pwdshadow_op_modify_mods(&st.st_pwdShadowLastChange,	&next);
-	pwdshadow_op_modify_mods(&st.st_pwdShadowMax,			&next);
-	pwdshadow_op_modify_mods(&st.st_pwdShadowMin,			&next);
-	pwdshadow_op_modify_mods(&st.st_pwdShadowWarning,		&next);
+	// last entry of the clock takes the removed entry's position
+	ps->ps_tuple_count--;
+	ps->ps_tuple_ring[tu->tu_ring]					= ps->ps_tuple_ring[ps->ps_tuple_count];
+	ps->ps_tuple_ring[tu->tu_ring]->tu_ring			= tu->tu_ring;
+	ps->ps_tuple_ring[ps->ps_tuple_count]			= NULL;
+	ps->ps_tuple_bytes								-= tu->tu_size;
 
-	if (!(rs))
-		return(SLAP_CB_CONTINUE);
+	ch_free(tu);
 
-	return(SLAP_CB_CONTINUE);
+	return;
 }
 
 
+// frees cached entries and sizes the cache for a key attribute, the thread
+// pool is paused or the database is not open
 int
-pwdshadow_op_modify_mods(
-		pwdshadow_data_t *			dat,
-		Modifications ***			nextp )
+pwdshadow_tuple_reset(
+		pwdshadow_t *				ps,
+		AttributeDescription *		ad,
+		unsigned long				max )
 {
-	AttributeDescription *	ad;
-	Modifications *			mods;
-
-	if ((pwdshadow_flg_usermods(dat)))
-		return(0);
-	if ( (!(pwdshadow_ops(dat->dt_flag))) || (!(dat->dt_ad)) )
-		return(0);
-	ad = dat->dt_ad;
-
-	// create initial modification
-	mods = (Modifications *) ch_malloc( sizeof( Modifications ) );
-	mods->sml_op				= LDAP_MOD_DELETE;
-	mods->sml_flags				= SLAP_MOD_INTERNAL;
-	mods->sml_type.bv_val		= NULL;
-	mods->sml_desc				= ad;
-	mods->sml_numvals			= 0;
-	mods->sml_values			= NULL;
-	mods->sml_nvalues			= NULL;
-	mods->sml_next				= NULL;
-	**nextp						= mods;
-	(*nextp)					= &mods->sml_next;
-
-	// exit if deleting entry
-	if ((pwdshadow_flg_evaldel(dat)))
-		return(0);
+	unsigned long			idx;
+	unsigned long			buckets;
+
+	ldap_pvt_thread_mutex_lock(&ps->ps_tuple_mutex);
+
+	for(idx = 0; idx < ps->ps_tuple_count; idx++)
+		ch_free(ps->ps_tuple_ring[idx]);
+	ch_free(ps->ps_tuple_keys);
+	ch_free(ps->ps_tuple_dns);
+	ch_free(ps->ps_tuple_ring);
+	ps->ps_tuple_keys	= NULL;
+	ps->ps_tuple_dns	= NULL;
+	ps->ps_tuple_ring	= NULL;
+	ps->ps_tuple_count	= 0;
+	ps->ps_tuple_mask	= 0;
+	ps->ps_tuple_hand	= 0;
+	ps->ps_tuple_bytes	= 0;
+	ps->ps_tuple_ad		= ad;
+	ps->ps_tuple_max	= max;
+	ps->ps_tuple_gen++;
+
+	// chains of hash tables average two entries once the cache is full
+	if ((ad))
+	{
+		for(buckets = 1; (buckets * 2) < max; buckets <<= 1);
+		ps->ps_tuple_mask	= buckets - 1;
+		ps->ps_tuple_keys	= ch_calloc(buckets, sizeof(pwdshadow_tuple_t *));
+		ps->ps_tuple_dns	= ch_calloc(buckets, sizeof(pwdshadow_tuple_t *));
+		ps->ps_tuple_ring	= ch_calloc(max, sizeof(pwdshadow_tuple_t *));
+		ps->ps_tuple_bytes	= ((buckets * 2) + max) * sizeof(pwdshadow_tuple_t *);
+	};
 
-	// complete modifications for adding/updating value
-	mods->sml_op				= LDAP_MOD_REPLACE;
-	mods->sml_numvals			= 1;
-	mods->sml_values			= ch_calloc( sizeof( struct berval ), 2 );
-	pwdshadow_copy_int_bv(dat->dt_post, &mods->sml_values[0]);
-	mods->sml_values[1].bv_val	= NULL;
-	mods->sml_values[1].bv_len	= 0;
+	ldap_pvt_thread_mutex_unlock(&ps->ps_tuple_mutex);
 
 	return(0);
 }
 
 
 int
-pwdshadow_set(
-		pwdshadow_data_t *			dat,
-		BerValue *					bv,
-		int							flags )
+pwdshadow_tuple_response(
+		Operation *					op,
+		SlapReply *					rs )
 {
-	int						type;
-	int						ival;
-	struct lutil_tm			tm;
-	struct lutil_timet		tt;
-	AttributeDescription *	ad;
-
-	ad		= dat->dt_ad;
-	type	= ((pwdshadow_type(dat->dt_flag))) ? pwdshadow_type(dat->dt_flag) : pwdshadow_type(flags);
-	if (pwdshadow_type(flags) != type)
-		return(-1);
+	pwdshadow_tuple_watch_t *	tw;
 
-	if ((flags & PWDSHADOW_FLG_USERDEL))
-		return(pwdshadow_set_value(dat, 0, flags));
-	if (!(bv))
-		return(-1);
+	tw = op->o_callback->sc_private;
 
-	switch(type)
-	{
-		case PWDSHADOW_TYPE_BOOL:
-		if (!(is_at_syntax(ad->ad_type, "1.3.6.1.4.1.1466.115.121.1.7")))
-			return(-1);
-		ival = 0;
-		if ( ((bv)) && ((bv->bv_val)) && (!(strcasecmp(bv->bv_val, "TRUE"))) )
-			ival = 1;
-		return(pwdshadow_set_value(dat, ival, flags));
+	if (rs->sr_type != REP_RESULT)
+		return(SLAP_CB_CONTINUE);
 
-		case PWDSHADOW_TYPE_DAYS:
-		if (!(is_at_syntax(ad->ad_type, SLAPD_INTEGER_SYNTAX)))
-			return(-1);
-		lutil_atoi(&ival, bv->bv_val);
-		return(pwdshadow_set_value(dat, ival, flags));
+	pwdshadow_tuple_invalidate(tw->tw_ps, &op->o_req_ndn, tw->tw_keys, tw->tw_flush);
 
-		case PWDSHADOW_TYPE_EXISTS:
-		ival = ( ((bv)) && ((bv->bv_len)) ) ? 1 : 0;
-		return(pwdshadow_set_value(dat, ival, flags));
+	return(SLAP_CB_CONTINUE);
+}
 
-		case PWDSHADOW_TYPE_INTEGER:
-		if (!(is_at_syntax(ad->ad_type, SLAPD_INTEGER_SYNTAX)))
-			return(-1);
-		lutil_atoi(&ival, bv->bv_val);
-		return(pwdshadow_set_value(dat, ival, flags));
 
-		case PWDSHADOW_TYPE_SECS:
-		if (!(is_at_syntax(ad->ad_type, SLAPD_INTEGER_SYNTAX)))
-			return(-1);
-		lutil_atoi(&ival, bv->bv_val);
-		ival /= 60 * 60 * 24;
-		return(pwdshadow_set_value(dat, ival, flags));
+// answers an equality search of a key, such as the
+// (&(objectClass=shadowAccount)(uid=jdoe)) of NSS shadow lookups, from the
+// cached entry of the key, otherwise the search is passed to the backend, the
+// cached entry holds a subset of the attributes of the entry and is only
+// returned when the access controls do not depend on the entry's contents
+int
+pwdshadow_tuple_search(
+		Operation *					op,
+		SlapReply *					rs,
+		pwdshadow_t *				ps,
+		pwdshadow_cfg_t *			cf )
+{
+	int						n;
+	int						rc;
+	int						idx;
+	int						pos;
+	int						slot;
+	int						hit;
+	unsigned long			gen;
+	slap_overinst *			on;
+	BackendInfo *			bd_info;
+	slap_callback *			sc;
+	Filter *				f;
+	AttributeName *			an;
+	struct berval *			key;
+	struct berval			parent;
+	const pwdshadow_rule_t *	ru;
+	pwdshadow_hash_t *		ha;
+	pwdshadow_stats_t *		sx;
+	pwdshadow_tuple_t *		tu;
+	Entry					e;
+	Attribute				attrs[(PWDSHADOW_RULES * 2) + 2];
+	struct berval			bvs[4];
+	struct berval			ocs[2];
+	struct berval			keys[2];
+	struct berval			nkeys[2];
+	struct berval			vals[PWDSHADOW_RULES * 2][2];
+	char					buff[PWDSHADOW_RULES * 2][PWDSHADOW_INT_LEN];
+
+	on = (slap_overinst *)op->o_bd->bd_info;
+
+	// only searches without controls for listed attributes are answered
+	if ( (!(cf->cf_tuple_ad)) || (cf->cf_mode != PWDSHADOW_MODE_STORED) )
+		return(SLAP_CB_CONTINUE);
+	if ( ((op->o_ctrls)) || (!(op->ors_attrs)) || (!(op->ors_filter)) || ((op->ors_deref & LDAP_DEREF_SEARCHING)) )
+		return(SLAP_CB_CONTINUE);
 
-		case PWDSHADOW_TYPE_TIME:
-		if (!(is_at_syntax(ad->ad_type, "1.3.6.1.4.1.1466.115.121.1.24")))
-			return(-1);
-		if (lutil_parsetime(bv->bv_val, &tm) != 0)
-			return(-1);
-		lutil_tm2time(&tm, &tt);
-		ival = (int)tt.tt_sec;
-		ival /= 60 * 60 * 24; // convert from seconds to days
-		return(pwdshadow_set_value(dat, ival, flags));
+	// the cached entry is loaded as the rootdn and access controls are only
+	// checked against the cached attributes, rules selecting entries by
+	// filter or granting access by the values of attributes would be checked
+	// against the wrong entry
+	if (!(pwdshadow_tuple_access(op->o_bd)))
+		return(SLAP_CB_CONTINUE);
 
-		default:
-		Debug( LDAP_DEBUG_ANY, "pwdshadow: pwdshadow_set(): unknown data type\n" );
-		return(-1);
+	// filter must select a single key, optionally of shadowAccount entries
+	key = NULL;
+	f	= (op->ors_filter->f_choice == LDAP_FILTER_AND) ? op->ors_filter->f_and : op->ors_filter;
+	for(; ((f)); f = f->f_next)
+	{
+		if (f->f_choice != LDAP_FILTER_EQUALITY)
+			return(SLAP_CB_CONTINUE);
+		if ( (f->f_av_desc == cf->cf_tuple_ad) && (!(key)) )
+			key = &f->f_av_value;
+		else if ( (!(oc_shadowAccount)) || (f->f_av_desc != ad_objectClass) || (oc_bvfind(&f->f_av_value) != oc_shadowAccount) )
+			return(SLAP_CB_CONTINUE);
 	};
+	if ( (!(key)) || (key->bv_len > UINT16_MAX) )
+		return(SLAP_CB_CONTINUE);
 
-	return(0);
-}
-
+	// internal search of pwdshadow_tuple_load()
+	for(sc = op->o_callback; ((sc)); sc = sc->sc_next)
+		if (sc->sc_response == pwdshadow_tuple_collect)
+			return(SLAP_CB_CONTINUE);
+
+	sx	= pwdshadow_stats_shard(ps, op);
+	tu	= NULL;
+	rc	= pwdshadow_tuple_lookup(op, ps, cf->cf_tuple_ad, key, &gen, &tu);
+	hit	= (rc == 0);
+	if (rc < 0)
+		rc = pwdshadow_tuple_load(op, ps, cf, key, gen, &tu);
+	if (rc != 0)
+	{
+		pwdshadow_stats_inc(sx, PWDSHADOW_STAT_TUPLE_MISSES);
+		return(SLAP_CB_CONTINUE);
+	};
 
-int
-pwdshadow_set_value(
-		pwdshadow_data_t *			dat,
-		int							val,
-		int							flags )
-{
-	int op;
+	// entry with the objectClass, key, shadow and generated attributes
+	memset(&e, 0, sizeof(e));
+	memset(attrs, 0, sizeof(attrs));
+	memset(ocs, 0, sizeof(ocs));
+	memset(keys, 0, sizeof(keys));
+	memset(nkeys, 0, sizeof(nkeys));
+	memset(vals, 0, sizeof(vals));
+	pwdshadow_tuple_strings(tu, bvs);
+	e.e_name	= bvs[3];
+	e.e_nname	= bvs[2];
+	e.e_attrs	= attrs;
+	n			= 0;
+	if ((tu->tu_flags & PWDSHADOW_TUPLE_SHADOW))
+	{
+		ocs[0]				= oc_shadowAccount->soc_cname;
+		attrs[n].a_desc		= ad_objectClass;
+		attrs[n].a_vals		= ocs;
+		attrs[n].a_nvals	= ocs;
+		n++;
+	};
+	keys[0]				= bvs[1];
+	nkeys[0]			= bvs[0];
+	attrs[n].a_desc		= cf->cf_tuple_ad;
+	attrs[n].a_vals		= keys;
+	attrs[n].a_nvals	= nkeys;
+	n++;
+	for(idx = 0; idx < PWDSHADOW_RULES; idx++)
+	{
+		ru = &pwdshadow_rules[idx];
+		for(pos = 0; pos < 2; pos++)
+		{
+			slot = (pos) ? ru->ru_slot : ru->ru_override;
+			if ( (!(cf->cf_ads[slot])) || (!(tu->tu_exists & pwdshadow_bit(slot))) )
+				continue;
+			vals[(idx * 2) + pos][0].bv_val	= buff[(idx * 2) + pos];
+			vals[(idx * 2) + pos][0].bv_len	= pwdshadow_int2str(tu->tu_vals[idx][pos], buff[(idx * 2) + pos]);
+			attrs[n].a_desc					= cf->cf_ads[slot];
+			attrs[n].a_vals					= vals[(idx * 2) + pos];
+			attrs[n].a_nvals				= vals[(idx * 2) + pos];
+			n++;
+		};
+	};
+	for(idx = 0; idx < n; idx++)
+	{
+		attrs[idx].a_numvals	= 1;
+		attrs[idx].a_next		= ((idx + 1) < n) ? &attrs[idx + 1] : NULL;
+	};
 
-	op  = PWDSHADOW_FLG_EXISTS;
-	op |= PWDSHADOW_FLG_USERADD;
-	op |= PWDSHADOW_FLG_USERDEL;
-	switch(flags & op)
+	// entry must be within the scope of the search
+	switch(op->ors_scope)
 	{
-		case PWDSHADOW_FLG_EXISTS:
-		dat->dt_prev = val;
-		dat->dt_post = val;
+		case LDAP_SCOPE_BASE:
+		rc = bvmatch(&e.e_nname, &op->o_req_ndn);
 		break;
 
-		case PWDSHADOW_FLG_USERADD:
-		dat->dt_mod  = val;
-		dat->dt_post = val;
+		case LDAP_SCOPE_ONELEVEL:
+		dnParent(&e.e_nname, &parent);
+		rc = bvmatch(&parent, &op->o_req_ndn);
 		break;
 
-		case PWDSHADOW_FLG_USERDEL:
-		dat->dt_mod  = 0;
-		dat->dt_post = 0;
+		case LDAP_SCOPE_SUBTREE:
+		rc = dnIsSuffix(&e.e_nname, &op->o_req_ndn);
 		break;
 
 		default:
-		return(-1);
+		rc = 0;
+		break;
 	};
 
-	dat->dt_flag  |= flags;
+	// attributes which are not cached must not be readable, access does not
+	// depend on the contents of the entry
+	for(an = op->ors_attrs; ( ((rc)) && ((an->an_name.bv_val)) ); an++)
+	{
+		if (!(an->an_desc))
+		{
+			rc = !(strcmp(an->an_name.bv_val, "1.1"));
+			continue;
+		};
+		if (an->an_desc == cf->cf_tuple_ad)
+			continue;
+		if ( ((ha = pwdshadow_slot_find(cf, an->an_desc)) != NULL) && ((ha->ha_scan & (PWDSHADOW_SCAN_OVERRIDE|PWDSHADOW_SCAN_VIRTUAL))) )
+			continue;
+		rc = !(access_allowed(op, &e, an->an_desc, NULL, ACL_READ, NULL));
+	};
 
-	return(0);
+	// filter is evaluated with the search access of the requestor
+	if ( (!(rc)) || (test_filter(op, &e, op->ors_filter) != LDAP_COMPARE_TRUE) )
+	{
+		op->o_tmpfree(tu, op->o_tmpmemctx);
+		pwdshadow_stats_inc(sx, PWDSHADOW_STAT_TUPLE_MISSES);
+		return(SLAP_CB_CONTINUE);
+	};
+	pwdshadow_stats_inc(sx, (hit) ? PWDSHADOW_STAT_TUPLE_HITS : PWDSHADOW_STAT_TUPLE_MISSES);
+
+	// attributes are returned through every overlay
+	bd_info				= op->o_bd->bd_info;
+	op->o_bd->bd_info	= (BackendInfo *)on->on_info;
+	rs->sr_type			= REP_SEARCH;
+	rs->sr_entry		= &e;
+	rs->sr_attrs		= op->ors_attrs;
+	rs->sr_flags		= 0;
+	rs->sr_err			= LDAP_SUCCESS;
+	rc					= send_search_entry(op, rs);
+	rs_flush_entry(op, rs, on);
+	rs->sr_type			= REP_RESULT;
+	rs->sr_attrs		= NULL;
+	rs->sr_err			= (rc == LDAP_UNAVAILABLE) ? LDAP_OTHER : LDAP_SUCCESS;
+	send_ldap_result(op, rs);
+	op->o_bd->bd_info	= bd_info;
+
+	op->o_tmpfree(tu, op->o_tmpmemctx);
+
+	return(rs->sr_err);
 }
 
 
-int
-pwdshadow_state_initialize(
-		pwdshadow_state_t *			st,
-		pwdshadow_t *				ps )
+// locates the normalized key, key, normalized DN and DN of a cached entry
+void
+pwdshadow_tuple_strings(
+		pwdshadow_tuple_t *			tu,
+		struct berval *				bvs )
 {
-	memset(st, 0, sizeof(pwdshadow_state_t));
+	char *					ptr;
+
+	ptr				= (char *)&tu[1];
+	bvs[0].bv_val	= ptr;
+	bvs[0].bv_len	= tu->tu_nklen;
+	ptr				+= tu->tu_nklen + 1;
+	bvs[1]			= bvs[0];
+	if (!(tu->tu_flags & PWDSHADOW_TUPLE_SAMEVAL))
+	{
+		bvs[1].bv_val	= ptr;
+		bvs[1].bv_len	= tu->tu_klen;
+		ptr				+= tu->tu_klen + 1;
+	};
+	bvs[2].bv_val	= ptr;
+	bvs[2].bv_len	= tu->tu_ndnlen;
+	ptr				+= tu->tu_ndnlen + 1;
+	bvs[3]			= bvs[2];
+	if (!(tu->tu_flags & PWDSHADOW_TUPLE_SAMEDN))
+	{
+		bvs[3].bv_val	= ptr;
+		bvs[3].bv_len	= tu->tu_dnlen;
+	};
+	return;
+}
 
-	st->st_policySubentry.dt_ad			= ps->ps_policy_ad;
 
-	ldap_pvt_thread_mutex_lock(&pwdshadow_ad_mutex);
+// removes cached entries changed by a write after the backend has applied
+// it, a rename expires every cached entry since entries of the renamed
+// subtree are not known
+int
+pwdshadow_tuple_watch(
+		Operation *					op,
+		pwdshadow_t *				ps,
+		pwdshadow_cfg_t *			cf )
+{
+	int							idx;
+	Attribute *					a;
+	Modifications *				mods;
+	BerVarray					vals;
+	struct berval				bv;
+	pwdshadow_tuple_watch_t *	tw;
+
+	if (!(cf->cf_tuple_ad))
+		return(0);
 
-	// slapo-pwdshadow policy attributes
-	st->st_pwdShadowAutoExpire.dt_ad	= ad_pwdShadowAutoExpire;
+	tw						= op->o_tmpcalloc(1, sizeof(pwdshadow_tuple_watch_t), op->o_tmpmemctx);
+	tw->tw_cb.sc_response	= pwdshadow_tuple_response;
+	tw->tw_cb.sc_cleanup	= pwdshadow_tuple_cleanup;
+	tw->tw_cb.sc_private	= tw;
+	tw->tw_ps				= ps;
+	tw->tw_flush			= (op->o_tag == LDAP_REQ_MODRDN);
 
-	// slapo-pwdshadow attributes
-	st->st_pwdShadowExpire.dt_ad		= ad_pwdShadowExpire;
-	st->st_pwdShadowFlag.dt_ad			= ad_pwdShadowFlag;
-	st->st_pwdShadowGenerate.dt_ad		= ad_pwdShadowGenerate;
-	st->st_pwdShadowInactive.dt_ad		= ad_pwdShadowInactive;
-	st->st_pwdShadowLastChange.dt_ad	= ad_pwdShadowLastChange;
-	st->st_pwdShadowMax.dt_ad			= ad_pwdShadowMax;
-	st->st_pwdShadowMin.dt_ad			= ad_pwdShadowMin;
-	st->st_pwdShadowWarning.dt_ad		= ad_pwdShadowWarning;
+	// added keys make cached keys ambiguous or select the entry
+	switch(op->o_tag)
+	{
+		case LDAP_REQ_ADD:
+		for(a = op->ora_e->e_attrs; ((a)); a = a->a_next)
+		{
+			if (a->a_desc->ad_type != cf->cf_tuple_ad->ad_type)
+				continue;
+			for(idx = 0; ((a->a_nvals[idx].bv_val)); idx++)
+			{
+				ber_dupbv_x(&bv, &a->a_nvals[idx], op->o_tmpmemctx);
+				ber_bvarray_add_x(&tw->tw_keys, &bv, op->o_tmpmemctx);
+			};
+		};
+		break;
 
-	// slapo-ppolicy attributes (IETF draft-behera-ldap-password-policy-11)
-	st->st_pwdChangedTime.dt_ad			= ad_pwdChangedTime;
-	st->st_pwdEndTime.dt_ad				= ad_pwdEndTime;
-	st->st_pwdExpireWarning.dt_ad		= ad_pwdExpireWarning;
-	st->st_pwdGraceExpiry.dt_ad			= ad_pwdGraceExpiry;
-	st->st_pwdMaxAge.dt_ad				= ad_pwdMaxAge;
-	st->st_pwdMinAge.dt_ad				= ad_pwdMinAge;
+		case LDAP_REQ_MODIFY:
+		for(mods = op->orm_modlist; ((mods)); mods = mods->sml_next)
+		{
+			if (mods->sml_desc->ad_type != cf->cf_tuple_ad->ad_type)
+				continue;
+			vals = ((mods->sml_nvalues)) ? mods->sml_nvalues : mods->sml_values;
+			for(idx = 0; ( ((vals)) && ((vals[idx].bv_val)) ); idx++)
+			{
+				ber_dupbv_x(&bv, &vals[idx], op->o_tmpmemctx);
+				ber_bvarray_add_x(&tw->tw_keys, &bv, op->o_tmpmemctx);
+			};
+		};
+		break;
 
-	// LDAP NIS attributes (RFC 2307)
-	st->st_shadowExpire.dt_ad			= ad_shadowExpire;
-	st->st_shadowFlag.dt_ad				= ad_shadowFlag;
-	st->st_shadowInactive.dt_ad			= ad_shadowInactive;
-	st->st_shadowLastChange.dt_ad		= ad_shadowLastChange;
-	st->st_shadowMax.dt_ad				= ad_shadowMax;
-	st->st_shadowMin.dt_ad				= ad_shadowMin;
-	st->st_shadowWarning.dt_ad			= ad_shadowWarning;
+		default:
+		break;
+	};
 
-	// User Schema (RFC 2256)
-	st->st_userPassword.dt_ad			= ad_userPassword;
+	tw->tw_cb.sc_next	= op->o_callback;
+	op->o_callback		= &tw->tw_cb;
+
+	return(0);
+}
 
-	ldap_pvt_thread_mutex_unlock(&pwdshadow_ad_mutex);
 
+int
+pwdshadow_virtual_eval(
+		Operation *					op,
+		pwdshadow_cfg_t *			cf,
+		pwdshadow_state_t *			st,
+		Entry *						entry )
+{
+	// evaluate entry as if every tracked attribute was modified
+	pwdshadow_state_initialize(st, cf);
+	pwdshadow_get_attrs(st, entry, PWDSHADOW_FLG_EXISTS);
+	st->st_force = 1;
+	pwdshadow_eval(op, st);
 	return(0);
 }
 
@@ -0,0 +1,1451 @@
+/*
+ *  OpenLDAP pwdPolicy/shadowAccount Overlay
+ *  Copyright (c) 2023 David M. Syzdek <david@syzdek.net>
+ *  All rights reserved.
+ *
+ *  Dominus vobiscum. Et cum spiritu tuo.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted only as authorized by the OpenLDAP
+ *  Public License.
+ *
+ *  A copy of this license is available in the file LICENSE in the
+ *  top-level directory of the distribution or, alternatively, at
+ *  <http://www.OpenLDAP.org/license.html>.
+ */
+/*
+ *  Offline transformer of slapcat(8) output which adds the attributes
+ *  generated by the overlay before the LDIF is loaded with slapadd(8). The
+ *  overlay is included directly so that entries are evaluated by the same
+ *  rules as a modification in slapd and is linked with the slapd stub in
+ *  bench/stub.c and the runtime in tools/runtime.c, which normalizes DNs and
+ *  stores the password policies.
+ *
+ *  The LDIF is memory mapped and divided into chunks which end on record
+ *  boundaries. Worker threads claim chunks in order, transform the records
+ *  of a chunk into a private buffer and write the buffers in the order the
+ *  chunks were claimed, which preserves the order of the input. Password
+ *  policies are loaded by a first pass of the workers over the input, which
+ *  decodes the objectClass values of every record and loads the records of
+ *  pwdPolicy and pwdShadowPolicy, and from an optional LDIF of policies.
+ *
+ *  Lines may end with LF or CRLF as determined by the first line of a file.
+ *  Records which cannot be parsed are reported with their first line and
+ *  copied unmodified, and the tool exits with a status of 1.
+ */
+#define _GNU_SOURCE 1
+#include "../pwdshadow.c"
+
+///////////////
+//           //
+//  Headers  //
+//           //
+///////////////
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "../bench/stub.h"
+#include "runtime.h"
+
+
+///////////////////
+//               //
+//  Definitions  //
+//               //
+///////////////////
+
+#define LDIF_ATTRS_MAX			(PWDSHADOW_SLOTS + 1)
+#define LDIF_CHUNK				(256 * 1024)
+#define LDIF_THREADS_MAX		256
+
+#define LDIF_ATTR_DN			0x01
+
+#define LDIF_LINE_COMMENT		-2
+#define LDIF_LINE_OTHER			-1
+
+
+//////////////////
+//              //
+//  Data Types  //
+//              //
+//////////////////
+
+// attribute of an entry which is read by the overlay
+typedef struct ldif_attr_t
+{
+	AttributeDescription *	la_ad;
+	int						la_flags;
+} ldif_attr_t;
+
+
+// logical line of a record, including folded lines and the newline
+typedef struct ldif_line_t
+{
+	const char *			ln_ptr;
+	size_t					ln_len;
+	size_t					ln_name;
+	int						ln_attr;
+} ldif_line_t;
+
+
+typedef struct ldif_t
+{
+	const char *			ld_map;
+	size_t					ld_size;
+	size_t					ld_cursor;
+	unsigned long			ld_seq_next;
+	unsigned long			ld_seq_out;
+	unsigned long			ld_entries;
+	unsigned long			ld_updated;
+	int						ld_changed;
+	int						ld_crlf;
+	int						ld_error;
+	int						ld_attrs_count;
+	int						ld_policies;
+	FILE *					ld_out;
+	pthread_mutex_t			ld_mutex;
+	pthread_cond_t			ld_cond;
+	ldif_attr_t				ld_attrs[LDIF_ATTRS_MAX];
+	slap_overinst			ld_on;
+	BackendInfo				ld_bi;
+	BackendDB				ld_be;
+	pwdshadow_t *			ld_ps;
+	struct berval			ld_suffix[2];
+	const char *			ld_eol;
+	size_t					ld_eol_len;
+} ldif_t;
+
+
+typedef struct ldif_worker_t
+{
+	ldif_t *				lw_ld;
+	pthread_t				lw_thread;
+	char *					lw_out;
+	size_t					lw_out_len;
+	size_t					lw_out_size;
+	char *					lw_buff;
+	size_t					lw_buff_len;
+	size_t					lw_buff_size;
+	char *					lw_dn;
+	size_t					lw_dn_len;
+	size_t					lw_dn_size;
+	ldif_line_t *			lw_lines;
+	size_t					lw_lines_count;
+	size_t					lw_lines_size;
+	OperationBuffer			lw_opbuf;
+	Attribute				lw_attrs[LDIF_ATTRS_MAX];
+	struct berval			lw_vals[LDIF_ATTRS_MAX][2];
+} ldif_worker_t;
+
+
+//////////////////
+//              //
+//  Prototypes  //
+//              //
+//////////////////
+
+static size_t
+ldif_boundary(
+		const char *				map,
+		size_t						size,
+		size_t						pos,
+		int							crlf );
+
+
+static int
+ldif_buff_grow(
+		char **						buffp,
+		size_t *					sizep,
+		size_t						len );
+
+
+static int
+ldif_claim(
+		ldif_t *					ld,
+		size_t *					startp,
+		size_t *					endp,
+		unsigned long *				seqp );
+
+
+static int
+ldif_copy(
+		ldif_worker_t *				lw,
+		const char *				rec,
+		size_t						len );
+
+
+static int
+ldif_crlf(
+		const char *				map,
+		size_t						size );
+
+
+static int
+ldif_decode(
+		char *						buff,
+		size_t *					lenp );
+
+
+static int
+ldif_dn(
+		ldif_worker_t *				lw,
+		struct berval *				dn,
+		size_t *					offp,
+		ber_len_t *					lenp );
+
+
+static int
+ldif_emit(
+		ldif_worker_t *				lw,
+		const char *				ptr,
+		size_t						len );
+
+
+static int
+ldif_error(
+		ldif_t *					ld,
+		const char *				rec,
+		size_t						len,
+		const char *				msg );
+
+
+static size_t
+ldif_first(
+		ldif_worker_t *				lw );
+
+
+static int
+ldif_lines(
+		ldif_worker_t *				lw,
+		const char *				rec,
+		size_t						len );
+
+
+static int
+ldif_next(
+		const char *				map,
+		size_t						size,
+		int							crlf,
+		size_t *					posp,
+		size_t *					endp );
+
+
+static int
+ldif_policy(
+		ldif_worker_t *				lw,
+		const char *				rec,
+		size_t						len );
+
+
+static int
+ldif_policy_file(
+		ldif_t *					ld,
+		const char *				path );
+
+
+static int
+ldif_policy_load(
+		ldif_t *					ld,
+		ldif_worker_t *				lw,
+		const char *				rec,
+		size_t						len );
+
+
+static int
+ldif_record(
+		ldif_worker_t *				lw,
+		const char *				rec,
+		size_t						len );
+
+
+static int
+ldif_reject(
+		ldif_worker_t *				lw,
+		const char *				rec,
+		size_t						len,
+		const char *				msg );
+
+
+static int
+ldif_run(
+		ldif_t *					ld,
+		ldif_worker_t *				workers,
+		int							threads,
+		void *						(*fn)(void *) );
+
+
+static void *
+ldif_scan(
+		void *						arg );
+
+
+static int
+ldif_setup(
+		ldif_t *					ld );
+
+
+static int
+ldif_subtree(
+		ldif_t *					ld,
+		const char *				arg );
+
+
+static int
+ldif_tracked(
+		ldif_t *					ld );
+
+
+static void
+ldif_usage(
+		void );
+
+
+static int
+ldif_value(
+		ldif_worker_t *				lw,
+		ldif_line_t *				ln,
+		struct berval *				bv );
+
+
+static void *
+ldif_worker(
+		void *						arg );
+
+
+static void
+ldif_worker_free(
+		ldif_worker_t *				lw );
+
+
+/////////////////
+//             //
+//  Variables  //
+//             //
+/////////////////
+
+// value of each base64 character plus one, zero for invalid characters
+static const unsigned char			ldif_b64[256] =
+{
+	['A'] =  1, ['B'] =  2, ['C'] =  3, ['D'] =  4, ['E'] =  5, ['F'] =  6,
+	['G'] =  7, ['H'] =  8, ['I'] =  9, ['J'] = 10, ['K'] = 11, ['L'] = 12,
+	['M'] = 13, ['N'] = 14, ['O'] = 15, ['P'] = 16, ['Q'] = 17, ['R'] = 18,
+	['S'] = 19, ['T'] = 20, ['U'] = 21, ['V'] = 22, ['W'] = 23, ['X'] = 24,
+	['Y'] = 25, ['Z'] = 26, ['a'] = 27, ['b'] = 28, ['c'] = 29, ['d'] = 30,
+	['e'] = 31, ['f'] = 32, ['g'] = 33, ['h'] = 34, ['i'] = 35, ['j'] = 36,
+	['k'] = 37, ['l'] = 38, ['m'] = 39, ['n'] = 40, ['o'] = 41, ['p'] = 42,
+	['q'] = 43, ['r'] = 44, ['s'] = 45, ['t'] = 46, ['u'] = 47, ['v'] = 48,
+	['w'] = 49, ['x'] = 50, ['y'] = 51, ['z'] = 52, ['0'] = 53, ['1'] = 54,
+	['2'] = 55, ['3'] = 56, ['4'] = 57, ['5'] = 58, ['6'] = 59, ['7'] = 60,
+	['8'] = 61, ['9'] = 62, ['+'] = 63, ['/'] = 64
+};
+
+
+/////////////////
+//             //
+//  Functions  //
+//             //
+/////////////////
+
+int
+main(
+		int							argc,
+		char *						argv[] )
+{
+	int						c;
+	int						fd;
+	int						threads;
+	int						verbose;
+	char *					cargv[3];
+	const char *			output;
+	const char *			text;
+	double					secs;
+	struct stat				sb;
+	struct timespec			start;
+	struct timespec			stop;
+	struct berval			bv;
+	struct berval			ndn;
+	ldif_t					ld;
+	ldif_worker_t *			workers;
+	AttributeDescription *	ad;
+	ConfigArgs				ca;
+	ConfigReply				cr;
+
+	memset(&ld, 0, sizeof(ld));
+	clock_gettime(CLOCK_REALTIME, &start);
+	stub_clock	= start.tv_sec;
+	threads		= (int)sysconf(_SC_NPROCESSORS_ONLN);
+	verbose		= 0;
+	output		= NULL;
+	pthread_mutex_init(&ld.ld_mutex, NULL);
+	pthread_cond_init(&ld.ld_cond, NULL);
+
+	if ((ldif_setup(&ld)))
+		return(1);
+
+	while((c = getopt(argc, argv, "a:cd:hj:o:p:s:t:v")) != -1)
+	{
+		switch(c)
+		{
+			case 'a':
+			if (slap_str2ad(optarg, &ad, &text) != LDAP_SUCCESS)
+			{
+				fprintf(stderr, "pwdshadow-ldif: %s: %s\n", optarg, text);
+				return(1);
+			};
+			cargv[0]		= "pwdshadow_policy_attr";
+			cargv[1]		= optarg;
+			cargv[2]		= NULL;
+			memset(&ca, 0, sizeof(ca));
+			ca.op			= SLAP_CONFIG_ADD;
+			ca.type			= PWDSHADOW_CFG_POLICY_AD;
+			ca.argc			= 2;
+			ca.argv			= cargv;
+			ca.log			= "pwdshadow-ldif";
+			ca.value_ad		= ad;
+			ca.bi			= (BackendInfo *)&ld.ld_on;
+			if ((pwdshadow_cfg_gen(&ca)))
+			{
+				fprintf(stderr, "pwdshadow-ldif: %s\n", ca.cr_msg);
+				return(1);
+			};
+			break;
+
+			case 'c':
+			ld.ld_changed = 1;
+			break;
+
+			case 'd':
+			ber_str2bv(optarg, 0, 0, &bv);
+			if (dnNormalize(0, NULL, NULL, &bv, &ndn, NULL) != LDAP_SUCCESS)
+			{
+				fprintf(stderr, "pwdshadow-ldif: %s: invalid DN\n", optarg);
+				return(1);
+			};
+			if ((ld.ld_ps->ps_def_policy.bv_val))
+				ch_free(ld.ld_ps->ps_def_policy.bv_val);
+			ld.ld_ps->ps_def_policy = ndn;
+			pwdshadow_cfg_publish(ld.ld_ps);
+			break;
+
+			case 'h':
+			ldif_usage();
+			return(0);
+
+			case 'j':
+			if ( ((threads = (int)strtol(optarg, NULL, 10)) < 1) || (threads > LDIF_THREADS_MAX) )
+			{
+				fprintf(stderr, "pwdshadow-ldif: invalid number of threads\n");
+				return(1);
+			};
+			break;
+
+			case 'o':
+			output = optarg;
+			break;
+
+			case 'p':
+			if ((ldif_policy_file(&ld, optarg)))
+				return(1);
+			break;
+
+			case 's':
+			if ((ldif_subtree(&ld, optarg)))
+				return(1);
+			break;
+
+			case 't':
+			stub_clock = (time_t)strtoll(optarg, NULL, 10);
+			break;
+
+			case 'v':
+			verbose = 1;
+			break;
+
+			default:
+			fprintf(stderr, "Try `pwdshadow-ldif -h' for more information.\n");
+			return(1);
+		};
+	};
+	if (optind != (argc - 1))
+	{
+		fprintf(stderr, "pwdshadow-ldif: missing LDIF file\n");
+		fprintf(stderr, "Try `pwdshadow-ldif -h' for more information.\n");
+		return(1);
+	};
+	threads = (threads < 1) ? 1 : threads;
+
+	// map input
+	if ((fd = open(argv[optind], O_RDONLY)) == -1)
+	{
+		fprintf(stderr, "pwdshadow-ldif: %s: %s\n", argv[optind], strerror(errno));
+		return(1);
+	};
+	if (fstat(fd, &sb) == -1)
+	{
+		fprintf(stderr, "pwdshadow-ldif: %s: %s\n", argv[optind], strerror(errno));
+		close(fd);
+		return(1);
+	};
+	ld.ld_size = (size_t)sb.st_size;
+	if ((ld.ld_size))
+	{
+		if ((ld.ld_map = mmap(NULL, ld.ld_size, PROT_READ, MAP_PRIVATE, fd, 0)) == MAP_FAILED)
+		{
+			fprintf(stderr, "pwdshadow-ldif: %s: %s\n", argv[optind], strerror(errno));
+			close(fd);
+			return(1);
+		};
+		madvise((void *)ld.ld_map, ld.ld_size, MADV_SEQUENTIAL);
+	};
+	close(fd);
+	ld.ld_crlf		= ldif_crlf(ld.ld_map, ld.ld_size);
+	ld.ld_eol		= ((ld.ld_crlf)) ? "\r\n" : "\n";
+	ld.ld_eol_len	= strlen(ld.ld_eol);
+
+	// open output
+	ld.ld_out = stdout;
+	if ( ((output)) && ((strcmp(output, "-"))) && ((ld.ld_out = fopen(output, "w")) == NULL) )
+	{
+		fprintf(stderr, "pwdshadow-ldif: %s: %s\n", output, strerror(errno));
+		return(1);
+	};
+
+	// load password policies stored in the input, then transform entries
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	workers = ch_calloc((size_t)threads, sizeof(ldif_worker_t));
+	if ((ldif_run(&ld, workers, threads, ldif_scan)))
+		return(1);
+	ld.ld_cursor	= 0;
+	ld.ld_seq_next	= 0;
+	ldif_tracked(&ld);
+	if ((ldif_run(&ld, workers, threads, ldif_worker)))
+		return(1);
+	for(fd = 0; fd < threads; fd++)
+		ldif_worker_free(&workers[fd]);
+	ch_free(workers);
+	clock_gettime(CLOCK_MONOTONIC, &stop);
+
+	if ((fflush(ld.ld_out)))
+	{
+		fprintf(stderr, "pwdshadow-ldif: %s: %s\n", ((output)) ? output : "stdout", strerror(errno));
+		ld.ld_error = 1;
+	};
+	if (ld.ld_out != stdout)
+		fclose(ld.ld_out);
+
+	if ((verbose))
+	{
+		secs = (double)(stop.tv_sec - start.tv_sec) + ((double)(stop.tv_nsec - start.tv_nsec) / 1e9);
+		fprintf(stderr, "# threads: %i policies: %i\n", threads, ld.ld_policies);
+		fprintf(stderr, "# entries: %lu updated: %lu\n", ld.ld_entries, ld.ld_updated);
+		fprintf(stderr, "# seconds: %.3f entries/s: %.0f\n", secs, (secs > 0) ? ((double)ld.ld_entries / secs) : 0);
+	};
+
+	// release resources
+	memset(&cr, 0, sizeof(cr));
+	pwdshadow_db_close(&ld.ld_be, &cr);
+	pwdshadow_db_destroy(&ld.ld_be, &cr);
+	runtime_destroy();
+	if ((ld.ld_map))
+		munmap((void *)ld.ld_map, ld.ld_size);
+
+	return( ((ld.ld_error)) ? 1 : 0 );
+}
+
+
+size_t
+ldif_boundary(
+		const char *				map,
+		size_t						size,
+		size_t						pos,
+		int							crlf )
+{
+	const char *			ptr;
+
+	// records are separated by one or more empty lines
+	if (pos >= size)
+		return(size);
+	pos = (pos > 0) ? pos - 1 : pos;
+	if ((ptr = memmem(&map[pos], size - pos, ((crlf)) ? "\n\r\n" : "\n\n", ((crlf)) ? 3 : 2)) == NULL)
+		return(size);
+	for(pos = (size_t)(ptr - map) + 1; ( (pos < size) && ( (map[pos] == '\n') || (map[pos] == '\r') ) ); pos++);
+
+	return(pos);
+}
+
+
+int
+ldif_buff_grow(
+		char **						buffp,
+		size_t *					sizep,
+		size_t						len )
+{
+	size_t					size;
+
+	if (len <= *sizep)
+		return(0);
+	for(size = ((*sizep)) ? *sizep : 4096; size < len; size *= 2);
+	*buffp = ch_realloc(*buffp, size);
+	*sizep = size;
+
+	return(0);
+}
+
+
+// claims the next chunk of the input, returns -1 once the input is consumed
+int
+ldif_claim(
+		ldif_t *					ld,
+		size_t *					startp,
+		size_t *					endp,
+		unsigned long *				seqp )
+{
+	pthread_mutex_lock(&ld->ld_mutex);
+	*startp			= ld->ld_cursor;
+	*endp			= ldif_boundary(ld->ld_map, ld->ld_size, *startp + LDIF_CHUNK, ld->ld_crlf);
+	*seqp			= ld->ld_seq_next++;
+	ld->ld_cursor	= *endp;
+	pthread_mutex_unlock(&ld->ld_mutex);
+
+	return( (*startp >= ld->ld_size) ? -1 : 0 );
+}
+
+
+// copies a record which is not modified followed by an empty line
+int
+ldif_copy(
+		ldif_worker_t *				lw,
+		const char *				rec,
+		size_t						len )
+{
+	ldif_t *				ld;
+
+	ld = lw->lw_ld;
+	if ((ld->ld_changed))
+		return(0);
+
+	ldif_emit(lw, rec, len);
+	if (rec[len-1] != '\n')
+		ldif_emit(lw, ld->ld_eol, ld->ld_eol_len);
+	ldif_emit(lw, ld->ld_eol, ld->ld_eol_len);
+
+	return(0);
+}
+
+
+// whether the first line of the file ends with CRLF
+int
+ldif_crlf(
+		const char *				map,
+		size_t						size )
+{
+	const char *			eol;
+
+	if ( (!(map)) || ((eol = memchr(map, '\n', size)) == NULL) )
+		return(0);
+
+	return( ( (eol > map) && (eol[-1] == '\r') ) ? 1 : 0 );
+}
+
+
+int
+ldif_decode(
+		char *						buff,
+		size_t *					lenp )
+{
+	size_t					pos;
+	size_t					len;
+	unsigned				bits;
+	unsigned				count;
+	unsigned char			c;
+
+	// decodes in place, decoded value is never longer than the input
+	for(pos = 0, len = 0, bits = 0, count = 0; pos < *lenp; pos++)
+	{
+		c = (unsigned char)buff[pos];
+		if (c == '=')
+			break;
+		if (!(ldif_b64[c]))
+			return(-1);
+		bits = (bits << 6) | (unsigned)(ldif_b64[c] - 1);
+		if ((++count % 4) == 0)
+		{
+			buff[len++] = (char)((bits >> 16) & 0xff);
+			buff[len++] = (char)((bits >>  8) & 0xff);
+			buff[len++] = (char)(bits & 0xff);
+			bits = 0;
+		};
+	};
+	switch(count % 4)
+	{
+		case 1:
+		return(-1);
+
+		case 2:
+		buff[len++] = (char)((bits >> 4) & 0xff);
+		break;
+
+		case 3:
+		buff[len++] = (char)((bits >> 10) & 0xff);
+		buff[len++] = (char)((bits >>  2) & 0xff);
+		break;
+
+		default:
+		break;
+	};
+	buff[len] = '\0';
+	*lenp = len;
+
+	return(0);
+}
+
+
+// normalizes a DN after the DNs already normalized for the record, the
+// buffer may move so the offset of the normalized DN is returned
+int
+ldif_dn(
+		ldif_worker_t *				lw,
+		struct berval *				dn,
+		size_t *					offp,
+		ber_len_t *					lenp )
+{
+	size_t					len;
+
+	ldif_buff_grow(&lw->lw_dn, &lw->lw_dn_size, lw->lw_dn_len + runtime_dn_size(dn->bv_val, dn->bv_len));
+	if (runtime_dn_normalize(dn->bv_val, dn->bv_len, &lw->lw_dn[lw->lw_dn_len], &len) != LDAP_SUCCESS)
+		return(-1);
+	*offp			 = lw->lw_dn_len;
+	*lenp			 = len;
+	lw->lw_dn_len	+= len + 1;
+
+	return(0);
+}
+
+
+int
+ldif_emit(
+		ldif_worker_t *				lw,
+		const char *				ptr,
+		size_t						len )
+{
+	ldif_buff_grow(&lw->lw_out, &lw->lw_out_size, lw->lw_out_len + len);
+	memcpy(&lw->lw_out[lw->lw_out_len], ptr, len);
+	lw->lw_out_len += len;
+	return(0);
+}
+
+
+// reports a record which cannot be parsed by its first line and sets the
+// exit status of the tool
+int
+ldif_error(
+		ldif_t *					ld,
+		const char *				rec,
+		size_t						len,
+		const char *				msg )
+{
+	const char *			eol;
+
+	if ((eol = memchr(rec, '\n', len)) != NULL)
+		len = (size_t)(eol - rec);
+	if ( (len > 0) && (rec[len-1] == '\r') )
+		len--;
+	fprintf(stderr, "pwdshadow-ldif: %s: %.*s\n", msg, (int)len, rec);
+	__atomic_store_n(&ld->ld_error, 1, __ATOMIC_RELAXED);
+
+	return(-1);
+}
+
+
+// first line of a record which is not a comment or the version of the LDIF,
+// which may precede the DN of the first record
+size_t
+ldif_first(
+		ldif_worker_t *				lw )
+{
+	size_t					idx;
+	ldif_line_t *			ln;
+
+	for(idx = 0; idx < lw->lw_lines_count; idx++)
+	{
+		ln = &lw->lw_lines[idx];
+		if (ln->ln_attr == LDIF_LINE_COMMENT)
+			continue;
+		if ( (ln->ln_name != 7) || ((strncasecmp(ln->ln_ptr, "version", 7))) )
+			break;
+	};
+
+	return(idx);
+}
+
+
+int
+ldif_lines(
+		ldif_worker_t *				lw,
+		const char *				rec,
+		size_t						len )
+{
+	int						idx;
+	size_t					pos;
+	size_t					next;
+	const char *			eol;
+	const char *			colon;
+	ldif_t *				ld;
+	ldif_line_t *			ln;
+	AttributeDescription *	ad;
+
+	ld					= lw->lw_ld;
+	lw->lw_lines_count	= 0;
+	lw->lw_buff_len		= 0;
+	lw->lw_dn_len		= 0;
+
+	// decoded values and their terminators are never longer than their lines
+	ldif_buff_grow(&lw->lw_buff, &lw->lw_buff_size, len + 1);
+
+	for(pos = 0; pos < len; pos = next)
+	{
+		if (lw->lw_lines_count >= lw->lw_lines_size)
+		{
+			lw->lw_lines_size	= ((lw->lw_lines_size)) ? lw->lw_lines_size * 2 : 64;
+			lw->lw_lines		= ch_realloc(lw->lw_lines, sizeof(ldif_line_t) * lw->lw_lines_size);
+		};
+		ln = &lw->lw_lines[lw->lw_lines_count++];
+
+		// logical line includes folded lines which begin with a space
+		eol		= memchr(&rec[pos], '\n', len - pos);
+		next	= ((eol)) ? (size_t)(eol - rec) + 1 : len;
+		colon	= memchr(&rec[pos], ':', next - pos);
+		while ( (next < len) && (rec[next] == ' ') )
+		{
+			eol		= memchr(&rec[next], '\n', len - next);
+			next	= ((eol)) ? (size_t)(eol - rec) + 1 : len;
+		};
+		ln->ln_ptr	= &rec[pos];
+		ln->ln_len	= next - pos;
+		ln->ln_name	= ((colon)) ? (size_t)(colon - ln->ln_ptr) : 0;
+		ln->ln_attr	= (rec[pos] == '#') ? LDIF_LINE_COMMENT : LDIF_LINE_OTHER;
+		if ( (ln->ln_attr == LDIF_LINE_COMMENT) || (!(ln->ln_name)) )
+			continue;
+
+		// attributes with options are distinct from the tracked attributes
+		for(idx = 0; idx < ld->ld_attrs_count; idx++)
+		{
+			ad = ld->ld_attrs[idx].la_ad;
+			if ( (ad->ad_cname.bv_len == ln->ln_name) && (!(strncasecmp(ad->ad_cname.bv_val, ln->ln_ptr, ln->ln_name))) )
+			{
+				ln->ln_attr = idx;
+				break;
+			};
+		};
+	};
+
+	return(0);
+}
+
+
+// bounds of the record at or after *posp, returns 0 if no record remains,
+// a record ends with the newline of its last line
+int
+ldif_next(
+		const char *				map,
+		size_t						size,
+		int							crlf,
+		size_t *					posp,
+		size_t *					endp )
+{
+	size_t					pos;
+	const char *			ptr;
+
+	for(pos = *posp; ( (pos < size) && ( (map[pos] == '\n') || (map[pos] == '\r') ) ); pos++);
+	if (pos >= size)
+		return(0);
+	ptr		= memmem(&map[pos], size - pos, ((crlf)) ? "\n\r\n" : "\n\n", ((crlf)) ? 3 : 2);
+	*posp	= pos;
+	*endp	= ((ptr)) ? (size_t)(ptr - map) + 1 : size;
+
+	return(1);
+}
+
+
+// whether the record has the objectClass pwdPolicy or pwdShadowPolicy, the
+// values are decoded so that folded and base64 values are found
+int
+ldif_policy(
+		ldif_worker_t *				lw,
+		const char *				rec,
+		size_t						len )
+{
+	size_t					idx;
+	struct berval			bv;
+	ldif_line_t *			ln;
+
+	ldif_lines(lw, rec, len);
+
+	for(idx = 0; idx < lw->lw_lines_count; idx++)
+	{
+		ln = &lw->lw_lines[idx];
+		if ( (ln->ln_name != 11) || ((strncasecmp(ln->ln_ptr, "objectClass", 11))) )
+			continue;
+		if ((ldif_value(lw, ln, &bv)))
+			return(ldif_error(lw->lw_ld, rec, len, "invalid objectClass value"));
+		if ( (!(strcasecmp(bv.bv_val, "pwdPolicy"))) || (!(strcasecmp(bv.bv_val, "pwdShadowPolicy"))) )
+			return(1);
+	};
+
+	return(0);
+}
+
+
+int
+ldif_policy_file(
+		ldif_t *					ld,
+		const char *				path )
+{
+	int						fd;
+	size_t					pos;
+	size_t					end;
+	size_t					size;
+	int						crlf;
+	char *					map;
+	struct stat				sb;
+	ldif_worker_t			lw;
+
+	if ((fd = open(path, O_RDONLY)) == -1)
+	{
+		fprintf(stderr, "pwdshadow-ldif: %s: %s\n", path, strerror(errno));
+		return(1);
+	};
+	if ( (fstat(fd, &sb) == -1) || (!(sb.st_size)) )
+	{
+		close(fd);
+		return(0);
+	};
+	size = (size_t)sb.st_size;
+	if ((map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0)) == MAP_FAILED)
+	{
+		fprintf(stderr, "pwdshadow-ldif: %s: %s\n", path, strerror(errno));
+		close(fd);
+		return(1);
+	};
+	close(fd);
+
+	// every entry of a policy file is loaded
+	memset(&lw, 0, sizeof(lw));
+	lw.lw_ld	= ld;
+	crlf		= ldif_crlf(map, size);
+	for(pos = 0; (ldif_next(map, size, crlf, &pos, &end)); pos = end)
+		if ((ldif_policy_load(ld, &lw, &map[pos], end - pos)))
+			break;
+	ldif_worker_free(&lw);
+	munmap(map, size);
+
+	return( (pos < size) ? 1 : 0 );
+}
+
+
+int
+ldif_policy_load(
+		ldif_t *					ld,
+		ldif_worker_t *				lw,
+		const char *				rec,
+		size_t						len )
+{
+	size_t					idx;
+	size_t					off;
+	char					name[64];
+	struct berval			bv;
+	struct berval			ndn;
+	Entry *					e;
+	ldif_line_t *			ln;
+
+	ldif_lines(lw, rec, len);
+
+	// first line of an entry is its DN
+	if ((idx = ldif_first(lw)) >= lw->lw_lines_count)
+		return(0);
+	ln = &lw->lw_lines[idx];
+	if ( (ln->ln_name != 2) || ((strncasecmp(ln->ln_ptr, "dn", 2))) )
+		return(ldif_error(ld, rec, len, "record without a DN"));
+	if ( ((ldif_value(lw, ln, &bv))) || ((ldif_dn(lw, &bv, &off, &ndn.bv_len))) )
+		return(ldif_error(ld, rec, len, "invalid DN"));
+	ndn.bv_val = &lw->lw_dn[off];
+	e = stub_entry_new(ndn.bv_val);
+
+	// attributes unknown to the runtime's schema are not used by policies
+	for(idx++; idx < lw->lw_lines_count; idx++)
+	{
+		ln = &lw->lw_lines[idx];
+		if (ln->ln_attr == LDIF_LINE_COMMENT)
+			continue;
+		if ( (!(ln->ln_name)) || ((ldif_value(lw, ln, &bv))) )
+		{
+			stub_entry_free(e);
+			return(ldif_error(ld, rec, len, "invalid value of password policy"));
+		};
+		if (ln->ln_name >= sizeof(name))
+			continue;
+		memcpy(name, ln->ln_ptr, ln->ln_name);
+		name[ln->ln_name] = '\0';
+		stub_entry_set(e, name, bv.bv_val);
+	};
+
+	if ((runtime_entry_add(e)))
+	{
+		stub_entry_free(e);
+		return(ldif_error(ld, rec, len, "duplicate password policy"));
+	};
+	ld->ld_policies++;
+
+	return(0);
+}
+
+
+int
+ldif_record(
+		ldif_worker_t *				lw,
+		const char *				rec,
+		size_t						len )
+{
+	size_t					idx;
+	size_t					off;
+	int						attr;
+	int						policy;
+	Entry					e;
+	Operation *				op;
+	Modifications *			mods;
+	Modifications *			mod;
+	Modifications **		next;
+	Attribute **			tail;
+	ldif_t *				ld;
+	ldif_line_t *			ln;
+	pwdshadow_t *			ps;
+	pwdshadow_mods_t *		mb;
+	pwdshadow_stats_t *		sx;
+	pwdshadow_state_t		st;
+
+	ld	= lw->lw_ld;
+	ps	= ld->ld_ps;
+	op	= &lw->lw_opbuf.ob_op;
+
+	ldif_lines(lw, rec, len);
+	for(attr = 0; attr < ld->ld_attrs_count; attr++)
+		lw->lw_attrs[attr].a_desc = NULL;
+
+	// records of comments are copied, entries begin with their DN
+	if ((idx = ldif_first(lw)) >= lw->lw_lines_count)
+		return(ldif_copy(lw, rec, len));
+	ln = &lw->lw_lines[idx];
+	if ( (ln->ln_name != 2) || ((strncasecmp(ln->ln_ptr, "dn", 2))) )
+		return(ldif_reject(lw, rec, len, "record without a DN"));
+	memset(&e, 0, sizeof(e));
+	if ( ((ldif_value(lw, ln, &e.e_name))) || ((ldif_dn(lw, &e.e_name, &off, &e.e_nname.bv_len))) )
+		return(ldif_reject(lw, rec, len, "invalid DN"));
+
+	// entry of tracked attributes, only the first value is evaluated and
+	// change records are copied unmodified
+	policy	= -1;
+	tail	= &e.e_attrs;
+	for(idx++; idx < lw->lw_lines_count; idx++)
+	{
+		ln = &lw->lw_lines[idx];
+		if (ln->ln_attr == LDIF_LINE_COMMENT)
+			continue;
+		if (!(ln->ln_name))
+			return(ldif_reject(lw, rec, len, "line without an attribute"));
+		if ( (ln->ln_name == 10) && (!(strncasecmp(ln->ln_ptr, "changetype", 10))) )
+			return(ldif_copy(lw, rec, len));
+		if ( (ln->ln_name == 2) && (!(strncasecmp(ln->ln_ptr, "dn", 2))) )
+			return(ldif_reject(lw, rec, len, "record with more than one DN"));
+		if ((attr = ln->ln_attr) < 0)
+			continue;
+		if ((lw->lw_attrs[attr].a_desc))
+			continue;
+		if ((ldif_value(lw, ln, &lw->lw_vals[attr][0])))
+			return(ldif_reject(lw, rec, len, "unsupported value"));
+		if ((ld->ld_attrs[attr].la_flags & LDIF_ATTR_DN))
+		{
+			if ((ldif_dn(lw, &lw->lw_vals[attr][0], &off, &lw->lw_vals[attr][0].bv_len)))
+				return(ldif_reject(lw, rec, len, "invalid DN value"));
+			policy = attr;
+		};
+		lw->lw_attrs[attr].a_desc		= ld->ld_attrs[attr].la_ad;
+		lw->lw_attrs[attr].a_vals		= lw->lw_vals[attr];
+		lw->lw_attrs[attr].a_nvals		= lw->lw_vals[attr];
+		lw->lw_attrs[attr].a_numvals	= 1;
+		lw->lw_attrs[attr].a_next		= NULL;
+		*tail							= &lw->lw_attrs[attr];
+		tail							= &lw->lw_attrs[attr].a_next;
+	};
+
+	// normalized DNs are located once the buffer no longer moves, the DN of
+	// the entry is the first DN normalized for the record
+	e.e_nname.bv_val = lw->lw_dn;
+	if (policy >= 0)
+		lw->lw_vals[policy][0].bv_val = &lw->lw_dn[off];
+
+	__atomic_add_fetch(&ld->ld_entries, 1, __ATOMIC_RELAXED);
+
+	// evaluate entry as if every tracked attribute was modified
+	sx					= pwdshadow_stats_shard(ps, op);
+	op->o_req_dn		= e.e_name;
+	op->o_req_ndn		= e.e_nname;
+	pwdshadow_state_initialize(&st, pwdshadow_cfg_get(ps));
+	pwdshadow_get_attrs(&st, &e, PWDSHADOW_FLG_EXISTS);
+	st.st_force			= 1;
+	pwdshadow_eval(op, &st);
+
+	// generate modifications
+	mods = NULL;
+	next = &mods;
+	mb   = pwdshadow_mods_alloc(op);
+	pwdshadow_op_modify_mods(sx, mb, &st, &next);
+	if (!(mods))
+	{
+		op->o_tmpfree(mb, op->o_tmpmemctx);
+		return(ldif_copy(lw, rec, len));
+	};
+	__atomic_add_fetch(&ld->ld_updated, 1, __ATOMIC_RELAXED);
+
+	// copy lines of attributes which were not modified
+	for(idx = 0; idx < lw->lw_lines_count; idx++)
+	{
+		ln = &lw->lw_lines[idx];
+		if (ln->ln_attr >= 0)
+		{
+			for(mod = mods; ( ((mod)) && (mod->sml_desc != ld->ld_attrs[ln->ln_attr].la_ad) ); mod = mod->sml_next);
+			if ((mod))
+				continue;
+		};
+		ldif_emit(lw, ln->ln_ptr, ln->ln_len);
+		if (ln->ln_ptr[ln->ln_len-1] != '\n')
+			ldif_emit(lw, ld->ld_eol, ld->ld_eol_len);
+	};
+
+	// append generated values
+	for(mod = mods; ((mod)); mod = mod->sml_next)
+	{
+		if (mod->sml_op != LDAP_MOD_REPLACE)
+			continue;
+		ldif_emit(lw, mod->sml_desc->ad_cname.bv_val, mod->sml_desc->ad_cname.bv_len);
+		ldif_emit(lw, ": ", 2);
+		ldif_emit(lw, mod->sml_values[0].bv_val, mod->sml_values[0].bv_len);
+		ldif_emit(lw, ld->ld_eol, ld->ld_eol_len);
+	};
+	ldif_emit(lw, ld->ld_eol, ld->ld_eol_len);
+	op->o_tmpfree(mb, op->o_tmpmemctx);
+
+	return(0);
+}
+
+
+// reports a record which cannot be parsed and copies it unmodified
+int
+ldif_reject(
+		ldif_worker_t *				lw,
+		const char *				rec,
+		size_t						len,
+		const char *				msg )
+{
+	ldif_error(lw->lw_ld, rec, len, msg);
+	return(ldif_copy(lw, rec, len));
+}
+
+
+// runs a pass of the workers over the input and waits for the pass to end
+int
+ldif_run(
+		ldif_t *					ld,
+		ldif_worker_t *				workers,
+		int							threads,
+		void *						(*fn)(void *) )
+{
+	int						idx;
+	int						rc;
+
+	for(idx = 0, rc = 0; ( (idx < threads) && (!(rc)) ); idx++)
+	{
+		workers[idx].lw_ld = ld;
+		if ((rc = pthread_create(&workers[idx].lw_thread, NULL, fn, &workers[idx])) != 0)
+		{
+			fprintf(stderr, "pwdshadow-ldif: pthread_create(): %s\n", strerror(rc));
+			idx--;
+		};
+	};
+	while(idx > 0)
+		pthread_join(workers[--idx].lw_thread, NULL);
+
+	return( ((rc)) ? 1 : 0 );
+}
+
+
+// first pass which loads the password policies of the input
+void *
+ldif_scan(
+		void *						arg )
+{
+	size_t					pos;
+	size_t					start;
+	size_t					end;
+	size_t					rec;
+	unsigned long			seq;
+	ldif_t *				ld;
+	ldif_worker_t *			lw;
+
+	lw	= arg;
+	ld	= lw->lw_ld;
+
+	while(!(ldif_claim(ld, &start, &end, &seq)))
+	{
+		for(pos = start; (ldif_next(ld->ld_map, end, ld->ld_crlf, &pos, &rec)); pos = rec)
+		{
+			if (ldif_policy(lw, &ld->ld_map[pos], rec - pos) != 1)
+				continue;
+			pthread_mutex_lock(&ld->ld_mutex);
+			ldif_policy_load(ld, lw, &ld->ld_map[pos], rec - pos);
+			pthread_mutex_unlock(&ld->ld_mutex);
+		};
+	};
+
+	return(NULL);
+}
+
+
+int
+ldif_setup(
+		ldif_t *					ld )
+{
+	ConfigReply				cr;
+
+	if ((pwdshadow_initialize()))
+	{
+		fprintf(stderr, "pwdshadow-ldif: pwdshadow_initialize() failed\n");
+		return(1);
+	};
+
+	// database with a single instance of the overlay
+	ld->ld_bi.bi_type		= "stub";
+	ld->ld_on				= pwdshadow;
+	ld->ld_on.on_info		= &ld->ld_bi;
+	ld->ld_be.bd_info		= (BackendInfo *)&ld->ld_on;
+	ld->ld_be.bd_self		= &ld->ld_be;
+	ber_str2bv("", 0, 0, &ld->ld_suffix[0]);
+	ld->ld_be.be_suffix		= ld->ld_suffix;
+	ld->ld_be.be_nsuffix	= ld->ld_suffix;
+	runtime_backend(&ld->ld_be);
+	slapMode				= SLAP_TOOL_MODE;
+
+	memset(&cr, 0, sizeof(cr));
+	if ((pwdshadow_db_init(&ld->ld_be, &cr)))
+		return(1);
+	ld->ld_ps = ld->ld_on.on_bi.bi_private;
+	if ((pwdshadow_db_open(&ld->ld_be, &cr)))
+		return(1);
+
+	return(0);
+}
+
+
+int
+ldif_subtree(
+		ldif_t *					ld,
+		const char *				arg )
+{
+	const char *			sep;
+	char *					argv[4];
+	ConfigArgs				c;
+
+	// DNs are normalized by the overlay's configuration
+	if ((sep = strchr(arg, '|')) == NULL)
+	{
+		fprintf(stderr, "pwdshadow-ldif: %s: expected \"suffixDN|policyDN\"\n", arg);
+		return(1);
+	};
+	argv[0] = "pwdshadow_subtree_policy";
+	argv[1] = strndup(arg, (size_t)(sep - arg));
+	argv[2] = strdup(&sep[1]);
+	argv[3] = NULL;
+
+	memset(&c, 0, sizeof(c));
+	c.op	= SLAP_CONFIG_ADD;
+	c.type	= PWDSHADOW_CFG_SUBTREE;
+	c.argc	= 3;
+	c.argv	= argv;
+	c.log	= "pwdshadow-ldif";
+	c.valx	= -1;
+	c.bi	= (BackendInfo *)&ld->ld_on;
+	if ((pwdshadow_cfg_gen(&c)))
+		fprintf(stderr, "pwdshadow-ldif: %s\n", c.cr_msg);
+	free(argv[1]);
+	free(argv[2]);
+
+	return( ((c.cr_msg[0])) ? 1 : 0 );
+}
+
+
+int
+ldif_tracked(
+		ldif_t *					ld )
+{
+	int						idx;
+	AttributeDescription *	ad;
+	pwdshadow_cfg_t *		cf;
+	pwdshadow_hash_t *		ha;
+
+	cf = pwdshadow_cfg_get(ld->ld_ps);
+
+	// attributes read from entries by the current configuration
+	ld->ld_attrs_count = 0;
+	for(idx = 0; ((pwdshadow_slots[idx].sl_ad)); idx++)
+	{
+		ad = *pwdshadow_slots[idx].sl_ad;
+		if (ad == ad_pwdShadowPolicySubentry)
+			ad = cf->cf_policy_ad;
+		if ( ((ha = pwdshadow_slot_find(cf, ad)) == NULL) || (!(ha->ha_scan & PWDSHADOW_SCAN_ENTRY)) )
+			continue;
+		ld->ld_attrs[ld->ld_attrs_count].la_ad		= ad;
+		ld->ld_attrs[ld->ld_attrs_count].la_flags	= (ad == cf->cf_policy_ad) ? LDIF_ATTR_DN : 0;
+		ld->ld_attrs_count++;
+	};
+
+	return(0);
+}
+
+
+void
+ldif_usage(
+		void )
+{
+	printf("Usage: pwdshadow-ldif [options] file.ldif\n");
+	printf("Options:\n");
+	printf("  -a attribute              attribute of an entry's password policy\n");
+	printf("  -c                        write only entries with generated changes\n");
+	printf("  -d dn                     DN of the default password policy\n");
+	printf("  -h                        print this help and exit\n");
+	printf("  -j threads                number of worker threads (default: online CPUs)\n");
+	printf("  -o file                   write LDIF to file (default: stdout)\n");
+	printf("  -p file                   load password policies from LDIF file\n");
+	printf("  -s 'suffix|policy'        password policy of entries within suffix\n");
+	printf("  -t epoch                  current time (default: time())\n");
+	printf("  -v                        print statistics to stderr\n");
+	printf("\n");
+	return;
+}
+
+
+int
+ldif_value(
+		ldif_worker_t *				lw,
+		ldif_line_t *				ln,
+		struct berval *				bv )
+{
+	size_t					pos;
+	size_t					len;
+	int						base64;
+	const char *			ptr;
+	char *					buff;
+
+	ptr		= &ln->ln_ptr[ln->ln_name + 1];
+	len		= ln->ln_len - ln->ln_name - 1;
+	base64	= 0;
+	if ( (len > 0) && (ptr[0] == '<') )
+		return(-1);
+	if ( (len > 0) && (ptr[0] == ':') )
+	{
+		base64 = 1;
+		ptr++;
+		len--;
+	};
+	for(; ( (len > 0) && (ptr[0] == ' ') ); ptr++, len--);
+
+	// unfold value into the record's buffer
+	buff = &lw->lw_buff[lw->lw_buff_len];
+	for(pos = 0, bv->bv_len = 0; pos < len; pos++)
+	{
+		if (ptr[pos] == '\n')
+		{
+			pos++;
+			continue;
+		};
+		if ( (ptr[pos] == '\r') && ((pos + 1) < len) && (ptr[pos+1] == '\n') )
+			continue;
+		buff[bv->bv_len++] = ptr[pos];
+	};
+	buff[bv->bv_len]	= '\0';
+	bv->bv_val			= buff;
+	if ( ((base64)) && ((ldif_decode(buff, &bv->bv_len))) )
+		return(-1);
+	lw->lw_buff_len += bv->bv_len + 1;
+
+	return(0);
+}
+
+
+void *
+ldif_worker(
+		void *						arg )
+{
+	size_t					pos;
+	size_t					start;
+	size_t					end;
+	size_t					rec;
+	unsigned long			seq;
+	ldif_t *				ld;
+	ldif_worker_t *			lw;
+	Operation *				op;
+
+	lw	= arg;
+	ld	= lw->lw_ld;
+	op	= &lw->lw_opbuf.ob_op;
+
+	stub_op_init(&lw->lw_opbuf);
+	op->o_bd					= &ld->ld_be;
+	op->o_dn					= ld->ld_be.be_rootdn;
+	op->o_ndn					= ld->ld_be.be_rootndn;
+	lw->lw_opbuf.ob_hdr.oh_threadctx = lw;
+
+	while(!(ldif_claim(ld, &start, &end, &seq)))
+	{
+		// transform records of chunk
+		lw->lw_out_len = 0;
+		for(pos = start; (ldif_next(ld->ld_map, end, ld->ld_crlf, &pos, &rec)); pos = rec)
+			ldif_record(lw, &ld->ld_map[pos], rec - pos);
+
+		// write chunks in the order of the input
+		pthread_mutex_lock(&ld->ld_mutex);
+		while(ld->ld_seq_out != seq)
+			pthread_cond_wait(&ld->ld_cond, &ld->ld_mutex);
+		if (fwrite(lw->lw_out, 1, lw->lw_out_len, ld->ld_out) != lw->lw_out_len)
+			ld->ld_error = 1;
+		ld->ld_seq_out++;
+		pthread_cond_broadcast(&ld->ld_cond);
+		pthread_mutex_unlock(&ld->ld_mutex);
+	};
+
+	return(NULL);
+}
+
+
+void
+ldif_worker_free(
+		ldif_worker_t *				lw )
+{
+	if ((lw->lw_out))
+		ch_free(lw->lw_out);
+	if ((lw->lw_buff))
+		ch_free(lw->lw_buff);
+	if ((lw->lw_dn))
+		ch_free(lw->lw_dn);
+	if ((lw->lw_lines))
+		ch_free(lw->lw_lines);
+	lw->lw_out		= NULL;
+	lw->lw_buff		= NULL;
+	lw->lw_dn		= NULL;
+	lw->lw_lines	= NULL;
+	return;
+}
+
+/* end of source file */
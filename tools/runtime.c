@@ -0,0 +1,769 @@
+/*
+ *  OpenLDAP pwdPolicy/shadowAccount Overlay
+ *  Copyright (c) 2023 David M. Syzdek <david@syzdek.net>
+ *  All rights reserved.
+ *
+ *  Dominus vobiscum. Et cum spiritu tuo.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted only as authorized by the OpenLDAP
+ *  Public License.
+ *
+ *  A copy of this license is available in the file LICENSE in the
+ *  top-level directory of the distribution or, alternatively, at
+ *  <http://www.OpenLDAP.org/license.html>.
+ */
+/*
+ *  Runtime of tools/ldif.c, which provides the database, DNs and attribute
+ *  types of slapd on top of the stub in bench/stub.c. Entries are stored in
+ *  a hash table keyed by their normalized DN which grows with the number of
+ *  policies. DNs are normalized as described by RFC 4514 for the attribute
+ *  types of the schema below: types are replaced by their primary name,
+ *  values are unescaped, insignificant spaces are removed, ASCII is
+ *  lowercased, multi-valued RDNs are sorted and the characters which
+ *  require it are escaped again. Unknown types are accepted and lowercased,
+ *  values which are not ASCII are compared exactly. Entries are added
+ *  before the workers of tools/ldif.c start, after which lookups may be made
+ *  by multiple threads.
+ */
+#include "portable.h"
+
+///////////////
+//           //
+//  Headers  //
+//           //
+///////////////
+
+#include <ctype.h>
+#include <stdint.h>
+#include <ldap.h>
+#include "slap.h"
+#include "../bench/stub.h"
+#include "runtime.h"
+
+
+///////////////////
+//               //
+//  Definitions  //
+//               //
+///////////////////
+
+// AVAs of a multi-valued RDN which are sorted without allocating
+#define RUNTIME_AVAS			8
+
+
+//////////////////
+//              //
+//  Data Types  //
+//              //
+//////////////////
+
+typedef struct runtime_at_t
+{
+	const char *			ra_oid;
+	const char *			ra_names[3];
+	const char *			ra_syntax;
+} runtime_at_t;
+
+
+//////////////////
+//              //
+//  Prototypes  //
+//              //
+//////////////////
+
+static const runtime_at_t *
+runtime_at_find(
+		const char *				name,
+		size_t						len );
+
+
+static int
+runtime_ava(
+		const char *				dn,
+		size_t						len,
+		size_t *					posp,
+		char *						out,
+		size_t *					olenp );
+
+
+static size_t
+runtime_escape(
+		char *						out,
+		size_t						olen,
+		int							first,
+		unsigned char				c );
+
+
+static size_t
+runtime_hash(
+		struct berval *				ndn );
+
+
+static int
+runtime_rdn_sort(
+		char *						rdn,
+		size_t *					avas,
+		size_t						count,
+		size_t						len );
+
+
+static int
+runtime_separator(
+		const char *				dn,
+		size_t						len,
+		size_t						pos );
+
+
+/////////////////
+//             //
+//  Variables  //
+//             //
+/////////////////
+
+// backend returned by select_backend()
+static BackendDB *			runtime_be				= NULL;
+
+// open addressed hash table of entries returned by be_entry_get_rw()
+static Entry **				runtime_entries			= NULL;
+static size_t				runtime_entries_count	= 0;
+static size_t				runtime_entries_size	= 0;
+
+// attribute types known to the tool, the types used in DNs are listed first
+// since normalization searches the table in order
+static const runtime_at_t	runtime_schema[] =
+{
+	// RFC 4519 and RFC 4524
+	{ "2.5.4.3",					{ "cn", "commonName", NULL },				"1.3.6.1.4.1.1466.115.121.1.15" },
+	{ "0.9.2342.19200300.100.1.1",	{ "uid", "userid", NULL },					"1.3.6.1.4.1.1466.115.121.1.15" },
+	{ "2.5.4.11",					{ "ou", "organizationalUnitName", NULL },	"1.3.6.1.4.1.1466.115.121.1.15" },
+	{ "0.9.2342.19200300.100.1.25",	{ "dc", "domainComponent", NULL },			"1.3.6.1.4.1.1466.115.121.1.26" },
+	{ "2.5.4.10",					{ "o", "organizationName", NULL },			"1.3.6.1.4.1.1466.115.121.1.15" },
+	{ "2.5.4.6",					{ "c", "countryName", NULL },				"1.3.6.1.4.1.1466.115.121.1.11" },
+	{ "2.5.4.7",					{ "l", "localityName", NULL },				"1.3.6.1.4.1.1466.115.121.1.15" },
+	{ "2.5.4.8",					{ "st", "stateOrProvinceName", NULL },		"1.3.6.1.4.1.1466.115.121.1.15" },
+	{ "2.5.4.9",					{ "street", "streetAddress", NULL },		"1.3.6.1.4.1.1466.115.121.1.15" },
+	{ "2.5.4.4",					{ "sn", "surname", NULL },					"1.3.6.1.4.1.1466.115.121.1.15" },
+	{ "2.5.4.42",					{ "givenName", "gn", NULL },				"1.3.6.1.4.1.1466.115.121.1.15" },
+	{ "0.9.2342.19200300.100.1.3",	{ "mail", "rfc822Mailbox", NULL },			"1.3.6.1.4.1.1466.115.121.1.26" },
+	{ "2.5.4.0",					{ "objectClass", NULL, NULL },				"1.3.6.1.4.1.1466.115.121.1.38" },
+	{ "2.5.4.13",					{ "description", NULL, NULL },				"1.3.6.1.4.1.1466.115.121.1.15" },
+	{ "2.5.4.35",					{ "userPassword", NULL, NULL },				"1.3.6.1.4.1.1466.115.121.1.40" },
+	{ "2.5.18.2",					{ "modifyTimestamp", NULL, NULL },			"1.3.6.1.4.1.1466.115.121.1.24" },
+
+	// slapo-ppolicy
+	{ "1.3.6.1.4.1.42.2.27.8.1.16",	{ "pwdChangedTime", NULL, NULL },			"1.3.6.1.4.1.1466.115.121.1.24" },
+	{ "1.3.6.1.4.1.42.2.27.8.1.28",	{ "pwdEndTime", NULL, NULL },				"1.3.6.1.4.1.1466.115.121.1.24" },
+	{ "1.3.6.1.4.1.42.2.27.8.1.7",	{ "pwdExpireWarning", NULL, NULL },			SLAPD_INTEGER_SYNTAX },
+	{ "1.3.6.1.4.1.42.2.27.8.1.30",	{ "pwdGraceExpiry", NULL, NULL },			SLAPD_INTEGER_SYNTAX },
+	{ "1.3.6.1.4.1.42.2.27.8.1.3",	{ "pwdMaxAge", NULL, NULL },				SLAPD_INTEGER_SYNTAX },
+	{ "1.3.6.1.4.1.42.2.27.8.1.2",	{ "pwdMinAge", NULL, NULL },				SLAPD_INTEGER_SYNTAX },
+	{ "1.3.6.1.4.1.42.2.27.8.1.23",	{ "pwdPolicySubentry", NULL, NULL },		SLAPD_DN_SYNTAX },
+
+	// RFC 2307
+	{ "1.3.6.1.1.1.1.0",			{ "uidNumber", NULL, NULL },				SLAPD_INTEGER_SYNTAX },
+	{ "1.3.6.1.1.1.1.1",			{ "gidNumber", NULL, NULL },				SLAPD_INTEGER_SYNTAX },
+	{ "1.3.6.1.1.1.1.3",			{ "homeDirectory", NULL, NULL },			"1.3.6.1.4.1.1466.115.121.1.26" },
+	{ "1.3.6.1.1.1.1.4",			{ "loginShell", NULL, NULL },				"1.3.6.1.4.1.1466.115.121.1.26" },
+	{ "1.3.6.1.1.1.1.10",			{ "shadowExpire", NULL, NULL },				SLAPD_INTEGER_SYNTAX },
+	{ "1.3.6.1.1.1.1.11",			{ "shadowFlag", NULL, NULL },				SLAPD_INTEGER_SYNTAX },
+	{ "1.3.6.1.1.1.1.9",			{ "shadowInactive", NULL, NULL },			SLAPD_INTEGER_SYNTAX },
+	{ "1.3.6.1.1.1.1.5",			{ "shadowLastChange", NULL, NULL },			SLAPD_INTEGER_SYNTAX },
+	{ "1.3.6.1.1.1.1.7",			{ "shadowMax", NULL, NULL },				SLAPD_INTEGER_SYNTAX },
+	{ "1.3.6.1.1.1.1.6",			{ "shadowMin", NULL, NULL },				SLAPD_INTEGER_SYNTAX },
+	{ "1.3.6.1.1.1.1.8",			{ "shadowWarning", NULL, NULL },			SLAPD_INTEGER_SYNTAX },
+
+	{ NULL, { NULL, NULL, NULL }, NULL }
+};
+
+
+/////////////////
+//             //
+//  Functions  //
+//             //
+/////////////////
+
+int
+be_entry_get_rw(
+		Operation *					op,
+		struct berval *				ndn,
+		ObjectClass *				oc,
+		AttributeDescription *		at,
+		int							rw,
+		Entry **					e )
+{
+	size_t			slot;
+	size_t			mask;
+
+	if ((runtime_entries_size))
+	{
+		mask = runtime_entries_size - 1;
+		for(slot = runtime_hash(ndn) & mask; ((runtime_entries[slot])); slot = (slot + 1) & mask)
+		{
+			if (!(bvmatch(&runtime_entries[slot]->e_nname, ndn)))
+				continue;
+			*e = runtime_entries[slot];
+			return(LDAP_SUCCESS);
+		};
+	};
+
+	if ( (!(op)) || ((oc)) || ((at)) || ((rw)) )
+		return(LDAP_NO_SUCH_OBJECT);
+	return(LDAP_NO_SUCH_OBJECT);
+}
+
+
+int
+be_entry_release_r(
+		Operation *					op,
+		Entry *						e )
+{
+	if ( (!(op)) || (!(e)) )
+		return(0);
+	return(0);
+}
+
+
+int
+dnIsSuffix(
+		struct berval *				dn,
+		struct berval *				suffix )
+{
+	ber_len_t		off;
+
+	if (dn->bv_len < suffix->bv_len)
+		return(0);
+	if (!(suffix->bv_len))
+		return(1);
+	off = dn->bv_len - suffix->bv_len;
+	if ( ((off)) && (!(runtime_separator(dn->bv_val, dn->bv_len, off - 1))) )
+		return(0);
+	return(!(memcmp(&dn->bv_val[off], suffix->bv_val, suffix->bv_len)));
+}
+
+
+int
+dnNormalize(
+		slap_mask_t					use,
+		Syntax *					syntax,
+		MatchingRule *				mr,
+		struct berval *				val,
+		struct berval *				out,
+		void *						ctx )
+{
+	size_t			len;
+
+	out->bv_val = ch_malloc(runtime_dn_size(val->bv_val, val->bv_len));
+	if (runtime_dn_normalize(val->bv_val, val->bv_len, out->bv_val, &len) != LDAP_SUCCESS)
+	{
+		ch_free(out->bv_val);
+		BER_BVZERO(out);
+		return(LDAP_INVALID_DN_SYNTAX);
+	};
+	out->bv_len = len;
+
+	if ( ((use)) || ((syntax)) || ((mr)) || ((ctx)) )
+		return(LDAP_SUCCESS);
+	return(LDAP_SUCCESS);
+}
+
+
+void
+dnParent(
+		struct berval *				dn,
+		struct berval *				pdn )
+{
+	ber_len_t		pos;
+
+	// escaped separators are part of a value
+	for(pos = 0; pos < dn->bv_len; pos++)
+	{
+		if (dn->bv_val[pos] == '\\')
+		{
+			pos++;
+			continue;
+		};
+		if (dn->bv_val[pos] == ',')
+			break;
+	};
+	if (pos >= dn->bv_len)
+	{
+		pdn->bv_val = &dn->bv_val[dn->bv_len];
+		pdn->bv_len = 0;
+		return;
+	};
+	pdn->bv_val = &dn->bv_val[pos + 1];
+	pdn->bv_len = dn->bv_len - pos - 1;
+	return;
+}
+
+
+const runtime_at_t *
+runtime_at_find(
+		const char *				name,
+		size_t						len )
+{
+	int						idx;
+	int						alias;
+	int						oid;
+	const char *			str;
+
+	// OIDs may be prefixed with "oid." as allowed by RFC 4512
+	if ( (len > 4) && (!(strncasecmp(name, "oid.", 4))) && (isdigit((unsigned char)name[4])) )
+	{
+		name	+= 4;
+		len		-= 4;
+	};
+
+	oid = isdigit((unsigned char)name[0]);
+	for(idx = 0; ((runtime_schema[idx].ra_oid)); idx++)
+	{
+		if ((oid))
+		{
+			if ( (!(strncmp(runtime_schema[idx].ra_oid, name, len))) && (!(runtime_schema[idx].ra_oid[len])) )
+				return(&runtime_schema[idx]);
+			continue;
+		};
+		for(alias = 0; ( (alias < 3) && ((str = runtime_schema[idx].ra_names[alias]) != NULL) ); alias++)
+			if ( (tolower((unsigned char)str[0]) == tolower((unsigned char)name[0])) && (!(strncasecmp(str, name, len))) && (!(str[len])) )
+				return(&runtime_schema[idx]);
+	};
+
+	return(NULL);
+}
+
+
+// parses the AVA at *posp, writes "type=value" at &out[*olenp] and leaves
+// *posp at the separator which follows the AVA
+int
+runtime_ava(
+		const char *				dn,
+		size_t						len,
+		size_t *					posp,
+		char *						out,
+		size_t *					olenp )
+{
+	size_t					pos;
+	size_t					olen;
+	size_t					start;
+	size_t					type;
+	size_t					value;
+	int						quoted;
+	int						space;
+	unsigned char			c;
+	char					name[RUNTIME_NAME_MAX + 1];
+	char					pair[3];
+	const char *			str;
+	const runtime_at_t *	at;
+	AttributeDescription *	ad;
+
+	pos		= *posp;
+	olen	= *olenp;
+
+	// attribute type is a descriptor or a numeric OID
+	for(; ( (pos < len) && (dn[pos] == ' ') ); pos++);
+	for(start = pos; ( (pos < len) && ( (isalnum((unsigned char)dn[pos])) || (dn[pos] == '-') || (dn[pos] == '.') ) ); pos++);
+	if ((type = pos - start) == 0)
+		return(-1);
+	for(; ( (pos < len) && (dn[pos] == ' ') ); pos++);
+	if ( (pos >= len) || (dn[pos] != '=') )
+		return(-1);
+	for(pos++; ( (pos < len) && (dn[pos] == ' ') ); pos++);
+
+	// known types are written with their primary name
+	str = NULL;
+	if ((at = runtime_at_find(&dn[start], type)) != NULL)
+		str = at->ra_names[0];
+	if ( (!(str)) && (type <= RUNTIME_NAME_MAX) )
+	{
+		memcpy(name, &dn[start], type);
+		name[type] = '\0';
+		if ((ad = stub_ad_find(name)) != NULL)
+			str = ad->ad_cname.bv_val;
+	};
+	if ( ((str)) && (strlen(str) <= RUNTIME_NAME_MAX) )
+	{
+		memcpy(&out[olen], str, strlen(str));
+		olen += strlen(str);
+	} else {
+		for(; type > 0; start++, type--)
+			out[olen++] = (char)tolower((unsigned char)dn[start]);
+	};
+	out[olen++] = '=';
+
+	// hexadecimal BER encoding of the value is compared as written
+	if ( (pos < len) && (dn[pos] == '#') )
+	{
+		out[olen++] = '#';
+		for(start = ++pos; ( (pos < len) && (isxdigit((unsigned char)dn[pos])) ); pos++)
+			out[olen++] = (char)tolower((unsigned char)dn[pos]);
+		if ( (pos == start) || (((pos - start) % 2)) )
+			return(-1);
+		for(; ( (pos < len) && (dn[pos] == ' ') ); pos++);
+		if ( (pos < len) && (dn[pos] != ',') && (dn[pos] != ';') && (dn[pos] != '+') )
+			return(-1);
+		*posp	= pos;
+		*olenp	= olen;
+		return(0);
+	};
+
+	// string value is unescaped, spaces are collapsed and trimmed and ASCII
+	// is lowercased before the value is escaped again
+	quoted = 0;
+	if ( (pos < len) && (dn[pos] == '"') )
+	{
+		quoted = 1;
+		pos++;
+	};
+	for(value = olen, space = 0; pos < len; pos++)
+	{
+		c = (unsigned char)dn[pos];
+		if ( ((quoted)) && (c == '"') )
+		{
+			quoted = 2;
+			pos++;
+			break;
+		};
+		if ( (!(quoted)) && ( (c == ',') || (c == ';') || (c == '+') ) )
+			break;
+		if (c == '\\')
+		{
+			if ((pos + 1) >= len)
+				return(-1);
+			c = (unsigned char)dn[++pos];
+			if ((isxdigit(c)))
+			{
+				if ( ((pos + 1) >= len) || (!(isxdigit((unsigned char)dn[pos+1]))) )
+					return(-1);
+				pair[0]	= dn[pos++];
+				pair[1]	= dn[pos];
+				pair[2]	= '\0';
+				c		= (unsigned char)strtoul(pair, NULL, 16);
+			}
+			else if ( (!(c)) || (!(strchr(" \"#+,;<=>\\", c))) )
+				return(-1);
+		};
+		if (c == ' ')
+		{
+			space = (olen > value);
+			continue;
+		};
+		if ((space))
+			out[olen++] = ' ';
+		space	= 0;
+		olen	= runtime_escape(out, olen, (olen == value), c);
+	};
+	if (quoted == 1)
+		return(-1);
+	if (quoted == 2)
+	{
+		for(; ( (pos < len) && (dn[pos] == ' ') ); pos++);
+		if ( (pos < len) && (dn[pos] != ',') && (dn[pos] != ';') && (dn[pos] != '+') )
+			return(-1);
+	};
+
+	*posp	= pos;
+	*olenp	= olen;
+
+	return(0);
+}
+
+
+int
+runtime_backend(
+		BackendDB *					be )
+{
+	runtime_be = be;
+	return(0);
+}
+
+
+void
+runtime_destroy(
+		void )
+{
+	size_t			slot;
+
+	for(slot = 0; slot < runtime_entries_size; slot++)
+		if ((runtime_entries[slot]))
+			stub_entry_free(runtime_entries[slot]);
+	ch_free(runtime_entries);
+	runtime_entries			= NULL;
+	runtime_entries_count	= 0;
+	runtime_entries_size	= 0;
+	return;
+}
+
+
+// normalizes the DN into out, which must hold runtime_dn_size() bytes
+int
+runtime_dn_normalize(
+		const char *				dn,
+		size_t						len,
+		char *						out,
+		size_t *					lenp )
+{
+	int				rc;
+	size_t			pos;
+	size_t			olen;
+	size_t			rdn;
+	size_t			count;
+	size_t			size;
+	size_t *		avas;
+	size_t *		grown;
+	size_t			buff[RUNTIME_AVAS];
+
+	for(pos = 0; ( (pos < len) && (dn[pos] == ' ') ); pos++);
+	avas	= buff;
+	size	= RUNTIME_AVAS;
+	olen	= 0;
+	rc		= LDAP_SUCCESS;
+
+	// RDNs are separated by ',' or ';' and AVAs of an RDN by '+'
+	while ( (pos < len) && (rc == LDAP_SUCCESS) )
+	{
+		for(rdn = olen, count = 0; (rc == LDAP_SUCCESS); pos++)
+		{
+			if (count >= size)
+			{
+				grown = ch_malloc(sizeof(size_t) * size * 2);
+				memcpy(grown, avas, sizeof(size_t) * size);
+				if (avas != buff)
+					ch_free(avas);
+				avas	 = grown;
+				size	*= 2;
+			};
+			avas[count++] = olen - rdn;
+			if ((runtime_ava(dn, len, &pos, out, &olen)))
+				rc = LDAP_INVALID_DN_SYNTAX;
+			if ( (pos >= len) || (dn[pos] != '+') )
+				break;
+			out[olen++] = '+';
+		};
+		if ( (rc == LDAP_SUCCESS) && (count > 1) )
+			runtime_rdn_sort(&out[rdn], avas, count, olen - rdn);
+		if (pos >= len)
+			break;
+
+		// separator must be followed by another RDN
+		out[olen++] = ',';
+		if (++pos >= len)
+			rc = LDAP_INVALID_DN_SYNTAX;
+	};
+	if (avas != buff)
+		ch_free(avas);
+
+	out[olen]	= '\0';
+	*lenp		= olen;
+
+	return(rc);
+}
+
+
+// bytes required to normalize the DN, escaping a character writes at most
+// three bytes and each type may be replaced by a longer primary name
+size_t
+runtime_dn_size(
+		const char *				dn,
+		size_t						len )
+{
+	size_t			pos;
+	size_t			types;
+
+	for(pos = 0, types = 0; pos < len; pos++)
+		if (dn[pos] == '=')
+			types++;
+
+	return((len * 3) + (types * RUNTIME_NAME_MAX) + 1);
+}
+
+
+// adds an entry with a normalized DN, entries are freed by runtime_destroy()
+int
+runtime_entry_add(
+		Entry *						e )
+{
+	size_t			slot;
+	size_t			size;
+	size_t			mask;
+	size_t			idx;
+	Entry **		entries;
+
+	// table is kept at most half full
+	if (((runtime_entries_count + 1) * 2) > runtime_entries_size)
+	{
+		size	= ((runtime_entries_size)) ? runtime_entries_size * 2 : 64;
+		mask	= size - 1;
+		entries	= ch_calloc(size, sizeof(Entry *));
+		for(slot = 0; slot < runtime_entries_size; slot++)
+		{
+			if (!(runtime_entries[slot]))
+				continue;
+			for(idx = runtime_hash(&runtime_entries[slot]->e_nname) & mask; ((entries[idx])); idx = (idx + 1) & mask);
+			entries[idx] = runtime_entries[slot];
+		};
+		ch_free(runtime_entries);
+		runtime_entries			= entries;
+		runtime_entries_size	= size;
+	};
+
+	mask = runtime_entries_size - 1;
+	for(slot = runtime_hash(&e->e_nname) & mask; ((runtime_entries[slot])); slot = (slot + 1) & mask)
+		if ((bvmatch(&runtime_entries[slot]->e_nname, &e->e_nname)))
+			return(-1);
+	runtime_entries[slot] = e;
+	runtime_entries_count++;
+
+	return(0);
+}
+
+
+// writes the character of a value, escaping characters as RFC 4514
+// requires and control characters as hexadecimal pairs
+size_t
+runtime_escape(
+		char *						out,
+		size_t						olen,
+		int							first,
+		unsigned char				c )
+{
+	static const char *		hex = "0123456789abcdef";
+
+	if ( (c < 0x20) || (c == 0x7f) )
+	{
+		out[olen++] = '\\';
+		out[olen++] = hex[c >> 4];
+		out[olen++] = hex[c & 0x0f];
+		return(olen);
+	};
+	if ( ((strchr(",+\"\\<>;", c))) || ( ((first)) && (c == '#') ) )
+		out[olen++] = '\\';
+	out[olen++] = (char)tolower(c);
+
+	return(olen);
+}
+
+
+// FNV-1a of the normalized DN
+size_t
+runtime_hash(
+		struct berval *				ndn )
+{
+	ber_len_t		pos;
+	uint64_t		hash;
+
+	for(pos = 0, hash = 14695981039346656037ULL; pos < ndn->bv_len; pos++)
+	{
+		hash ^= (unsigned char)ndn->bv_val[pos];
+		hash *= 1099511628211ULL;
+	};
+
+	return((size_t)hash);
+}
+
+
+// sorts the AVAs of an RDN, avas holds the offset of each AVA within rdn
+int
+runtime_rdn_sort(
+		char *						rdn,
+		size_t *					avas,
+		size_t						count,
+		size_t						len )
+{
+	int				cmp;
+	size_t			idx;
+	size_t			pos;
+	size_t			off;
+	size_t			olen;
+	size_t *		lens;
+	char *			copy;
+
+	// AVAs end with the '+' which precedes the next AVA
+	copy = ch_malloc(len);
+	lens = ch_malloc(sizeof(size_t) * count);
+	memcpy(copy, rdn, len);
+	for(idx = 0; idx < count; idx++)
+		lens[idx] = (((idx + 1) < count) ? avas[idx+1] - 1 : len) - avas[idx];
+
+	// insertion sort by the bytes of "type=value"
+	for(idx = 1; idx < count; idx++)
+	{
+		off		= avas[idx];
+		olen	= lens[idx];
+		for(pos = idx; pos > 0; pos--)
+		{
+			cmp = memcmp(&copy[avas[pos-1]], &copy[off], (lens[pos-1] < olen) ? lens[pos-1] : olen);
+			if ( (cmp < 0) || ( (cmp == 0) && (lens[pos-1] <= olen) ) )
+				break;
+			avas[pos] = avas[pos-1];
+			lens[pos] = lens[pos-1];
+		};
+		avas[pos] = off;
+		lens[pos] = olen;
+	};
+
+	for(idx = 0, pos = 0; idx < count; idx++)
+	{
+		if ((idx))
+			rdn[pos++] = '+';
+		memcpy(&rdn[pos], &copy[avas[idx]], lens[idx]);
+		pos += lens[idx];
+	};
+	ch_free(copy);
+	ch_free(lens);
+
+	return(0);
+}
+
+
+// whether the character at pos is a ',' which is not escaped
+int
+runtime_separator(
+		const char *				dn,
+		size_t						len,
+		size_t						pos )
+{
+	size_t			idx;
+
+	if ( (pos >= len) || (dn[pos] != ',') )
+		return(0);
+	for(idx = pos; ( (idx > 0) && (dn[idx-1] == '\\') ); idx--);
+
+	return(!((pos - idx) % 2));
+}
+
+
+BackendDB *
+select_backend(
+		struct berval *				dn,
+		int							noSubordinates )
+{
+	if ( (!(dn)) || ((noSubordinates)) )
+		return(runtime_be);
+	return(runtime_be);
+}
+
+
+int
+slap_str2ad(
+		const char *				name,
+		AttributeDescription **		ad,
+		const char **				text )
+{
+	const runtime_at_t *	at;
+
+	*text = NULL;
+
+	// aliases and OIDs resolve to the primary name of the type
+	if ((at = runtime_at_find(name, strlen(name))) != NULL)
+		name = at->ra_names[0];
+	if ((*ad = stub_ad_find(name)) != NULL)
+		return(LDAP_SUCCESS);
+	if ( ((at)) && ((*ad = stub_ad_new(name, strlen(name), at->ra_syntax, 0)) != NULL) )
+		return(LDAP_SUCCESS);
+
+	*text = "attribute type undefined";
+	return(LDAP_UNDEFINED_TYPE);
+}
+
+/* end of source file */
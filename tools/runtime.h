@@ -0,0 +1,46 @@
+/*
+ *  OpenLDAP pwdPolicy/shadowAccount Overlay
+ *  Copyright (c) 2023 David M. Syzdek <david@syzdek.net>
+ *  All rights reserved.
+ *
+ *  Dominus vobiscum. Et cum spiritu tuo.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted only as authorized by the OpenLDAP
+ *  Public License.
+ *
+ *  A copy of this license is available in the file LICENSE in the
+ *  top-level directory of the distribution or, alternatively, at
+ *  <http://www.OpenLDAP.org/license.html>.
+ */
+/*
+ *  Interfaces of the runtime of tools/ldif.c, which provides the database,
+ *  DNs and attribute types of slapd in place of bench/backend.c.
+ */
+#ifndef _PWDSHADOW_RUNTIME_H
+#define _PWDSHADOW_RUNTIME_H 1
+
+
+///////////////////
+//               //
+//  Definitions  //
+//               //
+///////////////////
+
+// longest attribute type which replaces a type of a DN
+#define RUNTIME_NAME_MAX		64
+
+
+//////////////////
+//              //
+//  Prototypes  //
+//              //
+//////////////////
+
+extern int			runtime_backend( BackendDB * be );
+extern void			runtime_destroy( void );
+extern int			runtime_dn_normalize( const char * dn, size_t len, char * out, size_t * lenp );
+extern size_t		runtime_dn_size( const char * dn, size_t len );
+extern int			runtime_entry_add( Entry * e );
+
+#endif /* end of header */